@@ -0,0 +1,361 @@
+#include "AnimationPlayer.h"
+
+#include "Log.h"
+
+static uint16_t get16(const uint8_t* in) {
+    return in[0] | (in[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+// Frame count of a valid header, 0 otherwise
+static uint16_t parseFileHeader(const uint8_t* in) {
+    if (memcmp(in, "FCAN", 4) != 0 || in[4] != ANIMATION_VERSION ||
+        get16(in + 6) != MATRIX_WIDTH || get16(in + 8) != MATRIX_HEIGHT) {
+        return 0;
+    }
+    return get16(in + 10);
+}
+
+AnimationPlayer::AnimationPlayer(MatrixDisplayManager* display, SettingsManager* settings)
+    : display(display),
+      settings(settings),
+      opened(false),
+      loaded(false),
+      frameCount(0),
+      currentFrame(0),
+      frameDelayUs(0),
+      clockUs(0),
+      stats{},
+      readPos(0),
+      readEnd(0),
+      layer{},
+      lutBrightnessIndex(-1) {}
+
+void AnimationPlayer::tick(uint32_t stepUs) {
+    if (loaded) {
+        clockUs += stepUs;
+    }
+}
+
+void AnimationPlayer::render() {
+    if (!opened) {
+        open();
+    }
+    if (!loaded) {
+        return;
+    }
+    updateLut();
+
+    // Decode every frame that is due; only the newest is drawn, in the same pass
+    bool drawn = false;
+    int decoded = 0;
+    while (loaded && clockUs >= frameDelayUs) {
+        clockUs -= frameDelayUs;
+        if (decoded == ANIMATION_MAX_CATCHUP) {
+            // Too far behind to decode every delta: jump to a key frame that is due by now,
+            // judging by the current frame's delay, or else let the animation run late
+            uint32_t due = clockUs / frameDelayUs + 1;
+            if (!skipToKeyFrame(min(due, (uint32_t)16)) && loaded) {
+                clockUs = 0;
+                stats.late++;
+            }
+        }
+        if (currentFrame == frameCount - 1) {
+            if (!seekFrame(0)) {
+                break;
+            }
+            if (stats.frames > 0) {
+                stats.loops++;
+            }
+        }
+
+        uint32_t start = micros();
+        uint64_t readBefore = stats.readUs;
+        uint16_t length, delayMs;
+        if (!readChunkHeader(length, delayMs)) {
+            break;
+        }
+        frameDelayUs = max(delayMs, (uint16_t)ANIMATION_MIN_DELAY_MS) * 1000UL;
+        bool last = clockUs < frameDelayUs;
+        if (!decodeFrame(length, last)) {
+            break;
+        }
+        currentFrame = (currentFrame + 1) % frameCount;
+        stats.decodeUs += (micros() - start) - (stats.readUs - readBefore);
+        drawn = last;
+        decoded++;
+    }
+
+    if (loaded && !drawn) {
+        for (int row = 0; row < MATRIX_HEIGHT; row++) {
+            compositeRow(row);
+        }
+        stats.redrawn++;
+    }
+}
+
+void AnimationPlayer::install() {
+    close();
+    LittleFS.remove(ANIMATION_PATH);
+    if (!LittleFS.rename(ANIMATION_UPLOAD_PATH, ANIMATION_PATH)) {
+        LOG_ERROR("AnimationPlayer: could not install the upload");
+    }
+    opened = false;  // Opened again on the next render
+}
+
+void AnimationPlayer::remove() {
+    close();
+    LittleFS.remove(ANIMATION_PATH);
+    opened = false;
+}
+
+bool AnimationPlayer::validate(const char* path) {
+    File in = LittleFS.open(path, "r");
+    if (!in) {
+        return false;
+    }
+    size_t size = in.size();
+    uint8_t header[ANIMATION_HEADER_SIZE];
+    uint16_t frames = 0;
+    if (in.read(header, sizeof(header)) == sizeof(header)) {
+        frames = parseFileHeader(header);
+    }
+    size_t first = ANIMATION_HEADER_SIZE + frames * 4;
+    if (frames == 0 || size < first) {
+        return false;
+    }
+
+    // Chunks follow each other in index order up to the end of the file, starting with a key
+    // frame; each chunk is read back at its offset to check its length
+    size_t expected = first;
+    for (uint16_t frame = 0; frame < frames; frame++) {
+        uint8_t entry[4];
+        uint8_t chunk[ANIMATION_CHUNK_HEADER_SIZE];
+        if (!in.seek(ANIMATION_HEADER_SIZE + frame * 4) || in.read(entry, 4) != 4) {
+            return false;
+        }
+        uint32_t offset = get32(entry);
+        if ((offset & ~ANIMATION_INDEX_KEY) != expected ||
+            (frame == 0 && !(offset & ANIMATION_INDEX_KEY)) || !in.seek(expected) ||
+            in.read(chunk, sizeof(chunk)) != sizeof(chunk)) {
+            return false;
+        }
+        expected += ANIMATION_CHUNK_HEADER_SIZE + get16(chunk);
+    }
+    return expected == size;
+}
+
+uint32_t AnimationPlayer::getReadBandwidth() const {
+    return stats.readUs ? stats.bytesRead * 1000000ULL / stats.readUs : 0;
+}
+
+uint32_t AnimationPlayer::getMaxFps() const {
+    uint64_t us = stats.readUs + stats.decodeUs;
+    return us ? stats.frames * 1000000ULL / us : 0;
+}
+
+void AnimationPlayer::open() {
+    opened = true;
+    if (!LittleFS.exists(ANIMATION_PATH)) {
+        return;
+    }
+    file = LittleFS.open(ANIMATION_PATH, "r");
+    uint8_t header[ANIMATION_HEADER_SIZE];
+    if (!file || file.read(header, sizeof(header)) != sizeof(header)) {
+        fail("could not read the header");
+        return;
+    }
+    frameCount = parseFileHeader(header);
+    if (frameCount == 0) {
+        fail("not an animation for this panel");
+        return;
+    }
+
+    // Frame 0 is due on the first render, as if the last frame had just finished
+    stats = {};
+    currentFrame = frameCount - 1;
+    frameDelayUs = 0;
+    clockUs = 0;
+    loaded = true;
+    LOG_INFO("AnimationPlayer: playing %d frames, %u bytes", frameCount, file.size());
+}
+
+void AnimationPlayer::close() {
+    if (file) {
+        file.close();
+    }
+    loaded = false;
+}
+
+void AnimationPlayer::fail(const char* reason) {
+    LOG_WARN("AnimationPlayer: stopped, %s", reason);
+    close();
+}
+
+bool AnimationPlayer::fill(size_t needed) {
+    if (readEnd - readPos >= needed) {
+        return true;
+    }
+    memmove(readAhead, readAhead + readPos, readEnd - readPos);
+    readEnd -= readPos;
+    readPos = 0;
+
+    // Always a full buffer, so reads stay large however small the rows are
+    uint32_t start = micros();
+    int got = file.read(readAhead + readEnd, ANIMATION_READ_AHEAD - readEnd);
+    stats.readUs += micros() - start;
+    if (got > 0) {
+        readEnd += got;
+        stats.bytesRead += got;
+    }
+    return readEnd - readPos >= needed;
+}
+
+bool AnimationPlayer::readIndex(uint16_t frame, uint32_t* entries, int count) {
+    uint8_t in[4 * 16];
+    count = min(count, (int)(sizeof(in) / 4));
+    uint32_t start = micros();
+    bool ok = file.seek(ANIMATION_HEADER_SIZE + frame * 4) &&
+              file.read(in, count * 4) == (size_t)count * 4;
+    stats.readUs += micros() - start;
+    if (!ok) {
+        fail("could not read the index");
+        return false;
+    }
+    stats.bytesRead += count * 4;
+    for (int i = 0; i < count; i++) {
+        entries[i] = get32(in + i * 4);
+    }
+    return true;
+}
+
+bool AnimationPlayer::seekFrame(uint16_t frame) {
+    uint32_t entry;
+    if (!readIndex(frame, &entry, 1)) {
+        return false;
+    }
+    if (!file.seek(entry & ~ANIMATION_INDEX_KEY)) {
+        fail("could not seek");
+        return false;
+    }
+    readPos = readEnd = 0;
+    return true;
+}
+
+bool AnimationPlayer::skipToKeyFrame(uint16_t due) {
+    uint16_t next = (currentFrame + 1) % frameCount;
+    int count = min((int)due, min(16, frameCount - next));
+    uint32_t entries[16];
+    size_t resume = file.position();  // Where the read-ahead continues
+    if (!readIndex(next, entries, count)) {
+        return false;
+    }
+    int key = -1;
+    for (int i = 0; i < count; i++) {
+        if (entries[i] & ANIMATION_INDEX_KEY) {
+            key = i;
+        }
+    }
+    if (key <= 0) {
+        // None due, or the next frame is one anyway
+        if (!file.seek(resume)) {
+            fail("could not seek");
+        }
+        return false;
+    }
+
+    stats.skipped += key;
+    clockUs -= key * frameDelayUs;
+    currentFrame = next + key - 1;
+    return seekFrame(next + key);
+}
+
+bool AnimationPlayer::readChunkHeader(uint16_t& length, uint16_t& delayMs) {
+    if (!fill(ANIMATION_CHUNK_HEADER_SIZE)) {
+        fail("truncated chunk");
+        return false;
+    }
+    length = get16(readAhead + readPos);
+    delayMs = get16(readAhead + readPos + 2);
+    readPos += ANIMATION_CHUNK_HEADER_SIZE;
+    return true;
+}
+
+bool AnimationPlayer::decodeFrame(size_t length, bool composite) {
+    // The header, row mask and palette come first; the read-ahead holds them whole
+    size_t head = min(length, (size_t)ANIMATION_READ_AHEAD);
+    if (!fill(head) || !FrameCodec::parseHeader(readAhead + readPos, head, MATRIX_WIDTH,
+                                                  MATRIX_HEIGHT, frameHeader)) {
+        fail("corrupt frame header");
+        return false;
+    }
+    readPos += frameHeader.size;
+    size_t remaining = length - frameHeader.size;
+
+    for (int row = 0; row < MATRIX_HEIGHT; row++) {
+        if (frameHeader.isRowCoded(row)) {
+            if (remaining < 2 || !fill(2)) {
+                fail("truncated frame");
+                return false;
+            }
+            size_t rowLength = get16(readAhead + readPos);
+            if (rowLength + 2 > remaining || rowLength + 2 > ANIMATION_READ_AHEAD ||
+                !fill(rowLength + 2) ||
+                !FrameCodec::decodeRow(frameHeader, readAhead + readPos + 2, rowLength,
+                                       layer[row])) {
+                fail("corrupt frame");
+                return false;
+            }
+            readPos += rowLength + 2;
+            remaining -= rowLength + 2;
+        } else if (!frameHeader.delta) {
+            memset(layer[row], 0, sizeof(layer[row]));
+        }
+        if (composite) {
+            compositeRow(row);
+        }
+    }
+    if (remaining != 0) {
+        fail("frame longer than its rows");
+        return false;
+    }
+    stats.frames++;
+    return true;
+}
+
+// Copies a layer row onto the canvas like plotEffectPixel() does, through the tables
+void AnimationPlayer::compositeRow(int row) {
+    const uint16_t* in = layer[row];
+    uint16_t* out = display->getFrameBuffer() + row * MATRIX_WIDTH;
+    for (int x = 0; x < MATRIX_WIDTH; x++) {
+        uint8_t level = display->getTextHaloLevel(x, row);
+        if (level == 0) {
+            continue;
+        }
+        uint16_t color = in[x];
+        color = lutR[color >> 11] | lutG[(color >> 5) & 0x3F] | lutB[color & 0x1F];
+        out[x] = level == 255 ? color : display->fadeColor(color, level);
+    }
+}
+
+void AnimationPlayer::updateLut() {
+    int brightnessIndex = settings->getBrightnessIndex();
+    if (brightnessIndex == lutBrightnessIndex) {
+        return;
+    }
+
+    // Same level as applyEffectBrightness(): one step above the setting, up to the maximum
+    float brightness = display->getBrightnessLevels()[min(brightnessIndex + 1,
+                                                          BRIGHTNESS_LEVELS - 1)];
+    for (int i = 0; i < 32; i++) {
+        lutR[i] = (uint16_t)(i * brightness) << 11;
+        lutB[i] = (uint16_t)(i * brightness);
+    }
+    for (int i = 0; i < 64; i++) {
+        lutG[i] = (uint16_t)(i * brightness) << 5;
+    }
+    lutBrightnessIndex = brightnessIndex;
+}
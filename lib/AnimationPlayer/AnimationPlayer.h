@@ -0,0 +1,120 @@
+#ifndef ANIMATION_PLAYER_H
+#define ANIMATION_PLAYER_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "FrameCodec.h"
+#include "MatrixDisplayManager.h"
+#include "SettingsManager.h"
+
+// Background animation streamed from LittleFS, played behind the clock as EFFECT_ANIMATION.
+// Files are made from GIFs by tools/frame_codec.py convert and uploaded with POST /animation.
+//
+// File (little endian):
+//   magic "FCAN" (4), version (1), flags (1, 0), width (2), height (2), frame count (2),
+//   reserved (4)
+//   index: frame count offsets (4 each) of the frame chunks, bit 31 set on key frames
+//   frame chunks: frame length (2), delay in ms (2), one FrameCodec frame
+//
+// Chunks are read in order through a small read-ahead buffer and decoded row by row into the
+// layer, which holds the last frame for the next delta. As each row is decoded it is copied
+// onto the canvas through brightness lookup tables, leaving out the text clearance and fading
+// the halo like the other effects. The index is only read to loop and to skip ahead to a key
+// frame when playback falls behind.
+#define ANIMATION_PATH "/animation.fca"
+#define ANIMATION_UPLOAD_PATH "/animation.tmp"
+#ifndef ANIMATION_MAX_BYTES
+#define ANIMATION_MAX_BYTES (512UL * 1024)
+#endif
+#define ANIMATION_VERSION 1
+#define ANIMATION_HEADER_SIZE 16
+#define ANIMATION_CHUNK_HEADER_SIZE 4
+#define ANIMATION_INDEX_KEY 0x80000000UL
+#define ANIMATION_READ_AHEAD 1024  // Holds a frame header with a full palette, or a row
+#define ANIMATION_MIN_DELAY_MS 20  // Shorter delays (GIFs often say 0) are raised to this
+#define ANIMATION_MAX_CATCHUP 3    // Frames decoded per render before skipping or running late
+
+// Counters since the animation was loaded
+struct AnimationStats {
+    uint32_t frames;   // Decoded
+    uint32_t skipped;  // Passed over to catch up
+    uint32_t late;     // Renders that gave up time, with no key frame due to skip to
+    uint32_t loops;
+    uint64_t bytesRead;
+    uint64_t readUs;    // Time spent in file reads
+    uint64_t decodeUs;  // Time spent decoding and drawing frames, reads excluded
+    uint32_t redrawn;   // Renders with no frame due, which only copied the layer
+};
+
+class AnimationPlayer {
+   public:
+    AnimationPlayer(MatrixDisplayManager* display, SettingsManager* settings);
+
+    // Advances the frame clock by one effects simulation tick
+    void tick(uint32_t stepUs);
+    // Decodes the frames that are due and draws the layer onto the canvas
+    void render();
+
+    // Replaces the animation with the uploaded file (or removes it when there is none).
+    // Loop task only, as playback reads the file.
+    void install();
+    void remove();
+
+    // Checks an uploaded file: header, index order and chunk sizes (not the frames)
+    static bool validate(const char* path);
+
+    bool isLoaded() const {
+        return loaded;
+    }
+    uint16_t getFrameCount() const {
+        return frameCount;
+    }
+    const AnimationStats& getStats() const {
+        return stats;
+    }
+    uint32_t getReadBandwidth() const;  // Bytes per second while reading, 0 before any read
+    uint32_t getMaxFps() const;         // Frames per second the reads and decode could sustain
+
+   private:
+    MatrixDisplayManager* display;
+    SettingsManager* settings;
+
+    File file;
+    bool opened;  // An open was attempted; not retried until install() or remove()
+    bool loaded;
+    uint16_t frameCount;
+    uint16_t currentFrame;  // On the layer
+    uint32_t frameDelayUs;  // How long the current frame stays
+    uint32_t clockUs;       // Time since the current frame was due
+    AnimationStats stats;
+
+    // Bytes [readPos, readEnd) are the file from the chunk being decoded on
+    uint8_t readAhead[ANIMATION_READ_AHEAD];
+    size_t readPos;
+    size_t readEnd;
+
+    uint16_t layer[MATRIX_HEIGHT][MATRIX_WIDTH];
+    FrameCodecHeader frameHeader;
+
+    // RGB565 channels with the effect brightness folded in
+    uint16_t lutR[32];
+    uint16_t lutG[64];
+    uint16_t lutB[32];
+    int lutBrightnessIndex;
+
+    void open();
+    void close();
+    bool fill(size_t needed);
+    bool readIndex(uint16_t frame, uint32_t* entries, int count);
+    bool seekFrame(uint16_t frame);
+    // Moves to the newest key frame among the next due frames; false if there is none
+    bool skipToKeyFrame(uint16_t due);
+    bool readChunkHeader(uint16_t& length, uint16_t& delayMs);
+    bool decodeFrame(size_t length, bool composite);
+    void compositeRow(int row);
+    void updateLut();
+    void fail(const char* reason);
+};
+
+#endif  // ANIMATION_PLAYER_H
@@ -16,9 +16,10 @@ enum AppState {
     EDIT_EFFECTS,
     EDIT_TIMEZONE,
     TIME_SET,
-    SYNC_NTP,   // New state for NTP sync
-    WIFI_MENU,  // New state for WiFi menu
-    OTA_MENU    // New state for OTA menu
+    SYNC_NTP,          // New state for NTP sync
+    WIFI_MENU,         // New state for WiFi menu
+    OTA_MENU,          // New state for OTA menu
+    SHOW_PIXEL_STREAM  // Network video sink - frames from DDP or sACN senders
 };
 
 #endif  // APP_STATE_H
@@ -1,13 +1,17 @@
 #include "AppStateManager.h"
 
+#include "Log.h"
+#include "Trace.h"
+
 // Define the display state cycle order
 const AppState AppStateManager::DISPLAY_STATES[] = {SHOW_TIME, SHOW_TIME_WITH_DATE, SHOW_WIFI_INFO,
-                                                    SHOW_MESSAGES};
+                                                    SHOW_MESSAGES, SHOW_PIXEL_STREAM};
 const int AppStateManager::DISPLAY_STATE_COUNT = sizeof(DISPLAY_STATES) / sizeof(DISPLAY_STATES[0]);
 
 AppStateManager::AppStateManager(ButtonManager* buttons, SettingsManager* settings,
                                  MatrixDisplayManager* display, EffectsEngine* effects,
-                                 MenuSystem* menu, ClockDisplay* clock, WiFiInfoDisplay* wifiInfo)
+                                 MenuSystem* menu, ClockDisplay* clock, WiFiInfoDisplay* wifiInfo,
+                                 EventStream* events, PixelStream* stream)
     : buttons(buttons),
       settings(settings),
       display(display),
@@ -15,24 +19,28 @@ AppStateManager::AppStateManager(ButtonManager* buttons, SettingsManager* settin
       menu(menu),
       clock(clock),
       wifiInfo(wifiInfo),
+      events(events),
+      stream(stream),
       currentState(SHOW_TIME),
+      reportedState(SHOW_TIME),
       previousStateBeforeMessage(SHOW_TIME),
       wasInterruptedByMessage(false),
+      previousStateBeforeStream(SHOW_TIME),
+      wasSwitchedByStream(false),
+      wasStreaming(false),
       blockMenuReentry(false),
       enterPressTime(0),
       wasPressed(false) {}
 
 void AppStateManager::begin() {
-    Serial.println("AppStateManager initialized");
+    LOG_INFO("AppStateManager initialized");
     currentState = SHOW_TIME;
 }
 
 void AppStateManager::setState(AppState newState) {
     if (currentState != newState) {
-        Serial.print("State change: ");
-        Serial.print(currentState);
-        Serial.print(" -> ");
-        Serial.println(newState);
+        LOG_INFO("State change: %d -> %d", currentState, newState);
+        TRACE_INSTANT("state", newState);
         currentState = newState;
     }
 }
@@ -55,6 +63,15 @@ void AppStateManager::handleInput() {
 }
 
 void AppStateManager::updateDisplay() {
+    // The menu and message handling change currentState directly, so changes are picked up
+    // here once per frame
+    if (currentState != reportedState) {
+        events->publishState(currentState);
+        reportedState = currentState;
+    }
+
+    followPixelStream();
+
     // Handle high-priority messages that can interrupt any state
     display->processMessageQueue();
     bool hasHighPriorityMessage = display->hasActiveHighPriorityMessage();
@@ -94,6 +111,12 @@ void AppStateManager::updateDisplay() {
         return;
     }
 
+    // Stream frames replace the whole canvas, so nothing is cleared first
+    if (currentState == SHOW_PIXEL_STREAM) {
+        renderPixelStream();
+        return;
+    }
+
     // Normal rendering for other states
     display->fillScreen(0);
     switch (currentState) {
@@ -189,6 +212,46 @@ void AppStateManager::renderMessageDisplay() {
     display->show();
 }
 
+void AppStateManager::renderPixelStream() {
+    buttons->setAllowButtonRepeat(false);
+
+    // Between frames the panel keeps showing the last one
+    if (stream->isStreaming()) {
+        stream->present();
+        return;
+    }
+
+    // No stream - show "waiting for stream" like the message screen
+    display->fillScreen(0);
+    display->drawCenteredTextWithBox("waiting for stream", 0, display->getClockColor(), 0x0000);
+    display->show();
+}
+
+void AppStateManager::followPixelStream() {
+    bool streaming = stream->isStreaming();
+    bool started = streaming && !wasStreaming;
+    wasStreaming = streaming;
+
+    // Leaving the stream with the buttons or the menu cancels the return to the clock; a
+    // message that interrupts it comes back to it
+    if (currentState != SHOW_PIXEL_STREAM &&
+        !(wasInterruptedByMessage && previousStateBeforeMessage == SHOW_PIXEL_STREAM)) {
+        wasSwitchedByStream = false;
+    }
+
+    // A stream that starts takes over the display states, like a message, and hands the
+    // display back once it stops
+    if (PIXEL_STREAM_AUTO_SWITCH && started && currentState != SHOW_PIXEL_STREAM &&
+        currentState != SHOW_MESSAGES && getCurrentDisplayStateIndex() != -1) {
+        previousStateBeforeStream = currentState;
+        currentState = SHOW_PIXEL_STREAM;
+        wasSwitchedByStream = true;
+    } else if (currentState == SHOW_PIXEL_STREAM && wasSwitchedByStream && !streaming) {
+        currentState = previousStateBeforeStream;
+        wasSwitchedByStream = false;
+    }
+}
+
 AppState AppStateManager::getNextDisplayState(AppState current) {
     int currentIndex = getCurrentDisplayStateIndex();
     if (currentIndex == -1)
@@ -220,6 +283,8 @@ void AppStateManager::processDelay() {
     if (currentState == SHOW_TIME || currentState == SHOW_TIME_WITH_DATE ||
         currentState == SHOW_WIFI_INFO) {
         delay(CLOCK_UPDATE_DELAY);
+    } else if (currentState == SHOW_PIXEL_STREAM) {
+        delay(STREAM_DELAY);
     } else {
         delay(APP_MENU_DELAY);
     }
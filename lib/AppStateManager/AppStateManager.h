@@ -7,8 +7,10 @@
 #include "ButtonManager.h"
 #include "ClockDisplay.h"
 #include "EffectsEngine.h"
+#include "EventStream.h"
 #include "MatrixDisplayManager.h"
 #include "MenuSystem.h"
+#include "PixelStream.h"
 #include "SettingsManager.h"
 #include "WiFiInfoDisplay.h"
 
@@ -17,7 +19,8 @@ class AppStateManager {
     // Constructor
     AppStateManager(ButtonManager* buttons, SettingsManager* settings,
                     MatrixDisplayManager* display, EffectsEngine* effects, MenuSystem* menu,
-                    ClockDisplay* clock, WiFiInfoDisplay* wifiInfo);
+                    ClockDisplay* clock, WiFiInfoDisplay* wifiInfo, EventStream* events,
+                    PixelStream* stream);
 
     // Initialization
     void begin();
@@ -44,21 +47,31 @@ class AppStateManager {
     MenuSystem* menu;
     ClockDisplay* clock;
     WiFiInfoDisplay* wifiInfo;
+    EventStream* events;
+    PixelStream* stream;
 
     // State management
     AppState currentState;
+    AppState reportedState;  // Last state sent to event subscribers
 
     // Display update methods
     void renderTimeDisplay();
     void renderTimeWithDateDisplay();
     void renderWiFiInfoDisplay();
     void renderMessageDisplay();
+    void renderPixelStream();
     void renderMenus();
 
     // Message state management
     AppState previousStateBeforeMessage;
     bool wasInterruptedByMessage;
 
+    // Pixel stream state management
+    AppState previousStateBeforeStream;
+    bool wasSwitchedByStream;
+    bool wasStreaming;
+    void followPixelStream();
+
     // Helper methods for state cycling
     AppState getNextDisplayState(AppState current);
     AppState getPreviousDisplayState(AppState current);
@@ -71,6 +84,7 @@ class AppStateManager {
     // Timing constants
     static const uint32_t CLOCK_UPDATE_DELAY = 5;  // Reduced from 10ms for more responsive buttons
     static const uint32_t APP_MENU_DELAY = 20;     // Reduced from 30ms for snappier menu response
+    static const uint32_t STREAM_DELAY = 1;        // A 60 fps stream has under 17ms per frame
 
     // State tracking variables
     bool blockMenuReentry;
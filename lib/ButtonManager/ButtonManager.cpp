@@ -1,5 +1,7 @@
 #include "ButtonManager.h"
 
+#include "Log.h"
+
 ButtonManager::ButtonManager() : btnUp(PIN_BTN_UP), btnDown(PIN_BTN_DOWN), btnEnter(PIN_BTN_ENTER) {
     allowButtonRepeat = false;
 }
@@ -8,7 +10,7 @@ void ButtonManager::begin() {
     pinMode(PIN_BTN_UP, INPUT_PULLUP);
     pinMode(PIN_BTN_DOWN, INPUT_PULLUP);
     pinMode(PIN_BTN_ENTER, INPUT_PULLUP);
-    Serial.println("Button Manager initialized");
+    LOG_INFO("Button Manager initialized");
 }
 
 void ButtonManager::updateAll() {
@@ -1,11 +1,17 @@
 #include "ClockDisplay.h"
 
+#include <WiFi.h>
+
+#include "Log.h"
+
+#include "SpriteAssets.h"
+
 ClockDisplay::ClockDisplay(MatrixDisplayManager* display, SettingsManager* settings,
                            RTC_DS3231* rtc, TimeManager* timeManager)
     : display(display), settings(settings), rtc(rtc), timeManager(timeManager) {}
 
 void ClockDisplay::begin() {
-    Serial.println("Clock Display initialized");
+    LOG_INFO("Clock Display initialized");
 }
 
 void ClockDisplay::displayTime() {
@@ -13,19 +19,20 @@ void ClockDisplay::displayTime() {
         return;
     }
 
-    DateTime now = timeManager->getLocalTime();  // Use TimeManager for timezone-aware time
-    String timeString = formatTime(now);
-
-    // Draw text background to ensure readability over effects
-    display->drawTextBackground();
+    LocalTime now;
+    timeManager->getLocalTime(now);  // Timezone-aware, formatted once per second
+    bool use24Hour = settings->getUse24HourFormat();
 
     // Use drawTightClock for proper centering and text size
-    display->drawTightClock(timeString.c_str(), settings->getTextSize(), display->getClockColor());
+    display->drawTightClock(use24Hour ? now.time24 : now.time12, settings->getTextSize(),
+                            display->getClockColor());
 
     // Handle AM/PM display for 12-hour format
-    if (!settings->getUse24HourFormat()) {
-        displayAMPM(now);
+    if (!use24Hour) {
+        displayAMPM(now.tm.tm_hour >= 12);
     }
+
+    displayStatusIcons();
 }
 
 void ClockDisplay::displayTimeWithDate() {
@@ -33,17 +40,14 @@ void ClockDisplay::displayTimeWithDate() {
         return;
     }
 
-    DateTime now = timeManager->getLocalTime();   // Use TimeManager for timezone-aware time
-    String timeString = formatTimeWithAMPM(now);  // Include AM/PM in the time string
-    String dateString = formatDateWithDay(now);   // Include 3-char day code in brackets
-
-    // Draw text background to ensure readability over effects (use specialized method for time with
-    // date)
-    display->drawTimeWithDateBackground();
+    LocalTime now;
+    timeManager->getLocalTime(now);  // Timezone-aware, formatted once per second
+    // AM/PM goes in the time string; the date carries a 3-char day code in brackets
+    const char* timeString = settings->getUse24HourFormat() ? now.time24 : now.time12AmPm;
 
     // Display time closer to center (not at very top)
     int timeY = 8;  // Moved down from y=2 to y=8 for better centering
-    display->drawTightClock(timeString.c_str(), 1, display->getClockColor(), timeY);
+    display->drawTightClock(timeString, 1, display->getClockColor(), timeY);
 
     // Display date with day code closer to center (not at very bottom)
     int dateY = 20;  // Moved up from y=20, and no separate day line
@@ -52,66 +56,12 @@ void ClockDisplay::displayTimeWithDate() {
     display->setTextColor(display->getClockColor());
 
     // Center the date string
-    int dateX = (128 - (dateString.length() * 6)) / 2;
+    int dateX = (128 - (strlen(now.date) * 6)) / 2;
     display->setCursor(dateX, dateY);
-    display->print(dateString.c_str());
-}
-
-String ClockDisplay::formatTime(DateTime now) {
-    char timeStr[12];
-
-    if (settings->getUse24HourFormat()) {
-        // 24-hour format: HH:MM:SS
-        sprintf(timeStr, "%02d:%02d:%02d", now.hour(), now.minute(), now.second());
-    } else {
-        // 12-hour format: HH:MM:SS (AM/PM displayed separately)
-        int hour = now.hour();
-        if (hour == 0)
-            hour = 12;  // Midnight is 12 AM
-        if (hour > 12)
-            hour -= 12;  // Convert PM hours
-
-        sprintf(timeStr, "%02d:%02d:%02d", hour, now.minute(), now.second());
-    }
-
-    return String(timeStr);
-}
-
-String ClockDisplay::formatTimeWithAMPM(DateTime now) {
-    char timeStr[16];  // Larger buffer to include AM/PM
-
-    if (settings->getUse24HourFormat()) {
-        // 24-hour format: HH:MM:SS (no AM/PM needed)
-        sprintf(timeStr, "%02d:%02d:%02d", now.hour(), now.minute(), now.second());
-    } else {
-        // 12-hour format: HH:MM:SS AM/PM (AM/PM included in string)
-        int hour = now.hour();
-        bool isPM = (hour >= 12);
-
-        if (hour == 0)
-            hour = 12;  // Midnight is 12 AM
-        if (hour > 12)
-            hour -= 12;  // Convert PM hours
-
-        sprintf(timeStr, "%02d:%02d:%02d %s", hour, now.minute(), now.second(), isPM ? "PM" : "AM");
-    }
-
-    return String(timeStr);
+    display->print(now.date);
 }
 
-String ClockDisplay::formatDateWithDay(DateTime now) {
-    const char* dayAbbrev[] = {"SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT"};
-    int dayOfWeek = now.dayOfTheWeek();
-
-    char dateStr[20];  // Buffer for date with day abbreviation
-    sprintf(dateStr, "%02d/%02d/%04d [%s]", now.month(), now.day(), now.year(),
-            dayAbbrev[dayOfWeek]);
-    return String(dateStr);
-}
-
-void ClockDisplay::displayAMPM(DateTime now) {
-    int hour = now.hour();
-    bool isPM = (hour >= 12);
+void ClockDisplay::displayAMPM(bool isPM) {
     String ampmStr = "";
 
     // Use short form (A/P) for text size 3 to avoid corner collision
@@ -134,6 +84,72 @@ void ClockDisplay::displayAMPM(DateTime now) {
     display->print(ampmStr.c_str());
 }
 
+void ClockDisplay::displayStatusIcons() {
+    // Only draw when the left margin beside the digits is wide enough (text sizes 1 and 2)
+    int x1, y1, x2, y2;
+    display->getTimeDisplayBounds(x1, y1, x2, y2, settings->getTextSize());
+    if (x1 < CLOCK_ICON_MARGIN * 2 + CLOCK_ICON_SIZE) {
+        return;
+    }
+
+    const Sprite* weatherIcon = nullptr;
+    switch (getWeather()) {
+        case WEATHER_SUN:
+            weatherIcon = &SPRITE_WEATHER_SUN;
+            break;
+        case WEATHER_CLOUD:
+            weatherIcon = &SPRITE_WEATHER_CLOUD;
+            break;
+        case WEATHER_RAIN:
+            weatherIcon = &SPRITE_WEATHER_RAIN;
+            break;
+        case WEATHER_SNOW:
+            weatherIcon = &SPRITE_WEATHER_SNOW;
+            break;
+        case WEATHER_STORM:
+            weatherIcon = &SPRITE_WEATHER_STORM;
+            break;
+        default:
+            break;
+    }
+    if (weatherIcon) {
+        display->drawSprite(*weatherIcon, CLOCK_ICON_MARGIN, CLOCK_ICON_MARGIN);
+    }
+
+    // Bottom-left: WiFi problems take precedence over the waiting-message indicator
+    int statusY = MATRIX_HEIGHT - CLOCK_ICON_SIZE - CLOCK_ICON_MARGIN;
+    if (settings->isWiFiEnabled() && !WiFi.isConnected()) {
+        display->drawSprite(SPRITE_STATUS_WIFI_OFF, CLOCK_ICON_MARGIN, statusY);
+    } else if (display->getQueueCount() > 0) {
+        display->drawSprite(SPRITE_STATUS_MESSAGE, CLOCK_ICON_MARGIN, statusY,
+                            display->getClockColor());
+    }
+}
+
+void ClockDisplay::setWeather(WeatherCondition condition) {
+    weather = condition;
+    weatherUpdatedAt = millis();
+}
+
+WeatherCondition ClockDisplay::getWeather() {
+    // Drop stale conditions rather than showing yesterday's weather
+    if (weather != WEATHER_NONE && millis() - weatherUpdatedAt > WEATHER_STALE_MS) {
+        weather = WEATHER_NONE;
+    }
+    return weather;
+}
+
+bool ClockDisplay::parseWeatherCondition(const char* name, WeatherCondition& out) {
+    static const char* names[] = {"none", "sun", "cloud", "rain", "snow", "storm"};
+    for (int i = 0; i < (int)(sizeof(names) / sizeof(names[0])); i++) {
+        if (strcasecmp(name, names[i]) == 0) {
+            out = (WeatherCondition)i;
+            return true;
+        }
+    }
+    return false;
+}
+
 // Utility methods for effects integration
 void ClockDisplay::getTimeDisplayBounds(int& x1, int& y1, int& x2, int& y2) {
     // Simple bounds for the time display area
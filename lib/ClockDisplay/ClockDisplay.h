@@ -9,6 +9,20 @@
 #include "SettingsManager.h"
 #include "TimeManager.h"
 
+// Status icons drawn in the left margin next to the clock
+#define CLOCK_ICON_SIZE 8
+#define CLOCK_ICON_MARGIN 1
+#define WEATHER_STALE_MS (3UL * 60UL * 60UL * 1000UL)  // Hide weather after 3 hours without updates
+
+enum WeatherCondition {
+    WEATHER_NONE,
+    WEATHER_SUN,
+    WEATHER_CLOUD,
+    WEATHER_RAIN,
+    WEATHER_SNOW,
+    WEATHER_STORM
+};
+
 class ClockDisplay {
    public:
     // Constructor
@@ -27,17 +41,23 @@ class ClockDisplay {
     void getAMPMDisplayBounds(int& x1, int& y1, int& x2, int& y2);
     bool isInTextArea(int x, int y);
 
+    // Weather icon shown beside the clock (set remotely, e.g. via POST /weather)
+    void setWeather(WeatherCondition condition);
+    WeatherCondition getWeather();
+    static bool parseWeatherCondition(const char* name, WeatherCondition& out);
+
    private:
     MatrixDisplayManager* display;
     SettingsManager* settings;
     RTC_DS3231* rtc;
     TimeManager* timeManager;
 
+    WeatherCondition weather = WEATHER_NONE;
+    unsigned long weatherUpdatedAt = 0;
+
     // Helper methods
-    String formatTime(DateTime now);
-    String formatTimeWithAMPM(DateTime now);  // New method for time with AM/PM included
-    String formatDateWithDay(DateTime now);   // New method for date with 3-char day code
-    void displayAMPM(DateTime now);
+    void displayAMPM(bool isPM);
+    void displayStatusIcons();
 };
 
 #endif  // CLOCK_DISPLAY_H
@@ -1,8 +1,15 @@
 #include "EffectsEngine.h"
 
-EffectsEngine::EffectsEngine(MatrixDisplayManager* display, SettingsManager* settings)
+#include "Log.h"
+#include "Trace.h"
+
+EffectsEngine::EffectsEngine(MatrixDisplayManager* display, SettingsManager* settings,
+                             VideoWall* wall, AnimationPlayer* animation, Metrics* metrics)
     : display(display),
       settings(settings),
+      wall(wall),
+      animation(animation),
+      metrics(metrics),
       confetti{},
       matrixDrops{},
       torrentDrops{},
@@ -10,7 +17,10 @@ EffectsEngine::EffectsEngine(MatrixDisplayManager* display, SettingsManager* set
       shootingStars{},
       sparkles{},
       fireworks{},
-      tronTrails{} {}
+      tronTrails{},
+      warpStars{},
+      warpReciprocal{},
+      warpDepthColors{} {}
 
 void EffectsEngine::begin() {
     // Initialize all effects
@@ -23,16 +33,77 @@ void EffectsEngine::begin() {
     initializeSparkles();
     initializeFireworks();
     initializeTron();
+    initializeWarp();
 
-    Serial.println("Effects Engine initialized");
+    LOG_INFO("Effects Engine initialized");
 }
 
 void EffectsEngine::updateEffects() {
-    EffectMode currentEffect = settings->getEffectMode();
+    TRACE_SCOPE("effects");
+    syncTextMask();
+
+    uint32_t now = micros();
+    if (!simClockStarted) {
+        lastSimMicros = now;
+        simAccumulatorUs = 0;
+        simClockStarted = true;
+    }
+    simAccumulatorUs += now - lastSimMicros;
+    lastSimMicros = now;
+
+    // Run however many fixed ticks are due; cap catch-up so a long stall (menu, OTA) can't
+    // trigger a burst of simulation work
+    int ticks = 0;
+    uint32_t dropped = 0;
+    while (simAccumulatorUs >= EFFECT_SIM_STEP_US) {
+        if (ticks >= EFFECT_SIM_MAX_CATCHUP) {
+            dropped = simAccumulatorUs / EFFECT_SIM_STEP_US;
+            simAccumulatorUs %= EFFECT_SIM_STEP_US;
+            break;
+        }
+        simulate();
+        simAccumulatorUs -= EFFECT_SIM_STEP_US;
+        ticks++;
+    }
+    metrics->countEffectTicks(ticks, dropped);
 
-    switch (currentEffect) {
+    render((float)simAccumulatorUs / EFFECT_SIM_STEP_US);
+}
+
+void EffectsEngine::simulate() {
+    // Effects driven by per-particle millis() timers (rain, sparkles, fireworks, tron) and the
+    // slow star drift stay in their update functions; only continuously moving particles and
+    // the animation clock tick here
+    switch (settings->getEffectMode()) {
         case EFFECT_CONFETTI:
-            updateConfetti();
+            if (!wall->isActive()) {
+                simulateConfetti();
+            }
+            break;
+        case EFFECT_STARS:
+            simulateShootingStars();
+            break;
+        case EFFECT_WARP:
+            simulateWarp();
+            simulateShootingStars();
+            break;
+        case EFFECT_ANIMATION:
+            // Frame delays are counted in simulation ticks
+            animation->tick(EFFECT_SIM_STEP_US);
+            break;
+        default:
+            break;
+    }
+}
+
+void EffectsEngine::render(float alpha) {
+    switch (settings->getEffectMode()) {
+        case EFFECT_CONFETTI:
+            if (wall->isActive()) {
+                renderWallConfetti();
+            } else {
+                renderConfetti(alpha);
+            }
             break;
         case EFFECT_ACID:
             updateMatrixRain();
@@ -45,6 +116,7 @@ void EffectsEngine::updateEffects() {
             break;
         case EFFECT_STARS:
             updateStars();
+            renderShootingStars(alpha);
             break;
         case EFFECT_SPARKLES:
             updateSparkles();
@@ -55,6 +127,13 @@ void EffectsEngine::updateEffects() {
         case EFFECT_TRON:
             updateTron();
             break;
+        case EFFECT_WARP:
+            renderWarp(alpha);
+            renderShootingStars(alpha);
+            break;
+        case EFFECT_ANIMATION:
+            animation->render();
+            break;
         case EFFECT_OFF:
         default:
             // No effects
@@ -71,35 +150,49 @@ void EffectsEngine::setDisplayMode(AppState displayMode) {
     currentDisplayMode = displayMode;
 }
 
-// Helper function to check if position is in text area
-bool EffectsEngine::isInTextArea(int x, int y) {
+// Point the display's text distance field at the layout currently on screen. The field is only
+// rebuilt when the layout actually changes, so this is cheap to call every frame.
+void EffectsEngine::syncTextMask() {
     if (isMenuPreviewMode) {
-        // During effect preview, only check the preview text area
-        // Don't block AM/PM area since no clock is being displayed
-        int x1, y1, x2, y2;
-        display->getMainTextBounds(x1, y1, x2, y2, previewTextSize);
-        return (x >= x1 && x <= x2 && y >= y1 && y <= y2);
+        // During effect preview, only the preview text box is blocked (no AM/PM corner)
+        display->setTextMaskLayout(TEXT_MASK_PREVIEW, previewTextSize);
     } else if (currentDisplayMode == SHOW_TIME_WITH_DATE) {
-        // For time with date mode, check both time area and date area
-        return display->isInTimeWithDateArea(x, y);
+        display->setTextMaskLayout(TEXT_MASK_CLOCK_WITH_DATE, 1);
     } else if (currentDisplayMode == SHOW_MESSAGES) {
-        // During message scrolling, be more permissive with effects
-        // Only avoid the actual message area (full width, proper height)
-        // Use the hardcoded message text size (always size 2)
-
-        int padding = 3;  // Same padding as message background
+        // Messages always use size 2 text in a full-width band
+        display->setTextMaskLayout(TEXT_MASK_MESSAGE_BAND, 2);
+    } else {
+        display->setTextMaskLayout(TEXT_MASK_CLOCK, settings->getTextSize());
+    }
+}
 
-        // Approximate the centered Y position (size 2 text is ~16 pixels high)
-        int textHeight = 16;  // Approximate height for size 2 text
-        int centeredY = (MATRIX_HEIGHT - textHeight) / 2;
+// Helper function to check if position is in text area
+bool EffectsEngine::isInTextArea(int x, int y) {
+    return display->getTextHaloLevel(x, y) == 0;
+}
 
-        int messageY = centeredY - padding;
-        int messageHeight = textHeight + (2 * padding);
+// Draw an effect pixel, skipping it inside the text clearance and fading it in the halo
+void EffectsEngine::plotEffectPixel(int x, int y, uint16_t color) {
+    if (x < 0 || x >= MATRIX_WIDTH || y < 0 || y >= MATRIX_HEIGHT) {
+        return;
+    }
+    uint8_t level = display->getTextHaloLevel(x, y);
+    if (level == 0) {
+        return;
+    }
+    // Straight into the frame buffer; most pixels are outside the halo and need no fade
+    display->getFrameBuffer()[y * MATRIX_WIDTH + x] =
+        level == 255 ? color : display->fadeColor(color, level);
+}
 
-        // Block effects in the full-width message area
-        return (y >= messageY && y < messageY + messageHeight);
-    } else {
-        return display->isInTextArea(x, y, true);
+// Filled circle of effect pixels, so each of them is masked
+void EffectsEngine::plotEffectCircle(int x, int y, int radius, uint16_t color) {
+    for (int dy = -radius; dy <= radius; dy++) {
+        for (int dx = -radius; dx <= radius; dx++) {
+            if (dx * dx + dy * dy <= radius * radius) {
+                plotEffectPixel(x + dx, y + dy, color);
+            }
+        }
     }
 }
 
@@ -114,10 +207,12 @@ void EffectsEngine::initializeConfetti() {
     for (int i = 0; i < NUM_CONFETTI; i++) {
         confetti[i].x = random(0, MATRIX_WIDTH);
         confetti[i].y = random(centerY - yRange, centerY + yRange);
+        confetti[i].prevX = confetti[i].x;
+        confetti[i].prevY = confetti[i].y;
 
         // Generate non-zero velocities
-        confetti[i].vx = display->generateVelocity(0.1, 0.8);   // Min 0.1, max 0.8 pixels/frame
-        confetti[i].vy = display->generateVelocity(0.05, 0.4);  // Min 0.05, max 0.4 pixels/frame
+        confetti[i].vx = display->generateVelocity(0.3, 2.4);   // Min 0.3, max 2.4 pixels/tick
+        confetti[i].vy = display->generateVelocity(0.15, 1.2);  // Min 0.15, max 1.2 pixels/tick
 
         confetti[i].color = display->randomVividColor();
     }
@@ -136,18 +231,43 @@ void EffectsEngine::resetConfettiParticle(int index) {
         confetti[index].y = random(2) == 0 ? -CONFETTI_RAD : MATRIX_HEIGHT + CONFETTI_RAD;
     }
 
+    // Respawn is a jump, not motion - don't interpolate across it
+    confetti[index].prevX = confetti[index].x;
+    confetti[index].prevY = confetti[index].y;
+
     // Generate non-zero velocities
-    confetti[index].vx = display->generateVelocity(0.1, 0.8);
-    confetti[index].vy = display->generateVelocity(0.05, 0.4);
+    confetti[index].vx = display->generateVelocity(0.3, 2.4);
+    confetti[index].vy = display->generateVelocity(0.15, 1.2);
     confetti[index].color = display->randomVividColor();
 }
 
-void EffectsEngine::updateConfetti() {
+void EffectsEngine::simulateConfetti() {
     for (int i = 0; i < NUM_CONFETTI; i++) {
+        confetti[i].prevX = confetti[i].x;
+        confetti[i].prevY = confetti[i].y;
         confetti[i].x += confetti[i].vx;
         confetti[i].y += confetti[i].vy;
 
-        // Check if particle is out of bounds or in text area
+        // Bounce off the text halo: step back and flip whichever velocity component points
+        // down the distance gradient (toward the glyphs)
+        int cx = (int)confetti[i].x;
+        int cy = (int)confetti[i].y;
+        if (display->getTextDistance(cx, cy) <= display->getTextClearance() + CONFETTI_RAD) {
+            int gradX = display->getTextDistance(cx + 1, cy) - display->getTextDistance(cx - 1, cy);
+            int gradY = display->getTextDistance(cx, cy + 1) - display->getTextDistance(cx, cy - 1);
+            if (gradX * confetti[i].vx < 0)
+                confetti[i].vx = -confetti[i].vx;
+            if (gradY * confetti[i].vy < 0)
+                confetti[i].vy = -confetti[i].vy;
+            if (gradX == 0 && gradY == 0) {
+                confetti[i].vx = -confetti[i].vx;
+                confetti[i].vy = -confetti[i].vy;
+            }
+            confetti[i].x = confetti[i].prevX;
+            confetti[i].y = confetti[i].prevY;
+        }
+
+        // Check if particle is out of bounds or (e.g. after a layout change) stuck in text
         bool outOfBounds =
             (confetti[i].x < -CONFETTI_RAD || confetti[i].x > MATRIX_WIDTH + CONFETTI_RAD ||
              confetti[i].y < -CONFETTI_RAD || confetti[i].y > MATRIX_HEIGHT + CONFETTI_RAD);
@@ -158,14 +278,74 @@ void EffectsEngine::updateConfetti() {
 
         if (outOfBounds || inText) {
             resetConfettiParticle(i);
-        } else {
-            // Draw the confetti particle as a filled circle
-            display->fillCircle((int)confetti[i].x, (int)confetti[i].y, CONFETTI_RAD,
-                                confetti[i].color);
         }
     }
 }
 
+void EffectsEngine::renderConfetti(float alpha) {
+    for (int i = 0; i < NUM_CONFETTI; i++) {
+        float x = confetti[i].prevX + (confetti[i].x - confetti[i].prevX) * alpha;
+        float y = confetti[i].prevY + (confetti[i].y - confetti[i].prevY) * alpha;
+
+        // Draw the confetti particle as a filled circle, masked like every other effect
+        plotEffectCircle((int)x, (int)y, CONFETTI_RAD, confetti[i].color);
+    }
+}
+
+// On a video wall every tile has to draw the same particles, so they are not simulated from
+// local state. Each particle lives for WALL_CONFETTI_LIFE frames, and its spawn point,
+// velocity and color come from the wall seed, its index and its generation. Where it is on
+// the canvas is then a function of the shared frame: it wraps around the canvas
+// horizontally and bounces off the top and bottom. Particles no longer bounce off the text;
+// they fade out around it like the other effects do.
+void EffectsEngine::renderWallConfetti() {
+    static const uint8_t vividColors[7][3] = {{255, 0, 0},   {0, 255, 0},   {0, 0, 255},
+                                              {255, 255, 0}, {255, 0, 255}, {0, 255, 255},
+                                              {255, 255, 255}};
+    int64_t wallUs = wall->getWallMicros();
+    uint32_t frame = wallUs / WALL_FRAME_US;
+    float phase = (float)(wallUs % WALL_FRAME_US) / WALL_FRAME_US;
+    int canvasWidth = wall->getTileCount() * MATRIX_WIDTH;
+    int tileX = wall->getTileIndex() * MATRIX_WIDTH;
+    int count = NUM_CONFETTI * wall->getTileCount();
+    float bounceRange = 2.0f * (MATRIX_HEIGHT - 1);
+
+    for (int i = 0; i < count; i++) {
+        // Staggered, so particles are not all replaced on the same frame
+        uint32_t t = frame + (uint32_t)i * WALL_CONFETTI_LIFE / count;
+        float age = (t % WALL_CONFETTI_LIFE) + phase;
+        uint32_t h = VideoWall::hash(wall->getSeed() + i, t / WALL_CONFETTI_LIFE);
+
+        float x0 = (h % (canvasWidth * 16)) / 16.0f;
+        h = VideoWall::hash(h, 1);
+        float y0 = MATRIX_HEIGHT / 4 + (h % (MATRIX_HEIGHT * 8)) / 16.0f;  // Central band
+        h = VideoWall::hash(h, 2);
+        float vx = (0.3f + (h % 1000) * 0.0021f) * ((h & 0x10000) ? 1 : -1);
+        h = VideoWall::hash(h, 3);
+        float vy = (0.15f + (h % 1000) * 0.00105f) * ((h & 0x10000) ? 1 : -1);
+        const uint8_t* rgb = vividColors[(h >> 20) % 7];
+
+        float x = fmodf(x0 + vx * age, canvasWidth);
+        if (x < 0) {
+            x += canvasWidth;
+        }
+        float y = fmodf(y0 + vy * age, bounceRange);
+        if (y < 0) {
+            y += bounceRange;
+        }
+        if (y > MATRIX_HEIGHT - 1) {
+            y = bounceRange - y;
+        }
+
+        int px = (int)x - tileX;
+        int py = (int)y;
+        if (px < -CONFETTI_RAD || px > MATRIX_WIDTH + CONFETTI_RAD) {
+            continue;  // On another tile
+        }
+        plotEffectCircle(px, py, CONFETTI_RAD, display->scaledColor565(rgb[0], rgb[1], rgb[2]));
+    }
+}
+
 // ===============================================
 // MATRIX RAIN EFFECT (Acid Rain - Green)
 // ===============================================
@@ -200,13 +380,13 @@ void EffectsEngine::updateMatrixRain() {
         // Draw the drop trail
         for (int j = 0; j < matrixDrops[i].length && (matrixDrops[i].y - j) >= 0; j++) {
             int y = matrixDrops[i].y - j;
-            if (y < MATRIX_HEIGHT && !isInTextArea(matrixDrops[i].x, y)) {
+            if (y < MATRIX_HEIGHT) {
                 uint8_t intensity = 255 - (j * 40);  // Fade as we go up
                 if (intensity < 50)
                     intensity = 50;
                 uint16_t color = display->scaledEffectColor565(
                     0, intensity, 0);  // Green rain with brightness scaling
-                display->drawPixel(matrixDrops[i].x, y, color);
+                plotEffectPixel(matrixDrops[i].x, y, color);
             }
         }
     }
@@ -246,13 +426,13 @@ void EffectsEngine::updateRain() {
         // Draw the drop trail in blue
         for (int j = 0; j < matrixDrops[i].length && (matrixDrops[i].y - j) >= 0; j++) {
             int y = matrixDrops[i].y - j;
-            if (y < MATRIX_HEIGHT && !isInTextArea(matrixDrops[i].x, y)) {
+            if (y < MATRIX_HEIGHT) {
                 uint8_t intensity = 255 - (j * 40);  // Fade as we go up
                 if (intensity < 50)
                     intensity = 50;
                 uint16_t color = display->scaledEffectColor565(
                     0, 0, intensity);  // Blue rain with brightness scaling
-                display->drawPixel(matrixDrops[i].x, y, color);
+                plotEffectPixel(matrixDrops[i].x, y, color);
             }
         }
     }
@@ -292,13 +472,13 @@ void EffectsEngine::updateTorrent() {
         // Draw the drop trail in white/light blue
         for (int j = 0; j < torrentDrops[i].length && (torrentDrops[i].y - j) >= 0; j++) {
             int y = torrentDrops[i].y - j;
-            if (y < MATRIX_HEIGHT && !isInTextArea(torrentDrops[i].x, y)) {
+            if (y < MATRIX_HEIGHT) {
                 uint8_t intensity = 255 - (j * 60);  // Faster fade for smaller drops
                 if (intensity < 80)
                     intensity = 80;
                 uint16_t color = display->scaledEffectColor565(
                     intensity / 2, intensity / 2, intensity);  // Light blue/white torrent
-                display->drawPixel(torrentDrops[i].x, y, color);
+                plotEffectPixel(torrentDrops[i].x, y, color);
             }
         }
     }
@@ -348,6 +528,8 @@ void EffectsEngine::spawnShootingStar(int index) {
         shootingStars[index].x = 0;
         shootingStars[index].y = random(0, MATRIX_HEIGHT);
     }
+    shootingStars[index].prevX = shootingStars[index].x;
+    shootingStars[index].prevY = shootingStars[index].y;
 
     // Diagonal movement (northwest to southeast)
     shootingStars[index].speedX = SHOOTING_STAR_SPEED;
@@ -357,38 +539,8 @@ void EffectsEngine::spawnShootingStar(int index) {
     shootingStars[index].spawnTime = millis();
 }
 
-void EffectsEngine::updateStars() {
+void EffectsEngine::simulateShootingStars() {
     uint32_t currentTime = millis();
-    static uint32_t lastDriftUpdate = 0;
-
-    // Slow drift movement - update every 150ms
-    if (currentTime - lastDriftUpdate > 150) {
-        static float globalDriftX = 0.005f;  // Slowed down to 10% of original speed
-        static float globalDriftY = 0.003f;  // Slowed down to 10% of original speed
-        float groupDriftX = globalDriftX;    // Completely fixed drift
-        float groupDriftY = globalDriftY;
-
-        // Apply the SAME movement to all stars as a unified group
-        for (int i = 0; i < NUM_STARS; i++) {
-            stars[i].x += groupDriftX;
-            stars[i].y += groupDriftY;
-
-            // If star has drifted off the right or bottom edge, respawn it on the opposite edges
-            if (stars[i].x > MATRIX_WIDTH + 2 || stars[i].y > MATRIX_HEIGHT + 2) {
-                if (stars[i].x > MATRIX_WIDTH + 2) {
-                    // Respawn on left side
-                    stars[i].x = -1.5f;
-                    stars[i].y = (i * MATRIX_HEIGHT / NUM_STARS) + (i % 3 - 1);
-                }
-                if (stars[i].y > MATRIX_HEIGHT + 2) {
-                    // Respawn on top side
-                    stars[i].y = -1.5f;
-                    stars[i].x = (i * MATRIX_WIDTH / NUM_STARS) + (i % 3 - 1);
-                }
-            }
-        }
-        lastDriftUpdate = currentTime;
-    }
 
     // Shooting star management
     if (currentTime - lastShootingStarTime > random(300000, 600000)) {  // 5-10 minutes
@@ -439,30 +591,75 @@ void EffectsEngine::updateStars() {
     // Update shooting stars
     for (int i = 0; i < NUM_SHOOTING_STARS; i++) {
         if (shootingStars[i].active) {
+            shootingStars[i].prevX = shootingStars[i].x;
+            shootingStars[i].prevY = shootingStars[i].y;
             shootingStars[i].x += shootingStars[i].speedX;
             shootingStars[i].y += shootingStars[i].speedY;
 
             // Deactivate if off screen
             if (shootingStars[i].x > MATRIX_WIDTH + 10 || shootingStars[i].y > MATRIX_HEIGHT + 10) {
                 shootingStars[i].active = false;
-            } else {
-                // Draw shooting star trail
-                for (int t = 0; t < shootingStars[i].trailLength; t++) {
-                    int trailX = (int)(shootingStars[i].x - t * shootingStars[i].speedX * 0.5f);
-                    int trailY = (int)(shootingStars[i].y - t * shootingStars[i].speedY * 0.5f);
-
-                    if (trailX >= 0 && trailX < MATRIX_WIDTH && trailY >= 0 &&
-                        trailY < MATRIX_HEIGHT) {
-                        if (!isInTextArea(trailX, trailY)) {
-                            uint8_t brightness = 255 - (t * 32);  // Fade trail
-                            uint16_t color =
-                                display->scaledEffectColor565(brightness, brightness, brightness);
-                            display->drawPixel(trailX, trailY, color);
-                        }
-                    }
+            }
+        }
+    }
+}
+
+void EffectsEngine::renderShootingStars(float alpha) {
+    for (int i = 0; i < NUM_SHOOTING_STARS; i++) {
+        if (!shootingStars[i].active) {
+            continue;
+        }
+
+        const ShootingStar& star = shootingStars[i];
+        float headX = star.prevX + (star.x - star.prevX) * alpha;
+        float headY = star.prevY + (star.y - star.prevY) * alpha;
+
+        // Trail points are half a pixel apart along the direction of travel
+        float stepX = star.speedX * 0.5f / SHOOTING_STAR_SPEED;
+        float stepY = star.speedY * 0.5f / SHOOTING_STAR_SPEED;
+
+        // Draw shooting star trail
+        for (int t = 0; t < star.trailLength; t++) {
+            int trailX = (int)(headX - t * stepX);
+            int trailY = (int)(headY - t * stepY);
+
+            if (trailX >= 0 && trailX < MATRIX_WIDTH && trailY >= 0 && trailY < MATRIX_HEIGHT) {
+                uint8_t brightness = 255 - (t * 32);  // Fade trail
+                uint16_t color = display->scaledEffectColor565(brightness, brightness, brightness);
+                plotEffectPixel(trailX, trailY, color);
+            }
+        }
+    }
+}
+
+void EffectsEngine::updateStars() {
+    uint32_t currentTime = millis();
+
+    // Slow drift movement - update every 150ms
+    if (currentTime - lastStarDriftUpdate > 150) {
+        const float groupDriftX = 0.005f;  // Slowed down to 10% of original speed
+        const float groupDriftY = 0.003f;  // Slowed down to 10% of original speed
+
+        // Apply the SAME movement to all stars as a unified group
+        for (int i = 0; i < NUM_STARS; i++) {
+            stars[i].x += groupDriftX;
+            stars[i].y += groupDriftY;
+
+            // If star has drifted off the right or bottom edge, respawn it on the opposite edges
+            if (stars[i].x > MATRIX_WIDTH + 2 || stars[i].y > MATRIX_HEIGHT + 2) {
+                if (stars[i].x > MATRIX_WIDTH + 2) {
+                    // Respawn on left side
+                    stars[i].x = -1.5f;
+                    stars[i].y = (i * MATRIX_HEIGHT / NUM_STARS) + (i % 3 - 1);
+                }
+                if (stars[i].y > MATRIX_HEIGHT + 2) {
+                    // Respawn on top side
+                    stars[i].y = -1.5f;
+                    stars[i].x = (i * MATRIX_WIDTH / NUM_STARS) + (i % 3 - 1);
                 }
             }
         }
+        lastStarDriftUpdate = currentTime;
     }
 
     // Draw regular stars
@@ -476,25 +673,163 @@ void EffectsEngine::updateStars() {
             stars[i].twinkleInterval = random(800, 2000);
         }
 
-        // Draw star if on screen and not in text area
+        // Draw star; plotEffectPixel leaves out what is off screen or in the text area
         int pixelX = (int)round(stars[i].x);
         int pixelY = (int)round(stars[i].y);
 
-        if (pixelX >= 0 && pixelX < MATRIX_WIDTH && pixelY >= 0 && pixelY < MATRIX_HEIGHT) {
-            if (!isInTextArea(pixelX, pixelY)) {
-                uint8_t brightness;
-                if (stars[i].shouldTwinkle) {
-                    // Twinkling stars: bright when on, dim when off
-                    brightness =
-                        stars[i].twinkleState ? stars[i].brightness : stars[i].brightness / 3;
-                } else {
-                    // Steady background stars: always at their base dim brightness
-                    brightness = stars[i].brightness;
+        uint8_t brightness;
+        if (stars[i].shouldTwinkle) {
+            // Twinkling stars: bright when on, dim when off
+            brightness = stars[i].twinkleState ? stars[i].brightness : stars[i].brightness / 3;
+        } else {
+            // Steady background stars: always at their base dim brightness
+            brightness = stars[i].brightness;
+        }
+        uint16_t color = display->scaledEffectColor565(brightness, brightness, brightness);
+        plotEffectPixel(pixelX, pixelY, color);
+    }
+}
+
+// ===============================================
+// WARP EFFECT (3D starfield)
+// ===============================================
+
+void EffectsEngine::initializeWarp() {
+    // Reciprocal table replaces the per-star perspective divide: sx = x * recip[z] >> 8
+    warpReciprocal[0] = 0;
+    for (int z = 1; z < WARP_MAX_Z; z++) {
+        warpReciprocal[z] = (WARP_FOCAL << 8) / z;
+    }
+
+    for (int i = 0; i < NUM_WARP_STARS; i++) {
+        respawnWarpStar(i, true);
+    }
+
+    warpSpeed = WARP_CRUISE_SPEED;
+    warpJumping = false;
+    nextWarpJump = millis() + random(15000, 40000);
+    warpColorBrightnessIndex = -1;  // Force color table rebuild on first frame
+}
+
+void EffectsEngine::respawnWarpStar(int index, bool anyDepth) {
+    // New stars appear at the back so they fade in rather than pop up close
+    int z = anyDepth ? random(WARP_MIN_Z, WARP_MAX_Z)
+                     : WARP_MAX_Z - 1 - random(0, WARP_SPAWN_DEPTH);
+    // Keep x and y inside the view at that depth; at the back this is the full spawn range
+    int depth = min(z, WARP_MAX_Z - WARP_SPAWN_DEPTH);
+    int rangeX = WARP_RANGE_X * depth / (WARP_MAX_Z - WARP_SPAWN_DEPTH);
+    int rangeY = WARP_RANGE_Y * depth / (WARP_MAX_Z - WARP_SPAWN_DEPTH);
+    warpStars[index].x = random(-rangeX, rangeX + 1);
+    warpStars[index].y = random(-rangeY, rangeY + 1);
+    warpStars[index].z = z;
+    warpStars[index].prevZ = z;
+}
+
+void EffectsEngine::refreshWarpColors() {
+    int brightnessIndex = settings->getBrightnessIndex();
+    if (brightnessIndex == warpColorBrightnessIndex) {
+        return;
+    }
+
+    // Grey ramp from dim (far) to white (near), scaled once per brightness change
+    for (int level = 0; level < WARP_DEPTH_LEVELS; level++) {
+        uint8_t intensity = 40 + (level * 215) / (WARP_DEPTH_LEVELS - 1);
+        warpDepthColors[level] = display->scaledEffectColor565(intensity, intensity, intensity);
+    }
+    warpColorBrightnessIndex = brightnessIndex;
+}
+
+void EffectsEngine::simulateWarp() {
+    uint32_t currentTime = millis();
+
+    // Periodically jump to warp speed, then ease back to cruising. Deadlines are compared
+    // as signed differences so they still fire across the millis() rollover.
+    if (!warpJumping && (int32_t)(currentTime - nextWarpJump) >= 0) {
+        warpJumping = true;
+        warpJumpEnd = currentTime + WARP_JUMP_DURATION;
+    } else if (warpJumping && (int32_t)(currentTime - warpJumpEnd) >= 0) {
+        warpJumping = false;
+        nextWarpJump = currentTime + random(15000, 40000);
+    }
+    uint8_t targetSpeed = warpJumping ? WARP_JUMP_SPEED : WARP_CRUISE_SPEED;
+    if (warpSpeed < targetSpeed) {
+        warpSpeed++;
+    } else if (warpSpeed > targetSpeed) {
+        warpSpeed--;
+    }
+
+    for (int i = 0; i < NUM_WARP_STARS; i++) {
+        if (warpStars[i].z <= WARP_MIN_Z + warpSpeed) {
+            respawnWarpStar(i, false);
+            continue;
+        }
+        warpStars[i].prevZ = warpStars[i].z;
+        warpStars[i].z -= warpSpeed;
+
+        // Recycle stars that have left the viewport so the field stays dense
+        int32_t recip = warpReciprocal[warpStars[i].z];
+        int sx = (warpStars[i].x * recip) >> 8;
+        int sy = (warpStars[i].y * recip) >> 8;
+        if (abs(sx) > MATRIX_WIDTH / 2 || abs(sy) > MATRIX_HEIGHT / 2) {
+            respawnWarpStar(i, false);
+        }
+    }
+}
+
+void EffectsEngine::renderWarp(float alpha) {
+    const int centerX = MATRIX_WIDTH / 2;
+    const int centerY = MATRIX_HEIGHT / 2;
+    int alpha256 = (int)(alpha * 256.0f);
+
+    refreshWarpColors();
+
+    bool drawStreaks = warpSpeed >= WARP_STREAK_SPEED;
+
+    for (int i = 0; i < NUM_WARP_STARS; i++) {
+        // Interpolate depth between the last two ticks (z only ever decreases)
+        uint16_t z = warpStars[i].prevZ - (((warpStars[i].prevZ - warpStars[i].z) * alpha256) >> 8);
+        int32_t recip = warpReciprocal[z];
+        int sx = centerX + ((warpStars[i].x * recip) >> 8);
+        int sy = centerY + ((warpStars[i].y * recip) >> 8);
+
+        if (sx < 0 || sx >= MATRIX_WIDTH || sy < 0 || sy >= MATRIX_HEIGHT) {
+            continue;
+        }
+
+        int level = ((WARP_MAX_Z - z) * WARP_DEPTH_LEVELS) / WARP_MAX_Z;
+        if (level >= WARP_DEPTH_LEVELS) {
+            level = WARP_DEPTH_LEVELS - 1;
+        }
+
+        if (drawStreaks) {
+            // Tail is where the star was two ticks ago; step toward the head pixel by pixel
+            uint16_t tailZ = z + warpSpeed * 2;
+            if (tailZ >= WARP_MAX_Z) {
+                tailZ = WARP_MAX_Z - 1;
+            }
+            int32_t tailRecip = warpReciprocal[tailZ];
+            int tx = centerX + ((warpStars[i].x * tailRecip) >> 8);
+            int ty = centerY + ((warpStars[i].y * tailRecip) >> 8);
+            int dx = sx - tx;
+            int dy = sy - ty;
+            int steps = max(abs(dx), abs(dy));
+            uint16_t tailColor = warpDepthColors[level / 2];
+
+            if (steps > 0) {
+                // 16.16 fixed point, one division per streak instead of two per pixel
+                int32_t stepX = (dx << 16) / steps;
+                int32_t stepY = (dy << 16) / steps;
+                int32_t px = (tx << 16) + 0x8000;
+                int32_t py = (ty << 16) + 0x8000;
+                for (int s = 0; s < steps; s++) {
+                    plotEffectPixel(px >> 16, py >> 16, tailColor);
+                    px += stepX;
+                    py += stepY;
                 }
-                uint16_t color = display->scaledEffectColor565(brightness, brightness, brightness);
-                display->drawPixel(pixelX, pixelY, color);
             }
         }
+
+        plotEffectPixel(sx, sy, warpDepthColors[level]);
     }
 }
 
@@ -525,15 +860,12 @@ void EffectsEngine::updateSparkles() {
             float brightness = sin(progress * PI) * 255;
             sparkles[i].brightness = (uint8_t)brightness;
 
-            // Draw sparkle if not in text area
-            if (!isInTextArea(sparkles[i].x, sparkles[i].y)) {
-                // Scale the stored color by brightness and apply global brightness
-                uint8_t r = ((sparkles[i].color >> 11) & 0x1F) * sparkles[i].brightness / 255;
-                uint8_t g = ((sparkles[i].color >> 5) & 0x3F) * sparkles[i].brightness / 255;
-                uint8_t b = (sparkles[i].color & 0x1F) * sparkles[i].brightness / 255;
-                uint16_t scaledColor = display->scaledEffectColor565(r << 3, g << 2, b << 3);
-                display->drawPixel(sparkles[i].x, sparkles[i].y, scaledColor);
-            }
+            // Scale the stored color by brightness and apply global brightness
+            uint8_t r = ((sparkles[i].color >> 11) & 0x1F) * sparkles[i].brightness / 255;
+            uint8_t g = ((sparkles[i].color >> 5) & 0x3F) * sparkles[i].brightness / 255;
+            uint8_t b = (sparkles[i].color & 0x1F) * sparkles[i].brightness / 255;
+            uint16_t scaledColor = display->scaledEffectColor565(r << 3, g << 2, b << 3);
+            plotEffectPixel(sparkles[i].x, sparkles[i].y, scaledColor);
         } else {
             // Reset sparkle to new position with new color
             sparkles[i].x = random(0, MATRIX_WIDTH);
@@ -605,13 +937,10 @@ void EffectsEngine::updateFireworks() {
                 // Calculate distance rocket needs to travel (from bottom to explosion height)
                 int travelDistance = fireworks[i].y - fireworks[i].explosionHeight;
                 int rocketY = fireworks[i].y - (progress * travelDistance);
-                if (rocketY >= 0 && rocketY < MATRIX_HEIGHT &&
-                    !isInTextArea(fireworks[i].x, rocketY)) {
-                    // White rocket trail
-                    uint16_t whiteColor =
-                        display->applyEffectBrightness(display->color565(255, 255, 255));
-                    display->drawPixel(fireworks[i].x, rocketY, whiteColor);
-                }
+                // White rocket trail
+                uint16_t whiteColor =
+                    display->applyEffectBrightness(display->color565(255, 255, 255));
+                plotEffectPixel(fireworks[i].x, rocketY, whiteColor);
             }
         } else {
             // Explosion phase - draw expanding particles
@@ -635,16 +964,14 @@ void EffectsEngine::updateFireworks() {
                                (0.1f * elapsed * elapsed / 10000.0f);  // Much reduced gravity
 
                     if (px >= 0 && px < MATRIX_WIDTH && py >= 0 && py < MATRIX_HEIGHT) {
-                        if (!isInTextArea(px, py)) {
-                            // More dramatic fade - particles disappear while still in sky
-                            float fade =
-                                (1.0f - progress) *
-                                (1.0f - progress);  // Exponential fade for more dramatic effect
-                            if (fade > 0.1f) {      // Only draw if fade is significant
-                                uint16_t fadedColor = display->applyEffectBrightness(
-                                    display->scaleBrightness(fireworks[i].color, fade));
-                                display->drawPixel((int)px, (int)py, fadedColor);
-                            }
+                        // More dramatic fade - particles disappear while still in sky
+                        float fade =
+                            (1.0f - progress) *
+                            (1.0f - progress);  // Exponential fade for more dramatic effect
+                        if (fade > 0.1f) {      // Only draw if fade is significant
+                            uint16_t fadedColor = display->applyEffectBrightness(
+                                display->scaleBrightness(fireworks[i].color, fade));
+                            plotEffectPixel((int)px, (int)py, fadedColor);
                         }
                     }
                 }
@@ -774,15 +1101,11 @@ void EffectsEngine::updateTron() {
                 uint8_t segX = tronTrails[i].trailPositions[j][0];
                 uint8_t segY = tronTrails[i].trailPositions[j][1];
 
-                if (segX < MATRIX_WIDTH && segY < MATRIX_HEIGHT) {
-                    if (!isInTextArea(segX, segY)) {
-                        // Fade from dim at tail to bright at head
-                        float brightness = (float)(j + 1) / tronTrails[i].currentLength;
-                        uint16_t fadedColor = display->applyEffectBrightness(
-                            display->scaleBrightness(tronTrails[i].color, brightness));
-                        display->drawPixel(segX, segY, fadedColor);
-                    }
-                }
+                // Fade from dim at tail to bright at head
+                float brightness = (float)(j + 1) / tronTrails[i].currentLength;
+                uint16_t fadedColor = display->applyEffectBrightness(
+                    display->scaleBrightness(tronTrails[i].color, brightness));
+                plotEffectPixel(segX, segY, fadedColor);
             }
         }
     }
@@ -3,13 +3,22 @@
 
 #include <Arduino.h>
 
+#include "AnimationPlayer.h"
 #include "AppState.h"
 #include "MatrixDisplayManager.h"
+#include "Metrics.h"
 #include "SettingsManager.h"
+#include "VideoWall.h"
+
+// Simulation timing
+#define EFFECT_SIM_HZ 30
+#define EFFECT_SIM_STEP_US (1000000UL / EFFECT_SIM_HZ)
+#define EFFECT_SIM_MAX_CATCHUP 4  // Ticks run per frame before dropping time
 
 // Effect Settings
 #define NUM_CONFETTI 40
 #define CONFETTI_RAD 1
+#define WALL_CONFETTI_LIFE 300  // Frames a particle lives on a video wall before it respawns
 
 #define NUM_MATRIX_DROPS 12
 #define MATRIX_CHAR_DELAY 80
@@ -21,9 +30,24 @@
 #define STAR_TWINKLE_CHANCE 5
 
 #define NUM_SHOOTING_STARS 2
-#define SHOOTING_STAR_SPEED 0.8f
+#define SHOOTING_STAR_SPEED 3.0f  // Pixels per simulation tick
 #define SHOOTING_STAR_TRAIL_LENGTH 8
 
+#define NUM_WARP_STARS 32       // All spawn on screen; fewer than Stars keeps Warp cheaper
+#define WARP_MIN_Z 8            // Nearest depth before a star is recycled
+#define WARP_MAX_Z 512          // Farthest depth (size of the reciprocal table)
+#define WARP_FOCAL 64           // Focal length in pixels
+#define WARP_SPAWN_DEPTH 32     // New stars appear this far in front of WARP_MAX_Z
+// World half-size at spawn: the panel's edges projected to the nearest spawn depth, so every
+// new star starts on screen
+#define WARP_RANGE_X (MATRIX_WIDTH / 2 * (WARP_MAX_Z - WARP_SPAWN_DEPTH) / WARP_FOCAL)
+#define WARP_RANGE_Y (MATRIX_HEIGHT / 2 * (WARP_MAX_Z - WARP_SPAWN_DEPTH) / WARP_FOCAL)
+#define WARP_DEPTH_LEVELS 16    // Brightness steps from far to near
+#define WARP_CRUISE_SPEED 3     // Depth units per tick while cruising
+#define WARP_JUMP_SPEED 23      // Depth units per tick during a jump
+#define WARP_STREAK_SPEED 10    // Draw streaks at or above this speed
+#define WARP_JUMP_DURATION 3000
+
 #define NUM_SPARKLES 200
 #define SPARKLE_DURATION 800
 
@@ -39,7 +63,8 @@
 
 // Effect Data Structures
 struct Confetti {
-    float x, y, vx, vy;
+    float x, y, vx, vy;  // Velocity in pixels per simulation tick
+    float prevX, prevY;  // Position at the previous tick, for interpolation
     uint16_t color;
 };
 
@@ -59,8 +84,15 @@ struct Star {
     bool shouldTwinkle;        // Whether this star twinkles or stays steady
 };
 
+struct WarpStar {
+    int16_t x, y;    // World position
+    uint16_t z;      // Depth, WARP_MIN_Z..WARP_MAX_Z-1
+    uint16_t prevZ;  // Depth at the previous tick, for interpolation
+};
+
 struct ShootingStar {
     float x, y;
+    float prevX, prevY;  // Position at the previous tick, for interpolation
     float speedX, speedY;
     bool active;
     uint8_t trailLength;
@@ -100,20 +132,25 @@ struct TronTrail {
 class EffectsEngine {
    public:
     // Constructor
-    EffectsEngine(MatrixDisplayManager* display, SettingsManager* settings);
+    EffectsEngine(MatrixDisplayManager* display, SettingsManager* settings, VideoWall* wall,
+                  AnimationPlayer* animation, Metrics* metrics);
 
     // Initialization
     void begin();
 
     // Effect Control
-    void updateEffects();
+    void updateEffects();      // Run due simulation ticks, then render
+    void simulate();           // Advance the active effect by one fixed tick
+    void render(float alpha);  // Draw, interpolating alpha (0..1) between ticks
     void setMenuPreviewMode(bool isPreview, int previewTextSize = 1);
     void setDisplayMode(AppState displayMode);
 
     // Individual effect controls
     void initializeConfetti();
-    void updateConfetti();
+    void simulateConfetti();
+    void renderConfetti(float alpha);
     void resetConfettiParticle(int index);
+    void renderWallConfetti();
 
     void initializeMatrixRain();
     void updateMatrixRain();
@@ -128,6 +165,12 @@ class EffectsEngine {
     void updateStars();
     void initializeShootingStars();
     void spawnShootingStar(int index);
+    void simulateShootingStars();
+    void renderShootingStars(float alpha);
+
+    void initializeWarp();
+    void simulateWarp();
+    void renderWarp(float alpha);
 
     void initializeSparkles();
     void updateSparkles();
@@ -140,12 +183,15 @@ class EffectsEngine {
 
     // Effect names accessor
     static const char* getEffectNames() {
-        return "Confetti,Acid,Rain,Torrent,Stars,Sparkles,Fireworks,Tron,Off";
+        return "Confetti,Acid,Rain,Torrent,Stars,Sparkles,Fireworks,Tron,Off,Warp,Animation";
     }
 
    private:
     MatrixDisplayManager* display;
     SettingsManager* settings;
+    VideoWall* wall;
+    AnimationPlayer* animation;  // Uploaded animation, streamed from flash
+    Metrics* metrics;            // Ticks run per frame, for /metrics
 
     // Effect particle arrays
     Confetti confetti[NUM_CONFETTI];
@@ -156,6 +202,19 @@ class EffectsEngine {
     Sparkle sparkles[NUM_SPARKLES];
     Firework fireworks[NUM_FIREWORKS];
     TronTrail tronTrails[NUM_TRON_TRAILS];
+    WarpStar warpStars[NUM_WARP_STARS];
+
+    // Stars drift timing
+    uint32_t lastStarDriftUpdate = 0;
+
+    // Warp starfield state
+    uint16_t warpReciprocal[WARP_MAX_Z];  // (WARP_FOCAL << 8) / z
+    uint16_t warpDepthColors[WARP_DEPTH_LEVELS];
+    int warpColorBrightnessIndex = -1;  // Brightness the color table was built for
+    uint8_t warpSpeed = WARP_CRUISE_SPEED;
+    bool warpJumping = false;
+    uint32_t nextWarpJump = 0;
+    uint32_t warpJumpEnd = 0;
 
     // Shooting star timing variables
     uint32_t lastShootingStarTime = 0;
@@ -164,6 +223,11 @@ class EffectsEngine {
     bool waitingForThirdStar = false;
     uint32_t thirdStarTimer = 0;
 
+    // Fixed-step simulation clock
+    uint32_t lastSimMicros = 0;
+    uint32_t simAccumulatorUs = 0;
+    bool simClockStarted = false;
+
     // Menu preview mode
     bool isMenuPreviewMode = false;
     int previewTextSize = 1;
@@ -172,7 +236,12 @@ class EffectsEngine {
     AppState currentDisplayMode = SHOW_TIME;
 
     // Helper functions
+    void syncTextMask();
     bool isInTextArea(int x, int y);
+    void plotEffectPixel(int x, int y, uint16_t color);
+    void plotEffectCircle(int x, int y, int radius, uint16_t color);
+    void respawnWarpStar(int index, bool anyDepth);
+    void refreshWarpColors();
 };
 
 #endif  // EFFECTS_ENGINE_H
@@ -0,0 +1,195 @@
+#include "EventStream.h"
+
+EventStream::EventStream()
+    : socket(nullptr),
+      ring{},
+      subscribers{},
+      head(0),
+      overruns(0),
+      lock(portMUX_INITIALIZER_UNLOCKED) {}
+
+void EventStream::begin(AsyncWebServer* server, ArRequestFilterFunction authorize) {
+    socket = new AsyncWebSocket(EVENT_STREAM_PATH);
+    socket->setFilter(authorize);
+    socket->onEvent([this](AsyncWebSocket* server, AsyncWebSocketClient* client,
+                           AwsEventType type, void* arg, uint8_t* data,
+                           size_t length) { onSocketEvent(client, type); });
+    server->addHandler(socket);
+}
+
+void EventStream::publishMessage(const char* type, const char* id, const char* priority) {
+    char body[EVENT_STREAM_EVENT_SIZE];
+    size_t length = snprintf(body, sizeof(body), ",\"type\":\"%s\",\"id\":", type);
+    if (!appendString(body, sizeof(body), length, id)) {
+        return;
+    }
+    length += snprintf(body + length, sizeof(body) - length, ",\"priority\":\"%s\"}", priority);
+    if (length < sizeof(body)) {
+        publish(body, length);
+    }
+}
+
+void EventStream::publishState(int state) {
+    char body[EVENT_STREAM_EVENT_SIZE];
+    size_t length = snprintf(body, sizeof(body), ",\"type\":\"state\",\"state\":%d}", state);
+    publish(body, length);
+}
+
+void EventStream::publishStats(uint16_t fps, uint32_t freeHeap, int queued) {
+    char body[EVENT_STREAM_EVENT_SIZE];
+    size_t length = snprintf(body, sizeof(body),
+                             ",\"type\":\"stats\",\"fps\":%u,\"heap\":%lu,\"queued\":%d}", fps,
+                             (unsigned long)freeHeap, queued);
+    publish(body, length);
+}
+
+void EventStream::publish(const char* body, size_t length) {
+    if (length >= EVENT_STREAM_EVENT_SIZE) {
+        return;  // Truncated by snprintf
+    }
+    uint32_t now = millis();
+
+    // Only a copy into the ring; subscribers are served later by update()
+    portENTER_CRITICAL(&lock);
+    StreamEvent& event = ring[head % EVENT_STREAM_CAPACITY];
+    event.seq = head;
+    event.ms = now;
+    event.length = length;
+    memcpy(event.body, body, length);
+    head++;
+    portEXIT_CRITICAL(&lock);
+}
+
+bool EventStream::readEvent(uint32_t seq, StreamEvent& event) {
+    portENTER_CRITICAL(&lock);
+    event = ring[seq % EVENT_STREAM_CAPACITY];
+    portEXIT_CRITICAL(&lock);
+    return event.seq == seq;  // False once a newer event took the entry
+}
+
+void EventStream::update() {
+    if (!socket) {
+        return;
+    }
+    for (int i = 0; i < EVENT_STREAM_MAX_SUBSCRIBERS; i++) {
+        portENTER_CRITICAL(&lock);
+        Subscriber subscriber = subscribers[i];
+        portEXIT_CRITICAL(&lock);
+        if (subscriber.clientId == 0) {
+            continue;
+        }
+
+        pump(subscriber);
+
+        // The entry may have been freed or reused while the frames were queued
+        portENTER_CRITICAL(&lock);
+        if (subscribers[i].clientId == subscriber.clientId) {
+            subscribers[i].nextSeq = subscriber.nextSeq;
+        }
+        portEXIT_CRITICAL(&lock);
+    }
+}
+
+void EventStream::pump(Subscriber& subscriber) {
+    AsyncWebSocketClient* client = socket->client(subscriber.clientId);
+    if (!client) {
+        return;
+    }
+
+    char frame[EVENT_STREAM_EVENT_SIZE + 32];
+    for (int sent = 0; sent < EVENT_STREAM_SEND_BUDGET && subscriber.nextSeq != head; sent++) {
+        if (client->queueIsFull()) {
+            return;  // Slow subscriber: leave the events in the ring
+        }
+
+        // Lapped by the ring: skip to the oldest event still held and say how many were lost
+        uint32_t behind = head - subscriber.nextSeq;
+        StreamEvent event;
+        if (behind > EVENT_STREAM_CAPACITY || !readEvent(subscriber.nextSeq, event)) {
+            uint32_t skipped = behind > EVENT_STREAM_CAPACITY ? behind - EVENT_STREAM_CAPACITY : 1;
+            subscriber.nextSeq += skipped;
+            overruns += skipped;
+            int length = snprintf(frame, sizeof(frame),
+                                  "{\"type\":\"overrun\",\"count\":%lu}", (unsigned long)skipped);
+            client->text(frame, length);
+            continue;
+        }
+
+        int length = snprintf(frame, sizeof(frame), "{\"seq\":%lu,\"ms\":%lu%.*s",
+                              (unsigned long)event.seq, (unsigned long)event.ms, event.length,
+                              event.body);
+        client->text(frame, length);
+        subscriber.nextSeq++;
+    }
+}
+
+void EventStream::onSocketEvent(AsyncWebSocketClient* client, AwsEventType type) {
+    if (type == WS_EVT_CONNECT) {
+        bool added = false;
+        portENTER_CRITICAL(&lock);
+        for (int i = 0; i < EVENT_STREAM_MAX_SUBSCRIBERS && !added; i++) {
+            if (subscribers[i].clientId == 0) {
+                // New subscribers start with the next event, not the backlog
+                subscribers[i].clientId = client->id();
+                subscribers[i].nextSeq = head;
+                added = true;
+            }
+        }
+        portEXIT_CRITICAL(&lock);
+        if (!added) {
+            client->close();
+        }
+    } else if (type == WS_EVT_DISCONNECT) {
+        portENTER_CRITICAL(&lock);
+        for (int i = 0; i < EVENT_STREAM_MAX_SUBSCRIBERS; i++) {
+            if (subscribers[i].clientId == client->id()) {
+                subscribers[i].clientId = 0;
+            }
+        }
+        portEXIT_CRITICAL(&lock);
+    }
+}
+
+int EventStream::getSubscriberCount() const {
+    int count = 0;
+    portENTER_CRITICAL(&lock);
+    for (int i = 0; i < EVENT_STREAM_MAX_SUBSCRIBERS; i++) {
+        if (subscribers[i].clientId != 0) {
+            count++;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    return count;
+}
+
+bool EventStream::appendString(char* out, size_t size, size_t& length, const char* text) {
+    // Message ids and poll URLs come from API clients, so quotes and control characters are
+    // escaped
+    if (length + 2 > size) {
+        return false;
+    }
+    out[length++] = '"';
+    for (const char* p = text; *p; p++) {
+        char escape = 0;
+        if (*p == '"' || *p == '\\') {
+            escape = *p;
+        } else if ((uint8_t)*p < 0x20) {
+            escape = 'u';
+        }
+        size_t needed = escape == 'u' ? 6 : (escape ? 2 : 1);
+        if (length + needed + 1 >= size) {
+            return false;
+        }
+        if (escape == 'u') {
+            length += snprintf(out + length, size - length, "\\u%04x", (uint8_t)*p);
+        } else {
+            if (escape) {
+                out[length++] = '\\';
+            }
+            out[length++] = *p;
+        }
+    }
+    out[length++] = '"';
+    out[length] = '\0';
+    return true;
+}
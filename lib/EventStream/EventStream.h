@@ -0,0 +1,74 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <Arduino.h>
+
+#include <ESPAsyncWebServer.h>
+
+// Live feed of display and queue events over a WebSocket, for dashboards that would otherwise
+// poll /status. Producers copy a compact JSON event into a fixed ring and return; update()
+// fans the ring out to subscribers. A subscriber whose send queue is full is skipped, and
+// once the ring has lapped it the events it missed are counted and reported instead of sent.
+#define EVENT_STREAM_PATH "/events"
+#define EVENT_STREAM_CAPACITY 64         // Events held in the ring
+#define EVENT_STREAM_EVENT_SIZE 96       // Longest event body, after seq and ms
+#define EVENT_STREAM_MAX_SUBSCRIBERS 4   // Further connections are closed
+#define EVENT_STREAM_SEND_BUDGET 8       // Events sent to each subscriber per update()
+#define EVENT_STREAM_STATS_MS 1000UL     // Between fps/heap events
+
+// Every event is one text frame: {"seq":N,"ms":M,"type":"...",...}. seq counts up by one
+// per event; after {"type":"overrun","count":K} the next seq is K higher than expected.
+class EventStream {
+   public:
+    EventStream();
+
+    // Registers the WebSocket endpoint; call before the server is started. A handshake is only
+    // accepted when authorize() returns true for it.
+    void begin(AsyncWebServer* server, ArRequestFilterFunction authorize);
+
+    // Safe from any task; never blocks on the network
+    void publishMessage(const char* type, const char* id, const char* priority);
+    void publishState(int state);
+    void publishStats(uint16_t fps, uint32_t freeHeap, int queued);
+
+    // Call from the loop: sends pending events to subscribers that can take them
+    void update();
+
+    int getSubscriberCount() const;
+    uint32_t getPublishedCount() const {
+        return head;
+    }
+    uint32_t getOverrunCount() const {
+        return overruns;
+    }
+
+    // Appends "text" as a JSON string; returns false when it does not fit
+    static bool appendString(char* out, size_t size, size_t& length, const char* text);
+
+   private:
+    struct StreamEvent {
+        uint32_t seq;
+        uint32_t ms;
+        uint8_t length;
+        char body[EVENT_STREAM_EVENT_SIZE];  // Fields after "ms", closing brace included
+    };
+
+    struct Subscriber {
+        uint32_t clientId;  // 0 when the entry is free
+        uint32_t nextSeq;
+    };
+
+    AsyncWebSocket* socket;
+    StreamEvent ring[EVENT_STREAM_CAPACITY];
+    Subscriber subscribers[EVENT_STREAM_MAX_SUBSCRIBERS];
+    volatile uint32_t head;  // Seq of the next event to publish
+    uint32_t overruns;       // Events skipped for slow subscribers, all subscribers together
+    mutable portMUX_TYPE lock;
+
+    void publish(const char* body, size_t length);
+    bool readEvent(uint32_t seq, StreamEvent& event);
+    void pump(Subscriber& subscriber);
+    void onSocketEvent(AsyncWebSocketClient* client, AwsEventType type);
+};
+
+#endif  // EVENT_STREAM_H
@@ -0,0 +1,220 @@
+#include "FrameCapture.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const uint8_t PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+static const uint8_t PNG_IEND[12] = {0, 0, 0, 0, 'I', 'E', 'N', 'D', 0xAE, 0x42, 0x60, 0x82};
+
+// CRC-32 as used by PNG, four bits at a time (a 16-entry table instead of 256)
+static uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+        0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return crc;
+}
+
+static void put32(uint8_t* out, uint32_t value) {
+    out[0] = value >> 24;
+    out[1] = value >> 16;
+    out[2] = value >> 8;
+    out[3] = value;
+}
+
+FrameCapture::FrameCapture(FrameCaptureFormat format, int width, int height, int frames)
+    : format(format),
+      width(width),
+      height(height),
+      frames(frames),
+      frame(0),
+      pos(0),
+      headerLength(0),
+      rowLength(0),
+      trailerLength(0),
+      frameLength(0),
+      header{},
+      trailer{},
+      row{},
+      rowData(row),
+      rowIndex(-1),
+      idatCrcStart(0),
+      idatCrc(0),
+      adlerA(1),
+      adlerB(0) {
+    if (!isValid()) {
+        this->frames = 0;  // Done before it starts
+        return;
+    }
+    buildHeader();
+    frameLength = headerLength + rowLength * height + trailerLength;
+}
+
+bool FrameCapture::parseFormat(const char* name, FrameCaptureFormat& format) {
+    if (strcmp(name, "raw") == 0) {
+        format = FRAME_CAPTURE_RAW;
+    } else if (strcmp(name, "ppm") == 0) {
+        format = FRAME_CAPTURE_PPM;
+    } else if (strcmp(name, "png") == 0) {
+        format = FRAME_CAPTURE_PNG;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool FrameCapture::isValid() const {
+    return width > 0 && width <= FRAME_CAPTURE_MAX_WIDTH && height > 0 && frames > 0 &&
+           (format != FRAME_CAPTURE_PNG || frames == 1);
+}
+
+const char* FrameCapture::getContentType() const {
+    switch (format) {
+        case FRAME_CAPTURE_PPM:
+            return "image/x-portable-pixmap";
+        case FRAME_CAPTURE_PNG:
+            return "image/png";
+        default:
+            return "application/octet-stream";
+    }
+}
+
+size_t FrameCapture::read(const uint16_t* pixels, uint8_t* out, size_t maxLength) {
+    size_t written = 0;
+    while (written < maxLength && !isDone()) {
+        const uint8_t* from;
+        size_t available;
+        size_t rowsEnd = headerLength + rowLength * height;
+        if (pos < headerLength) {
+            from = header + pos;
+            available = headerLength - pos;
+        } else if (pos < rowsEnd) {
+            int y = (pos - headerLength) / rowLength;
+            size_t offset = (pos - headerLength) % rowLength;
+            if (y != rowIndex) {
+                convertRow(pixels, y);
+            }
+            from = rowData + offset;
+            available = rowLength - offset;
+        } else {
+            if (pos == rowsEnd) {
+                buildTrailer();
+            }
+            from = trailer + (pos - rowsEnd);
+            available = frameLength - pos;
+        }
+
+        size_t count = available < maxLength - written ? available : maxLength - written;
+        memcpy(out + written, from, count);
+        written += count;
+        pos += count;
+        if (pos == frameLength) {
+            frame++;
+            pos = 0;
+            rowIndex = -1;
+            break;
+        }
+    }
+    return written;
+}
+
+void FrameCapture::buildHeader() {
+    if (format == FRAME_CAPTURE_RAW) {
+        rowLength = width * 2;
+        return;
+    }
+    if (format == FRAME_CAPTURE_PPM) {
+        headerLength = snprintf((char*)header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+        rowLength = width * 3;
+        return;
+    }
+
+    // One stored block per row: its header (5), the filter type (1, none) and the pixels
+    rowLength = 6 + width * 3;
+    trailerLength = 4 + 4 + sizeof(PNG_IEND);
+    uint8_t* out = header;
+    memcpy(out, PNG_SIGNATURE, sizeof(PNG_SIGNATURE));
+    out += sizeof(PNG_SIGNATURE);
+
+    // IHDR: 8-bit truecolor, no interlace
+    put32(out, 13);
+    memcpy(out + 4, "IHDR", 4);
+    put32(out + 8, width);
+    put32(out + 12, height);
+    const uint8_t ihdrTail[5] = {8, 2, 0, 0, 0};
+    memcpy(out + 16, ihdrTail, sizeof(ihdrTail));
+    put32(out + 21, crc32Update(0xFFFFFFFF, out + 4, 17) ^ 0xFFFFFFFF);
+    out += 25;
+
+    // IDAT: zlib header (deflate, 32K window, no preset dictionary), then the rows
+    put32(out, 2 + rowLength * height + 4);
+    memcpy(out + 4, "IDAT", 4);
+    out[8] = 0x78;
+    out[9] = 0x01;
+    idatCrcStart = crc32Update(0xFFFFFFFF, out + 4, 6);
+    out += 10;
+    headerLength = out - header;
+}
+
+void FrameCapture::convertRow(const uint16_t* pixels, int y) {
+    const uint16_t* in = pixels + y * width;
+    rowIndex = y;
+    if (format == FRAME_CAPTURE_RAW) {
+        rowData = (const uint8_t*)in;  // Both sides are little endian RGB565
+        return;
+    }
+
+    uint8_t* out = row;
+    if (format == FRAME_CAPTURE_PNG) {
+        if (y == 0) {
+            idatCrc = idatCrcStart;
+            adlerA = 1;
+            adlerB = 0;
+        }
+        uint16_t length = 1 + width * 3;
+        out[0] = y == height - 1;  // BFINAL on the last row, BTYPE 00 (stored)
+        out[1] = length;
+        out[2] = length >> 8;
+        out[3] = ~length;
+        out[4] = ~length >> 8;
+        out[5] = 0;
+        out += 6;
+    }
+    // Low bits repeat the high ones, so full-scale channels map to 255
+    for (int x = 0; x < width; x++) {
+        uint16_t color = in[x];
+        uint8_t r = color >> 11;
+        uint8_t g = (color >> 5) & 0x3F;
+        uint8_t b = color & 0x1F;
+        out[0] = (r << 3) | (r >> 2);
+        out[1] = (g << 2) | (g >> 4);
+        out[2] = (b << 3) | (b >> 2);
+        out += 3;
+    }
+    rowData = row;
+
+    if (format == FRAME_CAPTURE_PNG) {
+        // Adler-32 covers the filtered data only; one row cannot overflow before the modulo
+        for (const uint8_t* p = row + 5; p < out; p++) {
+            adlerA += *p;
+            adlerB += adlerA;
+        }
+        adlerA %= 65521;
+        adlerB %= 65521;
+        idatCrc = crc32Update(idatCrc, row, rowLength);
+    }
+}
+
+void FrameCapture::buildTrailer() {
+    if (format != FRAME_CAPTURE_PNG) {
+        return;
+    }
+    put32(trailer, (adlerB << 16) | adlerA);
+    put32(trailer + 4, crc32Update(idatCrc, trailer, 4) ^ 0xFFFFFFFF);
+    memcpy(trailer + 8, PNG_IEND, sizeof(PNG_IEND));
+}
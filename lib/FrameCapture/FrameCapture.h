@@ -0,0 +1,83 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Encodes RGB565 frames as raw RGB565, PPM or PNG for GET /frame. Output is produced on
+// demand in pieces of any size, converting one row at a time from the caller's frame, so the
+// frame is never copied and the total length is known before the first byte.
+//
+// Only the C library is used, so a host harness can build this file on its own and write
+// golden images from its own frame buffer with the same bytes the clock would send:
+//   FrameCapture capture(FRAME_CAPTURE_PNG, 128, 32, 1);
+//   while (!capture.isDone()) fwrite(buf, 1, capture.read(pixels, buf, sizeof(buf)), out);
+//
+// raw: each frame as it is in memory, 2 bytes per pixel, little endian
+// ppm: binary PPM (P6), 8-bit RGB; several frames simply follow each other
+// png: 8-bit RGB, one frame only. The image data is a zlib stream of stored (uncompressed)
+//   deflate blocks, one per row, so no compressor state is needed.
+#define FRAME_CAPTURE_MAX_WIDTH 256
+#define FRAME_CAPTURE_HEADER_MAX 48   // PNG signature, IHDR and the IDAT start
+#define FRAME_CAPTURE_TRAILER_MAX 20  // PNG Adler-32, IDAT CRC and IEND
+
+enum FrameCaptureFormat : uint8_t { FRAME_CAPTURE_RAW, FRAME_CAPTURE_PPM, FRAME_CAPTURE_PNG };
+
+class FrameCapture {
+   public:
+    // frames must be 1 for PNG; isValid() tells whether the combination can be encoded
+    FrameCapture(FrameCaptureFormat format, int width, int height, int frames);
+
+    // "raw", "ppm" or "png"; false for anything else
+    static bool parseFormat(const char* name, FrameCaptureFormat& format);
+
+    bool isValid() const;
+    const char* getContentType() const;
+    size_t getLength() const {
+        return frameLength * frames;
+    }
+    // The next byte read starts a frame, so the caller may move on to the next one
+    bool isFrameStart() const {
+        return pos == 0;
+    }
+    bool isDone() const {
+        return frame >= frames;
+    }
+
+    // Writes up to maxLength bytes of the current frame from pixels (width x height RGB565,
+    // row by row) and returns how many. Stops at the end of a frame, so each call reads one
+    // frame only; rows are read as the output reaches them.
+    size_t read(const uint16_t* pixels, uint8_t* out, size_t maxLength);
+
+   private:
+    FrameCaptureFormat format;
+    int width;
+    int height;
+    int frames;
+    int frame;   // Being read
+    size_t pos;  // Within the frame
+
+    size_t headerLength;
+    size_t rowLength;
+    size_t trailerLength;
+    size_t frameLength;
+    uint8_t header[FRAME_CAPTURE_HEADER_MAX];
+    uint8_t trailer[FRAME_CAPTURE_TRAILER_MAX];
+
+    // The row being read, converted; raw rows are read from the frame directly
+    uint8_t row[6 + FRAME_CAPTURE_MAX_WIDTH * 3];
+    const uint8_t* rowData;
+    int rowIndex;
+
+    // PNG checksums of the frame so far, updated as each row is converted
+    uint32_t idatCrcStart;  // Over "IDAT" and the zlib header
+    uint32_t idatCrc;
+    uint32_t adlerA;
+    uint32_t adlerB;
+
+    void buildHeader();
+    void convertRow(const uint16_t* pixels, int y);
+    void buildTrailer();
+};
+
+#endif  // FRAME_CAPTURE_H
@@ -0,0 +1,151 @@
+#include "FrameCodec.h"
+
+static uint16_t get16(const uint8_t* in) {
+    return in[0] | (in[1] << 8);
+}
+
+bool FrameCodec::parseHeader(const uint8_t* data, size_t length, int width, int height,
+                             FrameCodecHeader& header) {
+    if (length < FRAME_CODEC_HEADER_SIZE || data[0] != 'F' || data[1] != 'C' ||
+        data[2] != FRAME_CODEC_VERSION || get16(data + 4) != width ||
+        get16(data + 6) != height || height > FRAME_CODEC_MAX_HEIGHT) {
+        return false;
+    }
+    header.delta = data[3] & FRAME_CODEC_DELTA;
+    header.palette = data[3] & FRAME_CODEC_PALETTE;
+    header.width = width;
+    header.height = height;
+
+    size_t pos = FRAME_CODEC_HEADER_SIZE;
+    size_t maskBytes = (height + 7) / 8;
+    if (length < pos + maskBytes) {
+        return false;
+    }
+    memcpy(header.rowMask, data + pos, maskBytes);
+    pos += maskBytes;
+
+    header.paletteSize = 0;
+    if (header.palette) {
+        if (length < pos + 1) {
+            return false;
+        }
+        header.paletteSize = data[pos] ? data[pos] : FRAME_CODEC_PALETTE_MAX;
+        pos++;
+        if (length < pos + header.paletteSize * 2) {
+            return false;
+        }
+        for (int i = 0; i < header.paletteSize; i++) {
+            header.colors[i] = get16(data + pos + i * 2);
+        }
+        // Indices past the palette decode as 0, so the row loops need no range checks
+        for (int i = header.paletteSize; i < FRAME_CODEC_PALETTE_MAX; i++) {
+            header.colors[i] = 0;
+        }
+        pos += header.paletteSize * 2;
+    }
+    header.size = pos;
+    return true;
+}
+
+bool FrameCodec::decodeRow(const FrameCodecHeader& header, const uint8_t* data, size_t length,
+                           uint16_t* pixels) {
+    const uint8_t* in = data;
+    const uint8_t* end = data + length;
+    uint16_t* out = pixels;
+    uint16_t* rowEnd = pixels + header.width;
+    size_t valueSize = header.palette ? 1 : 2;
+
+    while (out < rowEnd) {
+        if (in >= end) {
+            return false;
+        }
+        uint8_t control = *in++;
+        int count = (control & FRAME_CODEC_RUN_LITERAL) ? (control & 0x7F) + 1
+                                                        : (control & 0x3F) + 1;
+        if (count > rowEnd - out) {
+            return false;
+        }
+
+        if (control < FRAME_CODEC_RUN_REPEAT) {
+            // Zero: nothing changes in a delta, black in a key frame
+            if (!header.delta) {
+                memset(out, 0, count * sizeof(uint16_t));
+            }
+            out += count;
+            continue;
+        }
+
+        size_t needed = (control < FRAME_CODEC_RUN_LITERAL ? 1 : count) * valueSize;
+        if ((size_t)(end - in) < needed) {
+            return false;
+        }
+        if (control < FRAME_CODEC_RUN_LITERAL) {
+            uint16_t value;
+            if (header.palette) {
+                value = header.colors[*in];
+            } else {
+                value = get16(in);
+            }
+            in += valueSize;
+            if (header.delta) {
+                for (int i = 0; i < count; i++) {
+                    out[i] ^= value;
+                }
+            } else {
+                for (int i = 0; i < count; i++) {
+                    out[i] = value;
+                }
+            }
+        } else if (header.palette && header.delta) {
+            for (int i = 0; i < count; i++) {
+                out[i] ^= header.colors[in[i]];
+            }
+            in += count;
+        } else if (header.palette) {
+            for (int i = 0; i < count; i++) {
+                out[i] = header.colors[in[i]];
+            }
+            in += count;
+        } else if (header.delta) {
+            for (int i = 0; i < count; i++) {
+                out[i] ^= get16(in + i * 2);
+            }
+            in += count * 2;
+        } else {
+            // Both sides are little endian RGB565
+            memcpy(out, in, count * 2);
+            in += count * 2;
+        }
+        out += count;
+    }
+    return in == end;
+}
+
+bool FrameCodec::decode(const uint8_t* data, size_t length, uint16_t* frame, int width,
+                        int height) {
+    FrameCodecHeader header;
+    if (!parseHeader(data, length, width, height, header)) {
+        return false;
+    }
+
+    size_t pos = header.size;
+    for (int row = 0; row < height; row++) {
+        uint16_t* pixels = frame + row * width;
+        if (!header.isRowCoded(row)) {
+            if (!header.delta) {
+                memset(pixels, 0, width * sizeof(uint16_t));
+            }
+            continue;
+        }
+        if (length < pos + 2) {
+            return false;
+        }
+        size_t rowLength = get16(data + pos);
+        pos += 2;
+        if (length < pos + rowLength || !decodeRow(header, data + pos, rowLength, pixels)) {
+            return false;
+        }
+        pos += rowLength;
+    }
+    return pos == length;
+}
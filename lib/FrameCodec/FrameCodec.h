@@ -0,0 +1,70 @@
+#ifndef FRAME_CODEC_H
+#define FRAME_CODEC_H
+
+#include <Arduino.h>
+
+// Compressed RGB565 frames, encoded by tools/frame_codec.py. A frame is either a key frame or
+// a delta that is XORed onto the previous frame, so pixels that did not change cost nothing.
+// Decoding happens in place on the buffer that holds the previous frame; no second frame
+// buffer is needed.
+//
+// Frame (little endian):
+//   magic "FC" (2), version (1), flags (1), width (2), height (2)
+//   row mask: (height + 7) / 8 bytes, bit r (LSB first) set if row r is coded. An uncoded row
+//     is unchanged in a delta and black in a key frame.
+//   palette mode only: entry count (1, 0 means 256), entries (2 each, RGB565)
+//   each coded row: its byte length (2), then runs that cover exactly width pixels
+//
+// Runs start with a control byte c. Values are RGB565 (2 bytes) or, in palette mode, a palette
+// index (1 byte); in a delta they are XOR masks.
+//   0x00-0x3F: (c & 0x3F) + 1 zero values, no data
+//   0x40-0x7F: (c & 0x3F) + 1 copies of one value
+//   0x80-0xFF: (c & 0x7F) + 1 values
+#define FRAME_CODEC_VERSION 1
+#define FRAME_CODEC_HEADER_SIZE 8
+#define FRAME_CODEC_DELTA 0x01    // XOR onto the previous frame
+#define FRAME_CODEC_PALETTE 0x02  // Values are palette indices
+#define FRAME_CODEC_MAX_HEIGHT 64
+#define FRAME_CODEC_PALETTE_MAX 256
+// Largest frame tools/frame_codec.py writes: every row coded as RGB565 literals, one control
+// byte per 128 of them. Palette frames with all 256 entries are smaller.
+#define FRAME_CODEC_MAX_BYTES(width, height) \
+    (FRAME_CODEC_HEADER_SIZE + ((height) + 7) / 8 + \
+     (height) * (2 + ((width) + 127) / 128 + 2 * (width)))
+
+#define FRAME_CODEC_RUN_ZERO 0x00
+#define FRAME_CODEC_RUN_REPEAT 0x40
+#define FRAME_CODEC_RUN_LITERAL 0x80
+
+struct FrameCodecHeader {
+    bool delta;
+    bool palette;
+    uint16_t width;
+    uint16_t height;
+    uint8_t rowMask[FRAME_CODEC_MAX_HEIGHT / 8];
+    uint16_t paletteSize;
+    uint16_t colors[FRAME_CODEC_PALETTE_MAX];
+    size_t size;  // Bytes up to the first coded row
+
+    bool isRowCoded(int row) const {
+        return rowMask[row >> 3] & (1 << (row & 7));
+    }
+};
+
+class FrameCodec {
+   public:
+    // Reads the header, row mask and palette; false if malformed or not width x height
+    static bool parseHeader(const uint8_t* data, size_t length, int width, int height,
+                            FrameCodecHeader& header);
+
+    // Applies the runs of one coded row (without its length) to the row's pixels
+    static bool decodeRow(const FrameCodecHeader& header, const uint8_t* data, size_t length,
+                          uint16_t* pixels);
+
+    // Applies a whole frame to a width x height buffer holding the previous frame. On false
+    // the buffer may be partly updated and only a key frame makes it whole again.
+    static bool decode(const uint8_t* data, size_t length, uint16_t* frame, int width,
+                       int height);
+};
+
+#endif  // FRAME_CODEC_H
@@ -0,0 +1,255 @@
+#include "Log.h"
+
+static_assert((LOG_RING_RECORDS & (LOG_RING_RECORDS - 1)) == 0, "ring size must be a power of two");
+
+static const uint32_t RING_MASK = LOG_RING_RECORDS - 1;
+static const char LEVEL_LETTERS[] = "DIWE";
+
+// A bounded queue after Dmitry Vyukov: each cell's sequence says whether the cell is free for
+// the writer at a ring position or holds a record for the reader there. Writers claim positions
+// with a compare-and-swap, so any number of tasks can write without a lock; the drain task is
+// the only reader. Sequences are stored minus the cell index so the zeroed ring is ready
+// before any constructor runs.
+struct LogCell {
+    std::atomic<uint32_t> sequence;
+    LogEntry entry;
+};
+
+static LogCell ring[LOG_RING_RECORDS];
+static std::atomic<uint32_t> writePos(0);
+static uint32_t readPos = 0;  // Drain task only
+static std::atomic<uint32_t> dropped(0);
+static std::atomic<bool> serialHeld(false);
+
+static char history[LOG_HISTORY_BYTES];
+static uint32_t historyEnd = 0;
+static portMUX_TYPE historyLock = portMUX_INITIALIZER_UNLOCKED;
+
+void Log::begin() {
+    xTaskCreatePinnedToCore(drainTask, "log", LOG_TASK_STACK, nullptr, 1, nullptr, 0);
+}
+
+LogEntry* Log::reserve(uint32_t& pos) {
+    pos = writePos.load(std::memory_order_relaxed);
+    while (true) {
+        LogCell& cell = ring[pos & RING_MASK];
+        uint32_t sequence = cell.sequence.load(std::memory_order_acquire) + (pos & RING_MASK);
+        int32_t lag = (int32_t)(sequence - pos);
+        if (lag == 0) {
+            if (writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                return &cell.entry;
+            }
+        } else if (lag < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);  // Full
+            return nullptr;
+        } else {
+            pos = writePos.load(std::memory_order_relaxed);  // Another writer took it
+        }
+    }
+}
+
+void Log::commit(uint32_t pos) {
+    ring[pos & RING_MASK].sequence.store(pos + 1 - (pos & RING_MASK), std::memory_order_release);
+}
+
+bool Log::pop(LogEntry& entry) {
+    LogCell& cell = ring[readPos & RING_MASK];
+    uint32_t sequence = cell.sequence.load(std::memory_order_acquire) + (readPos & RING_MASK);
+    if (sequence != readPos + 1) {
+        return false;  // Empty, or the writer is not done yet
+    }
+    entry = cell.entry;
+    cell.sequence.store(readPos + LOG_RING_RECORDS - (readPos & RING_MASK),
+                        std::memory_order_release);
+    readPos++;
+    entry.text[LOG_TEXT_MAX - 1] = '\0';
+    return true;
+}
+
+void Log::addText(LogEntry& entry, const char* text) {
+    if (entry.argCount == LOG_ARGS_MAX) {
+        return;
+    }
+    size_t room = LOG_TEXT_MAX - entry.textLength;
+    if (room == 0) {
+        addWord(entry, LOG_TEXT_MAX);  // Printed as an empty string
+        return;
+    }
+    size_t length = text ? strnlen(text, room - 1) : 0;
+    memcpy(entry.text + entry.textLength, text, length);
+    entry.text[entry.textLength + length] = '\0';
+    addWord(entry, entry.textLength);
+    entry.textLength += length + 1;
+}
+
+size_t Log::formatLine(const LogEntry& entry, char* out, size_t size) {
+    // Everything is written through snprintf with the room left, then cut to leave the last
+    // byte for the newline
+    size_t limit = size - 1;
+    int written = snprintf(out, size, "%4lu.%03lu %c ", (unsigned long)(entry.ms / 1000),
+                           (unsigned long)(entry.ms % 1000), LEVEL_LETTERS[entry.level & 3]);
+    size_t length = written < (int)limit ? written : limit;
+    const char* p = entry.format;
+    int arg = 0;
+    while (*p && length < limit) {
+        if (*p != '%') {
+            out[length++] = *p++;
+            continue;
+        }
+        p++;
+        if (*p == '%') {
+            out[length++] = *p++;
+            continue;
+        }
+
+        // Flags, width and precision are kept; length modifiers are not, as every argument is
+        // 32 bits and is printed with its own
+        char spec[16] = "%";
+        size_t specLength = 1;
+        while (*p && strchr("-+ #0123456789.", *p)) {
+            if (specLength < sizeof(spec) - 3) {
+                spec[specLength++] = *p;
+            }
+            p++;
+        }
+        while (*p && strchr("hljztL", *p)) {
+            p++;
+        }
+        char conversion = *p;
+        if (!conversion) {
+            break;
+        }
+        p++;
+        uint32_t value = arg < entry.argCount ? entry.args[arg] : 0;
+        arg++;
+
+        char* at = out + length;
+        size_t room = size - length;
+        switch (conversion) {
+            case 'd':
+            case 'i':
+                strcpy(spec + specLength, "ld");
+                written = snprintf(at, room, spec, (long)(int32_t)value);
+                break;
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+                spec[specLength] = 'l';
+                spec[specLength + 1] = conversion;
+                written = snprintf(at, room, spec, (unsigned long)value);
+                break;
+            case 'c':
+                spec[specLength] = 'c';
+                written = snprintf(at, room, spec, (int)value);
+                break;
+            case 's':
+                spec[specLength] = 's';
+                written =
+                    snprintf(at, room, spec, value < LOG_TEXT_MAX ? entry.text + value : "");
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G': {
+                float number;
+                memcpy(&number, &value, sizeof(number));
+                spec[specLength] = conversion;
+                written = snprintf(at, room, spec, (double)number);
+                break;
+            }
+            case 'p':
+                written = snprintf(at, room, "0x%08lx", (unsigned long)value);
+                break;
+            default:
+                written = 0;
+                break;
+        }
+        if (written > 0) {
+            length += (size_t)written < limit - length ? written : limit - length;
+        }
+    }
+    out[length++] = '\n';
+    return length;
+}
+
+void Log::appendHistory(const char* text, size_t length) {
+    portENTER_CRITICAL(&historyLock);
+    for (size_t i = 0; i < length; i++) {
+        history[(historyEnd + i) % LOG_HISTORY_BYTES] = text[i];
+    }
+    historyEnd += length;
+    portEXIT_CRITICAL(&historyLock);
+}
+
+uint32_t Log::getHistoryEnd() {
+    portENTER_CRITICAL(&historyLock);
+    uint32_t end = historyEnd;
+    portEXIT_CRITICAL(&historyLock);
+    return end;
+}
+
+size_t Log::readHistory(uint32_t& position, uint32_t end, char* out, size_t maxLength) {
+    size_t length = 0;
+    portENTER_CRITICAL(&historyLock);
+    uint32_t oldest = historyEnd > LOG_HISTORY_BYTES ? historyEnd - LOG_HISTORY_BYTES : 0;
+    if ((int32_t)(position - oldest) < 0) {
+        // Overwritten: skip the rest of the cut line
+        position = oldest;
+        while (position != historyEnd && history[position % LOG_HISTORY_BYTES] != '\n') {
+            position++;
+        }
+        if (position != historyEnd) {
+            position++;
+        }
+    }
+    while (length < maxLength && (int32_t)(end - position) > 0) {
+        out[length++] = history[position % LOG_HISTORY_BYTES];
+        position++;
+    }
+    portEXIT_CRITICAL(&historyLock);
+    return length;
+}
+
+uint32_t Log::getDropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+void Log::holdSerial(bool hold) {
+    serialHeld.store(hold);
+}
+
+void Log::drainTask(void* param) {
+    LogEntry entry;
+    char line[LOG_LINE_MAX];
+    uint32_t reported = 0;
+    while (true) {
+        if (serialHeld.load()) {
+            vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+            continue;
+        }
+        while (pop(entry)) {
+            size_t length = formatLine(entry, line, sizeof(line));
+            Serial.write((const uint8_t*)line, length);
+            appendHistory(line, length);
+        }
+
+        // Said once the ring has room again, so it comes after the records that made it
+        uint32_t count = getDropped();
+        if (count != reported) {
+            LogEntry note = {};
+            note.ms = millis();
+            note.format = "Log: %lu records dropped, ring full";
+            note.level = LOG_LEVEL_WARN;
+            note.argCount = 1;
+            note.args[0] = count - reported;
+            reported = count;
+            size_t length = formatLine(note, line, sizeof(line));
+            Serial.write((const uint8_t*)line, length);
+            appendHistory(line, length);
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
+    }
+}
@@ -0,0 +1,156 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+
+#include <atomic>
+
+// Logging that never waits for the UART. LOG_INFO("MessageClient: queued %s", text) stores a
+// binary record (time, the format string's address, level and arguments) in a RAM ring and
+// returns. A low-priority task on core 0 formats the records, writes them to Serial and keeps
+// the last few KB of text for GET /logs. The format must be a string literal, as only its
+// address is kept.
+//
+// Arguments are stored as 32 bits each: integers, enums, bool, pointers, and floating point as
+// float. Strings are copied into the record, cut to LOG_TEXT_MAX bytes for all of them together.
+// A record that finds the ring full is dropped and counted, never waited for. Calls below
+// LOG_LEVEL are compiled out, arguments and all.
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+#ifndef LOG_RING_RECORDS
+#define LOG_RING_RECORDS 64  // Power of two
+#endif
+#ifndef LOG_HISTORY_BYTES
+#define LOG_HISTORY_BYTES 4096  // Text kept for GET /logs
+#endif
+#define LOG_ARGS_MAX 6
+#define LOG_TEXT_MAX 48   // String arguments of one record, terminators included
+#define LOG_LINE_MAX 160  // Formatted line, longer ones are cut
+#define LOG_DRAIN_MS 20   // Drain task sleep between passes over the ring
+#define LOG_TASK_STACK 4096
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Log::write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) Log::write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) Log::write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Log::write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+struct LogEntry {
+    uint32_t ms;
+    const char* format;
+    uint8_t level;
+    uint8_t argCount;
+    uint8_t textLength;
+    uint32_t args[LOG_ARGS_MAX];  // Strings are offsets into text
+    char text[LOG_TEXT_MAX];
+};
+
+class Log {
+   public:
+    // Starts the drain task; records written before are kept and drained then
+    static void begin();
+
+    // From any task, not from interrupts. Use the LOG_ macros instead.
+    template <typename... Args>
+    static void write(uint8_t level, const char* format, const Args&... args) {
+        static_assert(sizeof...(Args) <= LOG_ARGS_MAX, "too many log arguments");
+        uint32_t pos;
+        LogEntry* entry = reserve(pos);
+        if (!entry) {
+            return;
+        }
+        entry->ms = millis();
+        entry->format = format;
+        entry->level = level;
+        entry->argCount = 0;
+        entry->textLength = 0;
+        int expand[] = {0, (add(*entry, args), 0)...};
+        (void)expand;
+        commit(pos);
+    }
+
+    // Text written so far, counted from boot; the history holds its last LOG_HISTORY_BYTES
+    static uint32_t getHistoryEnd();
+    // Copies history from position up to end and moves position on. A position the history has
+    // already overwritten moves up to the oldest whole line still there.
+    static size_t readHistory(uint32_t& position, uint32_t end, char* out, size_t maxLength);
+    static uint32_t getDropped();
+    // While held, the drain task leaves records in the ring, for a dump that needs the serial
+    // port to itself. Records that do not fit meanwhile are dropped and counted as usual.
+    static void holdSerial(bool hold);
+
+    // One line, "  12.345 I text\n"; returns its length
+    static size_t formatLine(const LogEntry& entry, char* out, size_t size);
+
+   private:
+    static LogEntry* reserve(uint32_t& pos);
+    static void commit(uint32_t pos);
+    static bool pop(LogEntry& entry);
+    static void appendHistory(const char* text, size_t length);
+    static void drainTask(void* param);
+
+    static void addWord(LogEntry& entry, uint32_t value) {
+        if (entry.argCount < LOG_ARGS_MAX) {
+            entry.args[entry.argCount++] = value;
+        }
+    }
+    static void addText(LogEntry& entry, const char* text);
+
+    static void add(LogEntry& entry, int value) {
+        addWord(entry, value);
+    }
+    static void add(LogEntry& entry, unsigned int value) {
+        addWord(entry, value);
+    }
+    static void add(LogEntry& entry, long value) {
+        addWord(entry, value);
+    }
+    static void add(LogEntry& entry, unsigned long value) {
+        addWord(entry, value);
+    }
+    static void add(LogEntry& entry, long long value) {
+        addWord(entry, value);  // Low 32 bits
+    }
+    static void add(LogEntry& entry, unsigned long long value) {
+        addWord(entry, value);
+    }
+    static void add(LogEntry& entry, double value) {
+        float narrow = value;
+        uint32_t bits;
+        memcpy(&bits, &narrow, sizeof(bits));
+        addWord(entry, bits);
+    }
+    static void add(LogEntry& entry, const void* value) {
+        addWord(entry, (uint32_t)(uintptr_t)value);
+    }
+    static void add(LogEntry& entry, const char* value) {
+        addText(entry, value);
+    }
+    static void add(LogEntry& entry, const String& value) {
+        addText(entry, value.c_str());
+    }
+};
+
+#endif  // LOG_H
@@ -1,10 +1,36 @@
 #include "MatrixDisplayManager.h"
 
-MatrixDisplayManager::MatrixDisplayManager(Adafruit_Protomatter* matrix, SettingsManager* settings)
-    : mqHead(0),
-      mqTail(0),
-      mqCount(0),
-      hasActiveMessage(false),
+#include "Log.h"
+#include "Trace.h"
+
+// Holds the message queue lock for one scope. Messages arrive on the web server task while
+// the loop task renders from the same slots. A no-op before begin() creates the lock.
+class QueueLockGuard {
+   public:
+    explicit QueueLockGuard(SemaphoreHandle_t lock) : lock(lock) {
+        if (lock) {
+            xSemaphoreTake(lock, portMAX_DELAY);
+        }
+    }
+    ~QueueLockGuard() {
+        if (lock) {
+            xSemaphoreGive(lock);
+        }
+    }
+
+   private:
+    SemaphoreHandle_t lock;
+};
+
+MatrixDisplayManager::MatrixDisplayManager(Adafruit_Protomatter* matrix, SettingsManager* settings,
+                                           EventStream* events, VideoWall* wall, Metrics* metrics)
+    : messageClockLastMs(0),
+      messageClockCarryMs(0),
+      messageClockSeconds(0),
+      queueLock(nullptr),
+      activeSlot(MESSAGE_NO_SLOT),
+      activeTextWidth(0),
+      activeTextChanged(false),
       activeTextSize(1),
       activeScrollX(0),
       activeScrollDir(1),
@@ -13,14 +39,32 @@ MatrixDisplayManager::MatrixDisplayManager(Adafruit_Protomatter* matrix, Setting
       activeDuration(0),
       activeScrollSpeed(50),
       activeColor(0xFFFF),
+      activeOriginFrame(0),
+      activeTextHash(0),
       matrix(matrix),
-      settings(settings) {}
+      settings(settings),
+      events(events),
+      wall(wall),
+      metrics(metrics),
+      frameCount(0),
+      lastShowUs(0),
+      captureState(CAPTURE_IDLE),
+      captureId(0),
+      captureLock(portMUX_INITIALIZER_UNLOCKED),
+      textDistance{},
+      textHaloLevels{},
+      textMaskClearance(0),
+      textMaskLayout(TEXT_MASK_NONE),
+      textMaskTextSize(0),
+      textMask24Hour(true),
+      textMaskValid(false) {}
 
 void MatrixDisplayManager::begin() {
     matrix->setTextWrap(false);
     matrix->setTextColor(textColors[settings->getBrightnessIndex()]);
     matrix->setTextSize(settings->getTextSize());
-    Serial.println("Matrix Display Manager initialized");
+    queueLock = xSemaphoreCreateMutex();
+    LOG_INFO("Matrix Display Manager initialized");
 }
 
 // Basic display operations
@@ -29,7 +73,70 @@ void MatrixDisplayManager::clearScreen() {
 }
 
 void MatrixDisplayManager::show() {
+    TRACE_SCOPE("show");
     matrix->show();
+    uint32_t now = micros();
+    if (frameCount > 0) {
+        metrics->countFrame(now - lastShowUs);
+    }
+    lastShowUs = now;
+    frameCount++;
+
+    // A frame asked for by GET /frame is copied out now, outside the lock. A capture
+    // cancelled meanwhile, or replaced by a new one, does not get it.
+    portENTER_CRITICAL(&captureLock);
+    uint32_t id = captureState == CAPTURE_WAITING ? captureId : 0;
+    portEXIT_CRITICAL(&captureLock);
+    if (id != 0) {
+        memcpy(captureFrame, matrix->getBuffer(), sizeof(captureFrame));
+        portENTER_CRITICAL(&captureLock);
+        if (captureState == CAPTURE_WAITING && captureId == id) {
+            captureState = CAPTURE_READY;
+        }
+        portEXIT_CRITICAL(&captureLock);
+    }
+}
+
+uint32_t MatrixDisplayManager::requestCapture() {
+    uint32_t id = 0;
+    portENTER_CRITICAL(&captureLock);
+    if (captureState == CAPTURE_IDLE) {
+        captureState = CAPTURE_WAITING;
+        captureId = captureId + 1 ? captureId + 1 : 1;
+        id = captureId;
+    }
+    portEXIT_CRITICAL(&captureLock);
+    return id;
+}
+
+const uint16_t* MatrixDisplayManager::getCapturedFrame(uint32_t id) {
+    portENTER_CRITICAL(&captureLock);
+    bool ready = captureState == CAPTURE_READY && id == captureId;
+    portEXIT_CRITICAL(&captureLock);
+    return ready ? captureFrame : nullptr;
+}
+
+void MatrixDisplayManager::releaseCapturedFrame(uint32_t id) {
+    portENTER_CRITICAL(&captureLock);
+    if (captureState == CAPTURE_READY && id == captureId) {
+        captureState = CAPTURE_IDLE;
+    }
+    portEXIT_CRITICAL(&captureLock);
+}
+
+void MatrixDisplayManager::cancelCapture(uint32_t id) {
+    portENTER_CRITICAL(&captureLock);
+    if (id == captureId) {
+        captureState = CAPTURE_IDLE;
+    }
+    portEXIT_CRITICAL(&captureLock);
+}
+
+bool MatrixDisplayManager::isCapturing(uint32_t id) {
+    portENTER_CRITICAL(&captureLock);
+    bool capturing = captureState != CAPTURE_IDLE && id == captureId;
+    portEXIT_CRITICAL(&captureLock);
+    return capturing;
 }
 
 void MatrixDisplayManager::fillScreen(uint16_t color) {
@@ -52,6 +159,81 @@ void MatrixDisplayManager::fillCircle(int x, int y, int radius, uint16_t color)
     matrix->fillCircle(x, y, radius, color);
 }
 
+// Sprite blitting
+void MatrixDisplayManager::drawSprite(const Sprite& sprite, int x, int y) {
+    drawSprite(sprite, x, y, sprite.color);
+}
+
+void MatrixDisplayManager::drawSprite(const Sprite& sprite, int x, int y, uint16_t monoColor) {
+    // Clip once up front so the row loops need no per-pixel bounds checks
+    int startCol = max(0, -x);
+    int startRow = max(0, -y);
+    int endCol = min((int)sprite.width, MATRIX_WIDTH - x);
+    int endRow = min((int)sprite.height, MATRIX_HEIGHT - y);
+    if (startCol >= endCol || startRow >= endRow)
+        return;
+
+    uint8_t level = (uint8_t)(brightnessLevels[settings->getBrightnessIndex()] * 255.0f);
+
+    // Write straight into the canvas when it is available, skipping the GFX virtual calls
+    uint16_t* framebuffer = matrix->getBuffer();
+    int fbStride = matrix->width();
+
+    // Sprite data lives in memory-mapped flash on the ESP32, so it is read directly
+    if (sprite.format == SPRITE_RGB565) {
+        const uint16_t* pixels = static_cast<const uint16_t*>(sprite.data);
+        for (int row = startRow; row < endRow; row++) {
+            const uint16_t* src = pixels + row * sprite.width;
+            for (int col = startCol; col < endCol; col++) {
+                uint16_t color = src[col];
+                if (sprite.hasTransparency && color == sprite.transparentColor)
+                    continue;
+                color = fadeColor(color, level);
+                if (framebuffer)
+                    framebuffer[(y + row) * fbStride + x + col] = color;
+                else
+                    matrix->drawPixel(x + col, y + row, color);
+            }
+        }
+    } else if (sprite.format == SPRITE_INDEXED4) {
+        // Scale the palette once per blit instead of every pixel
+        uint16_t palette[16] = {0};
+        for (int i = 0; i < sprite.paletteSize && i < 16; i++) {
+            palette[i] = fadeColor(sprite.palette[i], level);
+        }
+
+        const uint8_t* packed = static_cast<const uint8_t*>(sprite.data);
+        int stride = (sprite.width + 1) / 2;
+        for (int row = startRow; row < endRow; row++) {
+            const uint8_t* src = packed + row * stride;
+            for (int col = startCol; col < endCol; col++) {
+                uint8_t index = (src[col >> 1] >> ((col & 1) ? 0 : 4)) & 0x0F;
+                if (index == 0)
+                    continue;
+                if (framebuffer)
+                    framebuffer[(y + row) * fbStride + x + col] = palette[index];
+                else
+                    matrix->drawPixel(x + col, y + row, palette[index]);
+            }
+        }
+    } else {
+        uint16_t color = fadeColor(monoColor, level);
+        const uint8_t* packed = static_cast<const uint8_t*>(sprite.data);
+        int stride = (sprite.width + 7) / 8;
+        for (int row = startRow; row < endRow; row++) {
+            const uint8_t* src = packed + row * stride;
+            for (int col = startCol; col < endCol; col++) {
+                if (!(src[col >> 3] & (0x80 >> (col & 7))))
+                    continue;
+                if (framebuffer)
+                    framebuffer[(y + row) * fbStride + x + col] = color;
+                else
+                    matrix->drawPixel(x + col, y + row, color);
+            }
+        }
+    }
+}
+
 // Text operations
 void MatrixDisplayManager::setTextSize(int size) {
     matrix->setTextSize(size);
@@ -144,6 +326,18 @@ uint16_t MatrixDisplayManager::scaleBrightness(uint16_t color, float factor) {
     return (r << 11) | (g << 5) | b;
 }
 
+uint16_t MatrixDisplayManager::fadeColor(uint16_t color, uint8_t level) {
+    if (level == 255)
+        return color;
+
+    // Integer version of scaleBrightness() for per-pixel use; level is 0-255
+    uint16_t r = ((color >> 11) & 0x1F) * level >> 8;
+    uint16_t g = ((color >> 5) & 0x3F) * level >> 8;
+    uint16_t b = (color & 0x1F) * level >> 8;
+
+    return (r << 11) | (g << 5) | b;
+}
+
 uint16_t MatrixDisplayManager::scaledColor565(uint8_t r, uint8_t g, uint8_t b) {
     float brightness = brightnessLevels[settings->getBrightnessIndex()];
 
@@ -458,54 +652,49 @@ bool MatrixDisplayManager::isInTextArea(int x, int y, bool hasText, int textSize
     return false;
 }
 
-bool MatrixDisplayManager::isInTimeWithDateArea(int x, int y) {
-    // For the time with date mode, we need to check text areas:
-    // 1. Time area (centered, y=8) - includes AM/PM in the string now
-    // 2. Date area (centered, y=20) - includes day abbreviation in brackets
-
+void MatrixDisplayManager::getTimeWithDateBounds(bool dateLine, int& x1, int& y1, int& x2,
+                                                 int& y2) {
     const int TIME_TEXT_SIZE = 1;  // Fixed smallest size for time with date mode
 
-    // Time area bounds - centered at y=8
-    // Account for longer time string with AM/PM included (e.g., "12:34:56 PM")
-    int timeWidth = 11 * 6 * TIME_TEXT_SIZE;  // 11 chars * 6 pixels per char for "HH:MM:SS AM"
-    int timeHeight = 8 * TIME_TEXT_SIZE;
-    int timeY = 8;  // Centered position
+    int width, lineY;
+    if (dateLine) {
+        // Date area - centered at y=20
+        // Account for date with day abbreviation (e.g., "12/25/2024 [FRI]")
+        width = 16 * 6 * TIME_TEXT_SIZE;  // 16 chars * 6 pixels per char
+        lineY = 20;
+    } else {
+        // Time area - centered at y=8
+        // Account for longer time string with AM/PM included (e.g., "12:34:56 PM")
+        width = 11 * 6 * TIME_TEXT_SIZE;  // 11 chars * 6 pixels per char for "HH:MM:SS AM"
+        lineY = 8;
+    }
+    int height = 8 * TIME_TEXT_SIZE;
 
-    int timeX1 = (MATRIX_WIDTH - timeWidth) / 2 - 2;
-    int timeY1 = timeY - 2;
-    int timeX2 = timeX1 + timeWidth + 4;
-    int timeY2 = timeY1 + timeHeight + 4;
+    x1 = (MATRIX_WIDTH - width) / 2 - 2;
+    y1 = lineY - 2;
+    x2 = x1 + width + 4;
+    y2 = y1 + height + 4;
 
     // Clamp to screen bounds
-    timeX1 = max(0, timeX1);
-    timeY1 = max(0, timeY1);
-    timeX2 = min(MATRIX_WIDTH - 1, timeX2);
-    timeY2 = min(MATRIX_HEIGHT - 1, timeY2);
+    x1 = max(0, x1);
+    y1 = max(0, y1);
+    x2 = min(MATRIX_WIDTH - 1, x2);
+    y2 = min(MATRIX_HEIGHT - 1, y2);
+}
 
-    // Check if in time area
-    if (x >= timeX1 && x <= timeX2 && y >= timeY1 && y <= timeY2) {
+bool MatrixDisplayManager::isInTimeWithDateArea(int x, int y) {
+    // For the time with date mode, we need to check text areas:
+    // 1. Time area (centered, y=8) - includes AM/PM in the string now
+    // 2. Date area (centered, y=20) - includes day abbreviation in brackets
+    int x1, y1, x2, y2;
+
+    getTimeWithDateBounds(false, x1, y1, x2, y2);
+    if (x >= x1 && x <= x2 && y >= y1 && y <= y2) {
         return true;
     }
 
-    // Date area bounds - centered at y=20
-    // Account for date with day abbreviation (e.g., "12/25/2024 [FRI]")
-    int dateWidth = 16 * 6 * TIME_TEXT_SIZE;  // 16 chars * 6 pixels per char
-    int dateHeight = 8 * TIME_TEXT_SIZE;
-    int dateY = 20;  // Centered position
-
-    int dateX1 = (MATRIX_WIDTH - dateWidth) / 2 - 2;
-    int dateY1 = dateY - 2;
-    int dateX2 = dateX1 + dateWidth + 4;
-    int dateY2 = dateY1 + dateHeight + 4;
-
-    // Clamp to screen bounds
-    dateX1 = max(0, dateX1);
-    dateY1 = max(0, dateY1);
-    dateX2 = min(MATRIX_WIDTH - 1, dateX2);
-    dateY2 = min(MATRIX_HEIGHT - 1, dateY2);
-
-    // Check if in date area
-    if (x >= dateX1 && x <= dateX2 && y >= dateY1 && y <= dateY2) {
+    getTimeWithDateBounds(true, x1, y1, x2, y2);
+    if (x >= x1 && x <= x2 && y >= y1 && y <= y2) {
         return true;
     }
 
@@ -571,78 +760,197 @@ float MatrixDisplayManager::generateVelocity(float minSpeed, float maxSpeed, boo
     return velocity;
 }
 
-void MatrixDisplayManager::enqueueMessage(const char* id, const char* text, const char* priority) {
-    // Non-blocking enqueue into circular buffer
-    Serial.print("Enqueue message: ");
-    Serial.println(text);
+MessagePushResult MatrixDisplayManager::enqueueMessage(const char* id, const char* text,
+                                                       const char* priority,
+                                                       const MessageSchedule& schedule) {
+    // Non-blocking enqueue straight into an arena slot; a known id updates its message
+    LOG_INFO("Enqueue message: %s", text);
+
+    QueueLockGuard guard(queueLock);
+    updateMessageClock();
+    int slot = MESSAGE_NO_SLOT;
+    MessagePushResult result =
+        messageQueue.push(id, text, MessageQueue::parsePriority(priority), schedule, &slot);
+    if (result == MESSAGE_PUSH_FULL) {
+        LOG_WARN("Message queue full, dropping message");
+    } else if (result == MESSAGE_PUSH_QUEUED) {
+        messageStore.recordNewSlot(messageQueue, slot);
+    } else if (result == MESSAGE_PUSH_UPDATED) {
+        messageStore.recordSlot(messageQueue, slot);
+    }
 
-    if (mqCount >= MESSAGE_QUEUE_SIZE) {
-        Serial.println("Message queue full, dropping message");
-        return;
+    if (result == MESSAGE_PUSH_UPDATED && slot == activeSlot) {
+        // The text on screen changed; the render pass measures it, since the text settings
+        // of the matrix belong to the loop task
+        activeTextChanged = true;
     }
+    return result;
+}
 
-    messageQueue[mqTail].id = String(id);
-    messageQueue[mqTail].text = String(text);
-    messageQueue[mqTail].priority = String(priority);
-    mqTail = (mqTail + 1) % MESSAGE_QUEUE_SIZE;
-    mqCount++;
+bool MatrixDisplayManager::removeMessage(const char* id) {
+    QueueLockGuard guard(queueLock);
+    int slot = messageQueue.find(id);
+    if (slot == MESSAGE_NO_SLOT) {
+        return false;
+    }
+    // Deleting also stops any repeats, unlike cancelling the message on screen
+    if (slot == activeSlot) {
+        finishActiveMessage(true);
+        return true;
+    }
+    const MessageSlot& deleted = messageQueue.getSlot(slot);
+    events->publishMessage("deleted", deleted.id, MessageQueue::getPriorityName(deleted.priority));
+    messageQueue.release(slot);
+    messageStore.recordSlot(messageQueue, slot);
+    return true;
 }
 
 bool MatrixDisplayManager::hasQueuedMessages() const {
-    return mqCount > 0 || hasActiveMessage;
+    // removeMessage() on the server task can clear activeSlot between the two reads
+    QueueLockGuard guard(queueLock);
+    return messageQueue.count() > 0 || activeSlot != MESSAGE_NO_SLOT;
 }
 
 bool MatrixDisplayManager::hasActiveHighPriorityMessage() const {
-    return hasActiveMessage && (activePriority == "high" || activePriority == "urgent");
+    QueueLockGuard guard(queueLock);
+    return activeSlot != MESSAGE_NO_SLOT &&
+           messageQueue.getSlot(activeSlot).priority >= MSG_PRIORITY_HIGH;
 }
 
 void MatrixDisplayManager::cancelActiveMessage() {
-    hasActiveMessage = false;
-    activeId = "";
-    activeText = "";
-    activePriority = "";
+    // Dismisses this showing only; a repeating message comes back at its next interval
+    QueueLockGuard guard(queueLock);
+    if (activeSlot != MESSAGE_NO_SLOT) {
+        finishActiveMessage();
+    }
 }
 
 int MatrixDisplayManager::getQueueCount() const {
-    return mqCount;
+    return messageQueue.count();
+}
+
+void MatrixDisplayManager::updateMessageClock() {
+    // Seconds since boot for the message scheduler, carried so it survives millis() rollover
+    unsigned long now = millis();
+    messageClockCarryMs += now - messageClockLastMs;
+    messageClockLastMs = now;
+    messageClockSeconds += messageClockCarryMs / 1000;
+    messageClockCarryMs %= 1000;
+    messageQueue.advance(messageClockSeconds);
+}
+
+void MatrixDisplayManager::preemptActiveMessage() {
+    const MessageSlot& slot = messageQueue.getSlot(activeSlot);
+    events->publishMessage("preempted", slot.id, MessageQueue::getPriorityName(slot.priority));
+    wall->setLeaderMessage(0, 0);
+    if (MESSAGE_RESUME_PREEMPTED) {
+        messageQueue.requeueFront(activeSlot, activeScrollX);
+        activeSlot = MESSAGE_NO_SLOT;
+    } else {
+        finishActiveMessage();
+    }
+}
+
+void MatrixDisplayManager::finishActiveMessage(bool deleted) {
+    // Frees the slot or schedules the next repeat (none once deleted); either way the log
+    // needs the new state
+    const MessageSlot& slot = messageQueue.getSlot(activeSlot);
+    events->publishMessage(deleted ? "deleted" : "finished", slot.id,
+                           MessageQueue::getPriorityName(slot.priority));
+    wall->setLeaderMessage(0, 0);
+    if (deleted) {
+        messageQueue.release(activeSlot);
+    } else {
+        messageQueue.finish(activeSlot);
+    }
+    messageStore.recordSlot(messageQueue, activeSlot);
+    activeSlot = MESSAGE_NO_SLOT;
+}
+
+void MatrixDisplayManager::restoreMessages() {
+    // Reload messages that were queued or scheduled before the last reboot
+    if (!messageStore.begin()) {
+        return;
+    }
+    updateMessageClock();
+    messageStore.replay(messageQueue);
+}
+
+void MatrixDisplayManager::writeMessageLog() {
+    // Flash writes can stall for tens of ms, so they run here without the queue lock; the
+    // server task keeps filling the next batch meanwhile
+    bool due;
+    {
+        QueueLockGuard guard(queueLock);
+        updateMessageClock();
+        due = messageStore.update(messageQueue);
+    }
+    if (!due) {
+        return;
+    }
+    messageStore.write();
+
+    // Compaction is only attempted after a write, so a failing filesystem is not retried
+    // on every loop
+    if (!messageStore.isCompactionDue() || !messageStore.beginCompaction()) {
+        return;
+    }
+    uint8_t record[MESSAGE_RECORD_HEADER_SIZE + MESSAGE_RECORD_MAX_PAYLOAD];
+    for (int i = 0; i < MESSAGE_SLOT_COUNT; i++) {
+        size_t length;
+        {
+            QueueLockGuard guard(queueLock);
+            length = messageStore.encodeSlot(messageQueue, i, record);
+        }
+        messageStore.writeCompacted(record, length);
+    }
+    messageStore.finishCompaction();
 }
 
 void MatrixDisplayManager::processMessageQueue() {
+    writeMessageLog();
+    QueueLockGuard guard(queueLock);
+
+    // Release scheduled messages that are now due and drop expired ones
+    updateMessageClock();
+
+    // A more important message waiting interrupts the one on screen
+    if (activeSlot != MESSAGE_NO_SLOT &&
+        messageQueue.peekPriority() > messageQueue.getSlot(activeSlot).priority) {
+        LOG_INFO("Message preempted by higher priority message");
+        preemptActiveMessage();
+    }
+
     // If no active message, dequeue next
-    if (!hasActiveMessage && mqCount > 0) {
-        // Dequeue
-        const auto& item = messageQueue[mqHead];
-        activeId = item.id;
-        activeText = item.text;
-        activePriority = item.priority;
-        mqHead = (mqHead + 1) % MESSAGE_QUEUE_SIZE;
-        mqCount--;
+    if (activeSlot == MESSAGE_NO_SLOT && messageQueue.count() > 0) {
+        activeSlot = messageQueue.pop();
+        const MessageSlot& slot = messageQueue.getSlot(activeSlot);
+        const char* activeText = slot.text;
+        events->publishMessage("started", slot.id, MessageQueue::getPriorityName(slot.priority));
 
         // Initialize active message state
-        hasActiveMessage = true;
         activeTextSize = 2;  // Always use size 2 for messages as requested
         activeColor = getClockColor();
 
         // Get scroll speed from settings (applies to all messages regardless of priority)
         MessageScrollSpeed speedSetting = settings->getMessageScrollSpeed();
-        Serial.print("Message scroll speed setting: ");
-        Serial.println((int)speedSetting);
+        LOG_DEBUG("Message scroll speed setting: %d", (int)speedSetting);
         switch (speedSetting) {
             case MSG_SCROLL_SLOW:
                 activeScrollSpeed = 51;  // Slow - was original normal speed
-                Serial.println("Using SLOW scroll speed: 51ms");
+                LOG_DEBUG("Using SLOW scroll speed: 51ms");
                 break;
             case MSG_SCROLL_MEDIUM:
                 activeScrollSpeed = 25;  // Medium - was original fast speed
-                Serial.println("Using MEDIUM scroll speed: 25ms");
+                LOG_DEBUG("Using MEDIUM scroll speed: 25ms");
                 break;
             case MSG_SCROLL_FAST:
                 activeScrollSpeed = 6;  // Fast - twice as fast as before
-                Serial.println("Using FAST scroll speed: 6ms");
+                LOG_DEBUG("Using FAST scroll speed: 6ms");
                 break;
             default:
                 activeScrollSpeed = 25;  // Default to medium if invalid
-                Serial.println("Using DEFAULT scroll speed: 25ms");
+                LOG_DEBUG("Using DEFAULT scroll speed: 25ms");
                 break;
         }
 
@@ -652,57 +960,68 @@ void MatrixDisplayManager::processMessageQueue() {
         activeStartTime = millis();
         activeLastScroll = millis();
 
-        // Start message from right edge of screen
-        activeScrollX = MATRIX_WIDTH;
+        // Start message from right edge of screen, or where it was interrupted
+        activeScrollX = slot.hasResumePosition ? slot.resumeScrollX : MATRIX_WIDTH;
         activeScrollDir = -1;  // Moving left
 
-        // Debug: Show initial setup values
+        // Measure once; the text doesn't change while it scrolls
         setTextSize(activeTextSize);
         int16_t x1, y1;
-        uint16_t debugWidth, debugHeight;
-        getTextBounds(activeText.c_str(), 0, 0, &x1, &y1, &debugWidth, &debugHeight);
-        Serial.print("Starting message display: ");
-        Serial.println(activeText);
-        Serial.print("Text width: ");
-        Serial.print(debugWidth);
-        Serial.print(", Matrix width: ");
-        Serial.print(MATRIX_WIDTH);
-        Serial.print(", Starting scroll position: ");
-        Serial.println(activeScrollX);
+        uint16_t textHeight;
+        getTextBounds(activeText, 0, 0, &x1, &y1, &activeTextWidth, &textHeight);
+        activeTextChanged = false;
+        if (wall->isActive()) {
+            startWallMessage(slot.hasResumePosition ? slot.resumeScrollX
+                                                    : wall->getTileCount() * MATRIX_WIDTH);
+        }
+        LOG_INFO("Starting message display: %s", activeText);
+        LOG_DEBUG("Text width: %d, Matrix width: %d, Starting scroll position: %d",
+                  activeTextWidth, MATRIX_WIDTH, activeScrollX);
     }
 
     // If active, render the message
-    if (hasActiveMessage) {
+    if (activeSlot != MESSAGE_NO_SLOT) {
+        const char* activeText = messageQueue.getSlot(activeSlot).text;
+
+        // Keep scrolling from the same spot with the width of the updated text
+        if (activeTextChanged) {
+            setTextSize(activeTextSize);
+            int16_t x1, y1;
+            uint16_t textHeight;
+            getTextBounds(activeText, 0, 0, &x1, &y1, &activeTextWidth, &textHeight);
+            activeTextChanged = false;
+            if (wall->isActive()) {
+                // Carry on from the current position under the new text's hash
+                scrollWallMessage();
+                startWallMessage(activeScrollX);
+            }
+        }
+
         // Clear screen but don't call effects here - they'll be called after in main loop
         fillScreen(0);
 
         // Update scroll position for marquee effect
         unsigned long now = millis();
-        if (now - activeLastScroll >= activeScrollSpeed) {
+        if (wall->isActive()) {
+            if (!scrollWallMessage()) {
+                finishActiveMessage();
+                return;
+            }
+        } else if (now - activeLastScroll >= activeScrollSpeed) {
             activeLastScroll = now;
 
-            // Calculate text width for this message
-            setTextSize(activeTextSize);
-            int16_t x1, y1;
-            uint16_t textWidth, textHeight;
-            getTextBounds(activeText.c_str(), 0, 0, &x1, &y1, &textWidth, &textHeight);
-
             // Move text from right to left
             activeScrollX -= 1;
 
             // Check if the last letter has completely scrolled off the left side of screen
             // The text is completely gone when the rightmost pixel is at position -1 or less
             // activeScrollX is the left edge, so right edge is activeScrollX + textWidth - 1
-            int rightEdge = activeScrollX + (int)textWidth - 1;
+            int rightEdge = activeScrollX + (int)activeTextWidth - 1;
 
             if (rightEdge < 0) {
-                Serial.print("Message scroll complete - right edge at position: ");
-                Serial.println(rightEdge);
-                // Message finished scrolling, mark as complete
-                hasActiveMessage = false;
-                activeId = "";
-                activeText = "";
-                activePriority = "";
+                LOG_DEBUG("Message scroll complete - right edge at position: %d", rightEdge);
+                // Message finished scrolling; free its slot or schedule its next repeat
+                finishActiveMessage();
                 return;
             }
         }
@@ -712,9 +1031,7 @@ void MatrixDisplayManager::processMessageQueue() {
 
         // Draw background box for the message - full width of screen
         setTextSize(activeTextSize);
-        int16_t x1, y1;
-        uint16_t textWidth, textHeight;
-        getTextBounds(activeText.c_str(), 0, 0, &x1, &y1, &textWidth, &textHeight);
+        int textHeight = 8 * activeTextSize;  // Single line of the built-in font
 
         // Calculate bounding box dimensions - full width, text height
         int padding = 3;
@@ -726,79 +1043,42 @@ void MatrixDisplayManager::processMessageQueue() {
         // Draw full-width background box
         fillRect(boxX, boxY, boxWidth, boxHeight, 0x0000);
 
-        // Draw the message text
+        // Draw the message text; on a wall this tile shows its slice of the canvas
         setTextColor(activeColor);
-        setCursor(activeScrollX, centeredY);
-        print(activeText.c_str());
+        int tileX = wall->isActive() ? wall->getTileIndex() * MATRIX_WIDTH : 0;
+        setCursor(activeScrollX - tileX, centeredY);
+        print(activeText);
 
         // Remove timeout - let message complete its full scroll
         // The message will end when it finishes scrolling off screen
     }
 }
 
-/**
- * Draw black background rectangles around the text areas
- */
-void MatrixDisplayManager::drawTextBackground() {
-    drawTextBackground(settings->getTextSize());
+void MatrixDisplayManager::startWallMessage(int scrollX) {
+    // Moves from scrollX from the next frame on; the origin is where it would have entered
+    int64_t stepUs = activeScrollSpeed * 1000L;
+    int64_t behindUs = (int64_t)(wall->getTileCount() * MATRIX_WIDTH - scrollX) * stepUs;
+    int64_t origin = (int64_t)wall->getFrame() + 1 - behindUs / WALL_FRAME_US;
+    activeOriginFrame = origin > 0 ? origin : 0;  // Only right after boot
+    activeTextHash = VideoWall::hashText(messageQueue.getSlot(activeSlot).text);
+    activeScrollX = scrollX;
+    wall->setLeaderMessage(activeTextHash, activeOriginFrame);
 }
 
-void MatrixDisplayManager::drawTextBackground(int textSize) {
-    // Draw background for main text
-    int x1, y1, x2, y2;
-    getMainTextBounds(x1, y1, x2, y2, textSize);
-    fillRect(x1, y1, x2 - x1 + 1, y2 - y1 + 1, 0x0000);
-
-    // Draw background for auxiliary text (AM/PM for clock) if in 12-hour format
-    if (!settings->getUse24HourFormat()) {
-        getAuxiliaryTextBounds(x1, y1, x2, y2);
-        fillRect(x1, y1, x2 - x1 + 1, y2 - y1 + 1, 0x0000);
+bool MatrixDisplayManager::scrollWallMessage() {
+    // Followers scrolling the leader's message use the leader's origin frame, so the text
+    // crosses from one tile to the next without a jump
+    uint32_t leaderFrame;
+    if (wall->getLeaderMessage(activeTextHash, leaderFrame)) {
+        activeOriginFrame = leaderFrame;
     }
-}
-
-void MatrixDisplayManager::drawTimeWithDateBackground() {
-    // Draw background for time with date mode - uses the same bounds as isInTimeWithDateArea
-    const int TIME_TEXT_SIZE = 1;  // Fixed smallest size for time with date mode
-
-    // Time area background - centered at y=8
-    // Account for longer time string with AM/PM included (e.g., "12:34:56 PM")
-    int timeWidth = 11 * 6 * TIME_TEXT_SIZE;  // 11 chars * 6 pixels per char for "HH:MM:SS AM"
-    int timeHeight = 8 * TIME_TEXT_SIZE;
-    int timeY = 8;  // Centered position
-
-    int timeX1 = (MATRIX_WIDTH - timeWidth) / 2 - 2;
-    int timeY1 = timeY - 2;
-    int timeX2 = timeX1 + timeWidth + 4;
-    int timeY2 = timeY1 + timeHeight + 4;
-
-    // Clamp to screen bounds
-    timeX1 = max(0, timeX1);
-    timeY1 = max(0, timeY1);
-    timeX2 = min(MATRIX_WIDTH - 1, timeX2);
-    timeY2 = min(MATRIX_HEIGHT - 1, timeY2);
-
-    // Draw time background
-    fillRect(timeX1, timeY1, timeX2 - timeX1 + 1, timeY2 - timeY1 + 1, 0x0000);
-
-    // Date area background - centered at y=20
-    // Account for date with day abbreviation (e.g., "12/25/2024 [FRI]")
-    int dateWidth = 16 * 6 * TIME_TEXT_SIZE;  // 16 chars * 6 pixels per char
-    int dateHeight = 8 * TIME_TEXT_SIZE;
-    int dateY = 20;  // Centered position
 
-    int dateX1 = (MATRIX_WIDTH - dateWidth) / 2 - 2;
-    int dateY1 = dateY - 2;
-    int dateX2 = dateX1 + dateWidth + 4;
-    int dateY2 = dateY1 + dateHeight + 4;
+    int64_t elapsedUs = wall->getWallMicros() - (int64_t)activeOriginFrame * WALL_FRAME_US;
+    int64_t steps = elapsedUs > 0 ? elapsedUs / (activeScrollSpeed * 1000L) : 0;
+    activeScrollX = wall->getTileCount() * MATRIX_WIDTH - (int)steps;
 
-    // Clamp to screen bounds
-    dateX1 = max(0, dateX1);
-    dateY1 = max(0, dateY1);
-    dateX2 = min(MATRIX_WIDTH - 1, dateX2);
-    dateY2 = min(MATRIX_HEIGHT - 1, dateY2);
-
-    // Draw date background
-    fillRect(dateX1, dateY1, dateX2 - dateX1 + 1, dateY2 - dateY1 + 1, 0x0000);
+    // Done once the last column has left the left end of the canvas
+    return activeScrollX + (int)activeTextWidth - 1 >= 0;
 }
 
 /**
@@ -810,8 +1090,13 @@ void MatrixDisplayManager::drawTightClock(const char* timeStr, int textSize, uin
         y = getCenteredY(textSize);
     }
 
-    setTextSize(textSize);
-    setTextColor(color);
+    matrix->setTextColor(color);
+    drawTightClockGlyphs(matrix, timeStr, textSize, y);
+}
+
+void MatrixDisplayManager::drawTightClockGlyphs(Adafruit_GFX* gfx, const char* timeStr,
+                                                int textSize, int y) {
+    gfx->setTextSize(textSize);
 
     // Calculate spacing like the original
     int digitWidth = 6 * textSize;
@@ -828,14 +1113,157 @@ void MatrixDisplayManager::drawTightClock(const char* timeStr, int textSize, uin
         char c = timeStr[i];
         if (c == ':') {
             x += beforeColon;
-            setCursor(x, y);
-            print(":");
+            gfx->setCursor(x, y);
+            gfx->print(":");
             x += colonWidth + afterColon;
         } else {
-            setCursor(x, y);
+            gfx->setCursor(x, y);
             char charStr[2] = {c, '\0'};
-            print(charStr);
+            gfx->print(charStr);
             x += digitWidth;
         }
     }
 }
+
+// ===============================================
+// TEXT DISTANCE FIELD
+// ===============================================
+
+void MatrixDisplayManager::setTextMaskLayout(TextMaskLayout layout, int textSize) {
+    bool use24Hour = settings->getUse24HourFormat();
+    if (textMaskValid && layout == textMaskLayout && textSize == textMaskTextSize &&
+        use24Hour == textMask24Hour) {
+        return;
+    }
+
+    textMaskLayout = layout;
+    textMaskTextSize = textSize;
+    textMask24Hour = use24Hour;
+    rebuildTextMask();
+}
+
+void MatrixDisplayManager::rebuildTextMask() {
+    GFXcanvas1 mask(MATRIX_WIDTH, MATRIX_HEIGHT);
+    if (mask.getBuffer() == nullptr) {
+        // Out of memory - leave effects unmasked rather than blocking everything
+        memset(textDistance, 255, sizeof(textDistance));
+        memset(textHaloLevels, 255, sizeof(textHaloLevels));
+        textMaskClearance = 0;
+        textMaskValid = true;
+        return;
+    }
+    mask.fillScreen(0);
+    mask.setTextWrap(false);
+
+    // Clock layouts follow the glyphs; the preview box and message band stay rectangular
+    bool glyphShaped =
+        textMaskLayout == TEXT_MASK_CLOCK || textMaskLayout == TEXT_MASK_CLOCK_WITH_DATE;
+
+    if (glyphShaped) {
+        drawTextMaskGlyphs(&mask);
+    } else if (textMaskLayout == TEXT_MASK_PREVIEW) {
+        int x1, y1, x2, y2;
+        getMainTextBounds(x1, y1, x2, y2, textMaskTextSize);
+        mask.fillRect(x1, y1, x2 - x1 + 1, y2 - y1 + 1, 1);
+    } else if (textMaskLayout == TEXT_MASK_MESSAGE_BAND) {
+        // Full-width band matching the message background (size 2 text is ~16 pixels high)
+        int padding = 3;
+        int textHeight = 16;
+        int messageY = (MATRIX_HEIGHT - textHeight) / 2 - padding;
+        mask.fillRect(0, messageY, MATRIX_WIDTH, textHeight + (2 * padding), 1);
+    }
+
+    computeTextDistance(mask);
+
+    textMaskClearance = glyphShaped ? TEXT_HALO_CLEARANCE : 0;
+    for (int d = 0; d < TEXT_HALO_FADE_END; d++) {
+        if (d <= textMaskClearance) {
+            textHaloLevels[d] = 0;
+        } else if (glyphShaped) {
+            textHaloLevels[d] =
+                (d - textMaskClearance) * 255 / (TEXT_HALO_FADE_END - textMaskClearance);
+        } else {
+            textHaloLevels[d] = 255;  // Rectangles keep a hard edge
+        }
+    }
+    textMaskValid = true;
+}
+
+void MatrixDisplayManager::drawTextMaskGlyphs(Adafruit_GFX* gfx) {
+    // The mask is the union of every glyph that can appear in each cell, so it stays valid as
+    // the digits change and only needs rebuilding when the layout does
+    const char* dayAbbrev[] = {"SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT"};
+    gfx->setTextColor(1);
+
+    for (char d = '0'; d <= '9'; d++) {
+        char timeStr[9] = {d, d, ':', d, d, ':', d, d, '\0'};
+
+        if (textMaskLayout == TEXT_MASK_CLOCK) {
+            drawTightClockGlyphs(gfx, timeStr, textMaskTextSize, getCenteredY(textMaskTextSize));
+        } else {
+            // Same positions as ClockDisplay::displayTimeWithDate()
+            drawTightClockGlyphs(gfx, timeStr, 1, 8);
+
+            char dateStr[20];
+            snprintf(dateStr, sizeof(dateStr), "%c%c/%c%c/%c%c%c%c [%s]", d, d, d, d, d, d, d, d,
+                     dayAbbrev[(d - '0') % 7]);
+            gfx->setTextSize(1);
+            gfx->setCursor((MATRIX_WIDTH - (int)strlen(dateStr) * 6) / 2, 20);
+            gfx->print(dateStr);
+        }
+    }
+
+    // AM/PM corner, same position as ClockDisplay::displayAMPM()
+    if (textMaskLayout == TEXT_MASK_CLOCK && !textMask24Hour) {
+        const char* markers[] = {"AM", "PM"};
+        const char* shortMarkers[] = {"A", "P"};
+        gfx->setTextSize(1);
+        for (int i = 0; i < 2; i++) {
+            const char* marker = textMaskTextSize == 3 ? shortMarkers[i] : markers[i];
+            gfx->setCursor(MATRIX_WIDTH - (int)strlen(marker) * 6 - 1, MATRIX_HEIGHT - 8);
+            gfx->print(marker);
+        }
+    }
+}
+
+void MatrixDisplayManager::computeTextDistance(const GFXcanvas1& mask) {
+    // Two-pass chamfer transform giving the 8-connected (chessboard) distance to the nearest
+    // mask pixel, saturating at 255
+    for (int y = 0; y < MATRIX_HEIGHT; y++) {
+        for (int x = 0; x < MATRIX_WIDTH; x++) {
+            textDistance[y][x] = mask.getPixel(x, y) ? 0 : 255;
+        }
+    }
+
+    for (int y = 0; y < MATRIX_HEIGHT; y++) {
+        for (int x = 0; x < MATRIX_WIDTH; x++) {
+            int d = textDistance[y][x];
+            if (x > 0)
+                d = min(d, textDistance[y][x - 1] + 1);
+            if (y > 0) {
+                d = min(d, textDistance[y - 1][x] + 1);
+                if (x > 0)
+                    d = min(d, textDistance[y - 1][x - 1] + 1);
+                if (x < MATRIX_WIDTH - 1)
+                    d = min(d, textDistance[y - 1][x + 1] + 1);
+            }
+            textDistance[y][x] = d;
+        }
+    }
+
+    for (int y = MATRIX_HEIGHT - 1; y >= 0; y--) {
+        for (int x = MATRIX_WIDTH - 1; x >= 0; x--) {
+            int d = textDistance[y][x];
+            if (x < MATRIX_WIDTH - 1)
+                d = min(d, textDistance[y][x + 1] + 1);
+            if (y < MATRIX_HEIGHT - 1) {
+                d = min(d, textDistance[y + 1][x] + 1);
+                if (x > 0)
+                    d = min(d, textDistance[y + 1][x - 1] + 1);
+                if (x < MATRIX_WIDTH - 1)
+                    d = min(d, textDistance[y + 1][x + 1] + 1);
+            }
+            textDistance[y][x] = d;
+        }
+    }
+}
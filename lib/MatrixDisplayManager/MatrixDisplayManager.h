@@ -5,13 +5,35 @@
 
 #include <Adafruit_Protomatter.h>
 
+#include "EventStream.h"
+#include "MessageQueue.h"
+#include "MessageStore.h"
+#include "Metrics.h"
 #include "SettingsManager.h"
+#include "Sprite.h"
+#include "VideoWall.h"
 
 // Matrix Display Settings
 #define MATRIX_WIDTH 128
 #define MATRIX_HEIGHT 32
 #define BIT_DEPTH 5
 
+// Message display settings
+#define MESSAGE_RESUME_PREEMPTED true  // Preempted messages continue from where they stopped
+
+// Text halo settings (distance in pixels from the nearest glyph pixel)
+#define TEXT_HALO_CLEARANCE 1  // Effects never draw this close to a glyph
+#define TEXT_HALO_FADE_END 5   // Effects fade in between the clearance and this distance
+
+// Which text layout the effects mask describes
+enum TextMaskLayout {
+    TEXT_MASK_NONE,
+    TEXT_MASK_CLOCK,            // Centered HH:MM:SS plus AM/PM corner
+    TEXT_MASK_CLOCK_WITH_DATE,  // Small time line and date line
+    TEXT_MASK_MESSAGE_BAND,     // Full-width band behind scrolling messages
+    TEXT_MASK_PREVIEW           // Effect preview box in the menu
+};
+
 // Structure for text area information
 struct TextAreaInfo {
     uint16_t width;
@@ -25,7 +47,8 @@ struct TextAreaInfo {
 class MatrixDisplayManager {
    public:
     // Constructor
-    MatrixDisplayManager(Adafruit_Protomatter* matrix, SettingsManager* settings);
+    MatrixDisplayManager(Adafruit_Protomatter* matrix, SettingsManager* settings,
+                         EventStream* events, VideoWall* wall, Metrics* metrics);
 
     // Initialization
     void begin();
@@ -33,12 +56,36 @@ class MatrixDisplayManager {
     // Basic display operations
     void clearScreen();
     void show();
+    uint32_t getFrameCount() const {
+        return frameCount;
+    }
+    // The Protomatter canvas (RGB565, row by row) for whole-frame writes; show() swaps it in
+    uint16_t* getFrameBuffer() {
+        return matrix->getBuffer();
+    }
+
+    // Frame capture for GET /frame, one frame per request. The server task asks for a frame;
+    // the next show() copies the canvas into the capture buffer (one memcpy, ~8 KB) and the
+    // loop draws on, so a capture never stalls the panel however slowly the server sends it.
+    // The server calls take the id from requestCapture(), so a capture that was given up
+    // cannot touch the next one.
+    uint32_t requestCapture();  // Capture id, 0 while another capture is running
+    const uint16_t* getCapturedFrame(uint32_t id);  // The copied frame, nullptr if none yet
+    void releaseCapturedFrame(uint32_t id);         // Sent; the next capture may start
+    void cancelCapture(uint32_t id);                // The client went away
+    bool isCapturing(uint32_t id);                  // The frame is still to copy or send
+
     void fillScreen(uint16_t color);
     void fillRect(int x, int y, int w, int h, uint16_t color);
     void drawPixel(int x, int y, uint16_t color);
     void drawCircle(int x, int y, int radius, uint16_t color);
     void fillCircle(int x, int y, int radius, uint16_t color);
 
+    // Sprite blitting (clipped to the panel, scaled by the display brightness). Mono sprites
+    // draw in monoColor when given, otherwise in the color baked in by the asset converter.
+    void drawSprite(const Sprite& sprite, int x, int y);
+    void drawSprite(const Sprite& sprite, int x, int y, uint16_t monoColor);
+
     // Text operations
     void setTextSize(int size);
     void setTextColor(uint16_t color);
@@ -93,9 +140,7 @@ class MatrixDisplayManager {
     bool isInTextArea(int x, int y, bool hasText = true);
     bool isInTextArea(int x, int y, bool hasText, int textSize);
     bool isInTimeWithDateArea(int x, int y);
-    void drawTextBackground();
-    void drawTextBackground(int textSize);
-    void drawTimeWithDateBackground();  // New method for time with date mode
+    void getTimeWithDateBounds(bool dateLine, int& x1, int& y1, int& x2, int& y2);
 
     // Legacy clock-specific functions (for compatibility)
     void getTimeDisplayBounds(int& x1, int& y1, int& x2, int& y2) {
@@ -108,16 +153,47 @@ class MatrixDisplayManager {
         getAuxiliaryTextBounds(x1, y1, x2, y2);
     }
 
+    // Text distance field for effects masking. Rebuilt only when the layout key changes;
+    // lookups are a single table read.
+    void setTextMaskLayout(TextMaskLayout layout, int textSize);
+    uint8_t getTextDistance(int x, int y) const {
+        if (x < 0 || x >= MATRIX_WIDTH || y < 0 || y >= MATRIX_HEIGHT)
+            return 255;
+        return textDistance[y][x];
+    }
+    // 0 = blocked, 255 = unaffected, in between = fade factor for effect pixels
+    uint8_t getTextHaloLevel(int x, int y) const {
+        uint8_t d = getTextDistance(x, y);
+        return d < TEXT_HALO_FADE_END ? textHaloLevels[d] : 255;
+    }
+    uint8_t getTextClearance() const {
+        return textMaskClearance;
+    }
+    uint16_t fadeColor(uint16_t color, uint8_t level);
+
     // Utility functions
     float generateVelocity(float minSpeed, float maxSpeed, bool allowNegative = true);
 
-    // Message queue API (simple enqueue for scrolling messages)
-    void enqueueMessage(const char* id, const char* text, const char* priority);
+    // Message queue API (simple enqueue for scrolling messages). Safe to call from the
+    // web server task; the render loop holds the same lock while it reads the queue.
+    MessagePushResult enqueueMessage(const char* id, const char* text, const char* priority,
+                                     const MessageSchedule& schedule = MessageSchedule());
+    bool removeMessage(const char* id);  // Drops a queued or showing message by id
+    void restoreMessages();              // Replays persisted messages; call once at boot
     void processMessageQueue();
     bool hasQueuedMessages() const;
     bool hasActiveHighPriorityMessage() const;
     void cancelActiveMessage();
     int getQueueCount() const;
+    int getQueueCount(MessagePriority priority) const {
+        return messageQueue.count(priority);
+    }
+    int getScheduledCount() const {
+        return messageQueue.scheduledCount();
+    }
+    int getQueueCapacity() const {
+        return messageQueue.capacity();
+    }
 
     // Access to brightness arrays
     const uint16_t* getTextColors() const {
@@ -128,24 +204,22 @@ class MatrixDisplayManager {
     }
 
    private:
-    // Message queue internals
-    struct MessageQueueItem {
-        String id;
-        String text;
-        String priority;
-    };
-
-    static const int MESSAGE_QUEUE_SIZE = 8;
-    MessageQueueItem messageQueue[MESSAGE_QUEUE_SIZE];
-    int mqHead;
-    int mqTail;
-    int mqCount;
-
-    // Active message state
-    bool hasActiveMessage;
-    String activeId;
-    String activeText;
-    String activePriority;
+    // Message queue internals (fixed slot arena, no heap allocation per message)
+    MessageQueue messageQueue;
+    MessageStore messageStore;  // Flash log of the queue so messages survive a reboot
+    unsigned long messageClockLastMs;
+    uint32_t messageClockCarryMs;
+    uint32_t messageClockSeconds;
+    void updateMessageClock();
+    void writeMessageLog();  // Loop task: the batched log records go to flash, lock released
+    SemaphoreHandle_t queueLock;
+
+    // Active message state. The active message keeps its arena slot until it finishes.
+    int activeSlot;
+    void preemptActiveMessage();
+    void finishActiveMessage(bool deleted = false);  // deleted: stop repeats too
+    uint16_t activeTextWidth;  // Measured once when the message starts
+    bool activeTextChanged;    // Updated by id while showing; re-measured on the next pass
     int activeTextSize;
     int activeScrollX;
     int activeScrollDir;
@@ -155,8 +229,43 @@ class MatrixDisplayManager {
     int activeScrollSpeed;         // ms per step
     uint16_t activeColor;
 
+    // On a video wall the marquee runs on the canvas. Its position follows from the shared
+    // frame on which it entered at the right end of the canvas; followers take that frame
+    // from the leader.
+    uint32_t activeOriginFrame;
+    uint32_t activeTextHash;
+    void startWallMessage(int scrollX);
+    bool scrollWallMessage();
+
     Adafruit_Protomatter* matrix;
     SettingsManager* settings;
+    EventStream* events;
+    VideoWall* wall;
+    Metrics* metrics;
+    uint32_t frameCount;
+    uint32_t lastShowUs;
+
+    // Frame capture state, shared with the server task under captureLock. show() only writes
+    // captureFrame while WAITING and the server only reads it while READY.
+    enum CaptureState : uint8_t { CAPTURE_IDLE, CAPTURE_WAITING, CAPTURE_READY };
+    CaptureState captureState;
+    uint32_t captureId;
+    portMUX_TYPE captureLock;
+    uint16_t captureFrame[MATRIX_WIDTH * MATRIX_HEIGHT];
+
+    // Text distance field state
+    uint8_t textDistance[MATRIX_HEIGHT][MATRIX_WIDTH];
+    uint8_t textHaloLevels[TEXT_HALO_FADE_END];
+    uint8_t textMaskClearance;
+    TextMaskLayout textMaskLayout;
+    int textMaskTextSize;
+    bool textMask24Hour;
+    bool textMaskValid;
+
+    void rebuildTextMask();
+    void drawTextMaskGlyphs(Adafruit_GFX* gfx);
+    void computeTextDistance(const GFXcanvas1& mask);
+    static void drawTightClockGlyphs(Adafruit_GFX* gfx, const char* timeStr, int textSize, int y);
 
     // Brightness arrays
     uint16_t textColors[BRIGHTNESS_LEVELS] = {0x2104, 0x4208, 0x630C, 0x8410, 0xA514,
@@ -2,13 +2,17 @@
 
 #include <time.h>
 
+#include "Log.h"
+
 // Static menu data
 const char* MenuSystem::menuItems[] = {"Text Size", "Brightness", "Time Format", "Clock Color",
                                        "Msg Speed", "Effects",    "Timezone",    "Set Clock",
                                        "Sync NTP",  "WiFi Setup", "OTA Setup",   "Exit"};
 const int MenuSystem::MENU_ITEMS = sizeof(menuItems) / sizeof(menuItems[0]);
-const char* MenuSystem::effectNames[] = {"Confetti", "Acid",      "Rain", "Torrent", "Stars",
-                                         "Sparkles", "Fireworks", "Tron", "Off"};
+// Indexed by EffectMode
+const char* MenuSystem::effectNames[] = {"Confetti",  "Acid",      "Rain", "Torrent", "Stars",
+                                         "Sparkles",  "Fireworks", "Tron", "Off",     "Warp",
+                                         "Animation"};
 const int MenuSystem::EFFECT_OPTIONS = sizeof(effectNames) / sizeof(effectNames[0]);
 const char* MenuSystem::clockColorNames[] = {
     "White",  "Red",  "Green", "Blue", "Yellow", "Cyan", "Magenta", "Orange",
@@ -687,12 +691,11 @@ void MenuSystem::handleTimeSettingMode() {
     // Handle button inputs - allow repeating for scrolling, but consume each press
     if (buttons->isUpJustPressed()) {
         buttons->clearUpJustPressed();  // Immediately consume the button press
-        Serial.print("UP pressed (consumed)! ");
+        LOG_DEBUG("UP pressed (consumed)!");
         switch (setStep) {
             case SET_HOUR:
                 setHour = (setHour + 1) % 24;
-                Serial.print("Hour: ");
-                Serial.println(setHour);
+                LOG_DEBUG("Hour: %d", setHour);
                 break;
             case SET_MINUTE:
                 setMin = (setMin + 1) % 60;
@@ -791,6 +794,7 @@ void MenuSystem::handleInput(AppState& appState) {
         case SHOW_TIME_WITH_DATE:
         case SHOW_WIFI_INFO:
         case SHOW_MESSAGES:
+        case SHOW_PIXEL_STREAM:
             handleMenuEntry();
             if (shouldEnterMenu()) {
                 previousState = appState;  // Remember which screen we came from
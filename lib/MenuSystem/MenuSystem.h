@@ -161,6 +161,10 @@ class MenuSystem {
     int getMenuDelay() const {
         return MENU_DELAY;
     }
+    // The WiFi setup is reading the serial console
+    bool isSerialInputMode() const {
+        return serialInputMode;
+    }
 };
 
 #endif
@@ -1,22 +1,159 @@
 #include "MessageClient.h"
 
-#include <ArduinoJson.h>
-#include <HTTPClient.h>
-#include <WebServer.h>
+#include <memory>
+#include <new>
+
+#include "Log.h"
+#include "MessageItemSplitter.h"
+#include "Trace.h"
+
+// Per-request state of a POST /messages upload. It lives in the request's _tempObject,
+// which the server frees with free() once the request is done. This malloc of about 600
+// bytes (mostly the splitter's item buffer) is the one heap allocation per POST on the
+// message path, besides the server's own request objects; queuing a message allocates
+// nothing.
+struct MessageUpload {
+    int rejectStatus;  // Set when the upload was refused before any of it was queued
+    uint32_t clientIp;
+    MessageIngestResult result;
+    MessageItemSplitter splitter;
+};
+
+// Per-request state of a POST /animation upload, freed like MessageUpload. The file itself
+// is a MessageClient member, as only one upload is written at a time.
+struct AnimationUpload {
+    int rejectStatus;
+    bool writing;  // This request owns the upload file
+    size_t written;
+};
+
+// A small request body collected in full (/weather, /poll, /wall)
+struct RequestBody {
+    size_t length;
+    char data[MESSAGE_SMALL_BODY_MAX + 1];
+};
+
+static const char* errorJson(int status) {
+    switch (status) {
+        case 401:
+            return "{\"error\":\"unauthorized\"}";
+        case 409:
+            return "{\"error\":\"busy\"}";
+        case 413:
+            return "{\"error\":\"message too long\"}";
+        case 429:
+            return "{\"error\":\"rate limited\"}";
+        case 507:
+            return "{\"error\":\"insufficient memory\"}";
+        default:
+            return "{\"error\":\"bad request\"}";
+    }
+}
+
+// A missing timing field is 0. Negative, fractional or over-long ones are rejected rather
+// than read as 0 or wrapped.
+static bool readScheduleSeconds(JsonVariantConst value, uint32_t& seconds) {
+    if (value.isNull()) {
+        seconds = 0;
+        return true;
+    }
+    if (!value.is<unsigned long>() || value.as<unsigned long>() > MESSAGE_SCHEDULE_MAX_SECONDS) {
+        return false;
+    }
+    seconds = value.as<unsigned long>();
+    return true;
+}
 
-MessageClient::MessageClient(SettingsManager* settings, MatrixDisplayManager* display)
-    : settings(settings), display(display) {}
+MessageClient::MessageClient(SettingsManager* settings, MatrixDisplayManager* display,
+                             ClockDisplay* clock, TimeManager* timeManager, EventStream* events,
+                             VideoWall* wall, PixelStream* stream, AnimationPlayer* animation,
+                             Metrics* metrics)
+    : settings(settings),
+      display(display),
+      clock(clock),
+      timeManager(timeManager),
+      events(events),
+      wall(wall),
+      stream(stream),
+      animation(animation),
+      metrics(metrics),
+      rateLimiter(MESSAGE_RATE_PER_SECOND, MESSAGE_RATE_BURST) {
+    pendingPollUrl[0] = '\0';
+    datagrams.setKey(MESSAGE_UDP_KEY);
+    fleetDeviceId = (uint32_t)ESP.getEfuseMac();  // Low bytes of the MAC address
+}
 
 void MessageClient::begin() {
-    // read poll interval from settings later if added; keep default for now
-    // create web server
-    webServer = new WebServer(80);
-    webServer->on("/messages", HTTP_POST, [this]() { handlePostMessages(); });
-    webServer->on("/status", HTTP_GET, [this]() { handleStatus(); });
+    // Polling stays off until a feed URL has been configured (POST /poll)
+    poller.setUrl(settings->getPollUrl());
+    poller.onItem([this](const char* json, size_t length) { handlePolledItem(json, length); });
+
+    // create web server; "/messages" also matches "/messages/<id>"
+    webServer = new AsyncWebServer(80);
+    webServer->on(
+        "/messages", HTTP_POST,
+        [this](AsyncWebServerRequest* request) { handlePostMessages(request); }, nullptr,
+        [this](AsyncWebServerRequest* request, uint8_t* data, size_t length, size_t index,
+               size_t total) { handleMessageBody(request, data, length, index, total); });
+    webServer->on("/messages", HTTP_DELETE,
+                  [this](AsyncWebServerRequest* request) { handleDeleteMessage(request); });
+    webServer->on("/status", HTTP_GET,
+                  [this](AsyncWebServerRequest* request) { handleStatus(request); });
+    webServer->on(
+        "/weather", HTTP_POST,
+        [this](AsyncWebServerRequest* request) { handlePostWeather(request); }, nullptr,
+        collectBody);
+    webServer->on(
+        "/poll", HTTP_POST, [this](AsyncWebServerRequest* request) { handlePostPoll(request); },
+        nullptr, collectBody);
+    webServer->on(
+        "/wall", HTTP_POST, [this](AsyncWebServerRequest* request) { handlePostWall(request); },
+        nullptr, collectBody);
+    webServer->on(
+        "/animation", HTTP_POST,
+        [this](AsyncWebServerRequest* request) { handlePostAnimation(request); }, nullptr,
+        [this](AsyncWebServerRequest* request, uint8_t* data, size_t length, size_t index,
+               size_t total) { handleAnimationBody(request, data, length, index, total); });
+    webServer->on("/animation", HTTP_DELETE,
+                  [this](AsyncWebServerRequest* request) { handleDeleteAnimation(request); });
+    webServer->on("/frame", HTTP_GET,
+                  [this](AsyncWebServerRequest* request) { handleGetFrame(request); });
+    webServer->on("/metrics", HTTP_GET,
+                  [this](AsyncWebServerRequest* request) { handleMetrics(request); });
+    webServer->on("/logs", HTTP_GET,
+                  [this](AsyncWebServerRequest* request) { handleLogs(request); });
+#if TRACE_ENABLED
+    webServer->on("/trace", HTTP_GET,
+                  [this](AsyncWebServerRequest* request) { handleTrace(request); });
+#endif
+    // Same password as the other endpoints. A refused handshake falls through to the 401 below.
+    events->begin(webServer,
+                  [this](AsyncWebServerRequest* request) { return checkAuthentication(request); });
+    webServer->on(EVENT_STREAM_PATH, HTTP_GET, [](AsyncWebServerRequest* request) {
+        request->send(401, "application/json", errorJson(401));
+    });
     // do NOT call begin() here; start after WiFi is connected in loop
 }
 
 void MessageClient::loop() {
+    unsigned long now = millis();
+    if (lastLoopMs != 0) {
+        uint32_t gap = now - lastLoopMs;
+        uint32_t worst = loopGapMaxMs.load();
+        while (gap > worst && !loopGapMaxMs.compare_exchange_weak(worst, gap)) {
+        }
+    }
+    lastLoopMs = now;
+
+    // Queue and state events are published as they happen; stats go out once a second
+    if (now - lastStatsMs >= EVENT_STREAM_STATS_MS) {
+        uint32_t frames = display->getFrameCount();
+        uint16_t fps = (uint32_t)(frames - lastFrameCount) * 1000UL / (now - lastStatsMs);
+        events->publishStats(fps, ESP.getFreeHeap(), display->getQueueCount());
+        lastFrameCount = frames;
+        lastStatsMs = now;
+    }
+
     // Only poll if WiFi is connected
     if (!WiFi.isConnected())
         return;
@@ -25,21 +162,33 @@ void MessageClient::loop() {
     if (!serverStarted) {
         webServer->begin();
         serverStarted = true;
-        Serial.println("MessageClient: HTTP server started on port 80");
+        LOG_INFO("MessageClient: HTTP server started on port 80");
+        if (strlen(MESSAGE_UDP_KEY) > 0) {
+            udp.begin(MESSAGE_DATAGRAM_PORT);
+            LOG_INFO("MessageClient: UDP messages on port %d", MESSAGE_DATAGRAM_PORT);
+
+            IPAddress group;
+            if (group.fromString(MESSAGE_FLEET_GROUP)) {
+                fleetStarted = fleetUdp.beginMulticast(group, MESSAGE_FLEET_PORT);
+                LOG_INFO("MessageClient: fleet broadcasts on %s", MESSAGE_FLEET_GROUP);
+            }
+        }
     }
 
-    webServer->handleClient();
-
-    unsigned long now = millis();
+    // Queued before the next frame, so a push shows up one frame later
+    if (strlen(MESSAGE_UDP_KEY) > 0) {
+        receiveDatagrams(udp, false);
+        if (fleetStarted) {
+            receiveDatagrams(fleetUdp, true);
+        }
+    }
 
     // Periodic memory monitoring (every 30 seconds)
     static unsigned long lastMemoryCheck = 0;
     if (now - lastMemoryCheck > 30000) {
         uint32_t freeHeap = ESP.getFreeHeap();
         if (freeHeap < LOW_MEMORY_THRESHOLD) {
-            Serial.print("MessageClient: Low memory warning - ");
-            Serial.print(freeHeap);
-            Serial.println(" bytes free");
+            LOG_WARN("MessageClient: Low memory warning - %u bytes free", freeHeap);
 
             // Could implement additional cleanup here if needed
             // For now, just log the warning
@@ -47,204 +196,792 @@ void MessageClient::loop() {
         lastMemoryCheck = now;
     }
 
-    // Process one pending request per loop pass to keep work spread out
-    String pending;
-    if (dequeuePending(pending)) {
-        // process but don't block the HTTP response
-        bool ok = processJson(pending);
-        (void)ok;  // keep for potential future logging
+    // Apply a poll URL posted from the server task
+    if (pollUrlChanged) {
+        char url[MESSAGE_POLL_URL_MAX_LENGTH + 1];
+        portENTER_CRITICAL(&pollUrlLock);
+        strcpy(url, pendingPollUrl);
+        pollUrlChanged = false;
+        portEXIT_CRITICAL(&pollUrlLock);
+
+        poller.setUrl(url);
+        settings->setPollUrl(url);
+        settings->saveSettings();
+    }
+
+    // Apply a video wall layout posted from the server task
+    if (pendingWallTile >= 0) {
+        portENTER_CRITICAL(&pollUrlLock);
+        int tile = pendingWallTile;
+        int tiles = pendingWallTiles;
+        pendingWallTile = -1;
+        portEXIT_CRITICAL(&pollUrlLock);
+
+        wall->setLayout(tile, tiles);
+        settings->setWallLayout(tile, tiles);
+        settings->saveSettings();
+    }
+
+    // Swap in an uploaded animation, or drop the current one
+    if (pendingAnimation != ANIMATION_CHANGE_NONE) {
+        portENTER_CRITICAL(&pollUrlLock);
+        PendingAnimation change = pendingAnimation;
+        pendingAnimation = ANIMATION_CHANGE_NONE;
+        portEXIT_CRITICAL(&pollUrlLock);
+
+        if (change == ANIMATION_CHANGE_INSTALL) {
+            animation->install();
+        } else {
+            animation->remove();
+        }
+    }
+
+    // Advances the feed request in flight, if any; never waits on the network
+    poller.update();
+
+    events->update();
+}
+
+void MessageClient::receiveDatagrams(WiFiUDP& socket, bool fleet) {
+    uint8_t packet[MESSAGE_DATAGRAM_MAX_SIZE];
+    for (int i = 0; i < MESSAGE_DATAGRAM_BUDGET; i++) {
+        int size = socket.parsePacket();
+        if (size <= 0) {
+            return;
+        }
+        // Oversized datagrams are cut short by read() and then fail the length check
+        int length = socket.read(packet, sizeof(packet));
+
+        MessageDatagram message;
+        if (length <= 0 || (size_t)size > sizeof(packet) ||
+            datagrams.receive(packet, length, message) != DATAGRAM_OK) {
+            continue;  // No reply, so probing the port learns nothing
+        }
+
+        // A fleet retransmission of a message this clock already has is only acked again
+        uint8_t status;
+        if (fleet && datagrams.findDelivered(message, status)) {
+            status |= DATAGRAM_ACK_DUPLICATE;
+        } else {
+            status = deliverDatagram(message);
+            if (fleet) {
+                datagrams.rememberDelivered(message, status);
+            }
+        }
+
+        uint8_t ack[MESSAGE_FLEET_ACK_SIZE];
+        size_t ackLength =
+            fleet ? datagrams.buildFleetAck(ack, message.sequence, status, fleetDeviceId)
+                  : MessageDatagramReceiver::buildAck(ack, message.sequence, status);
+        socket.beginPacket(socket.remoteIP(), socket.remotePort());
+        socket.write(ack, ackLength);
+        socket.endPacket();
     }
+}
+
+uint8_t MessageClient::deliverDatagram(const MessageDatagram& message) {
+    const char* priority = MessageQueue::getPriorityName(message.priority);
+    MessagePushResult pushed = display->enqueueMessage(message.id, message.text, priority);
+    if (pushed == MESSAGE_PUSH_FULL) {
+        events->publishMessage("dropped", message.id, priority);
+        return DATAGRAM_ACK_FULL;
+    }
+    metrics->countMessagesAccepted(1);
+    if (pushed == MESSAGE_PUSH_QUEUED) {
+        events->publishMessage("accepted", message.id, priority);
+        return DATAGRAM_ACK_QUEUED;
+    }
+    events->publishMessage("updated", message.id, priority);
+    return DATAGRAM_ACK_UPDATED;
+}
+
+void MessageClient::ingestItem(const char* json, size_t length, MessageIngestResult& result) {
+    // Only one message object is held at a time, whatever the batch size
+    StaticJsonDocument<MESSAGE_ITEM_JSON_CAPACITY> item;
+    TRACE_BEGIN("json parse");
+    DeserializationError err = deserializeJson(item, json, length);
+    TRACE_END("json parse");
+    if (err || !item.is<JsonObject>()) {
+        LOG_WARN("MessageClient: JSON parse error: %s", err ? err.c_str() : "not an object");
+        result.malformed = true;
+        return;
+    }
+    enqueueMessage(item.as<JsonObjectConst>(), result);
+}
 
-    if (now - lastPoll < pollIntervalMs)
+void MessageClient::handlePolledItem(const char* json, size_t length) {
+    StaticJsonDocument<MESSAGE_ITEM_JSON_CAPACITY> item;
+    TRACE_BEGIN("json parse");
+    DeserializationError err = deserializeJson(item, json, length);
+    TRACE_END("json parse");
+    if (err || !item.is<JsonObject>()) {
+        LOG_WARN("MessageClient: malformed message in feed");
         return;
-    lastPoll = now;
+    }
+
+    MessageIngestResult result = {0, 0, 0, 0, 0, false};
+    JsonObjectConst obj = item.as<JsonObjectConst>();
+    enqueueMessage(obj, result);
 
-    pollServer();
+    // The next request only asks for messages newer than this one
+    const char* id = obj["id"] | "";
+    if (id[0] != '\0') {
+        poller.setCursor(id);
+    }
 }
 
-void MessageClient::pollServer() {
-    IPAddress ip = WiFi.localIP();
-    String serverUrl =
-        String("http://") + ip.toString() + ":3000/messages";  // uses device local IP
+void MessageClient::handleMessageBody(AsyncWebServerRequest* request, uint8_t* data,
+                                      size_t length, size_t index, size_t total) {
+    TRACE_SCOPE("http body /messages");
+    MessageUpload* upload = (MessageUpload*)request->_tempObject;
+
+    // Checks run once, before the first byte is queued
+    if (index == 0) {
+        void* memory = malloc(sizeof(MessageUpload));
+        if (!memory) {
+            LOG_WARN("MessageClient: No memory for upload state, rejecting messages");
+            return;
+        }
+        upload = new (memory) MessageUpload();
+        upload->rejectStatus = 0;
+        upload->clientIp = request->client()->remoteIP();
+        upload->result = {0, 0, 0, 0, 0, false};
+        request->_tempObject = upload;
+
+        if (!checkAuthentication(request)) {
+            upload->rejectStatus = 401;
+        } else if (ESP.getFreeHeap() < LOW_MEMORY_THRESHOLD) {
+            LOG_WARN("MessageClient: Low memory, rejecting message");
+            upload->rejectStatus = 507;
+        } else if (!rateLimiter.check(upload->clientIp, millis())) {
+            upload->rejectStatus = 429;
+        }
+        // No cap on the whole body: it is never held in full, and each message is held to
+        // MESSAGE_ITEM_MAX by the splitter and MESSAGE_TEXT_MAX_LENGTH by enqueueMessage()
+    }
+    if (!upload || upload->rejectStatus != 0) {
+        return;
+    }
 
-    HTTPClient http;
-    http.begin(serverUrl);
-    int httpCode = http.GET();
-    if (httpCode == HTTP_CODE_OK) {
-        String payload = http.getString();
-        processJson(payload);
-    } else {
-        Serial.print("MessageClient: HTTP GET failed, code: ");
-        Serial.println(httpCode);
+    // Each message is queued as soon as its closing brace arrives, if the client still has a
+    // token for it
+    upload->splitter.feed(data, length, [this, upload](const char* json, size_t itemLength) {
+        if (!rateLimiter.take(upload->clientIp, millis())) {
+            upload->result.limited++;
+            return;
+        }
+        ingestItem(json, itemLength, upload->result);
+    });
+}
+
+void MessageClient::handlePostMessages(AsyncWebServerRequest* request) {
+    TRACE_SCOPE("http POST /messages");
+    MessageUpload* upload = (MessageUpload*)request->_tempObject;
+
+    // Form-encoded posts (curl -d without a content type) arrive as a parameter instead
+    if (!upload && request->hasParam("body", true)) {
+        const String& body = request->getParam("body", true)->value();
+        handleMessageBody(request, (uint8_t*)body.c_str(), body.length(), 0, body.length());
+        upload = (MessageUpload*)request->_tempObject;
+    }
+
+    // No upload state with a body means its allocation failed, not that the body was empty
+    if (!upload) {
+        if (!checkAuthentication(request)) {
+            rejectMessages(request, 401, errorJson(401));
+        } else if (request->contentLength() > 0) {
+            rejectMessages(request, 507, errorJson(507));
+        } else {
+            rejectMessages(request, 400, "{\"error\":\"empty body\"}");
+        }
+        return;
+    }
+    if (upload->rejectStatus == 429) {
+        sendRateLimited(request, upload->clientIp);
+        return;
+    }
+    if (upload->rejectStatus != 0) {
+        rejectMessages(request, upload->rejectStatus, errorJson(upload->rejectStatus));
+        return;
     }
-    http.end();
+
+    MessageIngestResult& result = upload->result;
+    if (upload->splitter.isMalformed() || !upload->splitter.isComplete()) {
+        result.malformed = true;
+    }
+    if (result.queued == 0 && result.updated == 0) {
+        if (result.limited > 0) {
+            sendRateLimited(request, upload->clientIp);
+        } else if (result.malformed) {
+            rejectMessages(request, 400, "{\"error\":\"invalid json\"}");
+        } else if (result.tooLong > 0) {
+            rejectMessages(request, 413, errorJson(413));
+        } else if (result.dropped > 0) {
+            rejectMessages(request, 503, "{\"error\":\"queue full\"}");
+        } else {
+            rejectMessages(request, 400, "{\"error\":\"no message text\"}");
+        }
+        return;
+    }
+
+    // Partial batches are accepted; the counts tell the client what made it in
+    char response[160];
+    snprintf(response, sizeof(response),
+             "{\"status\":\"accepted\",\"queued\":%d,\"updated\":%d,\"dropped\":%d,"
+             "\"limited\":%d,\"too_long\":%d,\"malformed\":%s}",
+             result.queued, result.updated, result.dropped, result.limited, result.tooLong,
+             result.malformed ? "true" : "false");
+    request->send(201, "application/json", response);
 }
 
-void MessageClient::handlePostMessages() {
-    if (!webServer)
+void MessageClient::handleDeleteMessage(AsyncWebServerRequest* request) {
+    TRACE_SCOPE("http DELETE /messages");
+    if (!checkAuthentication(request)) {
+        request->send(401, "application/json", errorJson(401));
         return;
+    }
 
-    // Check authentication first
-    if (!checkAuthentication()) {
-        webServer->send(401, "application/json", "{\"error\":\"unauthorized\"}");
+    // DELETE /messages/<id>; the server has already URL-decoded the path
+    const String& url = request->url();
+    const char* prefix = "/messages/";
+    if (!url.startsWith(prefix) || !display->removeMessage(url.c_str() + strlen(prefix))) {
+        request->send(404, "application/json", "{\"error\":\"not found\"}");
         return;
     }
+    request->send(200, "application/json", "{\"status\":\"deleted\"}");
+}
 
-    // Check memory availability
-    if (ESP.getFreeHeap() < LOW_MEMORY_THRESHOLD) {
-        Serial.println("MessageClient: Low memory, rejecting message");
-        webServer->send(507, "application/json", "{\"error\":\"insufficient memory\"}");
+void MessageClient::handleStatus(AsyncWebServerRequest* request) {
+    TRACE_SCOPE("http GET /status");
+    // Check authentication for status endpoint too
+    if (!checkAuthentication(request)) {
+        request->send(401, "application/json", errorJson(401));
         return;
     }
 
-    // Rate limiting check
-    unsigned long now = millis();
-    if (now - lastMessageTime < MIN_MESSAGE_INTERVAL) {
-        webServer->send(429, "application/json", "{\"error\":\"rate limited\"}");
+    // Written straight into the response buffer rather than built up as a String
+    AsyncResponseStream* response = request->beginResponseStream("application/json");
+    response->printf("{\"ip\":\"%s\",", WiFi.localIP().toString().c_str());
+    response->printf("\"display_queue\":%d,", display->getQueueCount());
+    response->printf("\"display_capacity\":%d,", display->getQueueCapacity());
+    response->printf("\"display_scheduled\":%d,", display->getScheduledCount());
+    response->print("\"display_queue_by_priority\":{");
+    for (int p = MESSAGE_PRIORITY_COUNT - 1; p >= 0; p--) {
+        MessagePriority priority = (MessagePriority)p;
+        response->printf("\"%s\":%d%s", MessageQueue::getPriorityName(priority),
+                         display->getQueueCount(priority), p > 0 ? "," : "},");
+    }
+    // The poll URL is set by API clients, so it is escaped like an event id
+    char pollUrl[2 * MESSAGE_POLL_URL_MAX_LENGTH + 3];
+    size_t pollUrlLength = 0;
+    if (!EventStream::appendString(pollUrl, sizeof(pollUrl), pollUrlLength, poller.getUrl())) {
+        strcpy(pollUrl, "\"\"");
+    }
+    response->printf("\"poll_url\":%s,", pollUrl);
+    response->printf("\"poll_last_status\":%d,", poller.getLastStatus());
+    response->printf("\"poll_failures\":%d,", poller.getFailureCount());
+    response->printf("\"udp_rejected\":%lu,", (unsigned long)datagrams.getRejectedCount());
+    response->printf("\"fleet_group\":\"%s\",", fleetStarted ? MESSAGE_FLEET_GROUP : "");
+    response->printf("\"fleet_device_id\":%lu,", (unsigned long)fleetDeviceId);
+    response->printf("\"wall\":{\"tile\":%d,\"tiles\":%d,\"synced\":%s,\"beacons\":%lu,",
+                     wall->getTileIndex(), wall->getTileCount(),
+                     wall->isSynced() ? "true" : "false", (unsigned long)wall->getBeaconCount());
+    response->printf("\"frame\":%lu,\"offset_us\":%lld},", (unsigned long)wall->getFrame(),
+                     (long long)wall->getOffsetMicros());
+    const PixelStreamStats& frames = stream->getStats();
+    response->printf("\"stream\":{\"protocol\":\"%s\",\"fps\":%lu,\"packets\":%lu,",
+                     stream->getProtocol(), (unsigned long)stream->getFps(),
+                     (unsigned long)frames.packets);
+    response->printf("\"bad_packets\":%lu,\"lost_packets\":%lu,\"late_packets\":%lu,",
+                     (unsigned long)frames.badPackets, (unsigned long)frames.lostPackets,
+                     (unsigned long)frames.latePackets);
+    response->printf("\"frames\":%lu,\"incomplete\":%lu,\"shown\":%lu,\"dropped\":%lu,",
+                     (unsigned long)frames.frames, (unsigned long)frames.incomplete,
+                     (unsigned long)frames.shown, (unsigned long)frames.dropped);
+    response->printf("\"skipped\":%lu},", (unsigned long)frames.skipped);
+    // Per-frame costs on this clock's flash, and the frame rate they would allow
+    const AnimationStats& played = animation->getStats();
+    uint32_t decoded = played.frames ? played.frames : 1;
+    response->printf("\"animation\":{\"loaded\":%s,\"frames\":%u,\"decoded\":%lu,",
+                     animation->isLoaded() ? "true" : "false", animation->getFrameCount(),
+                     (unsigned long)played.frames);
+    response->printf("\"skipped\":%lu,\"loops\":%lu,\"read_bytes_per_second\":%lu,",
+                     (unsigned long)played.skipped, (unsigned long)played.loops,
+                     (unsigned long)animation->getReadBandwidth());
+    response->printf("\"read_us_per_frame\":%lu,\"decode_us_per_frame\":%lu,\"max_fps\":%lu},",
+                     (unsigned long)(played.readUs / decoded),
+                     (unsigned long)(played.decodeUs / decoded),
+                     (unsigned long)animation->getMaxFps());
+    // Each status read reports the worst loop gap since the previous one
+    response->printf("\"loop_gap_max_ms\":%lu,", (unsigned long)loopGapMaxMs.exchange(0));
+    response->printf("\"event_subscribers\":%d,", events->getSubscriberCount());
+    response->printf("\"event_overruns\":%lu,", (unsigned long)events->getOverrunCount());
+    response->printf("\"free_heap\":%u,", ESP.getFreeHeap());
+    response->printf("\"rate_limit\":{\"per_second\":%u,\"burst\":%u},", rateLimiter.getRate(),
+                     rateLimiter.getBurst());
+
+    // Per-client counters since each client was last added to the table
+    response->print("\"clients\":[");
+    bool first = true;
+    for (int i = 0; i < RATE_LIMIT_CLIENTS; i++) {
+        const RateLimitClient& client = rateLimiter.getClient(i);
+        if (client.ip == 0) {
+            continue;
+        }
+        response->printf("%s{\"ip\":\"%s\",\"tokens\":%lu,\"allowed\":%lu,\"limited\":%lu}",
+                         first ? "" : ",", IPAddress(client.ip).toString().c_str(),
+                         (unsigned long)(client.milliTokens / 1000), (unsigned long)client.allowed,
+                         (unsigned long)client.limited);
+        first = false;
+    }
+    response->print("],");
+    response->printf("\"max_message_length\":%d,", MESSAGE_TEXT_MAX_LENGTH);
+    response->printf("\"auth_required\":%s}", strlen(MESSAGE_API_PASSWORD) > 0 ? "true" : "false");
+    request->send(response);
+}
+
+void MessageClient::handlePostWeather(AsyncWebServerRequest* request) {
+    TRACE_SCOPE("http POST /weather");
+    if (!checkAuthentication(request)) {
+        request->send(401, "application/json", errorJson(401));
         return;
     }
 
-    // Read body (non-blocking read is handled by WebServer; arg("plain") is safe)
-    String body = webServer->arg("plain");
-    if (body.length() == 0) {
-        webServer->send(400, "application/json", "{\"error\":\"empty body\"}");
+    // Body: {"condition":"sun|cloud|rain|snow|storm|none"}
+    StaticJsonDocument<128> doc;
+    const char* body = getBody(request);
+    if (!body || deserializeJson(doc, body)) {
+        request->send(400, "application/json", "{\"error\":\"invalid json\"}");
         return;
     }
 
-    // Check message length
-    if (body.length() > MAX_MESSAGE_LENGTH) {
-        webServer->send(413, "application/json", "{\"error\":\"message too long\"}");
+    WeatherCondition condition;
+    if (!ClockDisplay::parseWeatherCondition(doc["condition"] | "", condition)) {
+        request->send(400, "application/json", "{\"error\":\"unknown condition\"}");
         return;
     }
 
-    // Try to enqueue the raw body for async processing. If queue full, return 503.
-    if (!enqueuePending(body)) {
-        webServer->send(503, "application/json", "{\"error\":\"server busy\"}");
+    clock->setWeather(condition);
+    request->send(200, "application/json", "{\"status\":\"ok\"}");
+}
+
+void MessageClient::handlePostPoll(AsyncWebServerRequest* request) {
+    TRACE_SCOPE("http POST /poll");
+    if (!checkAuthentication(request)) {
+        request->send(401, "application/json", errorJson(401));
         return;
     }
 
-    // Update rate limiting timestamp
-    lastMessageTime = now;
+    // Body: {"url":"http://host:port/path"}; an empty url turns polling off
+    StaticJsonDocument<256> doc;
+    const char* body = getBody(request);
+    if (!body || deserializeJson(doc, body)) {
+        request->send(400, "application/json", "{\"error\":\"invalid json\"}");
+        return;
+    }
+
+    const char* url = doc["url"] | "";
+    if (!MessagePoller::isSupportedUrl(url)) {
+        request->send(400, "application/json", "{\"error\":\"unsupported url\"}");
+        return;
+    }
 
-    // Respond immediately to the client. Actual parsing/queuing to display occurs asynchronously in
-    // loop().
-    webServer->send(201, "application/json", "{\"status\":\"accepted\"}");
+    // The poller belongs to the render loop; hand the URL over rather than touching it here
+    portENTER_CRITICAL(&pollUrlLock);
+    strcpy(pendingPollUrl, url);
+    pollUrlChanged = true;
+    portEXIT_CRITICAL(&pollUrlLock);
+    request->send(200, "application/json", "{\"status\":\"ok\"}");
 }
 
-void MessageClient::handleStatus() {
-    if (!webServer)
+void MessageClient::handlePostWall(AsyncWebServerRequest* request) {
+    TRACE_SCOPE("http POST /wall");
+    if (!checkAuthentication(request)) {
+        request->send(401, "application/json", errorJson(401));
         return;
+    }
 
-    // Check authentication for status endpoint too
-    if (!checkAuthentication()) {
-        webServer->send(401, "application/json", "{\"error\":\"unauthorized\"}");
-        return;
-    }
-
-    IPAddress ip = WiFi.localIP();
-    String payload;
-    payload += "{\"ip\":\"" + ip.toString() + "\",";
-    payload += "\"pending_queue\":" + String(pqCount) + ",";
-    payload += "\"pending_capacity\":" + String(PENDING_QUEUE_SIZE) + ",";
-    payload += "\"display_queue\":" + String(display->getQueueCount()) + ",";
-    payload += "\"display_capacity\":" + String(8) + ",";
-    payload += "\"free_heap\":" + String(ESP.getFreeHeap()) + ",";
-    payload += "\"rate_limit_ms\":" + String(MIN_MESSAGE_INTERVAL) + ",";
-    payload += "\"max_message_length\":" + String(MAX_MESSAGE_LENGTH) + ",";
-    payload +=
-        "\"auth_required\":" + String(strlen(MESSAGE_API_PASSWORD) > 0 ? "true" : "false") + "}";
-    webServer->send(200, "application/json", payload);
-}
-
-bool MessageClient::processJson(const String& json) {
-    // Try array first, then object. Use a conservative JSON document size.
-    StaticJsonDocument<2048> doc;
-    DeserializationError err = deserializeJson(doc, json);
-    if (err) {
-        Serial.print("MessageClient: JSON parse error: ");
-        Serial.println(err.c_str());
-        return false;
+    // Body: {"tile":1,"tiles":4}; {"tile":0,"tiles":1} makes a standalone clock again
+    StaticJsonDocument<128> doc;
+    const char* body = getBody(request);
+    if (!body || deserializeJson(doc, body)) {
+        request->send(400, "application/json", "{\"error\":\"invalid json\"}");
+        return;
+    }
+
+    int tile = doc["tile"] | -1;
+    int tiles = doc["tiles"] | 0;
+    if (tiles < 1 || tiles > WALL_TILES_MAX || tile < 0 || tile >= tiles) {
+        request->send(400, "application/json", "{\"error\":\"invalid layout\"}");
+        return;
     }
 
-    if (doc.is<JsonArray>()) {
-        for (JsonObject obj : doc.as<JsonArray>()) {
-            const char* id = obj["id"] | "";
-            const char* text = obj["text"] | "";
-            const char* priority = obj["priority"] | "normal";
+    // Layout and settings belong to the render loop, like the poll URL
+    portENTER_CRITICAL(&pollUrlLock);
+    pendingWallTile = tile;
+    pendingWallTiles = tiles;
+    portEXIT_CRITICAL(&pollUrlLock);
+    request->send(200, "application/json", "{\"status\":\"ok\"}");
+}
 
-            if (strlen(text) == 0)
-                continue;
+void MessageClient::handleAnimationBody(AsyncWebServerRequest* request, uint8_t* data,
+                                        size_t length, size_t index, size_t total) {
+    TRACE_SCOPE("http body /animation");
+    AnimationUpload* upload = (AnimationUpload*)request->_tempObject;
 
-            display->enqueueMessage(id, text, priority);
-            Serial.print("MessageClient: queued message: ");
-            Serial.println(text);
+    if (index == 0) {
+        upload = (AnimationUpload*)malloc(sizeof(AnimationUpload));
+        if (!upload) {
+            LOG_WARN("MessageClient: No memory for upload state, rejecting animation");
+            return;
         }
-        return true;
+        upload->rejectStatus = 0;
+        upload->writing = false;
+        upload->written = 0;
+        request->_tempObject = upload;
+
+        // An upload whose client went away mid-body is given up after a while
+        bool stale = millis() - animationUploadMs >= ANIMATION_UPLOAD_TIMEOUT_MS;
+        bool busy = pendingAnimation != ANIMATION_CHANGE_NONE || (animationUploading && !stale);
+        if (!checkAuthentication(request)) {
+            upload->rejectStatus = 401;
+        } else if (total > ANIMATION_MAX_BYTES) {
+            upload->rejectStatus = 413;
+        } else if (busy) {
+            upload->rejectStatus = 409;
+        } else {
+            if (animationUpload) {
+                animationUpload.close();
+            }
+            animationUpload = LittleFS.open(ANIMATION_UPLOAD_PATH, "w");
+            upload->writing = animationUpload;
+            upload->rejectStatus = animationUpload ? 0 : 507;
+            animationUploading = upload->writing;
+        }
+    }
+    if (!upload || !upload->writing) {
+        return;
     }
 
-    if (doc.is<JsonObject>()) {
-        JsonObject obj = doc.as<JsonObject>();
-        const char* id = obj["id"] | "";
-        const char* text = obj["text"] | "";
-        const char* priority = obj["priority"] | "normal";
+    animationUploadMs = millis();
+    if (animationUpload.write(data, length) != length) {
+        upload->rejectStatus = 507;  // Flash full
+        upload->writing = false;
+        animationUpload.close();
+        animationUploading = false;
+        LittleFS.remove(ANIMATION_UPLOAD_PATH);
+        return;
+    }
+    upload->written += length;
+}
 
-        if (strlen(text) == 0)
-            return false;
+void MessageClient::handlePostAnimation(AsyncWebServerRequest* request) {
+    TRACE_SCOPE("http POST /animation");
+    AnimationUpload* upload = (AnimationUpload*)request->_tempObject;
+    if (!upload) {
+        if (!checkAuthentication(request)) {
+            request->send(401, "application/json", errorJson(401));
+        } else if (request->contentLength() > 0) {
+            request->send(507, "application/json", errorJson(507));
+        } else {
+            request->send(400, "application/json", "{\"error\":\"empty body\"}");
+        }
+        return;
+    }
+    if (upload->rejectStatus == 413) {
+        request->send(413, "application/json", "{\"error\":\"animation too large\"}");
+        return;
+    }
+    if (upload->rejectStatus == 507) {
+        request->send(507, "application/json", "{\"error\":\"not enough flash\"}");
+        return;
+    }
+    if (upload->rejectStatus != 0) {
+        request->send(upload->rejectStatus, "application/json", errorJson(upload->rejectStatus));
+        return;
+    }
 
-        display->enqueueMessage(id, text, priority);
-        Serial.print("MessageClient: queued message: ");
-        Serial.println(text);
-        return true;
+    animationUpload.close();
+    animationUploading = false;
+    if (upload->written != request->contentLength() ||
+        !AnimationPlayer::validate(ANIMATION_UPLOAD_PATH)) {
+        LittleFS.remove(ANIMATION_UPLOAD_PATH);
+        request->send(400, "application/json", "{\"error\":\"invalid animation\"}");
+        return;
     }
 
-    Serial.println("MessageClient: unexpected JSON type");
-    return false;
+    portENTER_CRITICAL(&pollUrlLock);
+    pendingAnimation = ANIMATION_CHANGE_INSTALL;
+    portEXIT_CRITICAL(&pollUrlLock);
+    char response[64];
+    snprintf(response, sizeof(response), "{\"status\":\"accepted\",\"bytes\":%u}",
+             (unsigned)upload->written);
+    request->send(201, "application/json", response);
 }
 
-bool MessageClient::enqueuePending(const String& body) {
-    if (pqCount >= PENDING_QUEUE_SIZE)
-        return false;
-    pendingQueue[pqTail] = body;
-    pqTail = (pqTail + 1) % PENDING_QUEUE_SIZE;
-    pqCount++;
-    return true;
+void MessageClient::handleDeleteAnimation(AsyncWebServerRequest* request) {
+    TRACE_SCOPE("http DELETE /animation");
+    if (!checkAuthentication(request)) {
+        request->send(401, "application/json", errorJson(401));
+        return;
+    }
+    portENTER_CRITICAL(&pollUrlLock);
+    pendingAnimation = ANIMATION_CHANGE_REMOVE;
+    portEXIT_CRITICAL(&pollUrlLock);
+    request->send(200, "application/json", "{\"status\":\"deleted\"}");
 }
 
-bool MessageClient::dequeuePending(String& out) {
-    if (pqCount == 0)
-        return false;
-    out = pendingQueue[pqHead];
-    pqHead = (pqHead + 1) % PENDING_QUEUE_SIZE;
-    pqCount--;
-    return true;
+void MessageClient::handleGetFrame(AsyncWebServerRequest* request) {
+    TRACE_SCOPE("http GET /frame");
+    if (!checkAuthentication(request)) {
+        request->send(401, "application/json", errorJson(401));
+        return;
+    }
+    FrameCaptureFormat format = FRAME_CAPTURE_PNG;
+    if (request->hasParam("format") &&
+        !FrameCapture::parseFormat(request->getParam("format")->value().c_str(), format)) {
+        request->send(400, "application/json", "{\"error\":\"unknown format\"}");
+        return;
+    }
+    auto capture = std::make_shared<FrameCapture>(format, MATRIX_WIDTH, MATRIX_HEIGHT, 1);
+    uint32_t id = display->requestCapture();
+    if (id == 0) {
+        request->send(409, "application/json", errorJson(409));
+        return;
+    }
+
+    // The frame is sent from the copy show() made of it; until the next show() the server
+    // polls again, which never holds up the panel. Should the capture be cancelled, the rest
+    // comes from the live canvas so the response still ends at its length.
+    MatrixDisplayManager* display = this->display;
+    AsyncWebServerResponse* response = request->beginResponse(
+        capture->getContentType(), capture->getLength(),
+        [capture, display, id](uint8_t* buffer, size_t maxLength, size_t index) -> size_t {
+            const uint16_t* frame = display->getCapturedFrame(id);
+            if (!frame) {
+                if (display->isCapturing(id)) {
+                    return RESPONSE_TRY_AGAIN;
+                }
+                frame = display->getFrameBuffer();
+            }
+            size_t length = capture->read(frame, buffer, maxLength);
+            if (length > 0 && capture->isFrameStart()) {
+                display->releaseCapturedFrame(id);  // That was the whole frame
+            }
+            return length;
+        });
+    char size[16];
+    snprintf(size, sizeof(size), "%dx%d", MATRIX_WIDTH, MATRIX_HEIGHT);
+    response->addHeader("X-Frame-Size", size);
+    request->onDisconnect([display, id]() { display->cancelCapture(id); });
+    request->send(response);
 }
 
-bool MessageClient::checkAuthentication() {
-    // If no password is configured, allow all requests
-    if (strlen(MESSAGE_API_PASSWORD) == 0) {
+void MessageClient::handleMetrics(AsyncWebServerRequest* request) {
+    TRACE_SCOPE("http GET /metrics");
+    if (!checkAuthentication(request)) {
+        request->send(401, "application/json", errorJson(401));
+        return;
+    }
+
+    // Counters and gauges are read once, then written into the server's send buffer a few
+    // lines per call as the connection takes them. When the socket has too little room for
+    // the next line, the server asks again later.
+    MetricsCounts counts;
+    metrics->snapshot(counts);
+    MetricsGauges gauges;
+    for (int p = 0; p < MESSAGE_PRIORITY_COUNT; p++) {
+        gauges.queueDepth[p] = display->getQueueCount((MessagePriority)p);
+    }
+    gauges.queueCapacity = display->getQueueCapacity();
+    gauges.scheduled = display->getScheduledCount();
+    gauges.heapFree = ESP.getFreeHeap();
+    gauges.heapMinFree = ESP.getMinFreeHeap();
+    gauges.heapLargestBlock = ESP.getMaxAllocHeap();
+
+    auto writer = std::make_shared<MetricsWriter>(counts, gauges);
+    request->send(request->beginChunkedResponse(
+        "text/plain; version=0.0.4",
+        [writer](uint8_t* buffer, size_t maxLength, size_t index) -> size_t {
+            size_t length = writer->write(buffer, maxLength);
+            return length == 0 && !writer->isDone() ? RESPONSE_TRY_AGAIN : length;
+        }));
+}
+
+void MessageClient::handleLogs(AsyncWebServerRequest* request) {
+    TRACE_SCOPE("http GET /logs");
+    if (!checkAuthentication(request)) {
+        request->send(401, "application/json", errorJson(401));
+        return;
+    }
+
+    // The log history as it stands now, oldest whole line first, copied straight into the
+    // server's send buffer. Lines logged while it is sent are left for the next request.
+    auto position = std::make_shared<uint32_t>(0);
+    uint32_t end = Log::getHistoryEnd();
+    request->send(request->beginChunkedResponse(
+        "text/plain", [position, end](uint8_t* buffer, size_t maxLength, size_t index) -> size_t {
+            return Log::readHistory(*position, end, (char*)buffer, maxLength);
+        }));
+}
+
+#if TRACE_ENABLED
+void MessageClient::handleTrace(AsyncWebServerRequest* request) {
+    if (!checkAuthentication(request)) {
+        request->send(401, "application/json", errorJson(401));
+        return;
+    }
+
+    // Recording pauses until the response is gone, so the dump ends where the request came in
+    auto writer = std::make_shared<TraceWriter>();
+    request->send(request->beginChunkedResponse(
+        "application/json", [writer](uint8_t* buffer, size_t maxLength, size_t index) -> size_t {
+            size_t length = writer->write(buffer, maxLength);
+            return length == 0 && !writer->isDone() ? RESPONSE_TRY_AGAIN : length;
+        }));
+}
+#endif
+
+void MessageClient::collectBody(AsyncWebServerRequest* request, uint8_t* data, size_t length,
+                                size_t index, size_t total) {
+    if (index == 0) {
+        if (total > MESSAGE_SMALL_BODY_MAX) {
+            return;  // Left unset, so the handler answers 400
+        }
+        RequestBody* body = (RequestBody*)malloc(sizeof(RequestBody));
+        if (!body) {
+            return;
+        }
+        body->length = 0;
+        request->_tempObject = body;
+    }
+
+    RequestBody* body = (RequestBody*)request->_tempObject;
+    if (!body || body->length + length > MESSAGE_SMALL_BODY_MAX) {
+        return;
+    }
+    memcpy(body->data + body->length, data, length);
+    body->length += length;
+    body->data[body->length] = '\0';
+}
+
+const char* MessageClient::getBody(AsyncWebServerRequest* request) {
+    RequestBody* body = (RequestBody*)request->_tempObject;
+    if (body) {
+        return body->data;
+    }
+    // Form-encoded posts arrive as a parameter instead
+    if (request->hasParam("body", true)) {
+        return request->getParam("body", true)->value().c_str();
+    }
+    return nullptr;
+}
+
+void MessageClient::enqueueMessage(JsonObjectConst obj, MessageIngestResult& result) {
+    const char* id = obj["id"] | "";
+    const char* text = obj["text"] | "";
+    const char* priority = obj["priority"] | "normal";
+
+    if (strlen(text) == 0)
+        return;
+    // Refused rather than cut short, so the sender learns the text did not fit
+    if (strlen(text) > MESSAGE_TEXT_MAX_LENGTH) {
+        LOG_WARN("MessageClient: message text too long, message skipped");
+        result.tooLong++;
+        return;
+    }
+
+    MessageSchedule schedule;
+    if (!parseSchedule(obj, schedule)) {
+        LOG_WARN("MessageClient: invalid schedule, message skipped");
+        result.malformed = true;
+        return;
+    }
+
+    MessagePushResult pushed = display->enqueueMessage(id, text, priority, schedule);
+    const char* priorityName = MessageQueue::getPriorityName(MessageQueue::parsePriority(priority));
+    if (pushed == MESSAGE_PUSH_FULL) {
+        events->publishMessage("dropped", id, priorityName);
+        result.dropped++;
+        return;
+    }
+    metrics->countMessagesAccepted(1);
+    if (pushed == MESSAGE_PUSH_QUEUED) {
+        events->publishMessage("accepted", id, priorityName);
+        result.queued++;
+    } else {
+        events->publishMessage("updated", id, priorityName);
+        result.updated++;
+    }
+}
+
+bool MessageClient::parseSchedule(JsonObjectConst obj, MessageSchedule& schedule) {
+    // "delay", "ttl" and "repeat" are seconds; "at" is local "HH:MM" (next occurrence)
+    if (!readScheduleSeconds(obj["delay"], schedule.delaySeconds) ||
+        !readScheduleSeconds(obj["ttl"], schedule.ttlSeconds) ||
+        !readScheduleSeconds(obj["repeat"], schedule.repeatSeconds)) {
+        return false;
+    }
+
+    const char* at = obj["at"] | "";
+    if (at[0] == '\0') {
         return true;
     }
 
-    // Check for Authorization header
-    if (!webServer->hasHeader("Authorization")) {
+    int hour, minute;
+    if (sscanf(at, "%d:%d", &hour, &minute) != 2 || hour < 0 || hour > 23 || minute < 0 ||
+        minute > 59 || !timeManager) {
         return false;
     }
 
-    String authHeader = webServer->header("Authorization");
+    DateTime now = timeManager->getLocalTime();
+    long nowSeconds = now.hour() * 3600L + now.minute() * 60L + now.second();
+    long delay = hour * 3600L + minute * 60L - nowSeconds;
+    if (delay <= 0) {
+        delay += 24L * 3600L;  // Already past today, so show it tomorrow
+    }
+    schedule.delaySeconds = delay;
+    return true;
+}
 
-    // Support both Bearer token and Basic auth formats
-    String expectedBearer = "Bearer " + String(MESSAGE_API_PASSWORD);
-    if (authHeader == expectedBearer) {
+
+void MessageClient::sendRateLimited(AsyncWebServerRequest* request, uint32_t ip) {
+    metrics->countRejected(METRICS_REJECT_RATE_LIMITED);
+    char retryAfter[12];
+    snprintf(retryAfter, sizeof(retryAfter), "%lu",
+             (unsigned long)rateLimiter.getRetryAfter(ip, millis()));
+    AsyncWebServerResponse* response =
+        request->beginResponse(429, "application/json", errorJson(429));
+    response->addHeader("Retry-After", retryAfter);
+    request->send(response);
+}
+
+bool MessageClient::checkAuthentication(AsyncWebServerRequest* request) {
+    // If no password is configured, allow all requests
+    if (strlen(MESSAGE_API_PASSWORD) == 0) {
         return true;
     }
 
+    // Support the Bearer token format
+    if (request->hasHeader("Authorization")) {
+        const String& authHeader = request->getHeader("Authorization")->value();
+        if (authHeader.startsWith("Bearer ") &&
+            strcmp(authHeader.c_str() + 7, MESSAGE_API_PASSWORD) == 0) {
+            return true;
+        }
+    }
+
     // Also check for password in query parameter as fallback
-    if (webServer->hasArg("password")) {
-        String providedPassword = webServer->arg("password");
-        if (providedPassword == String(MESSAGE_API_PASSWORD)) {
+    if (request->hasParam("password")) {
+        if (request->getParam("password")->value() == MESSAGE_API_PASSWORD) {
             return true;
         }
     }
 
     return false;
 }
+
+void MessageClient::rejectMessages(AsyncWebServerRequest* request, int status, const char* json) {
+    metrics->countRejected(Metrics::reasonFor(status));
+    request->send(status, "application/json", json);
+}
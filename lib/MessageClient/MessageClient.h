@@ -3,11 +3,25 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
+#include <atomic>
+#include <WiFiUdp.h>
 
-#include <WebServer.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
 
+#include "AnimationPlayer.h"
+#include "ClockDisplay.h"
+#include "EventStream.h"
+#include "FrameCapture.h"
+#include "MessageDatagram.h"
 #include "MatrixDisplayManager.h"
+#include "MessagePoller.h"
+#include "Metrics.h"
+#include "RateLimiter.h"
 #include "SettingsManager.h"
+#include "TimeManager.h"
+#include "PixelStream.h"
+#include "VideoWall.h"
 
 // Try to include local message API config, use default if not available
 #if __has_include("../../credentials/message_config.h")
@@ -19,53 +33,146 @@
 #define MESSAGE_API_PASSWORD "defaultMessage"
 #endif
 
-struct MessageItem {
-    String id;
-    String text;
-    String priority;
+// HMAC key of the UDP message protocol; an empty key turns the UDP listener off
+#ifndef MESSAGE_UDP_KEY
+#define MESSAGE_UDP_KEY MESSAGE_API_PASSWORD
+#endif
+#define MESSAGE_DATAGRAM_BUDGET 8  // Datagrams handled per loop pass, per socket
+
+// Multicast group for fleet broadcasts, e.g. "239.255.42.10"; empty leaves it off
+#ifndef MESSAGE_FLEET_GROUP
+#define MESSAGE_FLEET_GROUP ""
+#endif
+
+// Per-client message rate: each message costs one token; tokens refill at
+// MESSAGE_RATE_PER_SECOND up to MESSAGE_RATE_BURST. Both can be set in message_config.h.
+#ifndef MESSAGE_RATE_PER_SECOND
+#define MESSAGE_RATE_PER_SECOND 2
+#endif
+#ifndef MESSAGE_RATE_BURST
+#define MESSAGE_RATE_BURST 10
+#endif
+
+// Streaming ingestion: each element of a message array is parsed into its own small document
+// and queued before the next one is read, so memory use does not grow with the batch size.
+#define MESSAGE_ITEM_JSON_CAPACITY 768  // One message object (text, id, priority, options)
+#define MESSAGE_SMALL_BODY_MAX 256      // Bodies of /weather, /poll and /wall
+
+// An animation upload that has not sent anything for this long gives way to a new one
+#define ANIMATION_UPLOAD_TIMEOUT_MS 10000UL
+
+// Animation file change waiting for the render loop
+enum PendingAnimation { ANIMATION_CHANGE_NONE, ANIMATION_CHANGE_INSTALL, ANIMATION_CHANGE_REMOVE };
+
+struct MessageIngestResult {
+    int queued;
+    int updated;     // Replaced or repeated a message already held under the same id
+    int dropped;     // Valid messages that found the display queue full
+    int limited;     // Messages refused because the client ran out of tokens
+    int tooLong;     // Text longer than MESSAGE_TEXT_MAX_LENGTH bytes, not queued
+    bool malformed;  // Parsing stopped early; messages before the error are kept
 };
 
 class MessageClient {
    public:
-    MessageClient(SettingsManager* settings, MatrixDisplayManager* display);
+    MessageClient(SettingsManager* settings, MatrixDisplayManager* display, ClockDisplay* clock,
+                  TimeManager* timeManager, EventStream* events, VideoWall* wall,
+                  PixelStream* stream, AnimationPlayer* animation, Metrics* metrics);
     void begin();
     void loop();
 
-    // HTTP server handler for incoming posts
-    void handlePostMessages();
-    void handleStatus();
-
    private:
     SettingsManager* settings;
     MatrixDisplayManager* display;
-    unsigned long lastPoll = 0;
-    unsigned long pollIntervalMs = 60000;  // default 60s
-    // Web server
-    WebServer* webServer = nullptr;
+    ClockDisplay* clock;
+    TimeManager* timeManager;
+    EventStream* events;
+    VideoWall* wall;
+    PixelStream* stream;
+    AnimationPlayer* animation;
+    Metrics* metrics;
+    MessagePoller poller;
+
+    // Event-driven web server. Requests are handled on the AsyncTCP task as their bytes
+    // arrive, so a slow client no longer holds up the render loop.
+    AsyncWebServer* webServer = nullptr;
     bool serverStarted = false;
 
-    // Incoming-body pending queue to avoid blocking the HTTP connection while processing
-    static const int PENDING_QUEUE_SIZE = 6;
-    String pendingQueue[PENDING_QUEUE_SIZE];
-    int pqHead = 0;
-    int pqTail = 0;
-    int pqCount = 0;
+    // Binary UDP pushes, read on the loop task. Fleet broadcasts share the receiver, so a
+    // sender has one sequence space whichever way it sends.
+    WiFiUDP udp;
+    WiFiUDP fleetUdp;
+    bool fleetStarted = false;
+    uint32_t fleetDeviceId;
+    MessageDatagramReceiver datagrams;
+    void receiveDatagrams(WiFiUDP& socket, bool fleet);
+    uint8_t deliverDatagram(const MessageDatagram& message);
 
-    // Rate limiting
-    static const unsigned long MIN_MESSAGE_INTERVAL = 500;    // 0.5 seconds
-    static const int MAX_MESSAGE_LENGTH = 500;                // 500 characters
+    // Request limits. The rate limiter is only used from the server task.
     static const unsigned long LOW_MEMORY_THRESHOLD = 50000;  // 50KB
-    unsigned long lastMessageTime = 0;
+    RateLimiter rateLimiter;
+
+    // A new poll URL arrives on the server task and is applied by loop()
+    char pendingPollUrl[MESSAGE_POLL_URL_MAX_LENGTH + 1];
+    bool pollUrlChanged = false;
+    portMUX_TYPE pollUrlLock = portMUX_INITIALIZER_UNLOCKED;
+
+    // Likewise a new video wall layout; -1 when none is pending
+    int pendingWallTile = -1;
+    int pendingWallTiles = 0;
+
+    // An animation upload is written to a temporary file on the server task, one at a time;
+    // the render loop swaps it in, as playback reads the current file
+    File animationUpload;
+    bool animationUploading = false;
+    unsigned long animationUploadMs = 0;  // Last body chunk
+    PendingAnimation pendingAnimation = ANIMATION_CHANGE_NONE;
+
+    // Longest gap between loop() calls since the last /status request. Raised by the loop
+    // task and taken by the server task, so both sides are atomic.
+    unsigned long lastLoopMs = 0;
+    std::atomic<uint32_t> loopGapMaxMs{0};
+
+    // Frame rate for the periodic stats event
+    unsigned long lastStatsMs = 0;
+    uint32_t lastFrameCount = 0;
+
+    // HTTP handlers (server task)
+    void handleMessageBody(AsyncWebServerRequest* request, uint8_t* data, size_t length,
+                           size_t index, size_t total);
+    void handlePostMessages(AsyncWebServerRequest* request);
+    void handleDeleteMessage(AsyncWebServerRequest* request);
+    void handleStatus(AsyncWebServerRequest* request);
+    void handlePostWeather(AsyncWebServerRequest* request);
+    void handlePostPoll(AsyncWebServerRequest* request);
+    void handlePostWall(AsyncWebServerRequest* request);
+    void handleAnimationBody(AsyncWebServerRequest* request, uint8_t* data, size_t length,
+                             size_t index, size_t total);
+    void handlePostAnimation(AsyncWebServerRequest* request);
+    void handleDeleteAnimation(AsyncWebServerRequest* request);
+    void handleGetFrame(AsyncWebServerRequest* request);
+    void handleMetrics(AsyncWebServerRequest* request);
+    void handleLogs(AsyncWebServerRequest* request);
+#if TRACE_ENABLED
+    void handleTrace(AsyncWebServerRequest* request);
+#endif
 
-    // Helpers for pending queue
-    bool enqueuePending(const String& body);
-    bool dequeuePending(String& out);
+    // Small JSON bodies are collected into the request before its handler runs
+    static void collectBody(AsyncWebServerRequest* request, uint8_t* data, size_t length,
+                            size_t index, size_t total);
+    static const char* getBody(AsyncWebServerRequest* request);
 
     // Authentication helper
-    bool checkAuthentication();
+    bool checkAuthentication(AsyncWebServerRequest* request);
+    void sendRateLimited(AsyncWebServerRequest* request, uint32_t ip);
+    // Error answer to POST /messages, counted for /metrics
+    void rejectMessages(AsyncWebServerRequest* request, int status, const char* json);
 
-    void pollServer();
-    bool processJson(const String& json);
+    // Parses one message object and copies it straight into a display queue slot
+    void ingestItem(const char* json, size_t length, MessageIngestResult& result);
+    void handlePolledItem(const char* json, size_t length);
+    void enqueueMessage(JsonObjectConst obj, MessageIngestResult& result);
+    bool parseSchedule(JsonObjectConst obj, MessageSchedule& schedule);
 };
 
 #endif
@@ -0,0 +1,214 @@
+#include "MessageDatagram.h"
+
+#include <limits.h>
+#include <mbedtls/md.h>
+
+static uint16_t get16(const uint8_t* in) {
+    return in[0] | (in[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) |
+           ((uint32_t)in[3] << 24);
+}
+
+static uint64_t get64(const uint8_t* in) {
+    return (uint64_t)get32(in) | ((uint64_t)get32(in + 4) << 32);
+}
+
+static void put32(uint8_t* out, uint32_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+static void put64(uint8_t* out, uint64_t value) {
+    put32(out, (uint32_t)value);
+    put32(out + 4, (uint32_t)(value >> 32));
+}
+
+MessageDatagramReceiver::MessageDatagramReceiver()
+    : key(""), senders{}, delivered{}, evictedHighest(0), nextDelivery(0), rejected(0) {}
+
+void MessageDatagramReceiver::setKey(const char* key) {
+    this->key = key;
+}
+
+DatagramStatus MessageDatagramReceiver::receive(const uint8_t* data, size_t length,
+                                                MessageDatagram& message) {
+    // Cheap format checks first; the HMAC only runs on datagrams that could be valid
+    if (length < MESSAGE_DATAGRAM_HEADER_SIZE + MESSAGE_DATAGRAM_TAG_SIZE ||
+        length > MESSAGE_DATAGRAM_MAX_SIZE || data[0] != 'M' || data[1] != 'Q' ||
+        data[2] != MESSAGE_DATAGRAM_VERSION || data[3] >= MESSAGE_PRIORITY_COUNT) {
+        rejected++;
+        return DATAGRAM_MALFORMED;
+    }
+    size_t idLength = data[16];
+    size_t textLength = get16(data + 17);
+    if (idLength > MESSAGE_ID_MAX_LENGTH || textLength == 0 ||
+        textLength > MESSAGE_TEXT_MAX_LENGTH ||
+        length != MESSAGE_DATAGRAM_HEADER_SIZE + idLength + textLength +
+                      MESSAGE_DATAGRAM_TAG_SIZE) {
+        rejected++;
+        return DATAGRAM_MALFORMED;
+    }
+
+    if (!checkTag(data, length)) {
+        rejected++;
+        return DATAGRAM_BAD_TAG;
+    }
+
+    uint32_t sender = get32(data + 4);
+    uint64_t sequence = get64(data + 8);
+    DatagramStatus status = checkSequence(sender, sequence);
+    if (status != DATAGRAM_OK) {
+        rejected++;
+        return status;
+    }
+
+    const uint8_t* id = data + MESSAGE_DATAGRAM_HEADER_SIZE;
+    message.sender = sender;
+    message.sequence = sequence;
+    message.priority = (MessagePriority)data[3];
+    memcpy(message.id, id, idLength);
+    message.id[idLength] = '\0';
+    memcpy(message.text, id + idLength, textLength);
+    message.text[textLength] = '\0';
+    return DATAGRAM_OK;
+}
+
+size_t MessageDatagramReceiver::buildAck(uint8_t* out, uint64_t sequence, uint8_t status) {
+    out[0] = 'M';
+    out[1] = 'A';
+    put64(out + 2, sequence);
+    out[10] = status;
+    return MESSAGE_DATAGRAM_ACK_SIZE;
+}
+
+size_t MessageDatagramReceiver::buildFleetAck(uint8_t* out, uint64_t sequence, uint8_t status,
+                                              uint32_t deviceId) const {
+    // Signed too, so a forged ack cannot report a clock as reached
+    out[0] = 'M';
+    out[1] = 'F';
+    put64(out + 2, sequence);
+    out[10] = status;
+    put32(out + 11, deviceId);
+    uint8_t mac[32];
+    sign(out, 15, mac);
+    memcpy(out + 15, mac, MESSAGE_DATAGRAM_TAG_SIZE);
+    return MESSAGE_FLEET_ACK_SIZE;
+}
+
+bool MessageDatagramReceiver::findDelivered(const MessageDatagram& message, uint8_t& status) {
+    if (message.id[0] == '\0') {
+        return false;  // Anonymous messages cannot be told apart from a retransmission
+    }
+    unsigned long now = millis();
+    for (int i = 0; i < MESSAGE_FLEET_DEDUPE_ENTRIES; i++) {
+        const Delivery& delivery = delivered[i];
+        if (delivery.id[0] != '\0' && delivery.sender == message.sender &&
+            now - delivery.ms < MESSAGE_FLEET_DEDUPE_MS && strcmp(delivery.id, message.id) == 0) {
+            status = delivery.status;
+            return true;
+        }
+    }
+    return false;
+}
+
+void MessageDatagramReceiver::rememberDelivered(const MessageDatagram& message, uint8_t status) {
+    if (message.id[0] == '\0') {
+        return;
+    }
+    Delivery& delivery = delivered[nextDelivery];
+    nextDelivery = (nextDelivery + 1) % MESSAGE_FLEET_DEDUPE_ENTRIES;
+    delivery.sender = message.sender;
+    strcpy(delivery.id, message.id);
+    delivery.status = status;
+    delivery.ms = millis();
+}
+
+bool MessageDatagramReceiver::sign(const uint8_t* data, size_t length, uint8_t* mac) const {
+    return mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const uint8_t*)key,
+                           strlen(key), data, length, mac) == 0;
+}
+
+bool MessageDatagramReceiver::checkTag(const uint8_t* data, size_t length) const {
+    size_t keyLength = strlen(key);
+    if (keyLength == 0) {
+        return false;
+    }
+
+    size_t signedLength = length - MESSAGE_DATAGRAM_TAG_SIZE;
+    uint8_t mac[32];
+    if (!sign(data, signedLength, mac)) {
+        return false;
+    }
+
+    // Constant time, so the tag cannot be guessed byte by byte from response timing
+    uint8_t diff = 0;
+    for (int i = 0; i < MESSAGE_DATAGRAM_TAG_SIZE; i++) {
+        diff |= mac[i] ^ data[signedLength + i];
+    }
+    return diff == 0;
+}
+
+DatagramStatus MessageDatagramReceiver::checkSequence(uint32_t sender, uint64_t sequence) {
+    unsigned long now = millis();
+    int oldest = 0;
+    unsigned long oldestIdle = 0;
+    for (int i = 0; i < MESSAGE_DATAGRAM_SENDERS; i++) {
+        SenderWindow& window = senders[i];
+        if (window.used && window.sender == sender) {
+            window.lastMs = now;
+            if (sequence > window.highest) {
+                // Slide the window forward; the old newest becomes bit (shift - 1)
+                uint64_t shift = sequence - window.highest;
+                if (shift > 64) {
+                    window.seen = 0;
+                } else {
+                    window.seen = (shift == 64 ? 0 : window.seen << shift) | (1ULL << (shift - 1));
+                }
+                window.highest = sequence;
+                return DATAGRAM_OK;
+            }
+            uint64_t behind = window.highest - sequence;
+            if (behind == 0 || behind > 64 || (window.seen & (1ULL << (behind - 1)))) {
+                return DATAGRAM_REPLAYED;
+            }
+            window.seen |= 1ULL << (behind - 1);
+            return DATAGRAM_OK;
+        }
+        // Free entries go first, then the sender idle the longest
+        unsigned long idle = window.used ? now - window.lastMs : ULONG_MAX;
+        if (idle > oldestIdle) {
+            oldest = i;
+            oldestIdle = idle;
+        }
+    }
+
+    // A sender not seen since boot (or evicted) has no window yet, so its first datagram is
+    // checked against the clock instead, and against what evicted windows had seen
+    if (sequence <= evictedHighest) {
+        return DATAGRAM_REPLAYED;
+    }
+    time_t wall = time(nullptr);
+    if (wall >= (time_t)MESSAGE_DATAGRAM_MIN_VALID_TIME) {
+        int64_t skew = (int64_t)(sequence / 1000000ULL) - (int64_t)wall;
+        if (skew > (int64_t)MESSAGE_DATAGRAM_MAX_SKEW_S ||
+            skew < -(int64_t)MESSAGE_DATAGRAM_MAX_SKEW_S) {
+            return DATAGRAM_STALE;
+        }
+    }
+
+    SenderWindow& window = senders[oldest];
+    if (window.used && window.highest > evictedHighest) {
+        evictedHighest = window.highest;
+    }
+    window.used = true;
+    window.sender = sender;
+    window.highest = sequence;
+    window.seen = 0;
+    window.lastMs = now;
+    return DATAGRAM_OK;
+}
@@ -0,0 +1,125 @@
+#ifndef MESSAGE_DATAGRAM_H
+#define MESSAGE_DATAGRAM_H
+
+#include <Arduino.h>
+
+#include "MessageQueue.h"
+
+// Compact binary message push over UDP, for alerting systems that cannot afford a TCP
+// handshake and a JSON parse per notification. One datagram carries one message.
+//
+// Layout (little endian):
+//   0  magic "MQ" (2)        2  version (1)          3  priority, 0 = low .. 3 = urgent (1)
+//   4  sender id (4)         8  sequence (8)        16  id length (1)
+//  17  text length (2)      19  id, then UTF-8 text
+//  end-16  tag: first 16 bytes of HMAC-SHA256(key, every byte before the tag)
+//
+// The sequence is the sender's wall clock in microseconds and must increase with every
+// datagram. The receiver remembers the highest sequence per sender plus a bitmap of the 64
+// before it, so reordered datagrams are still accepted but each one only once. A sender it
+// does not know yet must be within MESSAGE_DATAGRAM_MAX_SKEW_S of the local clock, so
+// captured datagrams cannot be replayed after a reboot (unless the clock is not set yet).
+//
+// Only MESSAGE_DATAGRAM_SENDERS windows are kept. Evicting the idlest one raises a low-water
+// mark to its newest sequence, and a sender without a window must be above the mark, so the
+// evicted sender's datagrams cannot be replayed. The cost, once more senders than that are
+// active: a sender whose clock lags the mark is refused until its clock passes it.
+#define MESSAGE_DATAGRAM_PORT 4210
+#define MESSAGE_DATAGRAM_VERSION 1
+#define MESSAGE_DATAGRAM_HEADER_SIZE 19
+#define MESSAGE_DATAGRAM_TAG_SIZE 16
+#define MESSAGE_DATAGRAM_MAX_SIZE                                                      \
+    (MESSAGE_DATAGRAM_HEADER_SIZE + MESSAGE_ID_MAX_LENGTH + MESSAGE_TEXT_MAX_LENGTH + \
+     MESSAGE_DATAGRAM_TAG_SIZE)
+#define MESSAGE_DATAGRAM_SENDERS 8  // Senders tracked for replay protection
+#define MESSAGE_DATAGRAM_MAX_SKEW_S 300UL
+#define MESSAGE_DATAGRAM_MIN_VALID_TIME 1600000000UL  // Wall clock below this is treated as unset
+
+// Reply to an authentic datagram: magic "MA" (2), sequence (8), status (1). Datagrams that
+// fail a check get no reply at all.
+#define MESSAGE_DATAGRAM_ACK_SIZE 11
+#define DATAGRAM_ACK_QUEUED 0
+#define DATAGRAM_ACK_UPDATED 1  // Replaced the message held under the same id
+#define DATAGRAM_ACK_FULL 2     // Display queue full, message dropped
+
+// Fleet broadcast: the same datagrams sent to a multicast group. Every clock answers with a
+// signed ack naming itself, so one round tells the sender which clocks have the message.
+// A retransmission is a new datagram (fresh sequence) with the same non-empty id; a clock
+// that already took that id from that sender acks again, flagged, without queuing it twice.
+// Fleet ack: magic "MF" (2), sequence (8), status (1), device id (4), tag (16) over the rest.
+#define MESSAGE_FLEET_PORT 4211
+#define MESSAGE_FLEET_ACK_SIZE 31
+#define DATAGRAM_ACK_DUPLICATE 0x80     // Status flag on fleet acks
+#define MESSAGE_FLEET_DEDUPE_ENTRIES 16  // Recent (sender, id) pairs remembered
+#define MESSAGE_FLEET_DEDUPE_MS 120000UL
+
+enum DatagramStatus : uint8_t {
+    DATAGRAM_OK,
+    DATAGRAM_MALFORMED,  // Bad magic, version, lengths or priority
+    DATAGRAM_BAD_TAG,
+    DATAGRAM_REPLAYED,  // Sequence already seen, or too far behind the newest
+    DATAGRAM_STALE      // Unknown sender whose sequence is far from the local clock
+};
+
+struct MessageDatagram {
+    uint32_t sender;
+    uint64_t sequence;
+    MessagePriority priority;
+    char id[MESSAGE_ID_MAX_LENGTH + 1];
+    char text[MESSAGE_TEXT_MAX_LENGTH + 1];
+};
+
+class MessageDatagramReceiver {
+   public:
+    MessageDatagramReceiver();
+
+    // The key must outlive the receiver. With an empty key every datagram fails the tag check.
+    void setKey(const char* key);
+
+    // Checks format, tag and sequence, and fills message. A datagram is only marked as seen
+    // once it passed all three.
+    DatagramStatus receive(const uint8_t* data, size_t length, MessageDatagram& message);
+
+    static size_t buildAck(uint8_t* out, uint64_t sequence, uint8_t status);
+    size_t buildFleetAck(uint8_t* out, uint64_t sequence, uint8_t status,
+                         uint32_t deviceId) const;
+
+    // Fleet dedupe: true with the status of the first delivery if this sender's message id
+    // was taken recently
+    bool findDelivered(const MessageDatagram& message, uint8_t& status);
+    void rememberDelivered(const MessageDatagram& message, uint8_t status);
+
+    uint32_t getRejectedCount() const {
+        return rejected;
+    }
+
+   private:
+    struct SenderWindow {
+        uint32_t sender;
+        bool used;
+        uint64_t highest;      // Newest sequence accepted
+        uint64_t seen;         // Bit n set: highest - 1 - n was accepted
+        unsigned long lastMs;  // For LRU eviction
+    };
+
+    struct Delivery {
+        uint32_t sender;
+        char id[MESSAGE_ID_MAX_LENGTH + 1];  // Empty when the entry is free
+        uint8_t status;
+        unsigned long ms;
+    };
+
+    const char* key;
+    SenderWindow senders[MESSAGE_DATAGRAM_SENDERS];
+    Delivery delivered[MESSAGE_FLEET_DEDUPE_ENTRIES];
+    uint64_t evictedHighest;  // Low-water mark for senders without a window
+    int nextDelivery;         // Entries are reused round robin, oldest first
+    uint32_t rejected;
+
+    bool sign(const uint8_t* data, size_t length, uint8_t* mac) const;
+
+    bool checkTag(const uint8_t* data, size_t length) const;
+    DatagramStatus checkSequence(uint32_t sender, uint64_t sequence);
+};
+
+#endif  // MESSAGE_DATAGRAM_H
@@ -0,0 +1,82 @@
+#include "MessageItemSplitter.h"
+
+void MessageItemSplitter::reset() {
+    itemLength = 0;
+    depth = 0;
+    started = false;
+    array = false;
+    done = false;
+    complete = false;
+    inString = false;
+    escaped = false;
+    overflow = false;
+    malformed = false;
+}
+
+void MessageItemSplitter::feed(const uint8_t* data, size_t length, const ItemHandler& handler) {
+    for (size_t i = 0; i < length && !done; i++) {
+        char c = data[i];
+
+        if (!started) {
+            if (isspace((uint8_t)c)) {
+                continue;
+            }
+            started = true;
+            array = c == '[';
+            if (array) {
+                continue;
+            }
+        }
+
+        // Between items only separators, whitespace or the end of the array may appear
+        if (depth == 0 && c != '{') {
+            if (array && c == ']') {
+                done = true;
+                complete = true;
+            } else if (c != ',' && !isspace((uint8_t)c)) {
+                malformed = true;
+                done = true;
+            }
+            continue;
+        }
+
+        if (depth == 0) {
+            itemLength = 0;
+            overflow = false;
+        }
+        if (itemLength < sizeof(item)) {
+            item[itemLength++] = c;
+        } else {
+            overflow = true;
+        }
+
+        if (inString) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                inString = false;
+            }
+            continue;
+        }
+
+        if (c == '"') {
+            inString = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+            // One whole message object: hand it over before reading on. One closed by a
+            // stray ']' is not an object, so it is dropped like an oversize one
+            if (overflow || c != '}') {
+                malformed = true;
+            } else if (handler) {
+                handler(item, itemLength);
+            }
+            if (!array) {
+                done = true;
+                complete = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef MESSAGE_ITEM_SPLITTER_H
+#define MESSAGE_ITEM_SPLITTER_H
+
+#include <Arduino.h>
+#include <functional>
+
+#define MESSAGE_ITEM_MAX 512  // Longest single message object, as raw JSON
+
+// Cuts a JSON body holding one message object or an array of them into single objects as
+// the bytes arrive, so a body can be consumed chunk by chunk from the network without ever
+// being held in full. Only the object being read is buffered.
+class MessageItemSplitter {
+   public:
+    // Called with the raw JSON of each message object as soon as it is complete
+    typedef std::function<void(const char* json, size_t length)> ItemHandler;
+
+    MessageItemSplitter() {
+        reset();
+    }
+
+    void reset();
+    void feed(const uint8_t* data, size_t length, const ItemHandler& handler);
+
+    bool isStarted() const {
+        return started;
+    }
+    // The closing bracket (or the end of a single object) has been seen
+    bool isComplete() const {
+        return complete;
+    }
+    // Something other than message objects, or an object longer than MESSAGE_ITEM_MAX
+    bool isMalformed() const {
+        return malformed;
+    }
+
+   private:
+    char item[MESSAGE_ITEM_MAX];
+    size_t itemLength;
+    int depth;
+    bool started;
+    bool array;
+    bool done;  // Complete, or parsing gave up
+    bool complete;
+    bool inString;
+    bool escaped;
+    bool overflow;
+    bool malformed;
+};
+
+#endif  // MESSAGE_ITEM_SPLITTER_H
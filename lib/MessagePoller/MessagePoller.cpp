@@ -0,0 +1,447 @@
+#include "MessagePoller.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <lwip/dns.h>
+#include <lwip/sockets.h>
+
+#include "Log.h"
+
+MessagePoller::MessagePoller()
+    : port(80),
+      path("/"),
+      state(POLL_IDLE),
+      sock(-1),
+      requestStartMs(0),
+      nextPollMs(0),
+      failures(0),
+      lastStatus(-1),
+      dnsTokens{},
+      dnsGeneration(0),
+      dnsDone(false),
+      dnsFound(false),
+      requestLength(0),
+      requestSent(0),
+      lineLength(0),
+      status(0),
+      contentLength(-1),
+      bodyReceived(0) {
+    url[0] = '\0';
+    host[0] = '\0';
+    etag[0] = '\0';
+    pendingEtag[0] = '\0';
+    cursor[0] = '\0';
+}
+
+bool MessagePoller::setUrl(const char* newUrl) {
+    if (newUrl == nullptr || newUrl[0] == '\0') {
+        closeSocket();
+        state = POLL_IDLE;
+        url[0] = '\0';
+        return true;
+    }
+
+    char newHost[sizeof(host)];
+    uint16_t newPort;
+    size_t pathOffset;
+    if (!parseUrl(newUrl, newHost, sizeof(newHost), newPort, pathOffset)) {
+        return false;
+    }
+
+    closeSocket();
+    state = POLL_IDLE;
+    strcpy(url, newUrl);
+    strcpy(host, newHost);
+    port = newPort;
+    path = url + pathOffset;
+
+    // A different feed: its ETag and cursor mean nothing here
+    etag[0] = '\0';
+    cursor[0] = '\0';
+    failures = 0;
+    nextPollMs = millis();
+    return true;
+}
+
+bool MessagePoller::isSupportedUrl(const char* url) {
+    char host[MESSAGE_POLL_HOST_MAX_LENGTH + 1];
+    uint16_t port;
+    size_t pathOffset;
+    return url[0] == '\0' || parseUrl(url, host, sizeof(host), port, pathOffset);
+}
+
+bool MessagePoller::parseUrl(const char* url, char* hostOut, size_t hostSize, uint16_t& portOut,
+                             size_t& pathOffset) {
+    if (strncmp(url, "http://", 7) != 0 || strlen(url) > MESSAGE_POLL_URL_MAX_LENGTH) {
+        return false;
+    }
+    const char* hostStart = url + 7;
+    size_t hostLength = strcspn(hostStart, ":/?");
+    if (hostLength == 0 || hostLength >= hostSize) {
+        return false;
+    }
+
+    portOut = 80;
+    const char* rest = hostStart + hostLength;
+    if (*rest == ':') {
+        char* end;
+        long value = strtol(rest + 1, &end, 10);
+        if (value <= 0 || value > 65535) {
+            return false;
+        }
+        portOut = value;
+        rest = end;
+    }
+    if (*rest != '\0' && *rest != '/' && *rest != '?') {
+        return false;
+    }
+
+    memcpy(hostOut, hostStart, hostLength);
+    hostOut[hostLength] = '\0';
+    pathOffset = rest - url;
+    return true;
+}
+
+void MessagePoller::setCursor(const char* id) {
+    strncpy(cursor, id, MESSAGE_POLL_CURSOR_MAX);
+    cursor[MESSAGE_POLL_CURSOR_MAX] = '\0';
+}
+
+void MessagePoller::update() {
+    unsigned long now = millis();
+    if (state == POLL_IDLE) {
+        if (url[0] != '\0' && (int32_t)(now - nextPollMs) >= 0) {
+            startRequest();
+        }
+        return;
+    }
+
+    if (now - requestStartMs > MESSAGE_POLL_TIMEOUT_MS) {
+        LOG_WARN("[MessagePoller] Poll timed out");
+        lastStatus = 0;
+        finish(false);
+        return;
+    }
+
+    switch (state) {
+        case POLL_RESOLVING:
+            if (!dnsDone) {
+                return;
+            }
+            if (!dnsFound) {
+                LOG_WARN("[MessagePoller] Could not resolve %s", host);
+                lastStatus = 0;
+                finish(false);
+                return;
+            }
+            startConnect();
+            return;
+
+        case POLL_CONNECTING: {
+            // Writable means the connection attempt has finished, one way or the other
+            fd_set writable;
+            FD_ZERO(&writable);
+            FD_SET(sock, &writable);
+            struct timeval zero = {0, 0};
+            if (select(sock + 1, nullptr, &writable, nullptr, &zero) <= 0) {
+                return;
+            }
+            int error = 0;
+            socklen_t errorLength = sizeof(error);
+            getsockopt(sock, SOL_SOCKET, SO_ERROR, &error, &errorLength);
+            if (error != 0) {
+                LOG_WARN("[MessagePoller] Connect to %s:%u failed (%d)", host, port, error);
+                lastStatus = 0;
+                finish(false);
+                return;
+            }
+            state = POLL_SENDING;
+            return;
+        }
+
+        case POLL_SENDING: {
+            int sent =
+                send(sock, request + requestSent, requestLength - requestSent, MSG_DONTWAIT);
+            if (sent < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    lastStatus = 0;
+                    finish(false);
+                }
+                return;
+            }
+            requestSent += sent;
+            if (requestSent == requestLength) {
+                state = POLL_READING_HEADERS;
+            }
+            return;
+        }
+
+        case POLL_READING_HEADERS:
+        case POLL_READING_BODY: {
+            uint8_t data[MESSAGE_POLL_CHUNK_SIZE];
+            int length = 0;
+            bool closed = false;
+            if (!readChunk(data, length, closed)) {
+                lastStatus = 0;
+                finish(false);
+                return;
+            }
+
+            int pos = 0;
+            while (state == POLL_READING_HEADERS && pos < length) {
+                char c = data[pos++];
+                if (c != '\n') {
+                    if (c != '\r' && lineLength < sizeof(line) - 1) {
+                        line[lineLength++] = c;
+                    }
+                    continue;
+                }
+                line[lineLength] = '\0';
+                if (lineLength > 0) {
+                    parseHeaderLine();
+                    lineLength = 0;
+                    continue;
+                }
+
+                // Blank line: headers done
+                lastStatus = status;
+                if (status == 304) {
+                    finish(true);
+                    return;
+                }
+                if (status != 200) {
+                    LOG_WARN("[MessagePoller] Feed returned HTTP %d", status);
+                    finish(false);
+                    return;
+                }
+                state = POLL_READING_BODY;
+            }
+
+            if (state == POLL_READING_BODY) {
+                long available = length - pos;
+                if (contentLength >= 0 && available > contentLength - bodyReceived) {
+                    available = contentLength - bodyReceived;
+                }
+                splitter.feed(data + pos, available, itemHandler);
+                bodyReceived += available;
+                if (contentLength >= 0 && bodyReceived >= contentLength) {
+                    endBody();
+                    return;
+                }
+            }
+
+            if (closed) {
+                if (state == POLL_READING_BODY) {
+                    endBody();
+                } else {
+                    lastStatus = 0;
+                    finish(false);
+                }
+            }
+            return;
+        }
+
+        default:
+            return;
+    }
+}
+
+void MessagePoller::startRequest() {
+    requestStartMs = millis();
+    lineLength = 0;
+    status = 0;
+    contentLength = -1;
+    bodyReceived = 0;
+    pendingEtag[0] = '\0';
+    splitter.reset();
+
+    // IP literals and cached names resolve at once; anything else completes in dnsCallback
+    dnsGeneration = dnsGeneration + 1;
+    dnsDone = false;
+    dnsFound = false;
+    if (ipaddr_aton(host, &serverAddress)) {
+        startConnect();
+        return;
+    }
+    DnsToken& token = dnsTokens[dnsGeneration % MESSAGE_POLL_DNS_TOKENS];
+    token.poller = this;
+    token.generation = dnsGeneration;
+    err_t err = dns_gethostbyname(host, &serverAddress, dnsCallback, &token);
+    if (err == ERR_OK) {
+        startConnect();
+    } else if (err == ERR_INPROGRESS) {
+        state = POLL_RESOLVING;
+    } else {
+        lastStatus = 0;
+        finish(false);
+    }
+}
+
+void MessagePoller::startConnect() {
+    sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock < 0) {
+        lastStatus = 0;
+        finish(false);
+        return;
+    }
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = ip_2_ip4(&serverAddress)->addr;
+
+    // A non-blocking connect returns straight away; completion is checked in update()
+    if (connect(sock, (struct sockaddr*)&address, sizeof(address)) < 0 && errno != EINPROGRESS) {
+        LOG_WARN("[MessagePoller] Connect to %s:%u failed (%d)", host, port, errno);
+        lastStatus = 0;
+        finish(false);
+        return;
+    }
+
+    buildRequest();
+    state = POLL_CONNECTING;
+}
+
+void MessagePoller::buildRequest() {
+    // HTTP/1.0 so the body is never chunked and ends when the server closes
+    requestLength = 0;
+    requestSent = 0;
+    appendRequest("GET ");
+    appendRequest(path[0] == '\0' ? "/" : path);
+
+    if (cursor[0] != '\0') {
+        appendRequest(strchr(path, '?') ? "&since=" : "?since=");
+        static const char hex[] = "0123456789ABCDEF";
+        for (const char* c = cursor; *c; c++) {
+            char encoded[4] = {*c, '\0', '\0', '\0'};
+            if (!isalnum((uint8_t)*c) && !strchr("-._~", *c)) {
+                encoded[0] = '%';
+                encoded[1] = hex[(uint8_t)*c >> 4];
+                encoded[2] = hex[*c & 0x0F];
+            }
+            appendRequest(encoded);
+        }
+    }
+
+    appendRequest(" HTTP/1.0\r\nHost: ");
+    appendRequest(host);
+    if (port != 80) {
+        char portText[8];
+        snprintf(portText, sizeof(portText), ":%u", port);
+        appendRequest(portText);
+    }
+    appendRequest("\r\nAccept: application/json\r\n");
+    if (etag[0] != '\0') {
+        appendRequest("If-None-Match: ");
+        appendRequest(etag);
+        appendRequest("\r\n");
+    }
+    appendRequest("\r\n");
+}
+
+void MessagePoller::appendRequest(const char* text) {
+    size_t length = strlen(text);
+    if (requestLength + length >= sizeof(request)) {
+        length = sizeof(request) - 1 - requestLength;
+    }
+    memcpy(request + requestLength, text, length);
+    requestLength += length;
+    request[requestLength] = '\0';
+}
+
+void MessagePoller::endBody() {
+    // An empty 200 means nothing new; a document cut off part-way counts as a failure
+    bool success = splitter.isComplete() || !splitter.isStarted();
+    if (success && !splitter.isMalformed()) {
+        strcpy(etag, pendingEtag);
+    }
+    if (splitter.isMalformed()) {
+        LOG_WARN("[MessagePoller] Malformed message feed");
+    }
+    finish(success);
+}
+
+void MessagePoller::finish(bool success) {
+    closeSocket();
+    state = POLL_IDLE;
+
+    unsigned long now = millis();
+    if (success) {
+        failures = 0;
+        nextPollMs = now + MESSAGE_POLL_INTERVAL_MS;
+        return;
+    }
+
+    // Exponential backoff with a little jitter so several clocks do not retry in step
+    failures++;
+    int shift = failures - 1 < 5 ? failures - 1 : 5;
+    unsigned long wait = MESSAGE_POLL_INTERVAL_MS << shift;
+    if (wait > MESSAGE_POLL_BACKOFF_MAX_MS) {
+        wait = MESSAGE_POLL_BACKOFF_MAX_MS;
+    }
+    wait += random(wait / 10 + 1);
+    nextPollMs = now + wait;
+    LOG_WARN("[MessagePoller] Poll failed (%d in a row), next try in %lu s", failures,
+             wait / 1000);
+}
+
+void MessagePoller::closeSocket() {
+    if (sock >= 0) {
+        close(sock);
+        sock = -1;
+    }
+}
+
+bool MessagePoller::readChunk(uint8_t* data, int& length, bool& closed) {
+    int received = recv(sock, data, MESSAGE_POLL_CHUNK_SIZE, MSG_DONTWAIT);
+    if (received > 0) {
+        length = received;
+        return true;
+    }
+    if (received == 0) {
+        closed = true;
+        return true;
+    }
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+void MessagePoller::parseHeaderLine() {
+    // Status line first ("HTTP/1.1 304 Not Modified"), then "Name: value" headers
+    if (status == 0) {
+        const char* code = strchr(line, ' ');
+        status = code ? atoi(code + 1) : -1;
+        return;
+    }
+
+    char* value = strchr(line, ':');
+    if (value == nullptr) {
+        return;
+    }
+    *value++ = '\0';
+    while (*value == ' ' || *value == '\t') {
+        value++;
+    }
+
+    if (strcasecmp(line, "ETag") == 0) {
+        strncpy(pendingEtag, value, MESSAGE_POLL_ETAG_MAX);
+        pendingEtag[MESSAGE_POLL_ETAG_MAX] = '\0';
+    } else if (strcasecmp(line, "Content-Length") == 0) {
+        contentLength = atol(value);
+    }
+}
+
+void MessagePoller::dnsCallback(const char* name, const ip_addr_t* address, void* arg) {
+    // Runs on the lwIP thread; update() picks the result up on its next pass
+    const DnsToken* token = (const DnsToken*)arg;
+    MessagePoller* poller = token->poller;
+    if (token->generation != poller->dnsGeneration) {
+        return;  // A lookup given up on; a newer one is in flight or the poll moved on
+    }
+    if (address) {
+        poller->serverAddress = *address;
+        poller->dnsFound = true;
+    }
+    poller->dnsDone = true;
+}
@@ -0,0 +1,131 @@
+#ifndef MESSAGE_POLLER_H
+#define MESSAGE_POLLER_H
+
+#include <Arduino.h>
+#include <functional>
+
+#include <lwip/ip_addr.h>
+
+#include "MessageItemSplitter.h"
+
+// Polling of a remote message feed. Each request runs as a state machine over a
+// non-blocking socket: update() does a bounded slice of work per loop pass and never waits
+// on DNS, connect or the network. Requests are conditional (If-None-Match plus a since=<id>
+// cursor), so an unchanged feed costs a 304.
+#define MESSAGE_POLL_URL_MAX_LENGTH 127
+#define MESSAGE_POLL_HOST_MAX_LENGTH 63
+#define MESSAGE_POLL_INTERVAL_MS 60000UL                   // Between successful polls
+#define MESSAGE_POLL_BACKOFF_MAX_MS (15UL * 60UL * 1000UL)  // Longest wait after failures
+#define MESSAGE_POLL_TIMEOUT_MS 10000UL  // Whole request, from DNS lookup to last body byte
+#define MESSAGE_POLL_CHUNK_SIZE 256      // Bytes read per update() call
+#define MESSAGE_POLL_ETAG_MAX 63
+#define MESSAGE_POLL_CURSOR_MAX 31  // Matches MESSAGE_ID_MAX_LENGTH
+#define MESSAGE_POLL_DNS_TOKENS 4   // Lookups tracked at once; lwIP gives up on one long before
+                                    // four more polls have started
+
+enum PollState {
+    POLL_IDLE,
+    POLL_RESOLVING,
+    POLL_CONNECTING,
+    POLL_SENDING,
+    POLL_READING_HEADERS,
+    POLL_READING_BODY
+};
+
+class MessagePoller {
+   public:
+    typedef MessageItemSplitter::ItemHandler ItemHandler;
+
+    MessagePoller();
+
+    // Only plain http:// URLs are supported; "" turns polling off. Changing the URL
+    // forgets the ETag and cursor of the old feed.
+    bool setUrl(const char* url);
+    const char* getUrl() const {
+        return url;
+    }
+    static bool isSupportedUrl(const char* url);
+
+    void onItem(ItemHandler handler) {
+        itemHandler = handler;
+    }
+
+    // Id of the newest message seen, sent as since=<id> on the next request
+    void setCursor(const char* id);
+
+    // Call from the loop. Starts a poll when one is due and advances the one in flight.
+    void update();
+
+    PollState getState() const {
+        return state;
+    }
+    int getFailureCount() const {
+        return failures;
+    }
+    // HTTP status of the last finished poll, 0 after a network error or timeout
+    int getLastStatus() const {
+        return lastStatus;
+    }
+
+   private:
+    char url[MESSAGE_POLL_URL_MAX_LENGTH + 1];
+    char host[MESSAGE_POLL_HOST_MAX_LENGTH + 1];
+    uint16_t port;
+    const char* path;  // Points into url
+
+    char etag[MESSAGE_POLL_ETAG_MAX + 1];
+    char pendingEtag[MESSAGE_POLL_ETAG_MAX + 1];  // Adopted once the body parsed cleanly
+    char cursor[MESSAGE_POLL_CURSOR_MAX + 1];
+
+    PollState state;
+    int sock;
+    unsigned long requestStartMs;
+    unsigned long nextPollMs;
+    int failures;
+    int lastStatus;
+
+    // DNS results arrive from the lwIP thread. Each lookup passes a token holding its
+    // generation, so the answer to a lookup that already timed out is ignored instead of
+    // being taken for the current one.
+    struct DnsToken {
+        MessagePoller* poller;
+        uint32_t generation;
+    };
+    DnsToken dnsTokens[MESSAGE_POLL_DNS_TOKENS];
+    volatile uint32_t dnsGeneration;
+    volatile bool dnsDone;
+    volatile bool dnsFound;
+    ip_addr_t serverAddress;
+
+    char request[512];
+    size_t requestLength;
+    size_t requestSent;
+
+    // Response headers, one line at a time
+    char line[128];
+    size_t lineLength;
+    int status;
+    long contentLength;  // -1 when the server did not send one
+    long bodyReceived;
+
+    MessageItemSplitter splitter;
+    ItemHandler itemHandler;
+
+    void startRequest();
+    void startConnect();
+    void buildRequest();
+    void appendRequest(const char* text);
+    void endBody();
+    void finish(bool success);
+    void closeSocket();
+
+    bool readChunk(uint8_t* data, int& length, bool& closed);
+    void parseHeaderLine();
+
+    // Splits http://host[:port][/path]; pathOffset is where the path starts in url
+    static bool parseUrl(const char* url, char* hostOut, size_t hostSize, uint16_t& portOut,
+                         size_t& pathOffset);
+    static void dnsCallback(const char* name, const ip_addr_t* address, void* arg);
+};
+
+#endif  // MESSAGE_POLLER_H
@@ -0,0 +1,448 @@
+#include "MessageQueue.h"
+
+MessageQueue::MessageQueue()
+    : freeCount(MESSAGE_SLOT_COUNT),
+      priorityMask(0),
+      queuedCount(0),
+      currentTick(0),
+      scheduledSlots(0) {
+    for (int p = 0; p < MESSAGE_PRIORITY_COUNT; p++) {
+        buckets[p].head = 0;
+        buckets[p].count = 0;
+    }
+    for (int i = 0; i < MESSAGE_SLOT_COUNT; i++) {
+        freeList[i] = MESSAGE_SLOT_COUNT - 1 - i;
+        slots[i].text[0] = '\0';
+        slots[i].id[0] = '\0';
+        slots[i].idHash = 0;
+        slots[i].textLength = 0;
+        slots[i].priority = MSG_PRIORITY_NORMAL;
+        slots[i].state = MESSAGE_SLOT_FREE;
+        slots[i].hasResumePosition = false;
+        slots[i].resumeScrollX = 0;
+        slots[i].ttlSeconds = 0;
+        slots[i].repeatSeconds = 0;
+        slots[i].lastShownTick = 0;
+        slots[i].timerDue = 0;
+        slots[i].wheelBucket = MESSAGE_WHEEL_NONE;
+        slots[i].wheelPrev = MESSAGE_WHEEL_NONE;
+        slots[i].wheelNext = MESSAGE_WHEEL_NONE;
+    }
+    memset(idIndex, MESSAGE_INDEX_EMPTY, sizeof(idIndex));
+    memset(wheel, MESSAGE_WHEEL_NONE, sizeof(wheel));
+}
+
+MessagePushResult MessageQueue::push(const char* id, const char* text, MessagePriority priority,
+                                     const MessageSchedule& schedule, int* slotOut) {
+    bool hasId = id != nullptr && id[0] != '\0';
+    size_t length = strnlen(text, MESSAGE_TEXT_MAX_LENGTH);
+
+    // Upsert: a message with the same id is replaced rather than queued twice
+    int existing = hasId ? find(id) : MESSAGE_NO_SLOT;
+    if (existing != MESSAGE_NO_SLOT) {
+        MessageSlot& slot = slots[existing];
+        if (slotOut)
+            *slotOut = existing;
+
+        if (slot.priority == priority && slot.textLength == length &&
+            memcmp(slot.text, text, length) == 0 && schedule.isEmpty()) {
+            return MESSAGE_PUSH_COALESCED;
+        }
+
+        memcpy(slot.text, text, length);
+        slot.text[length] = '\0';
+        slot.textLength = length;
+
+        if (!schedule.isEmpty()) {
+            if (slot.state == MESSAGE_SLOT_ACTIVE) {
+                // Showing now; the new timing applies from the next repeat
+                slot.priority = priority;
+                slot.ttlSeconds = schedule.ttlSeconds;
+                slot.repeatSeconds = schedule.repeatSeconds;
+            } else {
+                // Take it out of wherever it waits and schedule it afresh
+                detach(existing);
+                slot.priority = priority;
+                arm(existing, schedule);
+            }
+        } else if (slot.priority != priority && slot.state == MESSAGE_SLOT_QUEUED) {
+            // A queued message that changes priority moves to the back of its new bucket
+            unlinkFromBucket(existing);
+            slot.priority = priority;
+            appendToBucket(existing);
+        } else {
+            slot.priority = priority;
+        }
+        return MESSAGE_PUSH_UPDATED;
+    }
+
+    if (freeCount == 0) {
+        return MESSAGE_PUSH_FULL;
+    }
+
+    uint8_t index = freeList[--freeCount];
+    MessageSlot& slot = slots[index];
+
+    // Single copy from the parsed request into the slot's own storage
+    memcpy(slot.text, text, length);
+    slot.text[length] = '\0';
+    slot.textLength = length;
+    slot.priority = priority;
+    slot.hasResumePosition = false;
+
+    if (hasId) {
+        strncpy(slot.id, id, MESSAGE_ID_MAX_LENGTH);
+        slot.id[MESSAGE_ID_MAX_LENGTH] = '\0';
+        slot.idHash = hashId(slot.id);
+        indexInsert(index);
+    } else {
+        slot.id[0] = '\0';
+    }
+
+    arm(index, schedule);
+    if (slotOut)
+        *slotOut = index;
+    return MESSAGE_PUSH_QUEUED;
+}
+
+int MessageQueue::pop() {
+    int priority = peekPriority();
+    if (priority < 0) {
+        return MESSAGE_NO_SLOT;
+    }
+
+    PriorityBucket& bucket = buckets[priority];
+    uint8_t index = bucket.order[bucket.head];
+    bucket.head = (bucket.head + 1) % MESSAGE_SLOT_COUNT;
+    if (--bucket.count == 0) {
+        priorityMask &= ~(1 << priority);
+    }
+    queuedCount--;
+
+    // Shown now, so any expiry timer no longer applies
+    wheelUnlink(index);
+    slots[index].state = MESSAGE_SLOT_ACTIVE;
+    slots[index].lastShownTick = currentTick;
+    return index;
+}
+
+void MessageQueue::advance(uint32_t nowSeconds) {
+    while ((int32_t)(nowSeconds - currentTick) > 0) {
+        currentTick++;
+
+        // Pull the next block of coarser timers down as each finer wheel wraps around
+        if ((currentTick & (MESSAGE_WHEEL_SIZE - 1)) == 0) {
+            if ((currentTick & ((1UL << (2 * MESSAGE_WHEEL_BITS)) - 1)) == 0) {
+                cascade(2);
+            }
+            cascade(1);
+        }
+
+        uint8_t index = wheel[0][currentTick & (MESSAGE_WHEEL_SIZE - 1)];
+        while (index != MESSAGE_WHEEL_NONE) {
+            uint8_t next = slots[index].wheelNext;
+            if (slots[index].timerDue == currentTick) {
+                wheelUnlink(index);
+                fireTimer(index);
+            }
+            index = next;
+        }
+    }
+}
+
+void MessageQueue::finish(int slotIndex) {
+    if (slotIndex < 0 || slotIndex >= MESSAGE_SLOT_COUNT ||
+        slots[slotIndex].state != MESSAGE_SLOT_ACTIVE) {
+        return;
+    }
+
+    MessageSlot& slot = slots[slotIndex];
+    if (slot.repeatSeconds == 0) {
+        release(slotIndex);
+        return;
+    }
+
+    // Next showing is measured from when this one started
+    uint32_t due = slot.lastShownTick + slot.repeatSeconds;
+    if ((int32_t)(due - currentTick) <= 0) {
+        due = currentTick + 1;
+    }
+    slot.hasResumePosition = false;
+    slot.state = MESSAGE_SLOT_SCHEDULED;
+    scheduledSlots++;
+    wheelInsert(slotIndex, due);
+}
+
+void MessageQueue::release(int slotIndex) {
+    if (slotIndex < 0 || slotIndex >= MESSAGE_SLOT_COUNT ||
+        slots[slotIndex].state == MESSAGE_SLOT_FREE) {
+        return;
+    }
+
+    detach(slotIndex);
+
+    MessageSlot& slot = slots[slotIndex];
+    if (slot.id[0] != '\0') {
+        indexRemove(slotIndex);
+    }
+    slot.id[0] = '\0';
+    slot.text[0] = '\0';
+    slot.textLength = 0;
+    slot.state = MESSAGE_SLOT_FREE;
+    freeList[freeCount++] = slotIndex;
+}
+
+int MessageQueue::find(const char* id) const {
+    if (id == nullptr || id[0] == '\0') {
+        return MESSAGE_NO_SLOT;
+    }
+
+    uint32_t hash = hashId(id);
+    for (int probe = 0; probe < MESSAGE_INDEX_SIZE; probe++) {
+        uint8_t entry = idIndex[(hash + probe) & (MESSAGE_INDEX_SIZE - 1)];
+        if (entry == MESSAGE_INDEX_EMPTY) {
+            break;
+        }
+        const MessageSlot& slot = slots[entry];
+        if (slot.idHash == hash && strncmp(slot.id, id, MESSAGE_ID_MAX_LENGTH) == 0) {
+            return entry;
+        }
+    }
+    return MESSAGE_NO_SLOT;
+}
+
+void MessageQueue::requeueFront(int slotIndex, int16_t scrollX) {
+    if (slotIndex < 0 || slotIndex >= MESSAGE_SLOT_COUNT) {
+        return;
+    }
+
+    MessageSlot& slot = slots[slotIndex];
+    slot.hasResumePosition = true;
+    slot.resumeScrollX = scrollX;
+    slot.state = MESSAGE_SLOT_QUEUED;
+
+    PriorityBucket& bucket = buckets[slot.priority];
+    bucket.head = (bucket.head + MESSAGE_SLOT_COUNT - 1) % MESSAGE_SLOT_COUNT;
+    bucket.order[bucket.head] = slotIndex;
+    bucket.count++;
+    priorityMask |= 1 << slot.priority;
+    queuedCount++;
+}
+
+void MessageQueue::detach(int slotIndex) {
+    MessageSlot& slot = slots[slotIndex];
+    if (slot.state == MESSAGE_SLOT_QUEUED) {
+        unlinkFromBucket(slotIndex);
+    } else if (slot.state == MESSAGE_SLOT_SCHEDULED) {
+        scheduledSlots--;
+    }
+    wheelUnlink(slotIndex);
+}
+
+void MessageQueue::arm(int slotIndex, const MessageSchedule& schedule) {
+    MessageSlot& slot = slots[slotIndex];
+    slot.ttlSeconds = schedule.ttlSeconds;
+    slot.repeatSeconds = schedule.repeatSeconds;
+    slot.hasResumePosition = false;
+
+    if (schedule.delaySeconds > 0) {
+        slot.state = MESSAGE_SLOT_SCHEDULED;
+        scheduledSlots++;
+        wheelInsert(slotIndex, currentTick + schedule.delaySeconds);
+        return;
+    }
+
+    appendToBucket(slotIndex);
+    if (slot.ttlSeconds > 0) {
+        wheelInsert(slotIndex, currentTick + slot.ttlSeconds);
+    }
+}
+
+void MessageQueue::wheelInsert(int slotIndex, uint32_t due) {
+    // A timer beyond the wheel's reach waits in the bucket at its horizon. The cascade then
+    // files it again by its real due time, so it fires neither early nor late.
+    uint32_t delta = due - currentTick;
+    uint32_t filedAt = due;
+    if (delta >= MESSAGE_WHEEL_HORIZON) {
+        delta = MESSAGE_WHEEL_HORIZON - 1;
+        filedAt = currentTick + delta;
+    }
+
+    int level = 0;
+    while (level < MESSAGE_WHEEL_LEVELS - 1 &&
+           delta >= (1UL << (MESSAGE_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    int bucket = (filedAt >> (MESSAGE_WHEEL_BITS * level)) & (MESSAGE_WHEEL_SIZE - 1);
+
+    MessageSlot& slot = slots[slotIndex];
+    slot.timerDue = due;
+    slot.wheelBucket = level * MESSAGE_WHEEL_SIZE + bucket;
+    slot.wheelPrev = MESSAGE_WHEEL_NONE;
+    slot.wheelNext = wheel[level][bucket];
+    if (slot.wheelNext != MESSAGE_WHEEL_NONE) {
+        slots[slot.wheelNext].wheelPrev = slotIndex;
+    }
+    wheel[level][bucket] = slotIndex;
+}
+
+void MessageQueue::wheelUnlink(int slotIndex) {
+    MessageSlot& slot = slots[slotIndex];
+    if (slot.wheelBucket == MESSAGE_WHEEL_NONE) {
+        return;
+    }
+
+    if (slot.wheelPrev != MESSAGE_WHEEL_NONE) {
+        slots[slot.wheelPrev].wheelNext = slot.wheelNext;
+    } else {
+        wheel[slot.wheelBucket / MESSAGE_WHEEL_SIZE][slot.wheelBucket % MESSAGE_WHEEL_SIZE] =
+            slot.wheelNext;
+    }
+    if (slot.wheelNext != MESSAGE_WHEEL_NONE) {
+        slots[slot.wheelNext].wheelPrev = slot.wheelPrev;
+    }
+    slot.wheelBucket = MESSAGE_WHEEL_NONE;
+    slot.wheelPrev = MESSAGE_WHEEL_NONE;
+    slot.wheelNext = MESSAGE_WHEEL_NONE;
+}
+
+void MessageQueue::cascade(int level) {
+    // Re-file every timer of the block that just started into the finer levels
+    int bucket = (currentTick >> (MESSAGE_WHEEL_BITS * level)) & (MESSAGE_WHEEL_SIZE - 1);
+    uint8_t index = wheel[level][bucket];
+    wheel[level][bucket] = MESSAGE_WHEEL_NONE;
+
+    while (index != MESSAGE_WHEEL_NONE) {
+        uint8_t next = slots[index].wheelNext;
+        slots[index].wheelBucket = MESSAGE_WHEEL_NONE;
+        wheelInsert(index, slots[index].timerDue);
+        index = next;
+    }
+}
+
+void MessageQueue::fireTimer(int slotIndex) {
+    MessageSlot& slot = slots[slotIndex];
+    if (slot.state == MESSAGE_SLOT_SCHEDULED) {
+        // Not-before time reached; the ttl counts from here
+        scheduledSlots--;
+        appendToBucket(slotIndex);
+        if (slot.ttlSeconds > 0) {
+            wheelInsert(slotIndex, currentTick + slot.ttlSeconds);
+        }
+    } else if (slot.state == MESSAGE_SLOT_QUEUED) {
+        // Expired before it reached the screen
+        release(slotIndex);
+    }
+}
+
+MessagePriority MessageQueue::parsePriority(const char* name) {
+    if (name == nullptr) {
+        return MSG_PRIORITY_NORMAL;
+    }
+    if (strcasecmp(name, "urgent") == 0) {
+        return MSG_PRIORITY_URGENT;
+    }
+    if (strcasecmp(name, "high") == 0) {
+        return MSG_PRIORITY_HIGH;
+    }
+    if (strcasecmp(name, "low") == 0) {
+        return MSG_PRIORITY_LOW;
+    }
+    return MSG_PRIORITY_NORMAL;
+}
+
+const char* MessageQueue::getPriorityName(MessagePriority priority) {
+    switch (priority) {
+        case MSG_PRIORITY_LOW:
+            return "low";
+        case MSG_PRIORITY_HIGH:
+            return "high";
+        case MSG_PRIORITY_URGENT:
+            return "urgent";
+        default:
+            return "normal";
+    }
+}
+
+uint32_t MessageQueue::hashId(const char* id) {
+    // FNV-1a over at most the stored id length, so truncated ids hash like their slot copy
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < MESSAGE_ID_MAX_LENGTH && id[i] != '\0'; i++) {
+        hash = (hash ^ (uint8_t)id[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void MessageQueue::indexInsert(int slotIndex) {
+    uint32_t hash = slots[slotIndex].idHash;
+    for (int probe = 0; probe < MESSAGE_INDEX_SIZE; probe++) {
+        uint8_t& entry = idIndex[(hash + probe) & (MESSAGE_INDEX_SIZE - 1)];
+        if (entry == MESSAGE_INDEX_EMPTY) {
+            entry = slotIndex;
+            return;
+        }
+    }
+}
+
+void MessageQueue::indexRemove(int slotIndex) {
+    const uint32_t mask = MESSAGE_INDEX_SIZE - 1;
+
+    uint32_t hole = slots[slotIndex].idHash & mask;
+    while (idIndex[hole] != slotIndex) {
+        if (idIndex[hole] == MESSAGE_INDEX_EMPTY)
+            return;
+        hole = (hole + 1) & mask;
+    }
+
+    // Backward-shift deletion: pull later entries of the probe run into the hole so lookups
+    // never need tombstones
+    uint32_t next = hole;
+    while (true) {
+        next = (next + 1) & mask;
+        uint8_t entry = idIndex[next];
+        if (entry == MESSAGE_INDEX_EMPTY)
+            break;
+        uint32_t home = slots[entry].idHash & mask;
+        // Move the entry if its home position is not cyclically within (hole, next]
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            idIndex[hole] = entry;
+            hole = next;
+        }
+    }
+    idIndex[hole] = MESSAGE_INDEX_EMPTY;
+}
+
+void MessageQueue::appendToBucket(int slotIndex) {
+    MessageSlot& slot = slots[slotIndex];
+    PriorityBucket& bucket = buckets[slot.priority];
+    bucket.order[(bucket.head + bucket.count) % MESSAGE_SLOT_COUNT] = slotIndex;
+    bucket.count++;
+    priorityMask |= 1 << slot.priority;
+    queuedCount++;
+    slot.state = MESSAGE_SLOT_QUEUED;
+}
+
+void MessageQueue::unlinkFromBucket(int slotIndex) {
+    // Buckets hold at most MESSAGE_SLOT_COUNT entries, so closing the gap is cheap
+    MessagePriority priority = slots[slotIndex].priority;
+    PriorityBucket& bucket = buckets[priority];
+    int found = -1;
+    for (int i = 0; i < bucket.count; i++) {
+        if (bucket.order[(bucket.head + i) % MESSAGE_SLOT_COUNT] == slotIndex) {
+            found = i;
+            break;
+        }
+    }
+    if (found < 0) {
+        return;
+    }
+
+    for (int i = found; i < bucket.count - 1; i++) {
+        bucket.order[(bucket.head + i) % MESSAGE_SLOT_COUNT] =
+            bucket.order[(bucket.head + i + 1) % MESSAGE_SLOT_COUNT];
+    }
+    if (--bucket.count == 0) {
+        priorityMask &= ~(1 << priority);
+    }
+    queuedCount--;
+}
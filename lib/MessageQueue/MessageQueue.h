@@ -0,0 +1,189 @@
+#ifndef MESSAGE_QUEUE_H
+#define MESSAGE_QUEUE_H
+
+#include <Arduino.h>
+
+// Message arena settings. All storage is allocated statically, so queuing, showing and
+// retiring a message never touches the heap.
+#define MESSAGE_SLOT_COUNT 8         // Queued plus active messages
+#define MESSAGE_TEXT_MAX_LENGTH 255  // Bytes; the API rejects longer text, push() cuts it
+#define MESSAGE_ID_MAX_LENGTH 31     // Longer ids are truncated
+#define MESSAGE_NO_SLOT -1
+
+// Scheduling: three-level timing wheel with 1 s, 64 s and 4096 s buckets (~72 h horizon).
+// Later timers wait at the horizon and are filed again from there.
+#define MESSAGE_WHEEL_LEVELS 3
+#define MESSAGE_WHEEL_BITS 6
+#define MESSAGE_WHEEL_SIZE (1 << MESSAGE_WHEEL_BITS)
+#define MESSAGE_WHEEL_HORIZON (1UL << (MESSAGE_WHEEL_BITS * MESSAGE_WHEEL_LEVELS))
+#define MESSAGE_WHEEL_NONE 0xFF
+#define MESSAGE_SCHEDULE_MAX_SECONDS (365UL * 24UL * 3600UL)  // Longest delay, ttl or repeat
+
+// Id index: open addressing with linear probing, kept at most half full
+#define MESSAGE_INDEX_SIZE 16  // Power of two, at least 2 * MESSAGE_SLOT_COUNT
+#define MESSAGE_INDEX_EMPTY 0xFF
+
+enum MessagePriority : uint8_t {
+    MSG_PRIORITY_LOW,
+    MSG_PRIORITY_NORMAL,
+    MSG_PRIORITY_HIGH,
+    MSG_PRIORITY_URGENT
+};
+#define MESSAGE_PRIORITY_COUNT 4
+
+enum MessageSlotState : uint8_t {
+    MESSAGE_SLOT_FREE,
+    MESSAGE_SLOT_SCHEDULED,  // Waiting in the timing wheel for its not-before time
+    MESSAGE_SLOT_QUEUED,
+    MESSAGE_SLOT_ACTIVE  // Popped for display, still owns its storage
+};
+
+enum MessagePushResult : uint8_t {
+    MESSAGE_PUSH_QUEUED,     // New message took a free slot
+    MESSAGE_PUSH_UPDATED,    // A message with the same id had its text/priority replaced
+    MESSAGE_PUSH_COALESCED,  // Identical to the message already held under that id
+    MESSAGE_PUSH_FULL        // No free slot
+};
+
+// Optional timing for a message, all in seconds (0 = unused)
+struct MessageSchedule {
+    uint32_t delaySeconds = 0;   // Not shown before this much time has passed
+    uint32_t ttlSeconds = 0;     // Dropped if not shown within this long of becoming due
+    uint32_t repeatSeconds = 0;  // Shown again this long after each showing starts
+
+    bool isEmpty() const {
+        return delaySeconds == 0 && ttlSeconds == 0 && repeatSeconds == 0;
+    }
+};
+
+// One pre-allocated message
+struct MessageSlot {
+    char text[MESSAGE_TEXT_MAX_LENGTH + 1];
+    char id[MESSAGE_ID_MAX_LENGTH + 1];  // Empty for anonymous messages
+    uint32_t idHash;
+    uint16_t textLength;
+    MessagePriority priority;
+    MessageSlotState state;
+    bool hasResumePosition;  // Set when the message was preempted part-way through
+    int16_t resumeScrollX;
+
+    // Scheduling
+    uint32_t ttlSeconds;
+    uint32_t repeatSeconds;
+    uint32_t lastShownTick;
+    uint32_t timerDue;    // Tick the pending not-before or expiry timer is due
+    uint8_t wheelBucket;  // Wheel list the slot is linked into, MESSAGE_WHEEL_NONE if none
+    uint8_t wheelPrev;
+    uint8_t wheelNext;
+};
+
+class MessageQueue {
+   public:
+    MessageQueue();
+
+    // Copies id/text straight into a slot. A non-empty id that is already held is updated in
+    // place (upsert) instead of taking another slot; a schedule given with it replaces the
+    // old one unless the message is showing. slotOut receives the slot holding the message.
+    MessagePushResult push(const char* id, const char* text, MessagePriority priority,
+                           const MessageSchedule& schedule = MessageSchedule(),
+                           int* slotOut = nullptr);
+
+    // Moves the queue clock forward to nowSeconds, releasing due messages and dropping
+    // expired ones. Costs O(1) per elapsed second whatever the number of messages.
+    void advance(uint32_t nowSeconds);
+    uint32_t now() const {
+        return currentTick;
+    }
+
+    // Done showing a popped slot: repeating messages go back into the wheel, others are freed
+    void finish(int slotIndex);
+
+    // Takes the oldest slot of the highest non-empty priority off the queue. The slot stays
+    // allocated (for display) until release() is called. Returns MESSAGE_NO_SLOT when the
+    // queue is empty.
+    int pop();
+
+    // Frees a slot whatever its state (queued, scheduled or showing)
+    void release(int slotIndex);
+
+    // Slot holding the message with this id, or MESSAGE_NO_SLOT. O(1) via the id index.
+    int find(const char* id) const;
+
+    // Puts a popped (preempted) slot back at the front of its priority, remembering where it
+    // had scrolled to so it can continue from there.
+    void requeueFront(int slotIndex, int16_t scrollX);
+
+    // Highest priority currently queued, or -1 when empty
+    int peekPriority() const {
+        return priorityMask ? 31 - __builtin_clz(priorityMask) : -1;
+    }
+
+    const MessageSlot& getSlot(int slotIndex) const {
+        return slots[slotIndex];
+    }
+    const char* getId(int slotIndex) const {
+        return slots[slotIndex].id;
+    }
+
+    int count() const {
+        return queuedCount;
+    }
+    int scheduledCount() const {
+        return scheduledSlots;
+    }
+    int count(MessagePriority priority) const {
+        return buckets[priority].count;
+    }
+    int capacity() const {
+        return MESSAGE_SLOT_COUNT;
+    }
+    int freeSlots() const {
+        return freeCount;
+    }
+
+    // Priority names used by the HTTP API ("low", "normal", "high", "urgent")
+    static MessagePriority parsePriority(const char* name);
+    static const char* getPriorityName(MessagePriority priority);
+
+   private:
+    MessageSlot slots[MESSAGE_SLOT_COUNT];
+
+    // Free slot stack
+    uint8_t freeList[MESSAGE_SLOT_COUNT];
+    uint8_t freeCount;
+
+    // One FIFO of slot indices per priority, plus a bitmask of the non-empty ones so
+    // push and pop are O(1). Each ring can hold every slot, so none can overflow.
+    struct PriorityBucket {
+        uint8_t order[MESSAGE_SLOT_COUNT];
+        uint8_t head;
+        uint8_t count;
+    };
+    PriorityBucket buckets[MESSAGE_PRIORITY_COUNT];
+    uint8_t priorityMask;
+    uint8_t queuedCount;
+
+    // Timing wheel: per-bucket doubly linked lists threaded through the slots
+    uint8_t wheel[MESSAGE_WHEEL_LEVELS][MESSAGE_WHEEL_SIZE];
+    uint32_t currentTick;
+    uint8_t scheduledSlots;
+
+    void detach(int slotIndex);
+    void arm(int slotIndex, const MessageSchedule& schedule);
+    void wheelInsert(int slotIndex, uint32_t due);
+    void wheelUnlink(int slotIndex);
+    void cascade(int level);
+    void fireTimer(int slotIndex);
+
+    // Id -> slot index. Entries are slot numbers or MESSAGE_INDEX_EMPTY.
+    uint8_t idIndex[MESSAGE_INDEX_SIZE];
+
+    static uint32_t hashId(const char* id);
+    void indexInsert(int slotIndex);
+    void indexRemove(int slotIndex);
+
+    void appendToBucket(int slotIndex);
+    void unlinkFromBucket(int slotIndex);
+};
+
+#endif  // MESSAGE_QUEUE_H
@@ -0,0 +1,448 @@
+#include "MessageStore.h"
+
+#include <time.h>
+
+#include "Log.h"
+
+// Little-endian field helpers for the record format
+static void put16(uint8_t* out, uint16_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+}
+
+static void put32(uint8_t* out, uint32_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+static uint16_t get16(const uint8_t* in) {
+    return in[0] | (in[1] << 8);
+}
+
+static uint32_t get32(const uint8_t* in) {
+    return in[0] | (in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+MessageStore::MessageStore()
+    : mounted(false),
+      needsCompaction(false),
+      nextSeq(1),
+      buffered(0),
+      firstBufferedMs(0),
+      logBytes(0),
+      writeLength(0),
+      compactBytes(0),
+      compactOk(false) {
+    memset(slotSeq, 0, sizeof(slotSeq));
+}
+
+bool MessageStore::begin() {
+    mounted = LittleFS.begin(true);
+    if (!mounted) {
+        LOG_ERROR("[MessageStore] LittleFS mount failed, messages will not persist");
+    }
+    return mounted;
+}
+
+int MessageStore::replay(MessageQueue& queue) {
+    if (!mounted) {
+        return 0;
+    }
+
+    unsigned long start = millis();
+
+    // A leftover temp file means compaction was interrupted before the rename, so the old
+    // log is still the complete one
+    if (LittleFS.exists(MESSAGE_STORE_TEMP_PATH)) {
+        LittleFS.remove(MESSAGE_STORE_TEMP_PATH);
+    }
+
+    File file = LittleFS.open(MESSAGE_STORE_PATH, "r");
+    if (!file) {
+        return 0;
+    }
+    uint32_t fileSize = file.size();
+    uint32_t validBytes = 0;
+    replayFile(file, queue, validBytes);
+    file.close();
+    logBytes = validBytes;
+
+    int restored = 0;
+    for (int i = 0; i < MESSAGE_SLOT_COUNT; i++) {
+        if (slotSeq[i] != 0) {
+            restored++;
+        }
+    }
+
+    unsigned long elapsed = millis() - start;
+    LOG_INFO("[MessageStore] Restored %d messages from %u log bytes in %lu ms", restored,
+             (unsigned)validBytes, elapsed);
+    if (elapsed > MESSAGE_STORE_REPLAY_BUDGET_MS) {
+        LOG_WARN("[MessageStore] Replay exceeded its startup budget");
+    }
+
+    // Appending after a torn record would hide everything written later, so rewrite first
+    if (validBytes < fileSize) {
+        LOG_WARN("[MessageStore] Dropped %u bytes of incomplete log",
+                 (unsigned)(fileSize - validBytes));
+        compact(queue);
+    } else if (logBytes > MESSAGE_STORE_COMPACT_BYTES) {
+        compact(queue);
+    }
+    return restored;
+}
+
+void MessageStore::recordSlot(const MessageQueue& queue, int slotIndex) {
+    if (!mounted || slotIndex < 0 || slotIndex >= MESSAGE_SLOT_COUNT) {
+        return;
+    }
+
+    if (queue.getSlot(slotIndex).state == MESSAGE_SLOT_FREE) {
+        if (slotSeq[slotIndex] != 0) {
+            appendDelete(slotSeq[slotIndex]);
+            slotSeq[slotIndex] = 0;
+        }
+        return;
+    }
+
+    uint8_t record[MESSAGE_RECORD_HEADER_SIZE + MESSAGE_RECORD_MAX_PAYLOAD];
+    append(record, encodePut(queue, slotIndex, record));
+}
+
+void MessageStore::recordNewSlot(const MessageQueue& queue, int slotIndex) {
+    if (!mounted || slotIndex < 0 || slotIndex >= MESSAGE_SLOT_COUNT) {
+        return;
+    }
+
+    if (slotSeq[slotIndex] != 0) {
+        appendDelete(slotSeq[slotIndex]);
+        slotSeq[slotIndex] = 0;
+    }
+    recordSlot(queue, slotIndex);
+}
+
+bool MessageStore::update(const MessageQueue& queue) {
+    if (!mounted) {
+        return false;
+    }
+
+    // Messages that expired in the queue are freed without going through recordSlot()
+    for (int i = 0; i < MESSAGE_SLOT_COUNT; i++) {
+        if (slotSeq[i] != 0 && queue.getSlot(i).state == MESSAGE_SLOT_FREE) {
+            appendDelete(slotSeq[i]);
+            slotSeq[i] = 0;
+        }
+    }
+
+    if (buffered == 0 || (buffered < MESSAGE_STORE_FLUSH_BYTES &&
+                          millis() - firstBufferedMs < MESSAGE_STORE_FLUSH_MS)) {
+        return false;
+    }
+    takeBatch();
+    return true;
+}
+
+void MessageStore::write() {
+    if (!mounted || writeLength == 0) {
+        return;
+    }
+
+    File file = LittleFS.open(MESSAGE_STORE_PATH, "a");
+    if (!file) {
+        LOG_ERROR("[MessageStore] Could not open log for writing");
+        writeLength = 0;
+        needsCompaction = true;
+        return;
+    }
+    size_t written = file.write(writing, writeLength);
+    file.close();
+
+    if (written != writeLength) {
+        LOG_ERROR("[MessageStore] Short write to message log");
+        needsCompaction = true;
+    }
+    logBytes += written;
+    writeLength = 0;
+}
+
+void MessageStore::flush() {
+    takeBatch();
+    write();
+}
+
+void MessageStore::takeBatch() {
+    // A batch write() has not taken yet stays ahead of this one
+    if (writeLength != 0 || buffered == 0) {
+        return;
+    }
+    memcpy(writing, buffer, buffered);
+    writeLength = buffered;
+    buffered = 0;
+}
+
+size_t MessageStore::encodePut(const MessageQueue& queue, int slotIndex, uint8_t* record) {
+    const MessageSlot& slot = queue.getSlot(slotIndex);
+    if (slotSeq[slotIndex] == 0) {
+        slotSeq[slotIndex] = nextSeq++;
+    }
+
+    // Timers are stored as wall-clock times because the queue clock restarts at boot
+    uint32_t notBefore = 0;
+    uint32_t expireAt = 0;
+    uint32_t wallNow = wallClock();
+    if (wallNow != 0) {
+        if (slot.state == MESSAGE_SLOT_SCHEDULED) {
+            notBefore = wallNow + (slot.timerDue - queue.now());
+            if (slot.ttlSeconds > 0) {
+                expireAt = notBefore + slot.ttlSeconds;
+            }
+        } else if (slot.state == MESSAGE_SLOT_QUEUED && slot.wheelBucket != MESSAGE_WHEEL_NONE) {
+            expireAt = wallNow + (slot.timerDue - queue.now());
+        }
+    }
+
+    uint8_t* payload = record + MESSAGE_RECORD_HEADER_SIZE;
+    size_t pos = 0;
+    put32(payload + pos, slotSeq[slotIndex]);
+    pos += 4;
+    payload[pos++] = slot.priority;
+
+    size_t idLength = strlen(slot.id);
+    payload[pos++] = idLength;
+    memcpy(payload + pos, slot.id, idLength);
+    pos += idLength;
+
+    put16(payload + pos, slot.textLength);
+    pos += 2;
+    memcpy(payload + pos, slot.text, slot.textLength);
+    pos += slot.textLength;
+
+    put32(payload + pos, notBefore);
+    put32(payload + pos + 4, expireAt);
+    put32(payload + pos + 8, slot.ttlSeconds);
+    put32(payload + pos + 12, slot.repeatSeconds);
+    pos += 16;
+
+    return sealRecord(record, MESSAGE_RECORD_PUT, pos);
+}
+
+void MessageStore::appendDelete(uint32_t seq) {
+    uint8_t record[MESSAGE_RECORD_HEADER_SIZE + 4];
+    put32(record + MESSAGE_RECORD_HEADER_SIZE, seq);
+    append(record, sealRecord(record, MESSAGE_RECORD_DELETE, 4));
+}
+
+void MessageStore::append(const uint8_t* record, size_t length) {
+    // Called under the queue lock, often from the web server task, so it never writes flash.
+    // A rewrite of the whole queue brings back whatever does not fit.
+    if (buffered + length > MESSAGE_STORE_BUFFER_SIZE) {
+        LOG_WARN("[MessageStore] Batch full, log will be rewritten");
+        needsCompaction = true;
+        return;
+    }
+    if (buffered == 0) {
+        firstBufferedMs = millis();
+    }
+    memcpy(buffer + buffered, record, length);
+    buffered += length;
+}
+
+bool MessageStore::beginCompaction() {
+    // Write one put per live message to a temp file, then rename it over the log. LittleFS
+    // renames atomically, so power loss leaves either the old log or the new one.
+    if (!mounted) {
+        return false;
+    }
+    compactFile = LittleFS.open(MESSAGE_STORE_TEMP_PATH, "w");
+    if (!compactFile) {
+        LOG_ERROR("[MessageStore] Could not create compacted log");
+        needsCompaction = true;
+        return false;
+    }
+    needsCompaction = false;  // Set again if the batch overflows before the rename
+    compactBytes = 0;
+    compactOk = true;
+    return true;
+}
+
+size_t MessageStore::encodeSlot(const MessageQueue& queue, int slotIndex, uint8_t* record) {
+    // A freed slot is simply absent from the new log. Its seq stays set until update() logs
+    // the delete, which also covers any put for it still in the batch.
+    if (queue.getSlot(slotIndex).state == MESSAGE_SLOT_FREE) {
+        return 0;
+    }
+    return encodePut(queue, slotIndex, record);
+}
+
+void MessageStore::writeCompacted(const uint8_t* record, size_t length) {
+    if (!compactFile || !compactOk || length == 0) {
+        return;
+    }
+    compactOk = compactFile.write(record, length) == length;
+    compactBytes += length;
+}
+
+bool MessageStore::finishCompaction() {
+    if (!compactFile) {
+        return false;
+    }
+    compactFile.close();
+    if (!compactOk || !LittleFS.rename(MESSAGE_STORE_TEMP_PATH, MESSAGE_STORE_PATH)) {
+        LOG_ERROR("[MessageStore] Log compaction failed");
+        LittleFS.remove(MESSAGE_STORE_TEMP_PATH);
+        needsCompaction = true;
+        return false;
+    }
+
+    // Records still batched were logged after their slot's snapshot, so replaying them on
+    // top of it ends in the same state
+    LOG_INFO("[MessageStore] Compacted log from %u to %u bytes", (unsigned)logBytes,
+             (unsigned)compactBytes);
+    logBytes = compactBytes;
+    return true;
+}
+
+bool MessageStore::compact(const MessageQueue& queue) {
+    if (!beginCompaction()) {
+        return false;
+    }
+    uint8_t record[MESSAGE_RECORD_HEADER_SIZE + MESSAGE_RECORD_MAX_PAYLOAD];
+    for (int i = 0; i < MESSAGE_SLOT_COUNT; i++) {
+        writeCompacted(record, encodeSlot(queue, i, record));
+    }
+    return finishCompaction();
+}
+
+void MessageStore::replayFile(File& file, MessageQueue& queue, uint32_t& validBytes) {
+    // The write buffer is empty at boot, so it doubles as the payload buffer here
+    uint8_t header[MESSAGE_RECORD_HEADER_SIZE];
+    uint32_t wallNow = wallClock();
+    validBytes = 0;
+
+    while (file.read(header, sizeof(header)) == sizeof(header)) {
+        uint16_t length = get16(header + 2);
+        if (header[0] != MESSAGE_RECORD_MAGIC || length > MESSAGE_RECORD_MAX_PAYLOAD) {
+            break;
+        }
+        if (file.read(buffer, length) != length) {
+            break;
+        }
+        if (crc32(crc32(0, header + 1, 3), buffer, length) != get32(header + 4)) {
+            break;
+        }
+        validBytes += sizeof(header) + length;
+
+        if (header[1] == MESSAGE_RECORD_PUT) {
+            applyPut(buffer, length, queue, wallNow);
+        } else if (header[1] == MESSAGE_RECORD_DELETE && length >= 4) {
+            applyDelete(get32(buffer), queue);
+        }
+    }
+}
+
+void MessageStore::applyPut(const uint8_t* payload, size_t length, MessageQueue& queue,
+                            uint32_t wallNow) {
+    // seq, priority, id length, text length and the four timing fields
+    if (length < 4 + 1 + 1 + 2 + 16) {
+        return;
+    }
+    size_t pos = 0;
+    uint32_t seq = get32(payload);
+    pos += 4;
+    uint8_t priority = payload[pos++];
+    uint8_t idLength = payload[pos++];
+    if (idLength > MESSAGE_ID_MAX_LENGTH || pos + idLength + 2 + 16 > length) {
+        return;
+    }
+    char id[MESSAGE_ID_MAX_LENGTH + 1];
+    memcpy(id, payload + pos, idLength);
+    id[idLength] = '\0';
+    pos += idLength;
+
+    uint16_t textLength = get16(payload + pos);
+    pos += 2;
+    if (textLength > MESSAGE_TEXT_MAX_LENGTH || pos + textLength + 16 != length) {
+        return;
+    }
+    char text[MESSAGE_TEXT_MAX_LENGTH + 1];
+    memcpy(text, payload + pos, textLength);
+    text[textLength] = '\0';
+    pos += textLength;
+
+    uint32_t notBefore = get32(payload + pos);
+    uint32_t expireAt = get32(payload + pos + 4);
+    MessageSchedule schedule;
+    schedule.ttlSeconds = get32(payload + pos + 8);
+    schedule.repeatSeconds = get32(payload + pos + 12);
+
+    // Without a wall clock the timing cannot be recovered, so the message is due at once
+    if (wallNow != 0) {
+        if (notBefore > wallNow) {
+            schedule.delaySeconds = notBefore - wallNow;
+        }
+        if (expireAt != 0) {
+            uint32_t dueAt = notBefore > wallNow ? notBefore : wallNow;
+            if (expireAt <= dueAt) {
+                applyDelete(seq, queue);  // Expired while the device was off
+                return;
+            }
+            schedule.ttlSeconds = expireAt - dueAt;
+        }
+    }
+
+    // A later put for the same message replaces the earlier one
+    applyDelete(seq, queue);
+
+    if (priority >= MESSAGE_PRIORITY_COUNT) {
+        priority = MSG_PRIORITY_NORMAL;
+    }
+    int slot = MESSAGE_NO_SLOT;
+    if (queue.push(id, text, (MessagePriority)priority, schedule, &slot) == MESSAGE_PUSH_FULL) {
+        return;
+    }
+    slotSeq[slot] = seq;
+    if (seq >= nextSeq) {
+        nextSeq = seq + 1;
+    }
+}
+
+void MessageStore::applyDelete(uint32_t seq, MessageQueue& queue) {
+    for (int i = 0; i < MESSAGE_SLOT_COUNT; i++) {
+        if (slotSeq[i] == seq) {
+            queue.release(i);
+            slotSeq[i] = 0;
+            return;
+        }
+    }
+}
+
+size_t MessageStore::sealRecord(uint8_t* record, MessageRecordType type, size_t payloadLength) {
+    record[0] = MESSAGE_RECORD_MAGIC;
+    record[1] = type;
+    put16(record + 2, payloadLength);
+    uint32_t crc = crc32(crc32(0, record + 1, 3), record + MESSAGE_RECORD_HEADER_SIZE,
+                         payloadLength);
+    put32(record + 4, crc);
+    return MESSAGE_RECORD_HEADER_SIZE + payloadLength;
+}
+
+uint32_t MessageStore::crc32(uint32_t crc, const uint8_t* data, size_t length) {
+    // CRC-32 (IEEE), a nibble at a time to keep the table small. Calls can be chained.
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+        0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = (crc >> 4) ^ table[(crc ^ data[i]) & 0x0F];
+        crc = (crc >> 4) ^ table[(crc ^ (data[i] >> 4)) & 0x0F];
+    }
+    return ~crc;
+}
+
+uint32_t MessageStore::wallClock() {
+    time_t now = time(nullptr);
+    return now >= (time_t)MESSAGE_STORE_MIN_VALID_TIME ? (uint32_t)now : 0;
+}
@@ -0,0 +1,120 @@
+#ifndef MESSAGE_STORE_H
+#define MESSAGE_STORE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+#include "MessageQueue.h"
+
+// Queued and scheduled messages are kept on LittleFS as an append-only log so they survive a
+// reboot or OTA update. Records are batched in RAM to limit flash wear, so up to
+// MESSAGE_STORE_FLUSH_MS of changes can be lost on power failure. Only the loop task touches
+// flash: the web server task just fills the batch, under the caller's queue lock.
+#define MESSAGE_STORE_PATH "/messages.log"
+#define MESSAGE_STORE_TEMP_PATH "/messages.tmp"  // Compaction target, renamed over the log
+#define MESSAGE_STORE_BUFFER_SIZE 1024           // Pending records held before a write
+#define MESSAGE_STORE_FLUSH_MS 2000              // Longest a record waits in RAM
+#define MESSAGE_STORE_FLUSH_BYTES (MESSAGE_STORE_BUFFER_SIZE / 2)  // Write sooner when this full
+#define MESSAGE_STORE_COMPACT_BYTES 16384        // Log size that triggers a rewrite
+#define MESSAGE_STORE_REPLAY_BUDGET_MS 50        // Warn when boot replay takes longer
+#define MESSAGE_STORE_MIN_VALID_TIME 1600000000UL  // Wall clock below this is treated as unset
+
+// Record layout (little endian): magic, type, payload length (2), CRC-32 (4), payload.
+// The CRC covers type, length and payload, so a record torn by power loss is detected and
+// replay stops there.
+#define MESSAGE_RECORD_MAGIC 0xA7
+#define MESSAGE_RECORD_HEADER_SIZE 8
+#define MESSAGE_RECORD_MAX_PAYLOAD \
+    (4 + 1 + 1 + MESSAGE_ID_MAX_LENGTH + 2 + MESSAGE_TEXT_MAX_LENGTH + 16)
+
+enum MessageRecordType : uint8_t {
+    MESSAGE_RECORD_PUT = 1,    // Message added or changed: seq, priority, id, text, timing
+    MESSAGE_RECORD_DELETE = 2  // Message gone: seq
+};
+
+class MessageStore {
+   public:
+    MessageStore();
+
+    // Mounts LittleFS (formatting it if it cannot be mounted)
+    bool begin();
+
+    // Loads the log into the queue at boot and returns the number of messages restored.
+    // A torn or corrupt tail is dropped and the log rewritten without it.
+    int replay(MessageQueue& queue);
+
+    // Log the current state of a slot after it changed: a put while it holds a message, a
+    // delete once it has been freed
+    void recordSlot(const MessageQueue& queue, int slotIndex);
+
+    // Log a message that has just taken a slot. The slot's previous occupant may have
+    // expired without being logged yet, so that one is deleted first.
+    void recordNewSlot(const MessageQueue& queue, int slotIndex);
+
+    // Call from the loop with the queue locked: logs messages the queue dropped on its own
+    // (expiry) and hands the batch to write() once it is due. Returns true when it did.
+    bool update(const MessageQueue& queue);
+
+    // Call from the loop after update(), without the lock: appends the batch to the log
+    void write();
+
+    // The log has grown too large, may hold a torn record, or a full batch dropped records
+    bool isCompactionDue() const {
+        return needsCompaction || logBytes > MESSAGE_STORE_COMPACT_BYTES;
+    }
+
+    // Compaction from the loop, with the queue locked only while a slot is encoded:
+    // beginCompaction(), then for every slot encodeSlot() under the lock and writeCompacted()
+    // without it, then finishCompaction(). Records logged meanwhile stay in the batch and go
+    // to the new log.
+    bool beginCompaction();
+    size_t encodeSlot(const MessageQueue& queue, int slotIndex, uint8_t* record);  // 0 if free
+    void writeCompacted(const uint8_t* record, size_t length);
+    bool finishCompaction();
+
+    // Write the batch or compact in one go, for when nothing else touches the queue (boot)
+    void flush();
+    bool compact(const MessageQueue& queue);
+
+    uint32_t getLogSize() const {
+        return logBytes + buffered + writeLength;
+    }
+
+   private:
+    bool mounted;
+    bool needsCompaction;  // A short write may have left a torn record mid-log, or a full
+                           // batch dropped records that only a rewrite of the queue restores
+
+    // Log sequence number of the message each slot holds, 0 when it is not in the log
+    uint32_t slotSeq[MESSAGE_SLOT_COUNT];
+    uint32_t nextSeq;
+
+    uint8_t buffer[MESSAGE_STORE_BUFFER_SIZE];
+    size_t buffered;
+    unsigned long firstBufferedMs;
+    uint32_t logBytes;
+
+    // The batch handed over by update(), written by write() while the buffer refills
+    uint8_t writing[MESSAGE_STORE_BUFFER_SIZE];
+    size_t writeLength;
+
+    File compactFile;  // Temp file of a compaction in progress
+    uint32_t compactBytes;
+    bool compactOk;
+
+    size_t encodePut(const MessageQueue& queue, int slotIndex, uint8_t* record);
+    void appendDelete(uint32_t seq);
+    void append(const uint8_t* record, size_t length);
+    void takeBatch();
+
+    // Replays one file into the queue. validBytes receives the length of the intact prefix.
+    void replayFile(File& file, MessageQueue& queue, uint32_t& validBytes);
+    void applyPut(const uint8_t* payload, size_t length, MessageQueue& queue, uint32_t wallNow);
+    void applyDelete(uint32_t seq, MessageQueue& queue);
+
+    static size_t sealRecord(uint8_t* record, MessageRecordType type, size_t payloadLength);
+    static uint32_t crc32(uint32_t crc, const uint8_t* data, size_t length);
+    static uint32_t wallClock();
+};
+
+#endif  // MESSAGE_STORE_H
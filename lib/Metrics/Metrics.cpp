@@ -0,0 +1,266 @@
+#include "Metrics.h"
+
+// Upper bounds of the frame time buckets: a 30 Hz frame lands in the 0.033 s bucket
+static const uint32_t FRAME_BUCKET_US[METRICS_FRAME_BUCKETS] = {5000,  10000,  20000,  33000,
+                                                                50000, 100000, 250000, 1000000};
+static const char* const FRAME_BUCKET_LABELS[METRICS_FRAME_BUCKETS] = {
+    "0.005", "0.01", "0.02", "0.033", "0.05", "0.1", "0.25", "1"};
+static const char* const TICK_BUCKET_LABELS[METRICS_TICK_BUCKETS] = {"0", "1", "2", "3", "4"};
+static const int REJECT_STATUS[METRICS_REJECT_REASONS] = {400, 401, 413, 429, 503, 507};
+static const char* const NTP_RESULTS[2] = {"failure", "success"};
+static const char* const OTA_EVENTS[3] = {"started", "succeeded", "failed"};
+
+enum MetricsFamilyId {
+    FAMILY_FRAMES,
+    FAMILY_FRAME_TIME,
+    FAMILY_EFFECT_TICKS,
+    FAMILY_EFFECT_TICKS_DROPPED,
+    FAMILY_MESSAGES_ACCEPTED,
+    FAMILY_MESSAGES_REJECTED,
+    FAMILY_QUEUE_DEPTH,
+    FAMILY_QUEUE_CAPACITY,
+    FAMILY_SCHEDULED,
+    FAMILY_HEAP_FREE,
+    FAMILY_HEAP_MIN_FREE,
+    FAMILY_HEAP_LARGEST_BLOCK,
+    FAMILY_WIFI_RECONNECTS,
+    FAMILY_NTP_SYNCS,
+    FAMILY_OTA,
+    FAMILY_COUNT
+};
+
+struct MetricsFamily {
+    const char* name;
+    const char* type;
+    const char* help;
+    int samples;
+};
+
+// In MetricsFamilyId order
+static const MetricsFamily FAMILIES[FAMILY_COUNT] = {
+    {"matrix_frames_total", "counter", "Frames shown on the panel.", 1},
+    {"matrix_frame_time_seconds", "histogram", "Time from one frame to the next.",
+     METRICS_FRAME_BUCKETS + 3},  // Buckets, +Inf, sum, count
+    {"matrix_effect_ticks_per_frame", "histogram", "Effect simulation ticks run before a frame.",
+     METRICS_TICK_BUCKETS + 3},
+    {"matrix_effect_ticks_dropped_total", "counter",
+     "Effect ticks skipped after a stall instead of caught up.", 1},
+    {"matrix_messages_accepted_total", "counter", "Messages queued or updated, from any source.",
+     1},
+    {"matrix_messages_rejected_total", "counter", "POST /messages answered with an error.",
+     METRICS_REJECT_REASONS},
+    {"matrix_message_queue_depth", "gauge", "Messages waiting to be shown.",
+     MESSAGE_PRIORITY_COUNT},
+    {"matrix_message_queue_capacity", "gauge", "Message slots, queued and showing.", 1},
+    {"matrix_messages_scheduled", "gauge", "Messages waiting for their time.", 1},
+    {"matrix_heap_free_bytes", "gauge", "Free heap.", 1},
+    {"matrix_heap_min_free_bytes", "gauge", "Lowest free heap since boot.", 1},
+    {"matrix_heap_largest_block_bytes", "gauge", "Largest heap block that can be allocated.", 1},
+    {"matrix_wifi_reconnects_total", "counter", "WiFi connections regained after a drop.", 1},
+    {"matrix_ntp_syncs_total", "counter", "NTP syncs by result.", 2},
+    {"matrix_ota_updates_total", "counter", "OTA updates by event.", 3}};
+
+Metrics::Metrics()
+    : frames(0),
+      frameBuckets{},
+      frameSumMs(0),
+      frameCarryUs(0),
+      effectFrames(0),
+      tickBuckets{},
+      effectTicks(0),
+      droppedTicks(0),
+      messagesAccepted(0),
+      rejected{},
+      wifiReconnects(0),
+      ntpSyncs{},
+      ota{} {}
+
+void Metrics::countFrame(uint32_t frameUs) {
+    // The total goes up before the bucket, and snapshot() reads them the other way round
+    frames.fetch_add(1, std::memory_order_relaxed);
+    for (int i = 0; i < METRICS_FRAME_BUCKETS; i++) {
+        if (frameUs <= FRAME_BUCKET_US[i]) {
+            frameBuckets[i].fetch_add(1, std::memory_order_relaxed);
+            break;
+        }
+    }
+    frameCarryUs += frameUs;
+    frameSumMs.fetch_add(frameCarryUs / 1000, std::memory_order_relaxed);
+    frameCarryUs %= 1000;
+}
+
+void Metrics::countEffectTicks(int ticks, uint32_t dropped) {
+    effectFrames.fetch_add(1, std::memory_order_relaxed);
+    tickBuckets[ticks < METRICS_TICK_BUCKETS ? ticks : METRICS_TICK_BUCKETS - 1].fetch_add(
+        1, std::memory_order_relaxed);
+    effectTicks.fetch_add(ticks, std::memory_order_relaxed);
+    if (dropped > 0) {
+        droppedTicks.fetch_add(dropped, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::countMessagesAccepted(uint32_t count) {
+    messagesAccepted.fetch_add(count, std::memory_order_relaxed);
+}
+
+void Metrics::countRejected(MetricsRejectReason reason) {
+    if (reason < METRICS_REJECT_REASONS) {
+        rejected[reason].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::countWifiReconnect() {
+    wifiReconnects.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::countNtpSync(bool success) {
+    ntpSyncs[success ? 1 : 0].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Metrics::countOta(MetricsOtaEvent event) {
+    ota[event].fetch_add(1, std::memory_order_relaxed);
+}
+
+MetricsRejectReason Metrics::reasonFor(int status) {
+    for (int i = 0; i < METRICS_REJECT_REASONS; i++) {
+        if (REJECT_STATUS[i] == status) {
+            return (MetricsRejectReason)i;
+        }
+    }
+    return METRICS_REJECT_REASONS;
+}
+
+void Metrics::snapshot(MetricsCounts& counts) const {
+    for (int i = 0; i < METRICS_FRAME_BUCKETS; i++) {
+        counts.frameBuckets[i] = frameBuckets[i].load(std::memory_order_relaxed);
+    }
+    counts.frameSumMs = frameSumMs.load(std::memory_order_relaxed);
+    counts.frames = frames.load(std::memory_order_relaxed);
+    for (int i = 0; i < METRICS_TICK_BUCKETS; i++) {
+        counts.tickBuckets[i] = tickBuckets[i].load(std::memory_order_relaxed);
+    }
+    counts.effectTicks = effectTicks.load(std::memory_order_relaxed);
+    counts.effectFrames = effectFrames.load(std::memory_order_relaxed);
+    counts.droppedTicks = droppedTicks.load(std::memory_order_relaxed);
+    counts.messagesAccepted = messagesAccepted.load(std::memory_order_relaxed);
+    for (int i = 0; i < METRICS_REJECT_REASONS; i++) {
+        counts.rejected[i] = rejected[i].load(std::memory_order_relaxed);
+    }
+    counts.wifiReconnects = wifiReconnects.load(std::memory_order_relaxed);
+    for (int i = 0; i < 2; i++) {
+        counts.ntpSyncs[i] = ntpSyncs[i].load(std::memory_order_relaxed);
+    }
+    for (int i = 0; i < 3; i++) {
+        counts.ota[i] = ota[i].load(std::memory_order_relaxed);
+    }
+}
+
+MetricsWriter::MetricsWriter(const MetricsCounts& counts, const MetricsGauges& gauges)
+    : counts(counts), gauges(gauges), family(0), line(0) {}
+
+size_t MetricsWriter::write(uint8_t* buffer, size_t maxLength) {
+    char* out = (char*)buffer;
+    size_t used = 0;
+    while (family < FAMILY_COUNT) {
+        const MetricsFamily& info = FAMILIES[family];
+        char* at = out + used;
+        size_t room = maxLength - used;
+        int length;
+        if (line == 0) {
+            length = snprintf(at, room, "# HELP %s %s\n", info.name, info.help);
+        } else if (line == 1) {
+            length = snprintf(at, room, "# TYPE %s %s\n", info.name, info.type);
+        } else {
+            length = formatSample(family, line - 2, at, room);
+        }
+        // snprintf needs room for its terminator too; a cut line is written again next time
+        if (length < 0 || (size_t)length >= room) {
+            break;
+        }
+        used += length;
+        if (++line == info.samples + 2) {
+            family++;
+            line = 0;
+        }
+    }
+    return used;
+}
+
+bool MetricsWriter::isDone() const {
+    return family == FAMILY_COUNT;
+}
+
+int MetricsWriter::formatSample(int family, int sample, char* out, size_t size) const {
+    const char* name = FAMILIES[family].name;
+    switch (family) {
+        case FAMILY_FRAMES:
+            return snprintf(out, size, "%s %lu\n", name, (unsigned long)counts.frames);
+        case FAMILY_FRAME_TIME: {
+            if (sample < METRICS_FRAME_BUCKETS) {
+                uint32_t cumulative = 0;
+                for (int i = 0; i <= sample; i++) {
+                    cumulative += counts.frameBuckets[i];
+                }
+                return snprintf(out, size, "%s_bucket{le=\"%s\"} %lu\n", name,
+                                FRAME_BUCKET_LABELS[sample], (unsigned long)cumulative);
+            }
+            if (sample == METRICS_FRAME_BUCKETS) {
+                return snprintf(out, size, "%s_bucket{le=\"+Inf\"} %lu\n", name,
+                                (unsigned long)counts.frames);
+            }
+            if (sample == METRICS_FRAME_BUCKETS + 1) {
+                return snprintf(out, size, "%s_sum %lu.%03lu\n", name,
+                                (unsigned long)(counts.frameSumMs / 1000),
+                                (unsigned long)(counts.frameSumMs % 1000));
+            }
+            return snprintf(out, size, "%s_count %lu\n", name, (unsigned long)counts.frames);
+        }
+        case FAMILY_EFFECT_TICKS: {
+            if (sample < METRICS_TICK_BUCKETS) {
+                uint32_t cumulative = 0;
+                for (int i = 0; i <= sample; i++) {
+                    cumulative += counts.tickBuckets[i];
+                }
+                return snprintf(out, size, "%s_bucket{le=\"%s\"} %lu\n", name,
+                                TICK_BUCKET_LABELS[sample], (unsigned long)cumulative);
+            }
+            if (sample == METRICS_TICK_BUCKETS) {
+                return snprintf(out, size, "%s_bucket{le=\"+Inf\"} %lu\n", name,
+                                (unsigned long)counts.effectFrames);
+            }
+            if (sample == METRICS_TICK_BUCKETS + 1) {
+                return snprintf(out, size, "%s_sum %lu\n", name, (unsigned long)counts.effectTicks);
+            }
+            return snprintf(out, size, "%s_count %lu\n", name, (unsigned long)counts.effectFrames);
+        }
+        case FAMILY_EFFECT_TICKS_DROPPED:
+            return snprintf(out, size, "%s %lu\n", name, (unsigned long)counts.droppedTicks);
+        case FAMILY_MESSAGES_ACCEPTED:
+            return snprintf(out, size, "%s %lu\n", name, (unsigned long)counts.messagesAccepted);
+        case FAMILY_MESSAGES_REJECTED:
+            return snprintf(out, size, "%s{status=\"%d\"} %lu\n", name, REJECT_STATUS[sample],
+                            (unsigned long)counts.rejected[sample]);
+        case FAMILY_QUEUE_DEPTH:
+            return snprintf(out, size, "%s{priority=\"%s\"} %d\n", name,
+                            MessageQueue::getPriorityName((MessagePriority)sample),
+                            gauges.queueDepth[sample]);
+        case FAMILY_QUEUE_CAPACITY:
+            return snprintf(out, size, "%s %d\n", name, gauges.queueCapacity);
+        case FAMILY_SCHEDULED:
+            return snprintf(out, size, "%s %d\n", name, gauges.scheduled);
+        case FAMILY_HEAP_FREE:
+            return snprintf(out, size, "%s %lu\n", name, (unsigned long)gauges.heapFree);
+        case FAMILY_HEAP_MIN_FREE:
+            return snprintf(out, size, "%s %lu\n", name, (unsigned long)gauges.heapMinFree);
+        case FAMILY_HEAP_LARGEST_BLOCK:
+            return snprintf(out, size, "%s %lu\n", name, (unsigned long)gauges.heapLargestBlock);
+        case FAMILY_WIFI_RECONNECTS:
+            return snprintf(out, size, "%s %lu\n", name, (unsigned long)counts.wifiReconnects);
+        case FAMILY_NTP_SYNCS:
+            return snprintf(out, size, "%s{result=\"%s\"} %lu\n", name, NTP_RESULTS[sample],
+                            (unsigned long)counts.ntpSyncs[sample]);
+        default:
+            return snprintf(out, size, "%s{event=\"%s\"} %lu\n", name, OTA_EVENTS[sample],
+                            (unsigned long)counts.ota[sample]);
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+
+#include <atomic>
+
+#include "MessageQueue.h"
+
+// Counters for GET /metrics, in the Prometheus text format. They are bumped where things
+// happen, from the loop, the web server task or the WiFi callbacks, on either core, with
+// relaxed atomic increments (no lock). Values that already live elsewhere (queue depths, the
+// heap) are gauges read once per scrape into MetricsGauges.
+#define METRICS_FRAME_BUCKETS 8  // Frame time histogram buckets, +Inf not included
+#define METRICS_TICK_BUCKETS 5   // Effect ticks per frame: 0 to 4 (EFFECT_SIM_MAX_CATCHUP)
+
+// Why a POST /messages was answered with an error
+enum MetricsRejectReason : uint8_t {
+    METRICS_REJECT_INVALID,       // 400: malformed JSON, no text
+    METRICS_REJECT_UNAUTHORIZED,  // 401
+    METRICS_REJECT_TOO_LONG,      // 413
+    METRICS_REJECT_RATE_LIMITED,  // 429
+    METRICS_REJECT_QUEUE_FULL,    // 503
+    METRICS_REJECT_LOW_MEMORY,    // 507
+    METRICS_REJECT_REASONS
+};
+
+enum MetricsOtaEvent : uint8_t { METRICS_OTA_STARTED, METRICS_OTA_SUCCEEDED, METRICS_OTA_FAILED };
+
+// Counter values at the start of a scrape, so the lines of one scrape agree with each other
+struct MetricsCounts {
+    uint32_t frames;
+    uint32_t frameBuckets[METRICS_FRAME_BUCKETS];  // Not cumulative
+    uint32_t frameSumMs;
+    uint32_t effectFrames;
+    uint32_t tickBuckets[METRICS_TICK_BUCKETS];  // Not cumulative
+    uint32_t effectTicks;
+    uint32_t droppedTicks;
+    uint32_t messagesAccepted;
+    uint32_t rejected[METRICS_REJECT_REASONS];
+    uint32_t wifiReconnects;
+    uint32_t ntpSyncs[2];  // Failed, succeeded
+    uint32_t ota[3];       // By MetricsOtaEvent
+};
+
+// Read by the server task right before a scrape is written
+struct MetricsGauges {
+    int queueDepth[MESSAGE_PRIORITY_COUNT];
+    int queueCapacity;
+    int scheduled;
+    uint32_t heapFree;
+    uint32_t heapMinFree;  // Lowest since boot
+    uint32_t heapLargestBlock;
+};
+
+class Metrics {
+   public:
+    Metrics();
+
+    // One show(); frameUs is the time since the previous one. Loop task only, as the
+    // histogram sum carries the microseconds below a millisecond over to the next frame.
+    void countFrame(uint32_t frameUs);
+    // One effects frame: simulation ticks run before it, and ticks skipped to catch up
+    void countEffectTicks(int ticks, uint32_t dropped);
+    // Any task
+    void countMessagesAccepted(uint32_t count);
+    void countRejected(MetricsRejectReason reason);
+    void countWifiReconnect();
+    void countNtpSync(bool success);
+    void countOta(MetricsOtaEvent event);
+
+    // Status code of a rejected POST /messages; METRICS_REJECT_REASONS if it is not counted
+    static MetricsRejectReason reasonFor(int status);
+
+    void snapshot(MetricsCounts& counts) const;
+
+   private:
+    std::atomic<uint32_t> frames;
+    std::atomic<uint32_t> frameBuckets[METRICS_FRAME_BUCKETS];
+    std::atomic<uint32_t> frameSumMs;  // Wraps after 49 days, which scrapers take as a reset
+    uint32_t frameCarryUs;
+    std::atomic<uint32_t> effectFrames;
+    std::atomic<uint32_t> tickBuckets[METRICS_TICK_BUCKETS];
+    std::atomic<uint32_t> effectTicks;
+    std::atomic<uint32_t> droppedTicks;
+    std::atomic<uint32_t> messagesAccepted;
+    std::atomic<uint32_t> rejected[METRICS_REJECT_REASONS];
+    std::atomic<uint32_t> wifiReconnects;
+    std::atomic<uint32_t> ntpSyncs[2];
+    std::atomic<uint32_t> ota[3];
+};
+
+// Writes one scrape a line at a time into whatever buffer the server hands over, so the text
+// goes out in pieces and is never built up in memory. Lines that do not fit wait for the next
+// buffer.
+class MetricsWriter {
+   public:
+    MetricsWriter(const MetricsCounts& counts, const MetricsGauges& gauges);
+
+    // Bytes written, whole lines only; 0 once everything has been, or if the next line does
+    // not fit in maxLength
+    size_t write(uint8_t* buffer, size_t maxLength);
+    bool isDone() const;
+
+   private:
+    MetricsCounts counts;
+    MetricsGauges gauges;
+    int family;  // Being written
+    int line;    // Within the family: HELP, TYPE, then the samples
+
+    int formatSample(int family, int sample, char* out, size_t size) const;
+};
+
+#endif  // METRICS_H
@@ -0,0 +1,398 @@
+#include "PixelStream.h"
+
+#include "Log.h"
+
+// Both protocols put network byte order on the wire
+static uint16_t get16(const uint8_t* in) {
+    return (in[0] << 8) | in[1];
+}
+
+static uint32_t get32(const uint8_t* in) {
+    return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3];
+}
+
+// DDP header
+#define DDP_HEADER_SIZE 10
+#define DDP_TIMECODE_SIZE 4
+#define DDP_FLAG_VERSION_MASK 0xC0
+#define DDP_FLAG_VERSION_1 0x40
+#define DDP_FLAG_TIMECODE 0x10
+#define DDP_FLAG_NOT_DATA 0x0E  // Storage, reply and query
+#define DDP_FLAG_PUSH 0x01
+#define DDP_TYPE_CUSTOM 0x80  // Customer-defined data type: a compressed frame
+#define DDP_ID_DISPLAY 1  // The default output device; 0 is reserved but sent by some
+
+// sACN (ANSI E1.31) data packet offsets
+#define E131_ROOT_VECTOR 18
+#define E131_FRAMING_VECTOR 40
+#define E131_SYNC_ADDRESS 109
+#define E131_SEQUENCE 111
+#define E131_OPTIONS 112
+#define E131_UNIVERSE 113
+#define E131_DMP_VECTOR 117
+#define E131_ADDRESS_TYPE 118
+#define E131_PROPERTY_COUNT 123
+#define E131_START_CODE 125
+#define E131_DATA 126
+#define E131_OPTION_PREVIEW 0x80
+#define E131_VECTOR_ROOT_DATA 0x04
+#define E131_VECTOR_ROOT_EXTENDED 0x08
+#define E131_VECTOR_DATA 0x02
+#define E131_VECTOR_EXTENDED_SYNC 0x01
+#define E131_SYNC_SIZE 49
+#define E131_LATE_WINDOW 20  // E1.31 6.7.2: up to this far behind is an out-of-order packet
+#define E131_ALL_UNIVERSES ((1UL << PIXEL_STREAM_E131_UNIVERSES) - 1)
+
+static_assert(PIXEL_STREAM_E131_UNIVERSES <= 32, "sACN universes are tracked in 32-bit masks");
+static_assert(PIXEL_STREAM_BUFFER_BYTES >= PIXEL_STREAM_PIXELS * 2,
+              "A frame buffer holds a raw frame as RGB565");
+
+static const uint8_t E131_PACKET_ID[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', 0, 0, 0};
+
+// Writes RGB888 bytes that start at byte offset of a frame into its RGB565 pixels. A packet
+// may start or end inside a pixel, so a byte on its own replaces only its own channel.
+static void storeRgb(uint16_t* pixels, size_t offset, const uint8_t* in, size_t count) {
+    static const uint16_t masks[3] = {0xF800, 0x07E0, 0x001F};
+    static const uint8_t drops[3] = {3, 2, 3};
+    static const uint8_t shifts[3] = {11, 5, 0};
+    uint16_t* pixel = pixels + offset / 3;
+    int channel = offset % 3;
+    const uint8_t* end = in + count;
+    while (in < end) {
+        if (channel == 0 && end - in >= 3) {
+            *pixel++ = ((in[0] >> 3) << 11) | ((in[1] >> 2) << 5) | (in[2] >> 3);
+            in += 3;
+            continue;
+        }
+        *pixel = (*pixel & ~masks[channel]) | ((*in++ >> drops[channel]) << shifts[channel]);
+        if (++channel == 3) {
+            channel = 0;
+            pixel++;
+        }
+    }
+}
+
+PixelStream::PixelStream(MatrixDisplayManager* display, SettingsManager* settings)
+    : display(display),
+      settings(settings),
+      started(false),
+      assembling(buffers[0]),
+      ready(buffers[1]),
+      converting(buffers[2]),
+      frameReady(false),
+      readyNumber(0),
+      readyComplete(false),
+      readyEncoded(false),
+      readyLength(0),
+      assemblingEncoded(false),
+      assemblingLength(0),
+      lock(portMUX_INITIALIZER_UNLOCKED),
+      stats{},
+      protocol(""),
+      lastFrameMs(0),
+      lastTakenMs(0),
+      lastTakenNumber(0),
+      codecFrame{},
+      codecReference(false),
+      fpsWindowMs(0),
+      fpsWindowShown(0),
+      fps(0),
+      ddpSequence(0),
+      ddpPending(false),
+      ddpGap(false),
+      e131Sequence{},
+      e131Known(0),
+      e131Received(0),
+      e131SyncUniverse(0),
+      lutBrightnessIndex(-1) {}
+
+void PixelStream::loop() {
+    if (started || !WiFi.isConnected()) {
+        return;
+    }
+    started = true;
+
+    ddpUdp.onPacket(
+        [this](AsyncUDPPacket& packet) { handleDdp(packet.data(), packet.length()); });
+    e131Udp.onPacket(
+        [this](AsyncUDPPacket& packet) { handleE131(packet.data(), packet.length()); });
+    if (!ddpUdp.listen(PIXEL_STREAM_DDP_PORT)) {
+        LOG_ERROR("PixelStream: cannot listen for DDP");
+    }
+    if (!e131Udp.listen(PIXEL_STREAM_E131_PORT)) {
+        LOG_ERROR("PixelStream: cannot listen for sACN");
+    }
+    LOG_INFO("PixelStream: DDP on %d, sACN on %d", PIXEL_STREAM_DDP_PORT, PIXEL_STREAM_E131_PORT);
+}
+
+bool PixelStream::isStreaming() const {
+    unsigned long last = lastFrameMs;
+    return last != 0 && millis() - last < PIXEL_STREAM_IDLE_MS;
+}
+
+uint32_t PixelStream::getFps() const {
+    return isStreaming() ? fps : 0;
+}
+
+void PixelStream::handleDdp(const uint8_t* data, size_t length) {
+    stats.packets++;
+    if (length < DDP_HEADER_SIZE) {
+        stats.badPackets++;
+        return;
+    }
+    uint8_t flags = data[0];
+    if ((flags & DDP_FLAG_VERSION_MASK) != DDP_FLAG_VERSION_1 || (flags & DDP_FLAG_NOT_DATA) ||
+        data[3] > DDP_ID_DISPLAY) {
+        stats.badPackets++;
+        return;
+    }
+    size_t header = DDP_HEADER_SIZE + ((flags & DDP_FLAG_TIMECODE) ? DDP_TIMECODE_SIZE : 0);
+    uint32_t offset = get32(data + 4);
+    size_t dataLength = get16(data + 8);
+    if (length < header + dataLength) {
+        stats.badPackets++;
+        return;
+    }
+
+    // Sequence numbers run 1..15; 0 means the sender does not number its packets
+    uint8_t sequence = data[1] & 0x0F;
+    if (!isStreaming()) {
+        ddpSequence = 0;  // A sender that comes back may start anywhere
+    }
+    if (sequence != 0 && ddpSequence != 0) {
+        int ahead = (sequence - ddpSequence + 15) % 15;
+        if (ahead == 0 || ahead > 7) {
+            stats.latePackets++;
+            return;
+        }
+        if (ahead > 1) {
+            stats.lostPackets += ahead - 1;
+            ddpGap = true;
+        }
+    }
+    if (sequence != 0) {
+        ddpSequence = sequence;
+    }
+
+    if (dataLength > 0) {
+        // Data for the start of the panel before a push: the last frame's push went missing
+        if (offset == 0 && ddpPending) {
+            completeFrame(false, "ddp");
+        }
+        // A compressed frame is kept as sent, a raw one as RGB565
+        bool encoded = data[2] & DDP_TYPE_CUSTOM;
+        size_t limit = encoded ? PIXEL_STREAM_BUFFER_BYTES : PIXEL_STREAM_FRAME_BYTES;
+        if (offset < limit) {
+            size_t count = min(dataLength, (size_t)(limit - offset));
+            if (encoded) {
+                memcpy((uint8_t*)assembling + offset, data + header, count);
+            } else {
+                storeRgb(assembling, offset, data + header, count);
+            }
+        }
+        ddpPending = true;
+        assemblingEncoded = encoded;
+        assemblingLength = max(assemblingLength, (size_t)offset + dataLength);
+    }
+    if (flags & DDP_FLAG_PUSH) {
+        completeFrame(!ddpGap, "ddp");
+    }
+}
+
+void PixelStream::handleE131(const uint8_t* data, size_t length) {
+    stats.packets++;
+    if (length < E131_FRAMING_VECTOR + 4 || memcmp(data + 4, E131_PACKET_ID, 12) != 0) {
+        stats.badPackets++;
+        return;
+    }
+    uint32_t rootVector = get32(data + E131_ROOT_VECTOR);
+    if (rootVector == E131_VECTOR_ROOT_EXTENDED) {
+        handleE131Sync(data, length);
+        return;
+    }
+    if (rootVector != E131_VECTOR_ROOT_DATA || length < E131_DATA ||
+        get32(data + E131_FRAMING_VECTOR) != E131_VECTOR_DATA || data[E131_DMP_VECTOR] != 0x02 ||
+        data[E131_ADDRESS_TYPE] != 0xA1) {
+        stats.badPackets++;
+        return;
+    }
+    size_t properties = get16(data + E131_PROPERTY_COUNT);
+    if (properties == 0 || properties > 513 || length < E131_DATA - 1 + properties) {
+        stats.badPackets++;
+        return;
+    }
+
+    // Preview data, other start codes (RDM, priorities) and other fixtures' universes are
+    // valid but not for this panel
+    int index = (int)get16(data + E131_UNIVERSE) - PIXEL_STREAM_E131_UNIVERSE;
+    if ((data[E131_OPTIONS] & E131_OPTION_PREVIEW) || data[E131_START_CODE] != 0 || index < 0 ||
+        index >= PIXEL_STREAM_E131_UNIVERSES) {
+        return;
+    }
+
+    uint32_t bit = 1UL << index;
+    uint8_t sequence = data[E131_SEQUENCE];
+    if (!isStreaming()) {
+        e131Known = 0;
+    }
+    if (e131Known & bit) {
+        int ahead = (int8_t)(sequence - e131Sequence[index]);
+        if (ahead <= 0 && ahead > -E131_LATE_WINDOW) {
+            stats.latePackets++;
+            return;
+        }
+        if (ahead > 1) {
+            stats.lostPackets += ahead - 1;
+        }
+    }
+    e131Known |= bit;
+    e131Sequence[index] = sequence;
+
+    // A universe this frame already has: the last universe or the sync went missing
+    if (e131Received & bit) {
+        completeFrame(false, "sacn");
+    }
+    size_t offset = (size_t)index * PIXEL_STREAM_E131_PIXELS * 3;
+    size_t count = min(properties - 1, (size_t)PIXEL_STREAM_E131_PIXELS * 3);
+    count = min(count, (size_t)(PIXEL_STREAM_FRAME_BYTES - offset));
+    storeRgb(assembling, offset, data + E131_DATA, count);
+    e131Received |= bit;
+
+    if (index == PIXEL_STREAM_E131_UNIVERSES - 1) {
+        uint16_t syncUniverse = get16(data + E131_SYNC_ADDRESS);
+        if (syncUniverse != 0) {
+            e131SyncUniverse = syncUniverse;
+        } else {
+            completeFrame(e131Received == E131_ALL_UNIVERSES, "sacn");
+        }
+    }
+}
+
+void PixelStream::handleE131Sync(const uint8_t* data, size_t length) {
+    // Discovery packets share the root vector; only sync packets matter here
+    if (length < E131_SYNC_SIZE ||
+        get32(data + E131_FRAMING_VECTOR) != E131_VECTOR_EXTENDED_SYNC) {
+        return;
+    }
+    if (e131SyncUniverse != 0 && get16(data + 45) == e131SyncUniverse) {
+        completeFrame(e131Received == E131_ALL_UNIVERSES, "sacn");
+    }
+}
+
+void PixelStream::completeFrame(bool complete, const char* source) {
+    // A compressed frame too large for the buffer lost its end
+    if (assemblingEncoded && assemblingLength > PIXEL_STREAM_BUFFER_BYTES) {
+        complete = false;
+    }
+    stats.frames++;
+    if (!complete) {
+        stats.incomplete++;
+    }
+
+    portENTER_CRITICAL(&lock);
+    uint16_t* done = assembling;
+    assembling = ready;
+    ready = done;
+    frameReady = true;
+    readyNumber = stats.frames;
+    readyComplete = complete;
+    readyEncoded = assemblingEncoded;
+    readyLength = assemblingLength;
+    portEXIT_CRITICAL(&lock);
+    assemblingEncoded = false;
+    assemblingLength = 0;
+
+    protocol = source;
+    lastFrameMs = millis();
+    if (lastFrameMs == 0) {
+        lastFrameMs = 1;  // 0 means never
+    }
+    ddpPending = false;
+    ddpGap = false;
+    e131Received = 0;
+    e131SyncUniverse = 0;
+}
+
+bool PixelStream::present() {
+    uint32_t number = 0;
+    bool complete = false;
+    bool encoded = false;
+    size_t length = 0;
+    portENTER_CRITICAL(&lock);
+    bool available = frameReady;
+    if (available) {
+        uint16_t* next = ready;
+        ready = converting;
+        converting = next;
+        frameReady = false;
+        number = readyNumber;
+        complete = readyComplete;
+        encoded = readyEncoded;
+        length = readyLength;
+    }
+    portEXIT_CRITICAL(&lock);
+    if (!available) {
+        return false;
+    }
+
+    // Frames completed since the last one taken never made it to the panel
+    unsigned long now = millis();
+    bool follows = number == lastTakenNumber + 1;
+    if (lastTakenMs != 0 && now - lastTakenMs < PIXEL_STREAM_IDLE_MS) {
+        stats.dropped += number - lastTakenNumber - 1;
+    }
+    lastTakenNumber = number;
+    lastTakenMs = now;
+
+    const uint16_t* in = converting;
+    if (encoded) {
+        // A delta needs codecFrame to hold the frame right before it
+        const uint8_t* data = (const uint8_t*)converting;
+        bool delta = length > 3 && (data[3] & FRAME_CODEC_DELTA);
+        if (!complete || (delta && !(codecReference && follows)) ||
+            !FrameCodec::decode(data, length, codecFrame, MATRIX_WIDTH, MATRIX_HEIGHT)) {
+            stats.skipped++;
+            codecReference = false;  // Until the next key frame
+            return false;
+        }
+        codecReference = true;
+        in = codecFrame;
+    } else {
+        codecReference = false;
+    }
+
+    // Brightness goes in here, so the frames themselves stay as sent
+    updateLut();
+    uint16_t* out = display->getFrameBuffer();
+    for (int i = 0; i < PIXEL_STREAM_PIXELS; i++) {
+        uint16_t color = in[i];
+        out[i] = lut565R[color >> 11] | lut565G[(color >> 5) & 0x3F] | lut565B[color & 0x1F];
+    }
+    display->show();
+    stats.shown++;
+
+    if (now - fpsWindowMs >= 1000) {
+        fps = (stats.shown - fpsWindowShown) * 1000 / (now - fpsWindowMs);
+        fpsWindowMs = now;
+        fpsWindowShown = stats.shown;
+    }
+    return true;
+}
+
+void PixelStream::updateLut() {
+    int index = settings->getBrightnessIndex();
+    if (index == lutBrightnessIndex) {
+        return;
+    }
+    lutBrightnessIndex = index;
+
+    // Each channel scaled once per level instead of once per pixel
+    float brightness = display->getBrightnessLevels()[index];
+    for (int v = 0; v < 32; v++) {
+        lut565R[v] = (uint16_t)(v * brightness) << 11;
+        lut565B[v] = (uint16_t)(v * brightness);
+    }
+    for (int v = 0; v < 64; v++) {
+        lut565G[v] = (uint16_t)(v * brightness) << 5;
+    }
+}
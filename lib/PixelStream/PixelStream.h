@@ -0,0 +1,141 @@
+#ifndef PIXEL_STREAM_H
+#define PIXEL_STREAM_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+#include <WiFi.h>
+
+#include "FrameCodec.h"
+#include "MatrixDisplayManager.h"
+#include "SettingsManager.h"
+
+// Network video sink: raw RGB frames from lighting and video software (xLights, WLED,
+// Resolume, ...) over DDP or sACN (E1.31), shown in the SHOW_PIXEL_STREAM state.
+//
+// Packets are handled on the AsyncUDP task as they arrive and written at their offset into a
+// preallocated RGB565 frame, so a long loop pass does not lose them. A DDP packet with the
+// push flag, or the last universe of an sACN frame, completes the frame. The loop then
+// copies the newest complete frame straight into the Protomatter buffer through lookup
+// tables that include the brightness, and swaps it onto the panel.
+//
+// Pixels run in rows, left to right and top to bottom, 3 bytes each (R, G, B).
+// DDP: any offsets and packet sizes, push flag on the last packet of a frame. With the
+// customer-defined bit (0x80) set in the data type, the data is a compressed frame
+// (FrameCodec.h) instead. It is decoded onto the previous compressed frame, kept unscaled,
+// and copied to the panel through the brightness tables like a raw frame.
+// sACN: unicast only, 170 pixels per universe from PIXEL_STREAM_E131_UNIVERSE on, DMX start
+// code 0. Frames announced with a sync address are shown on the sync packet.
+#define PIXEL_STREAM_DDP_PORT 4048
+#define PIXEL_STREAM_E131_PORT 5568
+#ifndef PIXEL_STREAM_E131_UNIVERSE
+#define PIXEL_STREAM_E131_UNIVERSE 1
+#endif
+#ifndef PIXEL_STREAM_AUTO_SWITCH
+#define PIXEL_STREAM_AUTO_SWITCH true  // A clock face switches to a stream when one starts
+#endif
+#define PIXEL_STREAM_IDLE_MS 2000UL  // No frame this long ends the stream
+#define PIXEL_STREAM_PIXELS (MATRIX_WIDTH * MATRIX_HEIGHT)
+#define PIXEL_STREAM_FRAME_BYTES (PIXEL_STREAM_PIXELS * 3)  // RGB888 on the wire
+// A frame buffer holds either a raw frame as RGB565 or a compressed frame as sent
+#define PIXEL_STREAM_BUFFER_BYTES FRAME_CODEC_MAX_BYTES(MATRIX_WIDTH, MATRIX_HEIGHT)
+#define PIXEL_STREAM_E131_PIXELS 170  // 510 of the 512 channels of a universe
+#define PIXEL_STREAM_E131_UNIVERSES \
+    ((PIXEL_STREAM_PIXELS + PIXEL_STREAM_E131_PIXELS - 1) / PIXEL_STREAM_E131_PIXELS)
+
+// Counters since boot
+struct PixelStreamStats {
+    uint32_t packets;
+    uint32_t badPackets;   // Malformed or unsupported
+    uint32_t lostPackets;  // Sequence gaps
+    uint32_t latePackets;  // Older than one already received; ignored
+    uint32_t frames;       // Completed
+    uint32_t incomplete;   // Completed with data missing; those parts hold an older frame
+    uint32_t shown;
+    uint32_t dropped;  // Completed during a stream but replaced before the loop showed them
+    uint32_t skipped;  // Compressed: incomplete, corrupt, or a delta without its base shown
+};
+
+class PixelStream {
+   public:
+    PixelStream(MatrixDisplayManager* display, SettingsManager* settings);
+
+    // Starts listening once WiFi is up
+    void loop();
+
+    // A frame completed within the last PIXEL_STREAM_IDLE_MS
+    bool isStreaming() const;
+    // Shows the newest complete frame; false if there is none the panel has not shown yet.
+    // Between frames the panel keeps the last one.
+    bool present();
+
+    // Packet handlers; both run on the AsyncUDP task
+    void handleDdp(const uint8_t* data, size_t length);
+    void handleE131(const uint8_t* data, size_t length);
+
+    const PixelStreamStats& getStats() const {
+        return stats;
+    }
+    uint32_t getFps() const;  // Frames shown per second, 0 when not streaming
+    // Protocol of the last completed frame: "ddp", "sacn" or "" before the first
+    const char* getProtocol() const {
+        return protocol;
+    }
+
+   private:
+    MatrixDisplayManager* display;
+    SettingsManager* settings;
+    AsyncUDP ddpUdp;
+    AsyncUDP e131Udp;
+    bool started;
+
+    // Triple buffered, so the AsyncUDP task never waits for the loop or the other way round:
+    // packets fill assembling, a complete frame becomes ready, and the loop converts from its
+    // own buffer while the next frame comes in. Only the pointer swaps are locked.
+    uint16_t buffers[3][(PIXEL_STREAM_BUFFER_BYTES + 1) / 2];
+    uint16_t* assembling;
+    uint16_t* ready;
+    uint16_t* converting;
+    bool frameReady;
+    uint32_t readyNumber;  // Frame count when ready was completed
+    bool readyComplete;
+    bool readyEncoded;
+    size_t readyLength;  // Bytes of a compressed frame
+    bool assemblingEncoded;
+    size_t assemblingLength;
+    portMUX_TYPE lock;
+
+    PixelStreamStats stats;
+    const char* protocol;
+    volatile unsigned long lastFrameMs;
+    unsigned long lastTakenMs;
+    uint32_t lastTakenNumber;
+    // Last compressed frame as sent, without the brightness; the next delta applies to it
+    uint16_t codecFrame[PIXEL_STREAM_PIXELS];
+    bool codecReference;  // codecFrame holds the frame right before the next one
+    unsigned long fpsWindowMs;
+    uint32_t fpsWindowShown;
+    uint32_t fps;
+
+    // DDP: 4-bit sequence (0 when the sender does not number packets)
+    uint8_t ddpSequence;
+    bool ddpPending;  // Data received since the last push
+    bool ddpGap;
+
+    // sACN: 8-bit sequence per universe
+    uint8_t e131Sequence[PIXEL_STREAM_E131_UNIVERSES];
+    uint32_t e131Known;     // Universes with a sequence to compare against
+    uint32_t e131Received;  // Universes of the frame being assembled
+    uint16_t e131SyncUniverse;  // Non-zero while the frame waits for a sync packet
+
+    // RGB565 channels with the brightness folded in; rebuilt when the brightness changes
+    uint16_t lut565R[32];
+    uint16_t lut565G[64];
+    uint16_t lut565B[32];
+    int lutBrightnessIndex;
+
+    void completeFrame(bool complete, const char* source);
+    void handleE131Sync(const uint8_t* data, size_t length);
+    void updateLut();
+};
+
+#endif  // PIXEL_STREAM_H
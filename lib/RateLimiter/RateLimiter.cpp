@@ -0,0 +1,77 @@
+#include "RateLimiter.h"
+
+#include <limits.h>
+
+RateLimiter::RateLimiter(uint16_t ratePerSecond, uint16_t burst)
+    : ratePerSecond(ratePerSecond), burst(burst), clients{} {}
+
+bool RateLimiter::check(uint32_t ip, unsigned long nowMs) {
+    return lookup(ip, nowMs).milliTokens >= 1000;
+}
+
+bool RateLimiter::take(uint32_t ip, unsigned long nowMs) {
+    RateLimitClient& client = lookup(ip, nowMs);
+    if (client.milliTokens < 1000) {
+        client.limited++;
+        return false;
+    }
+    client.milliTokens -= 1000;
+    client.allowed++;
+    return true;
+}
+
+uint32_t RateLimiter::getRetryAfter(uint32_t ip, unsigned long nowMs) {
+    RateLimitClient& client = lookup(ip, nowMs);
+    if (client.milliTokens >= 1000 || ratePerSecond == 0) {
+        return 1;
+    }
+    // ratePerSecond tokens per second is ratePerSecond milli-tokens per ms
+    uint32_t waitMs = (1000 - client.milliTokens + ratePerSecond - 1) / ratePerSecond;
+    return (waitMs + 999) / 1000;
+}
+
+RateLimitClient& RateLimiter::lookup(uint32_t ip, unsigned long nowMs) {
+    int oldest = 0;
+    unsigned long oldestIdle = 0;
+    for (int i = 0; i < RATE_LIMIT_CLIENTS; i++) {
+        if (clients[i].ip == ip) {
+            clients[i].lastSeenMs = nowMs;
+            refill(clients[i], nowMs);
+            return clients[i];
+        }
+        // Free entries go first, then the one idle the longest
+        unsigned long idle = clients[i].ip == 0 ? ULONG_MAX : nowMs - clients[i].lastSeenMs;
+        if (idle > oldestIdle) {
+            oldest = i;
+            oldestIdle = idle;
+        }
+    }
+
+    RateLimitClient& client = clients[oldest];
+    client.ip = ip;
+    client.milliTokens = (uint32_t)burst * 1000;
+    client.lastRefillMs = nowMs;
+    client.lastSeenMs = nowMs;
+    client.allowed = 0;
+    client.limited = 0;
+    return client;
+}
+
+void RateLimiter::refill(RateLimitClient& client, unsigned long nowMs) {
+    uint32_t cap = (uint32_t)burst * 1000;
+    unsigned long elapsed = nowMs - client.lastRefillMs;
+    client.lastRefillMs = nowMs;
+
+    if (ratePerSecond == 0) {
+        return;
+    }
+    // A long idle client is simply full; avoids overflowing the product below
+    if (elapsed >= cap / ratePerSecond) {
+        client.milliTokens = cap;
+        return;
+    }
+    client.milliTokens += elapsed * ratePerSecond;
+    if (client.milliTokens > cap) {
+        client.milliTokens = cap;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <Arduino.h>
+
+// Token buckets per client IP, held in a fixed table. When the table is full the client seen
+// least recently is evicted, so a new or evicted client starts with a full burst. Tokens are
+// kept in thousandths so refill needs no floating point.
+#define RATE_LIMIT_CLIENTS 16  // Clients tracked at once
+
+struct RateLimitClient {
+    uint32_t ip;  // 0 when the entry is free
+    uint32_t milliTokens;
+    unsigned long lastRefillMs;
+    unsigned long lastSeenMs;  // For LRU eviction
+    uint32_t allowed;          // Messages let through since the client was added
+    uint32_t limited;          // Messages refused
+};
+
+class RateLimiter {
+   public:
+    // ratePerSecond tokens are added each second, up to burst
+    RateLimiter(uint16_t ratePerSecond, uint16_t burst);
+
+    // True if the client has at least one token, without taking it
+    bool check(uint32_t ip, unsigned long nowMs);
+
+    // Takes one token for one message; counts the message as allowed or limited
+    bool take(uint32_t ip, unsigned long nowMs);
+
+    // Seconds until the client has a token again (at least 1)
+    uint32_t getRetryAfter(uint32_t ip, unsigned long nowMs);
+
+    uint16_t getRate() const {
+        return ratePerSecond;
+    }
+    uint16_t getBurst() const {
+        return burst;
+    }
+    // Entries with ip == 0 are unused
+    const RateLimitClient& getClient(int index) const {
+        return clients[index];
+    }
+
+   private:
+    uint16_t ratePerSecond;
+    uint16_t burst;
+    RateLimitClient clients[RATE_LIMIT_CLIENTS];
+
+    RateLimitClient& lookup(uint32_t ip, unsigned long nowMs);
+    void refill(RateLimitClient& client, unsigned long nowMs);
+};
+
+#endif  // RATE_LIMITER_H
@@ -1,5 +1,7 @@
 #include "SettingsManager.h"
 
+#include "Log.h"
+
 // Try to include local OTA config, use default if not available
 #if __has_include("../../credentials/ota_config.h")
 #include "../../credentials/ota_config.h"
@@ -24,6 +26,9 @@ SettingsManager::SettingsManager() {
     wifiEnabled = false;
     strcpy(wifiSSID, "");
     strcpy(wifiPassword, "");
+    strcpy(pollUrl, "");
+    wallTileIndex = 0;
+    wallTileCount = 1;
 
     // OTA defaults - always use static password
     strcpy(otaPassword, OTA_STATIC_PASSWORD);
@@ -82,6 +87,18 @@ void SettingsManager::setWiFiCredentials(const char* ssid, const char* password)
     wifiEnabled = (strlen(ssid) > 0);
 }
 
+void SettingsManager::setPollUrl(const char* url) {
+    strncpy(pollUrl, url, sizeof(pollUrl) - 1);
+    pollUrl[sizeof(pollUrl) - 1] = '\0';
+}
+
+void SettingsManager::setWallLayout(int tileIndex, int tileCount) {
+    if (isValidWallLayout(tileIndex, tileCount)) {
+        wallTileIndex = tileIndex;
+        wallTileCount = tileCount;
+    }
+}
+
 void SettingsManager::saveSettings() {
     EEPROM.write(EEPROM_ADDR_MAGIC, EEPROM_MAGIC);
     EEPROM.write(EEPROM_ADDR_TEXT_SIZE, textSize);
@@ -105,19 +122,20 @@ void SettingsManager::saveSettings() {
         EEPROM.write(EEPROM_ADDR_WIFI_PASSWORD + i, wifiPassword[i]);
     }
 
+    // Save poll URL
+    for (int i = 0; i < POLL_URL_SIZE; i++) {
+        EEPROM.write(EEPROM_ADDR_POLL_URL + i, pollUrl[i]);
+    }
+    EEPROM.write(EEPROM_ADDR_WALL_TILE_INDEX, (uint8_t)wallTileIndex);
+    EEPROM.write(EEPROM_ADDR_WALL_TILE_COUNT, (uint8_t)wallTileCount);
+
     EEPROM.commit();
 
-    Serial.println("Settings saved to EEPROM");
-    Serial.print("Text Size: ");
-    Serial.println(textSize);
-    Serial.print("Brightness: ");
-    Serial.println(brightnessIndex + 1);
-    Serial.print("Effect Mode: ");
-    Serial.println((int)effectMode);
-    Serial.print("Time Format: ");
-    Serial.println(use24HourFormat ? "24H" : "12H");
-    Serial.print("Clock Color: ");
-    Serial.println((int)clockColorMode);
+    LOG_INFO("Settings saved to EEPROM");
+    LOG_DEBUG("Text Size: %d, Brightness: %d, Effect Mode: %d", textSize, brightnessIndex + 1,
+              (int)effectMode);
+    LOG_DEBUG("Time Format: %s, Clock Color: %d", use24HourFormat ? "24H" : "12H",
+              (int)clockColorMode);
 }
 
 void SettingsManager::loadSettings() {
@@ -174,6 +192,19 @@ void SettingsManager::loadSettings() {
         }
         wifiPassword[63] = '\0';  // Ensure null termination
 
+        // Load poll URL; bytes never written (older layouts) read as 0xFF and mean no URL
+        for (int i = 0; i < POLL_URL_SIZE; i++) {
+            pollUrl[i] = EEPROM.read(EEPROM_ADDR_POLL_URL + i);
+        }
+        pollUrl[POLL_URL_SIZE - 1] = '\0';
+        if (strncmp(pollUrl, "http://", 7) != 0) {
+            pollUrl[0] = '\0';
+        }
+
+        // Unwritten bytes (0xFF) fail validation and leave a standalone clock
+        setWallLayout(EEPROM.read(EEPROM_ADDR_WALL_TILE_INDEX),
+                      EEPROM.read(EEPROM_ADDR_WALL_TILE_COUNT));
+
         // Initialize OTA password - always use static password
         strcpy(otaPassword, OTA_STATIC_PASSWORD);
 
@@ -195,7 +226,7 @@ bool SettingsManager::isValidBrightnessIndex(int index) const {
 }
 
 bool SettingsManager::isValidEffectMode(int mode) const {
-    return (mode >= 0 && mode <= EFFECT_OFF);
+    return (mode >= 0 && mode <= EFFECT_ANIMATION);
 }
 
 bool SettingsManager::isValidClockColorMode(int mode) const {
@@ -205,3 +236,8 @@ bool SettingsManager::isValidClockColorMode(int mode) const {
 bool SettingsManager::isValidMessageScrollSpeed(int speed) const {
     return (speed >= MSG_SCROLL_SLOW && speed <= MSG_SCROLL_FAST);
 }
+
+bool SettingsManager::isValidWallLayout(int tileIndex, int tileCount) const {
+    return (tileCount >= 1 && tileCount <= WALL_TILES_MAX && tileIndex >= 0 &&
+            tileIndex < tileCount);
+}
@@ -5,7 +5,7 @@
 #include <EEPROM.h>
 
 // EEPROM Settings
-#define EEPROM_SIZE 128                       // Increased size for WiFi settings
+#define EEPROM_SIZE 256                       // Increased size for WiFi and poll settings
 #define EEPROM_MAGIC 0x42                     // Magic number to verify valid data
 #define EEPROM_ADDR_MAGIC 0                   // Address for magic number
 #define EEPROM_ADDR_TEXT_SIZE 1               // Address for text size
@@ -18,12 +18,18 @@
 #define EEPROM_ADDR_WIFI_PASSWORD 39          // Address for WiFi password (64 bytes)
 #define EEPROM_ADDR_TIMEZONE_INDEX 103        // Address for timezone index (1 byte)
 #define EEPROM_ADDR_MESSAGE_SCROLL_SPEED 104  // Address for message scroll speed (1 byte)
+#define EEPROM_ADDR_POLL_URL 105              // Address for message poll URL (128 bytes)
+#define POLL_URL_SIZE 128
+#define EEPROM_ADDR_WALL_TILE_INDEX 233       // Address for video wall tile index (1 byte)
+#define EEPROM_ADDR_WALL_TILE_COUNT 234       // Address for video wall tile count (1 byte)
 
 // Constants
 #define TEXT_SIZE_MIN 1
 #define TEXT_SIZE_MAX 3
 #define BRIGHTNESS_LEVELS 10
+#define WALL_TILES_MAX 8
 
+// Stored in EEPROM by number, so new modes only ever go at the end
 enum EffectMode {
     EFFECT_CONFETTI,
     EFFECT_ACID,
@@ -33,7 +39,9 @@ enum EffectMode {
     EFFECT_SPARKLES,
     EFFECT_FIREWORKS,
     EFFECT_TRON,
-    EFFECT_OFF
+    EFFECT_OFF,
+    EFFECT_WARP,
+    EFFECT_ANIMATION
 };
 
 enum ClockColorMode {
@@ -103,6 +111,19 @@ class SettingsManager {
         return wifiPassword;
     }
 
+    // Message feed polled for new messages ("" when polling is off)
+    const char* getPollUrl() const {
+        return pollUrl;
+    }
+
+    // Video wall layout (tile count 1 means a standalone clock)
+    int getWallTileIndex() const {
+        return wallTileIndex;
+    }
+    int getWallTileCount() const {
+        return wallTileCount;
+    }
+
     // OTA settings getters
     const char* getOTAPassword() const {
         return otaPassword;
@@ -120,6 +141,8 @@ class SettingsManager {
     // WiFi settings setters
     void setWiFiEnabled(bool enabled);
     void setWiFiCredentials(const char* ssid, const char* password);
+    void setPollUrl(const char* url);
+    void setWallLayout(int tileIndex, int tileCount);
 
     // Save/Load operations
     void saveSettings();
@@ -140,6 +163,13 @@ class SettingsManager {
     char wifiSSID[32];
     char wifiPassword[64];
 
+    // Message polling
+    char pollUrl[POLL_URL_SIZE];
+
+    // Video wall
+    int wallTileIndex;
+    int wallTileCount;
+
     // OTA settings
     char otaPassword[32];  // Increased buffer size for static OTA password
 
@@ -149,6 +179,7 @@ class SettingsManager {
     bool isValidEffectMode(int mode) const;
     bool isValidClockColorMode(int mode) const;
     bool isValidMessageScrollSpeed(int speed) const;
+    bool isValidWallLayout(int tileIndex, int tileCount) const;
 };
 
 #endif  // SETTINGS_MANAGER_H
@@ -0,0 +1,26 @@
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include <Arduino.h>
+
+// Pixel formats produced by tools/convert_assets.py
+enum SpriteFormat : uint8_t {
+    SPRITE_RGB565,    // uint16_t per pixel, transparentColor marks see-through pixels
+    SPRITE_INDEXED4,  // Two pixels per byte (high nibble first), index 0 is transparent
+    SPRITE_MONO       // Eight pixels per byte (MSB first), 0 bits are transparent
+};
+
+// Flash-resident image. Rows of packed formats are padded to a whole byte.
+struct Sprite {
+    uint16_t width;
+    uint16_t height;
+    SpriteFormat format;
+    bool hasTransparency;
+    uint8_t paletteSize;      // SPRITE_INDEXED4 only
+    const uint16_t* palette;  // RGB565 palette at full brightness, SPRITE_INDEXED4 only
+    uint16_t transparentColor;
+    uint16_t color;  // Default foreground color, SPRITE_MONO only
+    const void* data;
+};
+
+#endif  // SPRITE_H
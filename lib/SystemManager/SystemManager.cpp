@@ -1,5 +1,6 @@
 #include "SystemManager.h"
 
+#include "Log.h"
 #include "MenuSystem.h"
 
 SystemManager::SystemManager(Adafruit_Protomatter* matrix, RTC_DS3231* rtc,
@@ -22,8 +23,9 @@ SystemManager::SystemManager(Adafruit_Protomatter* matrix, RTC_DS3231* rtc,
       systemStartTime(systemStartTime) {}
 
 void SystemManager::initializeSystem() {
-    Serial.begin(9600);
-    Serial.println("Matrix Sign Starting...");
+    Serial.begin(MONITOR_SPEED);
+    Log::begin();
+    LOG_INFO("Matrix Sign Starting...");
 
     initializeHardware();
     initializeManagers();
@@ -32,31 +34,30 @@ void SystemManager::initializeSystem() {
     // Set startup time for grace period
     *systemStartTime = millis();
 
-    Serial.println("Setup complete!");
+    LOG_INFO("Setup complete!");
 }
 
 void SystemManager::initializeHardware() {
     // Initialize matrix
     ProtomatterStatus status = matrix->begin();
     if (status != PROTOMATTER_OK) {
-        Serial.print("Matrix initialization failed: ");
-        Serial.println(status);
+        LOG_ERROR("Matrix initialization failed: %d", status);
         while (true)
             ;  // Halt on failure
     }
-    Serial.println("Matrix initialized successfully");
+    LOG_INFO("Matrix initialized successfully");
 
     // Initialize RTC
     Wire.begin();
     if (!rtc->begin()) {
-        Serial.println("Couldn't find RTC");
+        LOG_ERROR("Couldn't find RTC");
         while (true)
             ;
     }
-    Serial.println("RTC initialized successfully");
+    LOG_INFO("RTC initialized successfully");
 
     if (rtc->lostPower()) {
-        Serial.println("RTC lost power, setting time!");
+        LOG_WARN("RTC lost power, setting time!");
         rtc->adjust(DateTime(F(__DATE__), F(__TIME__)));
     }
 }
@@ -74,6 +75,9 @@ void SystemManager::initializeManagers() {
     // Initialize TimeManager and set timezone
     timeManager->begin();
 
+    // Messages queued before the reboot; needs the wall clock for their timing
+    display->restoreMessages();
+
     // Set timezone from saved settings
     int savedTimezoneIndex = settings->getTimezoneIndex();
 
@@ -92,13 +96,13 @@ void SystemManager::initializeManagers() {
         timeManager->setTimezoneOffset(timezoneOffsets[savedTimezoneIndex],
                                        timezoneDST[savedTimezoneIndex],
                                        timezoneDSTOffset[savedTimezoneIndex]);
-        Serial.printf("[SystemManager] Setting timezone to index %d: UTC%+d (DST: %s)\n",
-                      savedTimezoneIndex, timezoneOffsets[savedTimezoneIndex],
-                      timezoneDST[savedTimezoneIndex] ? "yes" : "no");
+        LOG_INFO("[SystemManager] Setting timezone to index %d: UTC%+d (DST: %s)",
+                 savedTimezoneIndex, timezoneOffsets[savedTimezoneIndex],
+                 timezoneDST[savedTimezoneIndex] ? "yes" : "no");
     } else {
         // Fallback to Arizona timezone if invalid index
         timeManager->setTimezoneOffset(-7, false, 0);
-        Serial.println("[SystemManager] Using fallback timezone: UTC-7 (Arizona)");
+        LOG_INFO("[SystemManager] Using fallback timezone: UTC-7 (Arizona)");
     }
 
     // Initialize effects engine
@@ -117,7 +121,7 @@ void SystemManager::initializeManagers() {
 void SystemManager::initializeWiFiAndOTA() {
     // Initialize WiFi and OTA if enabled
     if (settings->isWiFiEnabled()) {
-        Serial.println("WiFi enabled, connecting...");
+        LOG_INFO("WiFi enabled, connecting...");
         wifiManager->begin(settings->getWiFiSSID(), settings->getWiFiPassword());
 
         // Always setup OTA if WiFi is enabled (it will work once WiFi connects)
@@ -125,14 +129,14 @@ void SystemManager::initializeWiFiAndOTA() {
                               display);  // Uses randomly generated password with display blanking
 
         if (wifiManager->isConnected()) {
-            Serial.println("WiFi connected - OTA ready for uploads!");
+            LOG_INFO("WiFi connected - OTA ready for uploads!");
             // NTP sync on boot if WiFi is connected
             timeManager->syncTimeWithNTP(true);
         } else {
-            Serial.println("WiFi connecting... OTA will be available once connected");
+            LOG_INFO("WiFi connecting... OTA will be available once connected");
         }
     } else {
-        Serial.println("WiFi disabled - use menu to configure");
+        LOG_INFO("WiFi disabled - use menu to configure");
     }
 }
 
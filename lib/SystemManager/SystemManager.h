@@ -17,6 +17,11 @@
 #include "WiFiInfoDisplay.h"
 #include "WiFiManager.h"
 
+// Serial baud rate; platformio.ini passes its monitor_speed
+#ifndef MONITOR_SPEED
+#define MONITOR_SPEED 115200
+#endif
+
 // Forward declarations
 class MenuSystem;
 
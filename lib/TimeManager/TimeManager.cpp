@@ -2,8 +2,12 @@
 
 #include <sys/time.h>
 
-TimeManager::TimeManager(RTC_DS3231* rtcInst, const char* ntpServer)
+#include "Log.h"
+#include "Trace.h"
+
+TimeManager::TimeManager(RTC_DS3231* rtcInst, Metrics* metrics, const char* ntpServer)
     : rtc(rtcInst),
+      metrics(metrics),
       ntpServer(ntpServer),
       gmtOffset_sec(-7 * 3600),
       daylightOffset_sec(0),
@@ -13,6 +17,10 @@ TimeManager::TimeManager(RTC_DS3231* rtcInst, const char* ntpServer)
       currentUTCOffset(-7),
       supportsDST(false),
       dstOffset(0),
+      localTime{},
+      localTimeValid(false),
+      localTimeGeneration(0),
+      localTimeLock(portMUX_INITIALIZER_UNLOCKED),
       ntpState(NTP_IDLE),
       ntpUpdateRTC(false),
       ntpStartTime(0),
@@ -26,8 +34,8 @@ void TimeManager::setTimezone(const char* tz) {
     timezoneString = tz;
     setenv("TZ", tz, 1);
     tzset();
-    Serial.print("[TimeManager] Timezone set to: ");
-    Serial.println(tz);
+    invalidateLocalTime();
+    LOG_INFO("[TimeManager] Timezone set to: %s", tz);
 }
 
 void TimeManager::setTimezoneAndUpdate(const char* tz) {
@@ -39,7 +47,8 @@ void TimeManager::setTimezoneAndUpdate(const char* tz) {
     if (now > 0) {
         struct timeval tv = {now, 0};
         settimeofday(&tv, nullptr);
-        Serial.println("[TimeManager] System time updated for new timezone");
+        invalidateLocalTime();
+        LOG_INFO("[TimeManager] System time updated for new timezone");
     }
 }
 
@@ -47,12 +56,13 @@ void TimeManager::setTimezoneOffset(int utcOffsetHours, bool isDST, int dstOffse
     currentUTCOffset = utcOffsetHours;
     supportsDST = isDST;
     dstOffset = dstOffsetHours;
+    invalidateLocalTime();
 
     // Always sync with UTC (no offset to configTime)
     configTime(0, 0, ntpServer);
 
-    Serial.printf("[TimeManager] Timezone set to UTC%+d (DST: %s, DST offset: %+d)\n",
-                  utcOffsetHours, isDST ? "yes" : "no", dstOffsetHours);
+    LOG_INFO("[TimeManager] Timezone set to UTC%+d (DST: %s, DST offset: %+d)",
+             utcOffsetHours, isDST ? "yes" : "no", dstOffsetHours);
 }
 
 bool TimeManager::isDSTActive(int month, int day, int utcOffsetHours) {
@@ -82,42 +92,97 @@ bool TimeManager::isDSTActive(int month, int day, int utcOffsetHours) {
 }
 
 DateTime TimeManager::getLocalTime() {
-    // Get current UTC time from system
+    LocalTime now;
+    getLocalTime(now);
+    return DateTime(now.tm.tm_year + 1900, now.tm.tm_mon + 1, now.tm.tm_mday, now.tm.tm_hour,
+                    now.tm.tm_min, now.tm.tm_sec);
+}
+
+void TimeManager::getLocalTime(LocalTime& out) {
     time_t utcTime = time(nullptr);
-    const struct tm* utcTm = gmtime(&utcTime);
+    portENTER_CRITICAL(&localTimeLock);
+    bool hit = localTimeValid && localTime.utc == utcTime;
+    if (hit) {
+        out = localTime;
+    }
+    uint32_t generation = localTimeGeneration;
+    portEXIT_CRITICAL(&localTimeLock);
+    if (hit) {
+        return;
+    }
+
+    // Worked out outside the lock; kept only if nothing invalidated the cache meanwhile
+    computeLocalTime(utcTime, out);
+    portENTER_CRITICAL(&localTimeLock);
+    if (localTimeGeneration == generation) {
+        localTime = out;
+        localTimeValid = true;
+    }
+    portEXIT_CRITICAL(&localTimeLock);
+}
+
+void TimeManager::computeLocalTime(time_t utcTime, LocalTime& out) {
+    static const char* const dayAbbrev[] = {"SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT"};
+
+    struct tm utcTm;
+    gmtime_r(&utcTime, &utcTm);
 
     // Calculate local offset including DST
     int totalOffset = currentUTCOffset;
-    if (supportsDST && isDSTActive(utcTm->tm_mon + 1, utcTm->tm_mday, currentUTCOffset)) {
+    if (supportsDST && isDSTActive(utcTm.tm_mon + 1, utcTm.tm_mday, currentUTCOffset)) {
         totalOffset += dstOffset;
     }
 
     // Apply offset to UTC time
-    time_t localTime = utcTime + (totalOffset * 3600);  // Convert hours to seconds
-    struct tm* localTm = gmtime(&localTime);
+    time_t local = utcTime + (totalOffset * 3600);  // Convert hours to seconds
+    out.utc = utcTime;
+    gmtime_r(&local, &out.tm);
+
+    // Narrowed to the ranges gmtime_r gives, so the compiler can see every field fits
+    const struct tm& t = out.tm;
+    uint8_t hour = (unsigned)t.tm_hour % 24;
+    uint8_t hour12 = hour % 12 == 0 ? 12 : hour % 12;  // Midnight is 12 AM
+    uint8_t minute = (unsigned)t.tm_min % 60;
+    uint8_t second = (unsigned)t.tm_sec % 60;
+    uint8_t month = (unsigned)t.tm_mon % 12 + 1;
+    uint8_t day = (unsigned)t.tm_mday % 32;
+    uint16_t year = (unsigned)(t.tm_year + 1900) % 10000;
+    snprintf(out.time24, sizeof(out.time24), "%02u:%02u:%02u", hour, minute, second);
+    snprintf(out.time12, sizeof(out.time12), "%02u:%02u:%02u", hour12, minute, second);
+    snprintf(out.time12AmPm, sizeof(out.time12AmPm), "%s %s", out.time12, hour >= 12 ? "PM" : "AM");
+    snprintf(out.date, sizeof(out.date), "%02u/%02u/%04u [%s]", month, day, year,
+             dayAbbrev[(unsigned)t.tm_wday % 7]);
+}
 
-    return DateTime(localTm->tm_year + 1900, localTm->tm_mon + 1, localTm->tm_mday,
-                    localTm->tm_hour, localTm->tm_min, localTm->tm_sec);
+void TimeManager::invalidateLocalTime() {
+    portENTER_CRITICAL(&localTimeLock);
+    localTimeValid = false;
+    localTimeGeneration++;
+    portEXIT_CRITICAL(&localTimeLock);
 }
 
 bool TimeManager::syncTimeWithNTP(bool updateRTC) {
-    Serial.println("[TimeManager] Starting NTP sync...");
+    TRACE_SCOPE("ntp sync");
+    LOG_INFO("[TimeManager] Starting NTP sync...");
     // Use 0, 0 for offsets when using timezone strings - let TZ handle the conversion
     configTime(0, 0, ntpServer);
     struct tm timeinfo;
     if (::getLocalTime(&timeinfo, 10000)) {  // Use global getLocalTime function
-        Serial.printf("[TimeManager] NTP Time: %04d-%02d-%02d %02d:%02d:%02d\n",
-                      timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
-                      timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+        LOG_INFO("[TimeManager] NTP Time: %04d-%02d-%02d %02d:%02d:%02d",
+                 timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
+                 timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
         if (updateRTC && rtc) {
             rtc->adjust(DateTime(timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
                                  timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec));
-            Serial.println("[TimeManager] RTC updated from NTP.");
+            LOG_INFO("[TimeManager] RTC updated from NTP.");
         }
         lastNTPSync = millis();
+        invalidateLocalTime();  // The clock may have been stepped
+        metrics->countNtpSync(true);
         return true;
     } else {
-        Serial.println("[TimeManager] Failed to get time from NTP server.");
+        LOG_WARN("[TimeManager] Failed to get time from NTP server.");
+        metrics->countNtpSync(false);
         return false;
     }
 }
@@ -125,7 +190,7 @@ bool TimeManager::syncTimeWithNTP(bool updateRTC) {
 void TimeManager::periodicNTPSync(unsigned long intervalMs) {
     // Only start a new sync if we're not already syncing and enough time has passed
     if (ntpState == NTP_IDLE && millis() - lastNTPSync > intervalMs) {
-        Serial.println("[TimeManager] Starting periodic non-blocking NTP sync");
+        LOG_INFO("[TimeManager] Starting periodic non-blocking NTP sync");
         startNTPSync(true);
     }
 }
@@ -133,7 +198,7 @@ void TimeManager::periodicNTPSync(unsigned long intervalMs) {
 void TimeManager::updateRTCFromNTP() {
     // Only start if not already syncing
     if (ntpState == NTP_IDLE) {
-        Serial.println("[TimeManager] Starting non-blocking RTC update from NTP");
+        LOG_INFO("[TimeManager] Starting non-blocking RTC update from NTP");
         startNTPSync(true);
     }
 }
@@ -145,7 +210,7 @@ void TimeManager::updateRTCFromSystem() {
     struct tm* timeinfo = localtime(&now);
     rtc->adjust(DateTime(timeinfo->tm_year + 1900, timeinfo->tm_mon + 1, timeinfo->tm_mday,
                          timeinfo->tm_hour, timeinfo->tm_min, timeinfo->tm_sec));
-    Serial.println("[TimeManager] RTC updated from system time.");
+    LOG_INFO("[TimeManager] RTC updated from system time.");
 }
 
 void TimeManager::updateSystemFromRTC() {
@@ -162,7 +227,8 @@ void TimeManager::updateSystemFromRTC() {
     time_t sysTime = mktime(&t);
     struct timeval tv = {sysTime, 0};
     settimeofday(&tv, nullptr);
-    Serial.println("[TimeManager] System time updated from RTC.");
+    invalidateLocalTime();
+    LOG_INFO("[TimeManager] System time updated from RTC.");
 }
 
 void TimeManager::setLastNTPSync(unsigned long ms) {
@@ -183,11 +249,12 @@ bool TimeManager::isNTPSyncRecent(unsigned long maxAgeMs) const {
 
 void TimeManager::startNTPSync(bool updateRTC) {
     if (ntpState != NTP_IDLE) {
-        Serial.println("[TimeManager] NTP sync already in progress");
+        LOG_WARN("[TimeManager] NTP sync already in progress");
         return;
     }
 
-    Serial.println("[TimeManager] Starting non-blocking NTP sync...");
+    LOG_INFO("[TimeManager] Starting non-blocking NTP sync...");
+    TRACE_SCOPE("ntp start");
     ntpState = NTP_CONFIGURING;
     ntpUpdateRTC = updateRTC;
     ntpStartTime = millis();
@@ -208,29 +275,37 @@ bool TimeManager::updateNTPSync() {
     if (ntpState == NTP_WAITING_FOR_TIME) {
         // Check if we've been waiting too long
         if (millis() - ntpStartTime > 10000) {  // 10 second timeout
-            Serial.println("[TimeManager] NTP sync timed out");
+            LOG_WARN("[TimeManager] NTP sync timed out");
+            TRACE_INSTANT("ntp timeout", 0);
             ntpState = NTP_COMPLETED_FAILURE;
             ntpLastResult = false;
+            metrics->countNtpSync(false);
             return true;
         }
 
         // Try to get time with very short timeout (non-blocking)
         struct tm timeinfo;
-        if (::getLocalTime(&timeinfo, 50)) {  // 50ms timeout - much shorter!
-            Serial.printf("[TimeManager] NTP Time: %04d-%02d-%02d %02d:%02d:%02d\n",
-                          timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
-                          timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
+        TRACE_BEGIN("ntp poll");
+        bool gotTime = ::getLocalTime(&timeinfo, 50);  // 50ms timeout - much shorter!
+        TRACE_END("ntp poll");
+        if (gotTime) {
+            LOG_INFO("[TimeManager] NTP Time: %04d-%02d-%02d %02d:%02d:%02d",
+                     timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
+                     timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
 
             if (ntpUpdateRTC && rtc) {
                 rtc->adjust(DateTime(timeinfo.tm_year + 1900, timeinfo.tm_mon + 1, timeinfo.tm_mday,
                                      timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec));
-                Serial.println("[TimeManager] RTC updated from NTP.");
+                LOG_INFO("[TimeManager] RTC updated from NTP.");
             }
 
             lastNTPSync = millis();
+            invalidateLocalTime();  // The clock may have been stepped
             ntpState = NTP_COMPLETED_SUCCESS;
             ntpLastResult = true;
-            Serial.println("[TimeManager] Non-blocking NTP sync completed successfully");
+            metrics->countNtpSync(true);
+            LOG_INFO("[TimeManager] Non-blocking NTP sync completed successfully");
+            TRACE_INSTANT("ntp synced", 0);
             return true;
         }
         // If getLocalTime fails, we continue waiting (not completed yet)
@@ -6,15 +6,30 @@
 #include <RTClib.h>
 #include <time.h>
 
+#include "Metrics.h"
+
+// Local time of one UTC second with the strings the clock draws, worked out once per second
+struct LocalTime {
+    time_t utc;
+    struct tm tm;         // Broken-down local time, DST applied
+    char time24[9];       // "13:05:09"
+    char time12[9];       // "01:05:09"
+    char time12AmPm[12];  // "01:05:09 PM"
+    char date[17];        // "03/09/2025 [SUN]"
+};
+
 class TimeManager {
    public:
-    explicit TimeManager(RTC_DS3231* rtcInst, const char* ntpServer = "pool.ntp.org");
+    TimeManager(RTC_DS3231* rtcInst, Metrics* metrics, const char* ntpServer = "pool.ntp.org");
     void begin();
     void setTimezone(const char* tz);
     void setTimezoneAndUpdate(const char* tz);  // Set timezone and force time update
     void setTimezoneOffset(int utcOffsetHours, bool isDST = false, int dstOffsetHours = 0);
     bool isDSTActive(int month, int day, int utcOffsetHours);  // Simple DST calculation
     DateTime getLocalTime();  // Get current time with timezone offset applied
+    // Same, with the display strings. The result is cached until the UTC second changes, so
+    // calling it every frame costs a time() and a copy. Any task.
+    void getLocalTime(LocalTime& out);
     bool syncTimeWithNTP(bool updateRTC = true);
     void periodicNTPSync(unsigned long intervalMs = 12UL * 60UL * 60UL * 1000UL);  // default 12h
     void updateRTCFromNTP();
@@ -42,6 +57,7 @@ class TimeManager {
     };
 
     RTC_DS3231* rtc;
+    Metrics* metrics;
     const char* ntpServer;
     long gmtOffset_sec;
     int daylightOffset_sec;
@@ -54,6 +70,15 @@ class TimeManager {
     bool supportsDST;
     int dstOffset;
 
+    // Cached getLocalTime() result, dropped whenever the offset or the clock itself changes
+    LocalTime localTime;
+    bool localTimeValid;
+    uint32_t localTimeGeneration;  // Bumped by invalidateLocalTime()
+    portMUX_TYPE localTimeLock;
+
+    void computeLocalTime(time_t utc, LocalTime& out);
+    void invalidateLocalTime();
+
     // Non-blocking NTP sync state
     NTPSyncState ntpState;
     bool ntpUpdateRTC;
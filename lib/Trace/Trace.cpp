@@ -0,0 +1,156 @@
+#include "Trace.h"
+
+#if TRACE_ENABLED
+
+#include "Log.h"
+
+static_assert((TRACE_EVENTS & (TRACE_EVENTS - 1)) == 0, "TRACE_EVENTS must be a power of two");
+
+static const uint32_t RING_MASK = TRACE_EVENTS - 1;
+static const char* const PHASES[] = {"B", "E", "i"};
+
+TraceEvent Trace::ring[TRACE_EVENTS];
+std::atomic<uint32_t> Trace::head(0);
+std::atomic<int> Trace::pauses(0);
+std::atomic<bool> Trace::serialDump(false);
+
+void Trace::record(TracePhase phase, const char* name, int32_t value) {
+    if (pauses.load(std::memory_order_relaxed) > 0) {
+        return;
+    }
+    // Claiming the slot is the only shared step; an event being filled in while a dump starts
+    // may come out half written, which a debugging timeline can live with
+    TraceEvent& event = ring[head.fetch_add(1, std::memory_order_relaxed) & RING_MASK];
+    event.us = micros();
+    event.name = name;
+    event.task = xTaskGetCurrentTaskHandle();
+    event.value = value;
+    event.phase = phase;
+    event.core = xPortGetCoreID();
+}
+
+void Trace::dumpToSerial() {
+    bool idle = false;
+    if (!serialDump.compare_exchange_strong(idle, true)) {
+        return;
+    }
+    if (xTaskCreatePinnedToCore(serialDumpTask, "trace", TRACE_DUMP_STACK, nullptr, 1, nullptr,
+                                0) != pdPASS) {
+        serialDump.store(false);
+    }
+}
+
+void Trace::serialDumpTask(void* param) {
+    Log::holdSerial(true);
+    {
+        TraceWriter writer;
+        uint8_t buffer[256];
+        while (!writer.isDone()) {
+            size_t length = writer.write(buffer, sizeof(buffer));
+            if (length == 0) {
+                break;  // An event larger than the buffer; cannot happen with these formats
+            }
+            Serial.write(buffer, length);
+        }
+        Serial.println();
+    }
+    Log::holdSerial(false);
+    serialDump.store(false);
+    vTaskDelete(nullptr);
+}
+
+TraceWriter::TraceWriter()
+    : next(0), taskCount(0), nextTask(0), opened(false), closed(false), tasks{}, taskNames{} {
+    Trace::pauses.fetch_add(1);
+    end = Trace::head.load();
+    first = end > TRACE_EVENTS ? end - TRACE_EVENTS : 0;
+    next = first;
+
+    // Task names are looked up now, while the tasks are known to exist
+    for (uint32_t i = first; i != end && taskCount < TRACE_TASKS_MAX; i++) {
+        void* task = Trace::ring[i & RING_MASK].task;
+        if (taskId(task) == 0) {
+            tasks[taskCount] = task;
+            strncpy(taskNames[taskCount], pcTaskGetName((TaskHandle_t)task),
+                    sizeof(taskNames[0]) - 1);
+            taskCount++;
+        }
+    }
+}
+
+TraceWriter::~TraceWriter() {
+    Trace::pauses.fetch_sub(1);
+}
+
+int TraceWriter::taskId(void* task) const {
+    for (int i = 0; i < taskCount; i++) {
+        if (tasks[i] == task) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+size_t TraceWriter::write(uint8_t* buffer, size_t maxLength) {
+    char* out = (char*)buffer;
+    size_t used = 0;
+    uint32_t startUs = first != end ? Trace::ring[first & RING_MASK].us : 0;
+    while (!closed) {
+        char* at = out + used;
+        size_t room = maxLength - used;
+        // Items after the first get a comma in front
+        const char* comma = nextTask > 0 || next != first ? "," : "";
+        int length;
+        if (!opened) {
+            length = snprintf(at, room, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        } else if (nextTask < taskCount) {
+            length = snprintf(at, room,
+                              "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                              "\"args\":{\"name\":\"%s\"}}\n",
+                              comma, nextTask + 1, taskNames[nextTask]);
+        } else if (next != end) {
+            const TraceEvent& event = Trace::ring[next & RING_MASK];
+            // Timestamps count from the oldest event, so a micros() wrap inside the ring is
+            // harmless
+            length = snprintf(at, room,
+                              "%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%lu,\"pid\":1,\"tid\":%d,"
+                              "\"args\":{\"core\":%u",
+                              comma, event.name, PHASES[event.phase % 3],
+                              (unsigned long)(event.us - startUs), taskId(event.task),
+                              event.core);
+            if (length >= 0 && (size_t)length < room) {
+                int tail;
+                if (event.phase == TRACE_PHASE_INSTANT) {
+                    tail = snprintf(at + length, room - length, ",\"value\":%ld},\"s\":\"t\"}\n",
+                                    (long)event.value);
+                } else {
+                    tail = snprintf(at + length, room - length, "}}\n");
+                }
+                length = tail < 0 ? tail : length + tail;
+            }
+        } else {
+            length = snprintf(at, room, "]}\n");
+        }
+        // snprintf needs room for its terminator too; a cut item is written again next time
+        if (length < 0 || (size_t)length >= room) {
+            break;
+        }
+        used += length;
+        if (!opened) {
+            opened = true;
+        } else if (nextTask < taskCount) {
+            nextTask++;
+        } else if (next != end) {
+            next++;
+        } else {
+            closed = true;
+        }
+    }
+    return used;
+}
+
+bool TraceWriter::isDone() const {
+    return closed;
+}
+
+#endif  // TRACE_ENABLED
@@ -0,0 +1,108 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+
+#include <atomic>
+
+// Timeline of begin/end events for chasing frame hitches, dumped as Chrome trace-event JSON
+// for chrome://tracing or ui.perfetto.dev. Off unless built with -DTRACE_ENABLED=1; the macros
+// then compile to nothing and the ring takes no RAM.
+//
+// An event is a name (a string literal, as only its address is kept), a timestamp in
+// microseconds, the task and core it happened on, and a number for instant events. The last
+// TRACE_EVENTS are kept. Recording pauses while a dump is written, so a dump shows what led up
+// to it and not itself.
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS 512  // Power of two, 20 bytes each
+#endif
+#define TRACE_TASKS_MAX 8  // Tasks named in a dump; events of others still show, unnamed
+#define TRACE_DUMP_STACK 4096
+
+#if TRACE_ENABLED
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_BEGIN(name) Trace::record(TRACE_PHASE_BEGIN, name, 0)
+#define TRACE_END(name) Trace::record(TRACE_PHASE_END, name, 0)
+#define TRACE_INSTANT(name, value) Trace::record(TRACE_PHASE_INSTANT, name, value)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_INSTANT(name, value) ((void)0)
+#define TRACE_SCOPE(name) ((void)0)
+#endif
+
+enum TracePhase : uint8_t { TRACE_PHASE_BEGIN, TRACE_PHASE_END, TRACE_PHASE_INSTANT };
+
+struct TraceEvent {
+    uint32_t us;
+    const char* name;
+    void* task;
+    int32_t value;  // Instant events only
+    TracePhase phase;
+    uint8_t core;
+};
+
+class Trace {
+   public:
+    // Any task, not from interrupts. Use the TRACE_ macros instead.
+    static void record(TracePhase phase, const char* name, int32_t value);
+
+    // Writes a dump to Serial from a task of its own, holding back log lines meanwhile so the
+    // JSON comes out in one piece. Does nothing if a serial dump is already running.
+    static void dumpToSerial();
+
+   private:
+    friend class TraceWriter;
+    static TraceEvent ring[TRACE_EVENTS];
+    static std::atomic<uint32_t> head;    // Events recorded since boot
+    static std::atomic<int> pauses;       // Dumps being written
+    static std::atomic<bool> serialDump;  // dumpToSerial() running
+
+    static void serialDumpTask(void* param);
+};
+
+// Brackets a block with a begin and an end event
+class TraceScope {
+   public:
+    explicit TraceScope(const char* name) : name(name) {
+        Trace::record(TRACE_PHASE_BEGIN, name, 0);
+    }
+    ~TraceScope() {
+        Trace::record(TRACE_PHASE_END, name, 0);
+    }
+
+   private:
+    const char* name;
+};
+
+// Writes the events recorded so far as trace-event JSON, a whole event at a time, into whatever
+// buffer it is handed, like MetricsWriter. Recording stays paused while it exists.
+class TraceWriter {
+   public:
+    TraceWriter();
+    ~TraceWriter();
+
+    // Bytes written; 0 once everything has been, or if the next piece does not fit
+    size_t write(uint8_t* buffer, size_t maxLength);
+    bool isDone() const;
+
+   private:
+    uint32_t first;  // Oldest event in the dump, as a count since boot
+    uint32_t end;
+    uint32_t next;  // Event to write next
+    int taskCount;
+    int nextTask;  // Task name to write next
+    bool opened;
+    bool closed;
+    void* tasks[TRACE_TASKS_MAX];
+    char taskNames[TRACE_TASKS_MAX][16];
+
+    int taskId(void* task) const;
+};
+
+#endif  // TRACE_H
@@ -0,0 +1,200 @@
+#include "VideoWall.h"
+
+#include <esp_timer.h>
+
+#include "Log.h"
+
+static uint32_t get32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) |
+           ((uint32_t)in[3] << 24);
+}
+
+static void put32(uint8_t* out, uint32_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+VideoWall::VideoWall(SettingsManager* settings)
+    : settings(settings),
+      tileIndex(0),
+      tileCount(1),
+      seed(0),
+      started(false),
+      lastBeaconMs(0),
+      offsetUs(0),
+      samples{},
+      sampleCount(0),
+      nextSample(0),
+      beacons(0),
+      lastHeardMs(0),
+      messageHash(0),
+      messageStartFrame(0) {}
+
+void VideoWall::begin() {
+    group.fromString(WALL_SYNC_GROUP);
+    seed = esp_random();  // Followers replace it with the leader's
+    setLayout(settings->getWallTileIndex(), settings->getWallTileCount());
+}
+
+void VideoWall::setLayout(int tileIndex, int tileCount) {
+    if (tileCount < 1 || tileIndex < 0 || tileIndex >= tileCount) {
+        return;
+    }
+    this->tileIndex = tileIndex;
+    this->tileCount = tileCount;
+    sampleCount = 0;
+    offsetUs = 0;
+    lastHeardMs = 0;
+    LOG_INFO("VideoWall: tile %d of %d", tileIndex, tileCount);
+}
+
+void VideoWall::loop() {
+    if (!isActive()) {
+        if (started) {
+            udp.stop();
+            started = false;
+        }
+        return;
+    }
+    if (!WiFi.isConnected()) {
+        return;
+    }
+    if (!started) {
+        started = udp.beginMulticast(group, WALL_SYNC_PORT);
+        LOG_INFO("VideoWall: sync on %s", WALL_SYNC_GROUP);
+    }
+
+    if (isLeader()) {
+        unsigned long now = millis();
+        if (now - lastBeaconMs >= WALL_BEACON_MS) {
+            lastBeaconMs = now;
+            sendBeacon();
+        }
+    } else {
+        receiveBeacons();
+    }
+}
+
+int64_t VideoWall::getWallMicros() const {
+    return esp_timer_get_time() + offsetUs;
+}
+
+bool VideoWall::isSynced() const {
+    if (!isActive() || isLeader()) {
+        return true;
+    }
+    return lastHeardMs != 0 && millis() - lastHeardMs < WALL_SYNC_TIMEOUT_MS;
+}
+
+void VideoWall::setLeaderMessage(uint32_t hash, uint32_t startFrame) {
+    if (isLeader()) {
+        messageHash = hash;
+        messageStartFrame = startFrame;
+    }
+}
+
+bool VideoWall::getLeaderMessage(uint32_t hash, uint32_t& startFrame) const {
+    if (isLeader() || messageHash == 0 || messageHash != hash || !isSynced()) {
+        return false;
+    }
+    startFrame = messageStartFrame;
+    return true;
+}
+
+void VideoWall::sendBeacon() {
+    uint8_t beacon[WALL_BEACON_SIZE];
+    // Stamped right before sending, so the follower only sees network and loop delay
+    size_t length = buildBeacon(beacon, getWallMicros());
+    udp.beginPacket(group, WALL_SYNC_PORT);
+    udp.write(beacon, length);
+    udp.endPacket();
+}
+
+size_t VideoWall::buildBeacon(uint8_t* out, int64_t wallUs) const {
+    out[0] = 'W';
+    out[1] = 'B';
+    out[2] = WALL_BEACON_VERSION;
+    out[3] = tileCount;
+    put32(out + 4, seed);
+    put32(out + 8, (uint32_t)(wallUs / WALL_FRAME_US));
+    put32(out + 12, (uint32_t)(wallUs % WALL_FRAME_US));
+    put32(out + 16, messageHash);
+    put32(out + 20, messageStartFrame);
+    return WALL_BEACON_SIZE;
+}
+
+void VideoWall::receiveBeacons() {
+    uint8_t beacon[WALL_BEACON_SIZE];
+    for (int i = 0; i < WALL_BEACON_BUDGET; i++) {
+        int size = udp.parsePacket();
+        if (size <= 0) {
+            return;
+        }
+        int length = udp.read(beacon, sizeof(beacon));
+        if (length == size) {
+            handleBeacon(beacon, length, esp_timer_get_time());
+        }
+    }
+}
+
+bool VideoWall::handleBeacon(const uint8_t* data, size_t length, int64_t localUs) {
+    // A beacon from a wall of another size belongs to some other wall on the network
+    if (isLeader() || length != WALL_BEACON_SIZE || data[0] != 'W' || data[1] != 'B' ||
+        data[2] != WALL_BEACON_VERSION || data[3] != tileCount) {
+        return false;
+    }
+
+    int64_t wallUs = (int64_t)get32(data + 8) * WALL_FRAME_US + get32(data + 12);
+    int64_t sample = wallUs - localUs;
+    if (sampleCount > 0 && llabs(sample - offsetUs) > WALL_RESYNC_US) {
+        sampleCount = 0;  // The leader restarted, the old samples mean nothing now
+    }
+    samples[nextSample] = sample;
+    nextSample = (nextSample + 1) % WALL_SYNC_WINDOW;
+    if (sampleCount < WALL_SYNC_WINDOW) {
+        sampleCount++;
+    }
+
+    // A beacon can arrive late (network, a long loop pass) but never early, so the largest
+    // offset of the last few beacons is the one with the least delay in it
+    int64_t best = sample;
+    for (int i = 1; i <= sampleCount; i++) {
+        int64_t candidate = samples[(nextSample - i + WALL_SYNC_WINDOW) % WALL_SYNC_WINDOW];
+        if (candidate > best) {
+            best = candidate;
+        }
+    }
+    offsetUs = best;
+
+    seed = get32(data + 4);
+    messageHash = get32(data + 16);
+    messageStartFrame = get32(data + 20);
+    beacons++;
+    lastHeardMs = millis();
+    if (lastHeardMs == 0) {
+        lastHeardMs = 1;  // 0 means never heard
+    }
+    return true;
+}
+
+uint32_t VideoWall::hash(uint32_t a, uint32_t b) {
+    // Integer mixer; the same on every tile, unlike random()
+    uint32_t x = a ^ (b * 0x9E3779B9u);
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+uint32_t VideoWall::hashText(const char* text) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (const char* p = text; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619u;
+    }
+    return h ? h : 1;
+}
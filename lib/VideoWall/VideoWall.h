@@ -0,0 +1,114 @@
+#ifndef VIDEO_WALL_H
+#define VIDEO_WALL_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#include "SettingsManager.h"
+
+// Several clocks side by side as one wide virtual canvas. Each clock is a tile and shows the
+// columns tile * MATRIX_WIDTH onward. Tile 0 leads: it picks the effects seed and sends a
+// sync beacon to the wall group a few times a second, and the other tiles take its time base
+// from it. Only confetti and the message marquee span the canvas: they are computed from the
+// seed and the shared frame number, so every tile works out the same scene and draws only
+// its own part of it. All other effects draw per tile.
+//
+// Beacon (little endian): magic "WB" (2), version (1), tile count (1), seed (4), frame (4),
+// microseconds into the frame (4), hash of the message the leader is scrolling (4), frame
+// that message started on (4). Followers start the same message on the same frame.
+#ifndef WALL_SYNC_GROUP
+#define WALL_SYNC_GROUP "239.255.42.11"
+#endif
+#define WALL_SYNC_PORT 4212
+#define WALL_BEACON_VERSION 1
+#define WALL_BEACON_SIZE 24
+#define WALL_BEACON_MS 250UL
+#define WALL_BEACON_BUDGET 4           // Beacons read per loop pass
+#define WALL_FRAME_HZ 30               // Same rate as the effects simulation
+#define WALL_FRAME_US (1000000L / WALL_FRAME_HZ)
+#define WALL_SYNC_WINDOW 8             // Beacons the clock offset is estimated over
+#define WALL_SYNC_TIMEOUT_MS 3000UL    // A follower without beacons this long is unsynced
+#define WALL_RESYNC_US 1000000LL       // An offset jump this large means the leader restarted
+
+class VideoWall {
+   public:
+    explicit VideoWall(SettingsManager* settings);
+
+    // Takes the tile layout from the settings
+    void begin();
+    // Sends (leader) or reads (followers) beacons; call before the display is drawn
+    void loop();
+
+    // With one tile, the default, the wall is off and no beacons are sent or read
+    void setLayout(int tileIndex, int tileCount);
+    bool isActive() const {
+        return tileCount > 1;
+    }
+    bool isLeader() const {
+        return tileIndex == 0;
+    }
+    int getTileIndex() const {
+        return tileIndex;
+    }
+    int getTileCount() const {
+        return tileCount;
+    }
+
+    // Shared time base: microseconds since the leader booted. A follower that has not heard
+    // a beacon yet runs on its own clock.
+    int64_t getWallMicros() const;
+    uint32_t getFrame() const {
+        return getWallMicros() / WALL_FRAME_US;
+    }
+    uint32_t getSeed() const {
+        return seed;
+    }
+    bool isSynced() const;
+    int64_t getOffsetMicros() const {
+        return offsetUs;
+    }
+    uint32_t getBeaconCount() const {
+        return beacons;
+    }
+
+    // The leader announces the message it scrolls (hash 0 for none). A follower gets the
+    // start frame if the leader is scrolling a message with the same hash.
+    void setLeaderMessage(uint32_t hash, uint32_t startFrame);
+    bool getLeaderMessage(uint32_t hash, uint32_t& startFrame) const;
+
+    // Applies a beacon that arrived at localUs (esp_timer clock); false if it was ignored
+    bool handleBeacon(const uint8_t* data, size_t length, int64_t localUs);
+    size_t buildBeacon(uint8_t* out, int64_t wallUs) const;
+
+    // Deterministic helpers, so every tile derives the same values from the seed
+    static uint32_t hash(uint32_t a, uint32_t b);
+    static uint32_t hashText(const char* text);  // Never 0
+
+   private:
+    SettingsManager* settings;
+    int tileIndex;
+    int tileCount;
+    uint32_t seed;
+
+    WiFiUDP udp;
+    IPAddress group;
+    bool started;
+    unsigned long lastBeaconMs;
+
+    // Follower clock: wall time = local time + offsetUs
+    int64_t offsetUs;
+    int64_t samples[WALL_SYNC_WINDOW];
+    int sampleCount;
+    int nextSample;
+    uint32_t beacons;
+    unsigned long lastHeardMs;
+
+    uint32_t messageHash;
+    uint32_t messageStartFrame;
+
+    void sendBeacon();
+    void receiveBeacons();
+};
+
+#endif  // VIDEO_WALL_H
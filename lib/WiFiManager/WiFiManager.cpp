@@ -2,13 +2,16 @@
 
 #include "MatrixDisplayManager.h"
 #include "SettingsManager.h"
+#include "Trace.h"
 
-WiFiManager::WiFiManager(SettingsManager* settings)
+WiFiManager::WiFiManager(SettingsManager* settings, Metrics* metrics)
     : wifiConnected(false),
+      connectedBefore(false),
       otaInProgress(false),
       lastConnectionAttempt(0),
       otaProgress(0),
-      displayManager(nullptr) {
+      displayManager(nullptr),
+      metrics(metrics) {
     settingsManager = settings;
 }
 
@@ -56,6 +59,7 @@ void WiFiManager::connectToWiFi(const char* ssid, const char* password) {
 
     if (WiFi.status() == WL_CONNECTED) {
         wifiConnected = true;
+        connectedBefore = true;
         MDNS.begin("matrix-clock");
     } else {
         wifiConnected = false;
@@ -84,7 +88,11 @@ void WiFiManager::setupOTA(const char* hostname, MatrixDisplayManager* display)
 void WiFiManager::handleOTA() {
     if (WiFi.status() == WL_CONNECTED) {
         ArduinoOTA.handle();
+        if (!wifiConnected && connectedBefore) {
+            metrics->countWifiReconnect();
+        }
         wifiConnected = true;
+        connectedBefore = true;
     } else {
         wifiConnected = false;
 
@@ -118,6 +126,8 @@ void WiFiManager::onOTAStart() {
     String type = (ArduinoOTA.getCommand() == U_FLASH) ? "sketch" : "filesystem";
     otaInProgress = true;
     otaProgress = 0;
+    TRACE_BEGIN("ota");
+    metrics->countOta(METRICS_OTA_STARTED);
 
     if (displayManager != nullptr) {
         displayManager->clearScreen();
@@ -126,7 +136,9 @@ void WiFiManager::onOTAStart() {
 }
 
 void WiFiManager::onOTAEnd() {
+    metrics->countOta(METRICS_OTA_SUCCEEDED);
     otaInProgress = false;
+    TRACE_END("ota");
     otaProgress = 100;
 }
 
@@ -135,6 +147,11 @@ void WiFiManager::onOTAProgress(unsigned int progress, unsigned int total) {
 }
 
 void WiFiManager::onOTAError(ota_error_t error) {
+    metrics->countOta(METRICS_OTA_FAILED);
+    TRACE_INSTANT("ota error", error);
+    if (otaInProgress) {
+        TRACE_END("ota");  // Errors before the start (a wrong password) have nothing to end
+    }
     otaInProgress = false;
 }
 
@@ -6,9 +6,11 @@
 #include <ArduinoOTA.h>
 #include <ESPmDNS.h>
 
+#include "Metrics.h"
+
 class WiFiManager {
    public:
-    explicit WiFiManager(class SettingsManager* settings);
+    WiFiManager(class SettingsManager* settings, Metrics* metrics);
     void begin(const char* ssid, const char* password);
     void reconnectWithNewCredentials(const char* ssid, const char* password);
     void disconnect();
@@ -24,11 +26,13 @@ class WiFiManager {
 
    private:
     bool wifiConnected;
+    bool connectedBefore;  // A later connection counts as a reconnect
     bool otaInProgress;
     unsigned long lastConnectionAttempt;
     unsigned int otaProgress;
     class SettingsManager* settingsManager;
     class MatrixDisplayManager* displayManager;
+    Metrics* metrics;
     const unsigned long reconnectInterval = 30000;  // 30 seconds
 
     void connectToWiFi(const char* ssid, const char* password);
@@ -6,16 +6,22 @@
 #include <RTClib.h>
 #include <time.h>  // For NTP and timezone
 
+#include "AnimationPlayer.h"
 #include "AppStateManager.h"
 #include "ButtonManager.h"
 #include "ClockDisplay.h"
 #include "EffectsEngine.h"
+#include "EventStream.h"
 #include "MatrixDisplayManager.h"
 #include "MenuSystem.h"
 #include "MessageClient.h"
+#include "Metrics.h"
+#include "PixelStream.h"
 #include "SettingsManager.h"
 #include "SystemManager.h"
 #include "TimeManager.h"
+#include "Trace.h"
+#include "VideoWall.h"
 #include "WiFiInfoDisplay.h"
 #include "WiFiManager.h"
 
@@ -45,23 +51,31 @@ Adafruit_Protomatter matrix(MATRIX_WIDTH, BIT_DEPTH, 1, rgbPins, 4, addrPins, cl
                             oePin, true);
 RTC_DS3231 rtc;
 
+// Counters for /metrics, bumped by the objects below
+Metrics metrics;
+
 // TimeManager instance (must be after rtc)
-TimeManager timeManager(&rtc);
+TimeManager timeManager(&rtc, &metrics);
 
 // System instances
+EventStream eventStream;
 SettingsManager settings;
+VideoWall videoWall(&settings);
 ButtonManager buttons;
-WiFiManager wifiManager(&settings);
-MatrixDisplayManager display(&matrix, &settings);
-EffectsEngine effects(&display, &settings);
+WiFiManager wifiManager(&settings, &metrics);
+MatrixDisplayManager display(&matrix, &settings, &eventStream, &videoWall, &metrics);
+AnimationPlayer animation(&display, &settings);
+EffectsEngine effects(&display, &settings, &videoWall, &animation, &metrics);
 ClockDisplay clockDisplay(&display, &settings, &rtc, &timeManager);
 MenuSystem menu(&display, &settings, &buttons, &effects, &rtc, &wifiManager, &timeManager);
 WiFiInfoDisplay wifiInfoDisplay(&display, &wifiManager, &settings);
+PixelStream pixelStream(&display, &settings);
 AppStateManager appManager(&buttons, &settings, &display, &effects, &menu, &clockDisplay,
-                           &wifiInfoDisplay);
+                           &wifiInfoDisplay, &eventStream, &pixelStream);
 
 // Message client
-MessageClient messageClient(&settings, &display);
+MessageClient messageClient(&settings, &display, &clockDisplay, &timeManager, &eventStream,
+                            &videoWall, &pixelStream, &animation, &metrics);
 
 // State Variables
 unsigned long systemStartTime = 0;
@@ -77,6 +91,7 @@ SystemManager systemManager(&matrix, &rtc, &settings, &buttons, &display, &timeM
  */
 void setup() {
     systemManager.initializeSystem();
+    videoWall.begin();
     messageClient.begin();
 }
 
@@ -102,11 +117,22 @@ void loop() {
     // Handle all NTP sync coordination (periodic and manual)
     systemManager.handleNTPSync(&menu);
 
+    // Wall time base first, so this frame is drawn on the latest beacon
+    videoWall.loop();
+    pixelStream.loop();
+
+    // Display states render their own effects layer before show()
     appManager.updateDisplay();
-    // Only render effects here if not in message mode (message mode handles its own effects)
-    if (appManager.getCurrentState() != SHOW_MESSAGES) {
-        effects.updateEffects();  // Render background effects
-    }
     messageClient.loop();
+
+#if TRACE_ENABLED
+    // 't' on the serial console dumps the trace, unless the WiFi setup is reading it. Only
+    // that byte is taken; anything else is left for whoever reads the console.
+    if (!menu.isSerialInputMode() && Serial.available() && Serial.peek() == 't') {
+        Serial.read();
+        Trace::dumpToSerial();
+    }
+#endif
+
     appManager.processDelay();
 }
@@ -0,0 +1,104 @@
+#ifndef HOST_ADAFRUIT_GFX_H
+#define HOST_ADAFRUIT_GFX_H
+
+// Adafruit GFX with the built-in 6x8 font's metrics. Text is measured as the library does, but
+// each glyph is drawn as a solid 5x7 cell, which is enough for layout and masking tests.
+#include <Arduino.h>
+
+#include <vector>
+
+class Adafruit_GFX : public Print {
+   public:
+    Adafruit_GFX(int16_t w, int16_t h) : _width(w), _height(h) {}
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+    virtual void fillScreen(uint16_t color) {
+        fillRect(0, 0, _width, _height, color);
+    }
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+        fillRect(x, y, w, 1, color);
+    }
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+        fillRect(x, y, 1, h, color);
+    }
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+    void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+    void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color);
+
+    void setTextWrap(bool wrap) {}
+    void setTextColor(uint16_t color) {
+        textColor = color;
+    }
+    void setTextSize(uint8_t size) {
+        textSize = size > 0 ? size : 1;
+    }
+    void setCursor(int16_t x, int16_t y) {
+        cursorX = x;
+        cursorY = y;
+    }
+    int16_t getCursorX() const {
+        return cursorX;
+    }
+    void getTextBounds(const char* text, int16_t x, int16_t y, int16_t* x1, int16_t* y1,
+                       uint16_t* w, uint16_t* h);
+    void getTextBounds(const String& text, int16_t x, int16_t y, int16_t* x1, int16_t* y1,
+                       uint16_t* w, uint16_t* h) {
+        getTextBounds(text.c_str(), x, y, x1, y1, w, h);
+    }
+    size_t write(uint8_t c) override;
+    size_t print(const char* text);
+    size_t print(const String& text) {
+        return print(text.c_str());
+    }
+
+    int16_t width() const {
+        return _width;
+    }
+    int16_t height() const {
+        return _height;
+    }
+
+   protected:
+    int16_t _width;
+    int16_t _height;
+    int16_t cursorX = 0;
+    int16_t cursorY = 0;
+    uint16_t textColor = 0xFFFF;
+    uint8_t textSize = 1;
+};
+
+class GFXcanvas1 : public Adafruit_GFX {
+   public:
+    GFXcanvas1(uint16_t w, uint16_t h) : Adafruit_GFX(w, h), buffer((w + 7) / 8 * h) {}
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    bool getPixel(int16_t x, int16_t y) const;
+    uint8_t* getBuffer() {
+        return buffer.data();
+    }
+
+   private:
+    std::vector<uint8_t> buffer;  // Rows padded to whole bytes, MSB first, as the library
+};
+
+class GFXcanvas16 : public Adafruit_GFX {
+   public:
+    GFXcanvas16(uint16_t w, uint16_t h) : Adafruit_GFX(w, h), buffer(w * h) {}
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+        if (x >= 0 && x < _width && y >= 0 && y < _height) {
+            buffer[y * _width + x] = color;
+        }
+    }
+    uint16_t getPixel(int16_t x, int16_t y) const {
+        return x >= 0 && x < _width && y >= 0 && y < _height ? buffer[y * _width + x] : 0;
+    }
+    uint16_t* getBuffer() {
+        return buffer.data();
+    }
+
+   private:
+    std::vector<uint16_t> buffer;
+};
+
+#endif  // HOST_ADAFRUIT_GFX_H
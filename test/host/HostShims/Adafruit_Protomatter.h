@@ -0,0 +1,34 @@
+#ifndef HOST_ADAFRUIT_PROTOMATTER_H
+#define HOST_ADAFRUIT_PROTOMATTER_H
+
+// The HUB75 driver as a plain RGB565 canvas; show() only counts frames
+#include <Adafruit_GFX.h>
+
+enum ProtomatterStatus { PROTOMATTER_OK, PROTOMATTER_ERR_MALLOC };
+
+class Adafruit_Protomatter : public GFXcanvas16 {
+   public:
+    Adafruit_Protomatter(uint16_t bitWidth, uint8_t bitDepth, uint8_t rgbCount, uint8_t* rgbList,
+                         uint8_t addrCount, uint8_t* addrList, uint8_t clockPin, uint8_t latchPin,
+                         uint8_t oePin, bool doubleBuffer, int8_t tile = 1,
+                         void* timer = nullptr)
+        : GFXcanvas16(bitWidth, (2 << addrCount) * (tile < 0 ? -tile : tile)) {}
+
+    ProtomatterStatus begin() {
+        return PROTOMATTER_OK;
+    }
+    void show() {
+        frames++;
+    }
+    uint32_t getFrameCount() const {
+        return frames;
+    }
+    static uint16_t color565(uint8_t r, uint8_t g, uint8_t b) {
+        return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+    }
+
+   private:
+    uint32_t frames = 0;
+};
+
+#endif  // HOST_ADAFRUIT_PROTOMATTER_H
@@ -0,0 +1,123 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Just enough of the Arduino core and FreeRTOS for the libraries the native tests build. The
+// clocks stand still unless a test moves them: millis() and micros() read hostMillis, and
+// time() reads hostTime (0 until a test sets a wall clock).
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define PI 3.1415926535897932384626433832795
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+
+extern unsigned long hostMillis;
+extern time_t hostTime;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+// Deterministic: the sequence restarts from randomSeed()
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
+
+// SNTP from the ESP32 core: nothing is fetched, getLocalTime() reports hostTime as UTC
+void configTime(long gmtOffsetSeconds, int daylightOffsetSeconds, const char* server1,
+                const char* server2 = nullptr, const char* server3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t timeoutMs = 5000);
+
+class String {
+   public:
+    String(const char* text = "") : value(text ? text : "") {}
+    String& operator=(const char* text) {
+        value = text ? text : "";
+        return *this;
+    }
+    const char* c_str() const {
+        return value.c_str();
+    }
+    unsigned int length() const {
+        return value.size();
+    }
+
+   private:
+    std::string value;
+};
+
+class Print {
+   public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) {
+        return 1;
+    }
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        return size;
+    }
+};
+
+class Stream : public Print {
+   public:
+    virtual int available() {
+        return 0;
+    }
+    virtual int read() {
+        return -1;
+    }
+    virtual int peek() {
+        return -1;
+    }
+};
+
+class HardwareSerial : public Stream {
+   public:
+    void begin(unsigned long baud) {}
+};
+extern HardwareSerial Serial;
+
+// FreeRTOS: the tests run on one thread, so critical sections and task creation do nothing
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+typedef uint32_t TickType_t;
+#define pdPASS 1
+#define pdMS_TO_TICKS(ms) (ms)
+int xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stack, void* param,
+                            unsigned priority, TaskHandle_t* handle, int core);
+void vTaskDelay(TickType_t ticks);
+typedef void* SemaphoreHandle_t;
+#define portMAX_DELAY 0xFFFFFFFF
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return (SemaphoreHandle_t)1;
+}
+inline int xSemaphoreTake(SemaphoreHandle_t handle, TickType_t ticks) {
+    return pdPASS;
+}
+inline int xSemaphoreGive(SemaphoreHandle_t handle) {
+    return pdPASS;
+}
+inline int xPortGetCoreID() {
+    return 0;
+}
+
+#endif  // HOST_ARDUINO_H
@@ -0,0 +1,36 @@
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+// Emulated flash EEPROM. bytes is public so a test can lay out what an older firmware saved;
+// begin() sizes it like blank flash (all 0xFF) unless a test filled it first.
+#include <Arduino.h>
+
+#include <vector>
+
+class EEPROMClass {
+   public:
+    std::vector<uint8_t> bytes;
+    int commits = 0;
+
+    bool begin(size_t size) {
+        if (bytes.size() < size) {
+            bytes.resize(size, 0xFF);
+        }
+        return true;
+    }
+    uint8_t read(int address) {
+        return address >= 0 && (size_t)address < bytes.size() ? bytes[address] : 0xFF;
+    }
+    void write(int address, uint8_t value) {
+        if (address >= 0 && (size_t)address < bytes.size()) {
+            bytes[address] = value;
+        }
+    }
+    bool commit() {
+        commits++;
+        return true;
+    }
+};
+extern EEPROMClass EEPROM;
+
+#endif  // HOST_EEPROM_H
@@ -0,0 +1,61 @@
+#ifndef HOST_ESP_ASYNC_WEBSERVER_H
+#define HOST_ESP_ASYNC_WEBSERVER_H
+
+// The WebSocket side of ESPAsyncWebServer that EventStream registers. Nothing is served and
+// no client ever connects.
+#include <Arduino.h>
+
+#include <functional>
+
+class AsyncWebServerRequest;
+typedef std::function<bool(AsyncWebServerRequest*)> ArRequestFilterFunction;
+
+class AsyncWebHandler {
+   public:
+    virtual ~AsyncWebHandler() {}
+    AsyncWebHandler& setFilter(ArRequestFilterFunction filter) {
+        return *this;
+    }
+};
+
+class AsyncWebServer {
+   public:
+    explicit AsyncWebServer(uint16_t port) {}
+    void addHandler(AsyncWebHandler* handler) {}
+};
+
+typedef enum {
+    WS_EVT_CONNECT,
+    WS_EVT_DISCONNECT,
+    WS_EVT_PONG,
+    WS_EVT_ERROR,
+    WS_EVT_DATA
+} AwsEventType;
+
+class AsyncWebSocketClient {
+   public:
+    uint32_t id() const {
+        return 0;
+    }
+    bool queueIsFull() const {
+        return false;
+    }
+    void text(const char* data, size_t length) {}
+    void close() {}
+};
+
+class AsyncWebSocket;
+typedef std::function<void(AsyncWebSocket*, AsyncWebSocketClient*, AwsEventType, void*, uint8_t*,
+                           size_t)>
+    AwsEventHandler;
+
+class AsyncWebSocket : public AsyncWebHandler {
+   public:
+    explicit AsyncWebSocket(const char* url) {}
+    void onEvent(AwsEventHandler handler) {}
+    AsyncWebSocketClient* client(uint32_t id) {
+        return nullptr;
+    }
+};
+
+#endif  // HOST_ESP_ASYNC_WEBSERVER_H
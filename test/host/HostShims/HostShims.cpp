@@ -0,0 +1,410 @@
+#include <Adafruit_GFX.h>
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <LittleFS.h>
+#include <RTClib.h>
+#include <WiFi.h>
+#include <esp_timer.h>
+#include <lwip/dns.h>
+#include <lwip/sockets.h>
+#include <mbedtls/md.h>
+
+#include <algorithm>
+#include <vector>
+
+unsigned long hostMillis = 0;
+time_t hostTime = 0;
+HardwareSerial Serial;
+LittleFSFS LittleFS;
+EEPROMClass EEPROM;
+WiFiClass WiFi;
+static uint32_t randomState = 1;
+
+unsigned long millis() {
+    return hostMillis;
+}
+
+unsigned long micros() {
+    return hostMillis * 1000UL;
+}
+
+void delay(unsigned long ms) {
+    hostMillis += ms;
+}
+
+void yield() {}
+
+int64_t esp_timer_get_time() {
+    return (int64_t)hostMillis * 1000;
+}
+
+// xorshift32, so runs repeat exactly
+uint32_t esp_random() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+long random(long max) {
+    return max > 0 ? esp_random() % max : 0;
+}
+
+long random(long min, long max) {
+    return min < max ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long seed) {
+    randomState = seed ? seed : 1;
+}
+
+// Replaces the C library's time() for the whole test binary, so wall-clock code sees hostTime
+extern "C" time_t time(time_t* out) {
+    if (out) {
+        *out = hostTime;
+    }
+    return hostTime;
+}
+
+void configTime(long gmtOffsetSeconds, int daylightOffsetSeconds, const char* server1,
+                const char* server2, const char* server3) {}
+
+bool getLocalTime(struct tm* info, uint32_t timeoutMs) {
+    if (hostTime == 0) {
+        return false;
+    }
+    gmtime_r(&hostTime, info);
+    return true;
+}
+
+int xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stack, void* param,
+                            unsigned priority, TaskHandle_t* handle, int core) {
+    return pdPASS;  // Never started; the tests call what they need directly
+}
+
+void vTaskDelay(TickType_t ticks) {}
+
+// SHA-256 (FIPS 180-4), plain and unoptimized
+struct mbedtls_md_info_t {
+    int unused;
+};
+
+static void sha256Block(uint32_t* state, const uint8_t* block) {
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
+        0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
+        0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
+        0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+        0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
+        0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
+        0xc67178f2};
+    auto rotr = [](uint32_t x, int n) { return (x >> n) | (x << (32 - n)); };
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)block[i * 4] << 24 | block[i * 4 + 1] << 16 | block[i * 4 + 2] << 8 |
+               block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t v[8];
+    memcpy(v, state, sizeof(v));
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = rotr(v[4], 6) ^ rotr(v[4], 11) ^ rotr(v[4], 25);
+        uint32_t t1 = v[7] + s1 + ((v[4] & v[5]) ^ (~v[4] & v[6])) + k[i] + w[i];
+        uint32_t s0 = rotr(v[0], 2) ^ rotr(v[0], 13) ^ rotr(v[0], 22);
+        uint32_t t2 = s0 + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        memmove(v + 1, v, 7 * sizeof(uint32_t));
+        v[4] += t1;
+        v[0] = t1 + t2;
+    }
+    for (int i = 0; i < 8; i++) {
+        state[i] += v[i];
+    }
+}
+
+// Hashes prefix then data, so HMAC needs no copy of the message
+static void sha256(const uint8_t* prefix, size_t prefixLength, const uint8_t* data,
+                   size_t length, uint8_t* out) {
+    uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                         0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    std::vector<uint8_t> message(prefix, prefix + prefixLength);
+    message.insert(message.end(), data, data + length);
+    uint64_t bits = (uint64_t)message.size() * 8;
+    message.push_back(0x80);
+    while (message.size() % 64 != 56) {
+        message.push_back(0);
+    }
+    for (int i = 7; i >= 0; i--) {
+        message.push_back(bits >> (i * 8));
+    }
+    for (size_t i = 0; i < message.size(); i += 64) {
+        sha256Block(state, message.data() + i);
+    }
+    for (int i = 0; i < 32; i++) {
+        out[i] = state[i / 4] >> (24 - (i % 4) * 8);
+    }
+}
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t type) {
+    static const mbedtls_md_info_t sha256Info = {0};
+    return type == MBEDTLS_MD_SHA256 ? &sha256Info : nullptr;
+}
+
+int mbedtls_md_hmac(const mbedtls_md_info_t* info, const unsigned char* key, size_t keyLength,
+                    const unsigned char* input, size_t length, unsigned char* output) {
+    if (!info) {
+        return -1;
+    }
+    uint8_t block[64] = {};
+    if (keyLength > sizeof(block)) {
+        sha256(nullptr, 0, key, keyLength, block);
+    } else {
+        memcpy(block, key, keyLength);
+    }
+    uint8_t pad[64];
+    uint8_t inner[32];
+    for (int i = 0; i < 64; i++) {
+        pad[i] = block[i] ^ 0x36;
+    }
+    sha256(pad, sizeof(pad), input, length, inner);
+    for (int i = 0; i < 64; i++) {
+        pad[i] = block[i] ^ 0x5c;
+    }
+    sha256(pad, sizeof(pad), inner, sizeof(inner), output);
+    return 0;
+}
+
+std::vector<HostDnsLookup> hostDnsLookups;
+
+int ipaddr_aton(const char* text, ip_addr_t* address) {
+    struct in_addr parsed;
+    if (inet_pton(AF_INET, text, &parsed) != 1) {
+        return 0;
+    }
+    address->ip4.addr = parsed.s_addr;
+    return 1;
+}
+
+err_t dns_gethostbyname(const char* name, ip_addr_t* address, dns_found_callback callback,
+                        void* arg) {
+    if (name == nullptr || name[0] == '\0') {
+        return ERR_ARG;
+    }
+    hostDnsLookups.push_back({name, callback, arg});
+    return ERR_INPROGRESS;
+}
+
+void hostDnsAnswer(size_t index, const char* ip) {
+    const HostDnsLookup& lookup = hostDnsLookups.at(index);
+    ip_addr_t address;
+    if (ip && ipaddr_aton(ip, &address)) {
+        lookup.callback(lookup.name.c_str(), &address, lookup.arg);
+    } else {
+        lookup.callback(lookup.name.c_str(), nullptr, lookup.arg);
+    }
+}
+
+size_t File::size() const {
+    return fs ? fs->files[path].size() : 0;
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+    if (!fs) {
+        return 0;
+    }
+    const std::vector<uint8_t>& data = fs->files[path];
+    size_t length = pos < data.size() ? std::min(size, data.size() - pos) : 0;
+    memcpy(buffer, data.data() + pos, length);
+    pos += length;
+    return length;
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    if (!fs) {
+        return 0;
+    }
+    std::vector<uint8_t>& data = fs->files[path];
+    data.insert(data.end(), buffer, buffer + size);
+    return size;
+}
+
+bool File::seek(uint32_t position) {
+    if (position > size()) {
+        return false;
+    }
+    pos = position;
+    return true;
+}
+
+bool LittleFSFS::rename(const char* from, const char* to) {
+    if (!exists(from)) {
+        return false;
+    }
+    files[to] = files[from];
+    files.erase(from);
+    return true;
+}
+
+File LittleFSFS::open(const char* path, const char* mode) {
+    if (mode[0] == 'r' && !exists(path)) {
+        return File();
+    }
+    if (mode[0] == 'w') {
+        files[path].clear();
+    } else {
+        files[path];
+    }
+    return File(this, path);
+}
+
+DateTime::DateTime(uint32_t unixTime) {
+    time_t t = unixTime;
+    struct tm parts;
+    gmtime_r(&t, &parts);
+    yearValue = parts.tm_year + 1900;
+    monthValue = parts.tm_mon + 1;
+    dayValue = parts.tm_mday;
+    hourValue = parts.tm_hour;
+    minuteValue = parts.tm_min;
+    secondValue = parts.tm_sec;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute,
+                   uint8_t second)
+    : yearValue(year),
+      monthValue(month),
+      dayValue(day),
+      hourValue(hour),
+      minuteValue(minute),
+      secondValue(second) {}
+
+uint8_t DateTime::dayOfTheWeek() const {
+    // As RTClib: days since 2000-01-01, which was a Saturday
+    static const uint8_t daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30};
+    uint16_t yearOffset = yearValue - 2000;
+    uint16_t days = dayValue;
+    for (uint8_t i = 1; i < monthValue; i++) {
+        days += daysInMonth[i - 1];
+    }
+    if (monthValue > 2 && yearOffset % 4 == 0) {
+        days++;
+    }
+    days += 365 * yearOffset + (yearOffset + 3) / 4 - 1;
+    return (days + 6) % 7;
+}
+
+uint32_t DateTime::unixtime() const {
+    struct tm parts = {};
+    parts.tm_year = yearValue - 1900;
+    parts.tm_mon = monthValue - 1;
+    parts.tm_mday = dayValue;
+    parts.tm_hour = hourValue;
+    parts.tm_min = minuteValue;
+    parts.tm_sec = secondValue;
+    return timegm(&parts);
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    for (int16_t row = y; row < y + h; row++) {
+        for (int16_t col = x; col < x + w; col++) {
+            drawPixel(col, row, color);
+        }
+    }
+}
+
+void Adafruit_GFX::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+    int dx = abs(x1 - x0);
+    int dy = -abs(y1 - y0);
+    int stepX = x0 < x1 ? 1 : -1;
+    int stepY = y0 < y1 ? 1 : -1;
+    int error = dx + dy;
+    while (true) {
+        drawPixel(x0, y0, color);
+        if (x0 == x1 && y0 == y1) {
+            return;
+        }
+        if (2 * error >= dy) {
+            error += dy;
+            x0 += stepX;
+        }
+        if (2 * error <= dx) {
+            error += dx;
+            y0 += stepY;
+        }
+    }
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y, h, color);
+    drawFastVLine(x + w - 1, y, h, color);
+}
+
+void Adafruit_GFX::drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+    for (int16_t y = -r; y <= r; y++) {
+        for (int16_t x = -r; x <= r; x++) {
+            int d = x * x + y * y;
+            if (d <= r * r && d > (r - 1) * (r - 1)) {
+                drawPixel(x0 + x, y0 + y, color);
+            }
+        }
+    }
+}
+
+void Adafruit_GFX::fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+    for (int16_t y = -r; y <= r; y++) {
+        for (int16_t x = -r; x <= r; x++) {
+            if (x * x + y * y <= r * r) {
+                drawPixel(x0 + x, y0 + y, color);
+            }
+        }
+    }
+}
+
+void Adafruit_GFX::getTextBounds(const char* text, int16_t x, int16_t y, int16_t* x1,
+                                 int16_t* y1, uint16_t* w, uint16_t* h) {
+    size_t length = strlen(text);
+    *x1 = x;
+    *y1 = y;
+    *w = length * 6 * textSize;
+    *h = length ? 8 * textSize : 0;
+}
+
+size_t Adafruit_GFX::write(uint8_t c) {
+    if (c != ' ') {
+        fillRect(cursorX, cursorY, 5 * textSize, 7 * textSize, textColor);
+    }
+    cursorX += 6 * textSize;
+    return 1;
+}
+
+size_t Adafruit_GFX::print(const char* text) {
+    size_t count = 0;
+    while (*text) {
+        count += write((uint8_t)*text++);
+    }
+    return count;
+}
+
+void GFXcanvas1::drawPixel(int16_t x, int16_t y, uint16_t color) {
+    if (x < 0 || x >= _width || y < 0 || y >= _height) {
+        return;
+    }
+    uint8_t& byte = buffer[y * ((_width + 7) / 8) + x / 8];
+    uint8_t bit = 0x80 >> (x & 7);
+    byte = color ? byte | bit : byte & ~bit;
+}
+
+bool GFXcanvas1::getPixel(int16_t x, int16_t y) const {
+    if (x < 0 || x >= _width || y < 0 || y >= _height) {
+        return false;
+    }
+    return buffer[y * ((_width + 7) / 8) + x / 8] & (0x80 >> (x & 7));
+}
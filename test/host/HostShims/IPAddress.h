@@ -0,0 +1,35 @@
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <Arduino.h>
+
+class IPAddress {
+   public:
+    IPAddress() : address(0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+    explicit IPAddress(uint32_t address) : address(address) {}
+
+    // Dotted quad; false (and unchanged) for anything else
+    bool fromString(const char* text) {
+        unsigned a, b, c, d;
+        char end;
+        if (sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4 || a > 255 || b > 255 ||
+            c > 255 || d > 255) {
+            return false;
+        }
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+    operator uint32_t() const {
+        return address;
+    }
+    uint8_t operator[](int index) const {
+        return address >> (8 * index);
+    }
+
+   private:
+    uint32_t address;  // First octet in the low byte, as the ESP32 core
+};
+
+#endif  // HOST_IPADDRESS_H
@@ -0,0 +1,61 @@
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+// LittleFS kept in RAM. Tests reach the file contents through LittleFS.files, to cut a log
+// short or corrupt it between runs.
+#include <Arduino.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+class LittleFSFS;
+
+class File : public Stream {
+   public:
+    File() : fs(nullptr), pos(0) {}
+    File(LittleFSFS* fs, const char* path) : fs(fs), path(path), pos(0) {}
+
+    explicit operator bool() const {
+        return fs != nullptr;
+    }
+    size_t size() const;
+    size_t read(uint8_t* buffer, size_t size);
+    size_t write(const uint8_t* buffer, size_t size) override;
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+    bool seek(uint32_t position);
+    size_t position() const {
+        return pos;
+    }
+    void close() {
+        fs = nullptr;
+    }
+
+   private:
+    LittleFSFS* fs;
+    std::string path;
+    size_t pos;
+};
+
+class LittleFSFS {
+   public:
+    std::map<std::string, std::vector<uint8_t>> files;
+
+    bool begin(bool formatOnFail = false) {
+        return true;
+    }
+    bool exists(const char* path) const {
+        return files.count(path) != 0;
+    }
+    bool remove(const char* path) {
+        return files.erase(path) != 0;
+    }
+    bool rename(const char* from, const char* to);
+    // "r" fails for a missing file, "w" truncates, "a" appends
+    File open(const char* path, const char* mode);
+};
+extern LittleFSFS LittleFS;
+
+#endif  // HOST_LITTLEFS_H
@@ -0,0 +1,19 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+// Station state only; a test sets connected
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <WiFiUdp.h>
+
+class WiFiClass {
+   public:
+    bool connected = false;
+
+    bool isConnected() const {
+        return connected;
+    }
+};
+extern WiFiClass WiFi;
+
+#endif  // HOST_WIFI_H
@@ -0,0 +1,69 @@
+#ifndef HOST_WIFIUDP_H
+#define HOST_WIFIUDP_H
+
+// A socket with no network: packets a test queues in inbox are read back one per
+// parsePacket(), and sent packets are kept in sent
+#include <Arduino.h>
+#include <IPAddress.h>
+
+#include <deque>
+#include <vector>
+
+class WiFiUDP : public Stream {
+   public:
+    std::deque<std::vector<uint8_t>> inbox;
+    std::vector<std::vector<uint8_t>> sent;
+
+    uint8_t begin(uint16_t port) {
+        return 1;
+    }
+    uint8_t beginMulticast(IPAddress group, uint16_t port) {
+        return 1;
+    }
+    void stop() {}
+
+    int beginPacket(IPAddress address, uint16_t port) {
+        outgoing.clear();
+        return 1;
+    }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        outgoing.insert(outgoing.end(), buffer, buffer + size);
+        return size;
+    }
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+    int endPacket() {
+        sent.push_back(outgoing);
+        return 1;
+    }
+
+    int parsePacket() {
+        if (inbox.empty()) {
+            return 0;
+        }
+        packet = inbox.front();
+        inbox.pop_front();
+        readPos = 0;
+        return packet.size();
+    }
+    int read(uint8_t* buffer, size_t size) {
+        size_t length = std::min(size, packet.size() - readPos);
+        memcpy(buffer, packet.data() + readPos, length);
+        readPos += length;
+        return length;
+    }
+    int read() override {
+        return readPos < packet.size() ? packet[readPos++] : -1;
+    }
+    int available() override {
+        return packet.size() - readPos;
+    }
+
+   private:
+    std::vector<uint8_t> outgoing;
+    std::vector<uint8_t> packet;
+    size_t readPos = 0;
+};
+
+#endif  // HOST_WIFIUDP_H
@@ -0,0 +1,31 @@
+#ifndef HOST_LWIP_DNS_H
+#define HOST_LWIP_DNS_H
+
+#include <lwip/ip_addr.h>
+
+#include <string>
+#include <vector>
+
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_INPROGRESS -5
+#define ERR_ARG -16
+
+typedef void (*dns_found_callback)(const char* name, const ip_addr_t* address, void* arg);
+
+// Every name lookup stays pending until the test answers it with hostDnsAnswer(), in any
+// order and as late as it likes, the way lwIP's callbacks can arrive
+err_t dns_gethostbyname(const char* name, ip_addr_t* address, dns_found_callback callback,
+                        void* arg);
+
+struct HostDnsLookup {
+    std::string name;
+    dns_found_callback callback;
+    void* arg;
+};
+extern std::vector<HostDnsLookup> hostDnsLookups;
+
+// Calls back lookup `index` with ip, or with no address when ip is null
+void hostDnsAnswer(size_t index, const char* ip);
+
+#endif  // HOST_LWIP_DNS_H
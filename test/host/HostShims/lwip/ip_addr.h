@@ -0,0 +1,20 @@
+#ifndef HOST_LWIP_IP_ADDR_H
+#define HOST_LWIP_IP_ADDR_H
+
+#include <stdint.h>
+
+// IPv4 only; addr is in network byte order as in lwIP
+typedef struct {
+    uint32_t addr;
+} ip4_addr_t;
+
+typedef struct {
+    ip4_addr_t ip4;
+} ip_addr_t;
+
+#define ip_2_ip4(address) (&(address)->ip4)
+
+// 1 when text is a dotted IPv4 address
+int ipaddr_aton(const char* text, ip_addr_t* address);
+
+#endif  // HOST_LWIP_IP_ADDR_H
@@ -0,0 +1,248 @@
+// AnimationPlayer on the host: files built here the way tools/frame_codec.py writes them,
+// played from the in-memory LittleFS onto the host canvas.
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+#include <vector>
+
+#include "AnimationPlayer.h"
+
+#define DELAY_MS 50
+#define FRAME_US (DELAY_MS * 1000UL)
+
+static uint8_t pins[6] = {};
+static Adafruit_Protomatter matrix(MATRIX_WIDTH, BIT_DEPTH, 1, pins, 4, pins, 0, 0, 0, true);
+static SettingsManager settings;
+static Metrics metrics;
+static EventStream events;
+static VideoWall wall(&settings);
+static MatrixDisplayManager display(&matrix, &settings, &events, &wall, &metrics);
+static AnimationPlayer* player;
+
+// One frame to encode: every pixel in `color`, except the rectangle from (x, y) to the
+// bottom right corner, which is `patch`
+struct TestFrame {
+    bool key;
+    uint16_t color;
+    uint16_t patch;
+    int x;
+    int y;
+
+    uint16_t at(int px, int py) const {
+        return px >= x && py >= y ? patch : color;
+    }
+};
+
+static void put16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+}
+
+static void put32(std::vector<uint8_t>& out, uint32_t value) {
+    put16(out, value & 0xFFFF);
+    put16(out, value >> 16);
+}
+
+// Every row coded as literal runs of 16 values; deltas hold the XOR against `previous`
+static std::vector<uint8_t> encodeFrame(const TestFrame& frame, const TestFrame* previous) {
+    std::vector<uint8_t> out = {'F', 'C', FRAME_CODEC_VERSION,
+                                (uint8_t)(frame.key ? 0 : FRAME_CODEC_DELTA)};
+    put16(out, MATRIX_WIDTH);
+    put16(out, MATRIX_HEIGHT);
+    for (int i = 0; i < (MATRIX_HEIGHT + 7) / 8; i++) {
+        out.push_back(0xFF);
+    }
+    for (int y = 0; y < MATRIX_HEIGHT; y++) {
+        std::vector<uint8_t> row;
+        for (int x = 0; x < MATRIX_WIDTH; x++) {
+            if (x % 16 == 0) {
+                row.push_back(FRAME_CODEC_RUN_LITERAL | 15);
+            }
+            uint16_t value = frame.at(x, y);
+            put16(row, frame.key ? value : value ^ previous->at(x, y));
+        }
+        put16(out, row.size());
+        out.insert(out.end(), row.begin(), row.end());
+    }
+    return out;
+}
+
+static std::vector<uint8_t> encodeAnimation(const std::vector<TestFrame>& frames) {
+    std::vector<uint8_t> out = {'F', 'C', 'A', 'N', ANIMATION_VERSION, 0};
+    put16(out, MATRIX_WIDTH);
+    put16(out, MATRIX_HEIGHT);
+    put16(out, frames.size());
+    put32(out, 0);
+    std::vector<uint8_t> chunks;
+    size_t offset = ANIMATION_HEADER_SIZE + frames.size() * 4;
+    for (size_t i = 0; i < frames.size(); i++) {
+        put32(out, (offset + chunks.size()) | (frames[i].key ? ANIMATION_INDEX_KEY : 0));
+        std::vector<uint8_t> frame = encodeFrame(frames[i], i > 0 ? &frames[i - 1] : nullptr);
+        put16(chunks, frame.size());
+        put16(chunks, DELAY_MS);
+        chunks.insert(chunks.end(), frame.begin(), frame.end());
+    }
+    out.insert(out.end(), chunks.begin(), chunks.end());
+    return out;
+}
+
+static void load(const std::vector<TestFrame>& frames) {
+    LittleFS.files[ANIMATION_UPLOAD_PATH] = encodeAnimation(frames);
+    TEST_ASSERT_TRUE(AnimationPlayer::validate(ANIMATION_UPLOAD_PATH));
+    player->install();
+}
+
+// Advances the animation clock and draws onto a cleared canvas
+static void render(uint32_t us) {
+    player->tick(us);
+    display.clearScreen();
+    player->render();
+}
+
+static uint16_t pixel(int x, int y) {
+    return matrix.getBuffer()[y * MATRIX_WIDTH + x];
+}
+
+void setUp(void) {
+    LittleFS.files.clear();
+    delete player;
+    player = new AnimationPlayer(&display, &settings);
+}
+
+void tearDown(void) {}
+
+void test_frames_play_in_order_and_loop(void) {
+    load({{true, 0xF800, 0xF800, 0, 0}, {true, 0x07E0, 0x07E0, 0, 0},
+          {true, 0x001F, 0x001F, 0, 0}});
+    const uint16_t expected[] = {0xF800, 0x07E0, 0x001F, 0xF800, 0x07E0};
+    render(0);
+    TEST_ASSERT_TRUE(player->isLoaded());
+    TEST_ASSERT_EQUAL_HEX16(expected[0], pixel(0, 0));
+    for (int i = 1; i < 5; i++) {
+        render(FRAME_US);
+        TEST_ASSERT_EQUAL_HEX16(expected[i], pixel(0, 0));
+    }
+    TEST_ASSERT_EQUAL_UINT32(5, player->getStats().frames);
+    TEST_ASSERT_EQUAL_UINT32(1, player->getStats().loops);
+}
+
+void test_a_frame_stays_until_its_delay_is_over(void) {
+    load({{true, 0xF800, 0xF800, 0, 0}, {true, 0x07E0, 0x07E0, 0, 0}});
+    render(0);
+    render(FRAME_US / 2);
+    TEST_ASSERT_EQUAL_HEX16(0xF800, pixel(0, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, player->getStats().redrawn);
+    render(FRAME_US / 2);
+    TEST_ASSERT_EQUAL_HEX16(0x07E0, pixel(0, 0));
+}
+
+void test_deltas_change_only_what_they_code(void) {
+    load({{true, 0x1234, 0x1234, 0, 0}, {false, 0x1234, 0xFFFF, 108, 27},
+          {false, 0x1234, 0x0841, 120, 29}});
+    render(0);
+    render(FRAME_US);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, pixel(0, 0));
+    TEST_ASSERT_EQUAL_HEX16(0xFFFF, pixel(110, 28));
+    render(FRAME_US);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, pixel(110, 28));
+    TEST_ASSERT_EQUAL_HEX16(0x0841, pixel(MATRIX_WIDTH - 1, MATRIX_HEIGHT - 1));
+}
+
+// Behind by more than ANIMATION_MAX_CATCHUP frames, playback jumps to the key frame that is
+// due instead of decoding every delta on the way
+void test_falling_behind_skips_to_a_key_frame(void) {
+    std::vector<TestFrame> frames = {{true, 0x0001, 0x0001, 0, 0}};
+    for (uint16_t i = 2; i <= 6; i++) {
+        frames.push_back({false, i, i, 0, 0});
+    }
+    frames.push_back({true, 0x7777, 0x7777, 0, 0});
+    frames.push_back({false, 0x8888, 0x8888, 0, 0});
+    load(frames);
+    render(0);
+    render(6 * FRAME_US);  // Frame 6, the key frame, is due
+    TEST_ASSERT_EQUAL_HEX16(0x7777, pixel(0, 0));
+    TEST_ASSERT_TRUE(player->getStats().skipped > 0);
+    TEST_ASSERT_TRUE(player->getStats().frames < 7);
+    render(FRAME_US);
+    TEST_ASSERT_EQUAL_HEX16(0x8888, pixel(0, 0));
+}
+
+void test_text_clearance_is_left_clear(void) {
+    load({{true, 0xFFFF, 0xFFFF, 0, 0}});
+    render(0);
+    int blocked = 0;
+    for (int y = 0; y < MATRIX_HEIGHT; y++) {
+        for (int x = 0; x < MATRIX_WIDTH; x++) {
+            uint8_t level = display.getTextHaloLevel(x, y);
+            if (level == 0) {
+                TEST_ASSERT_EQUAL_HEX16(0, pixel(x, y));
+                blocked++;
+            } else if (level == 255) {
+                TEST_ASSERT_EQUAL_HEX16(0xFFFF, pixel(x, y));
+            }
+        }
+    }
+    TEST_ASSERT_TRUE(blocked > 0);
+}
+
+void test_validate_rejects_malformed_files(void) {
+    std::vector<TestFrame> frames = {{true, 1, 1, 0, 0}, {false, 2, 2, 0, 0}};
+    std::vector<uint8_t> good = encodeAnimation(frames);
+
+    std::vector<uint8_t> file = good;
+    file.pop_back();  // Truncated
+    LittleFS.files["/a"] = file;
+    TEST_ASSERT_FALSE(AnimationPlayer::validate("/a"));
+
+    file = good;
+    file[0] = 'X';  // Not an animation
+    LittleFS.files["/a"] = file;
+    TEST_ASSERT_FALSE(AnimationPlayer::validate("/a"));
+
+    file = good;
+    file[6] ^= 1;  // Made for another panel width
+    LittleFS.files["/a"] = file;
+    TEST_ASSERT_FALSE(AnimationPlayer::validate("/a"));
+
+    file = good;
+    file[ANIMATION_HEADER_SIZE + 3] &= 0x7F;  // Starts on a delta
+    LittleFS.files["/a"] = file;
+    TEST_ASSERT_FALSE(AnimationPlayer::validate("/a"));
+
+    LittleFS.files["/a"] = good;
+    TEST_ASSERT_TRUE(AnimationPlayer::validate("/a"));
+}
+
+// validate() does not decode the frames; a bad row stops playback on the device instead
+void test_a_corrupt_frame_stops_playback(void) {
+    std::vector<TestFrame> frames = {{true, 1, 1, 0, 0}, {false, 2, 2, 0, 0}};
+    std::vector<uint8_t> file = encodeAnimation(frames);
+    size_t second = (file[ANIMATION_HEADER_SIZE + 4] | (file[ANIMATION_HEADER_SIZE + 5] << 8));
+    size_t firstRow = second + ANIMATION_CHUNK_HEADER_SIZE + FRAME_CODEC_HEADER_SIZE +
+                      (MATRIX_HEIGHT + 7) / 8;
+    file[firstRow + 2] = FRAME_CODEC_RUN_REPEAT | 63;  // Runs past the end of the row
+    LittleFS.files[ANIMATION_UPLOAD_PATH] = file;
+    TEST_ASSERT_TRUE(AnimationPlayer::validate(ANIMATION_UPLOAD_PATH));
+    player->install();
+    render(0);
+    TEST_ASSERT_TRUE(player->isLoaded());
+    render(FRAME_US);
+    TEST_ASSERT_FALSE(player->isLoaded());
+}
+
+int main(int argc, char** argv) {
+    settings.begin();
+    settings.setBrightnessIndex(BRIGHTNESS_LEVELS - 2);  // Effects run one step up: full
+    display.begin();
+    display.setTextMaskLayout(TEXT_MASK_CLOCK, 2);
+    UNITY_BEGIN();
+    RUN_TEST(test_frames_play_in_order_and_loop);
+    RUN_TEST(test_a_frame_stays_until_its_delay_is_over);
+    RUN_TEST(test_deltas_change_only_what_they_code);
+    RUN_TEST(test_falling_behind_skips_to_a_key_frame);
+    RUN_TEST(test_text_clearance_is_left_clear);
+    RUN_TEST(test_validate_rejects_malformed_files);
+    RUN_TEST(test_a_corrupt_frame_stops_playback);
+    return UNITY_END();
+}
@@ -0,0 +1,140 @@
+// EffectsEngine on the host canvas: no effect draws inside the text clearance, Warp's jump
+// schedule, and its per-frame cost against Stars, the effect it has to stay cheaper than.
+#include <Arduino.h>
+#include <unity.h>
+
+#include <chrono>
+#include <vector>
+
+#include "EffectsEngine.h"
+
+#define FRAME_MS 16  // The loop shows about 60 frames a second, so half of them run a tick
+
+static uint8_t pins[6] = {};
+static Adafruit_Protomatter matrix(MATRIX_WIDTH, BIT_DEPTH, 1, pins, 4, pins, 0, 0, 0, true);
+static SettingsManager settings;
+static Metrics metrics;
+static EventStream events;
+static VideoWall wall(&settings);
+static MatrixDisplayManager display(&matrix, &settings, &events, &wall, &metrics);
+static AnimationPlayer animation(&display, &settings);
+static EffectsEngine effects(&display, &settings, &wall, &animation, &metrics);
+
+// One pass of the display loop: clear, run the effects, show
+static void frame() {
+    hostMillis += FRAME_MS;
+    display.clearScreen();
+    effects.updateEffects();
+    display.show();
+}
+
+static int litPixels() {
+    const uint16_t* pixels = matrix.getBuffer();
+    int lit = 0;
+    for (int i = 0; i < MATRIX_WIDTH * MATRIX_HEIGHT; i++) {
+        lit += pixels[i] != 0;
+    }
+    return lit;
+}
+
+static void startEffect(EffectMode mode) {
+    settings.setEffectMode(mode);
+    randomSeed(1);
+    effects.begin();
+}
+
+void setUp(void) {
+    hostMillis = 1000;
+    effects.setDisplayMode(SHOW_TIME);
+}
+
+void tearDown(void) {}
+
+// Every effect goes through the text mask: over 20000 frames of each, no pixel where the halo
+// level is 0 is ever lit
+void test_effects_keep_out_of_the_text_clearance(void) {
+    const EffectMode modes[] = {EFFECT_CONFETTI, EFFECT_ACID,      EFFECT_RAIN,
+                                EFFECT_TORRENT,  EFFECT_STARS,     EFFECT_SPARKLES,
+                                EFFECT_TRON,     EFFECT_FIREWORKS, EFFECT_WARP};
+    for (EffectMode mode : modes) {
+        startEffect(mode);
+        std::vector<int> blocked;
+        for (int f = 0; f < 20000; f++) {
+            hostMillis += FRAME_MS;
+            display.clearScreen();
+            effects.updateEffects();
+            if (blocked.empty()) {  // The mask is laid out on the first frame
+                for (int i = 0; i < MATRIX_WIDTH * MATRIX_HEIGHT; i++) {
+                    if (display.getTextHaloLevel(i % MATRIX_WIDTH, i / MATRIX_WIDTH) == 0) {
+                        blocked.push_back(i);
+                    }
+                }
+                TEST_ASSERT_FALSE(blocked.empty());
+            }
+            const uint16_t* pixels = matrix.getBuffer();
+            for (int i : blocked) {
+                if (pixels[i] != 0) {
+                    char report[64];
+                    snprintf(report, sizeof(report), "effect %d lit (%d, %d) on frame %d", mode,
+                             i % MATRIX_WIDTH, i / MATRIX_WIDTH, f);
+                    TEST_FAIL_MESSAGE(report);
+                }
+            }
+        }
+    }
+}
+
+// The jump schedule is kept on millis() deadlines; it has to keep working across the 49-day
+// rollover. A jump draws streaks, so it shows up as a frame with many more lit pixels.
+void test_warp_jumps_across_millis_rollover(void) {
+    hostMillis = 0xFFFFFFFFUL - 20000;
+    startEffect(EFFECT_WARP);
+    int cruise = 0;
+    int most = 0;
+    for (int f = 0; f < 90000 / FRAME_MS; f++) {
+        frame();
+        if (f == 50) {
+            cruise = litPixels();
+        }
+        most = max(most, litPixels());
+    }
+    TEST_ASSERT_TRUE((uint32_t)millis() < 90000);  // The 32-bit clock did wrap
+    TEST_ASSERT_TRUE(most > cruise * 2);
+}
+
+static double nsPerFrame(EffectMode mode, long frames) {
+    startEffect(mode);
+    auto start = std::chrono::steady_clock::now();
+    for (long f = 0; f < frames; f++) {
+        hostMillis += FRAME_MS;
+        effects.updateEffects();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / frames;
+}
+
+// Effects work only (no clear or show), over 10 simulated minutes so Warp makes its jumps.
+// Best of a few interleaved runs, so one noisy run on a busy host doesn't decide it.
+void test_benchmark_warp_against_stars(void) {
+    const long frames = 10L * 60 * 1000 / FRAME_MS;
+    double stars = 1e9;
+    double warp = 1e9;
+    for (int run = 0; run < 3; run++) {
+        stars = min(stars, nsPerFrame(EFFECT_STARS, frames));
+        warp = min(warp, nsPerFrame(EFFECT_WARP, frames));
+    }
+    char report[96];
+    snprintf(report, sizeof(report), "per frame: stars %.0f ns, warp %.0f ns (%.2fx)", stars,
+             warp, warp / stars);
+    TEST_MESSAGE(report);
+}
+
+int main(int argc, char** argv) {
+    settings.begin();
+    display.begin();
+    UNITY_BEGIN();
+    RUN_TEST(test_effects_keep_out_of_the_text_clearance);
+    RUN_TEST(test_warp_jumps_across_millis_rollover);
+    RUN_TEST(test_benchmark_warp_against_stars);
+    return UNITY_END();
+}
@@ -0,0 +1,308 @@
+// FrameCodec on the host: frames encoded here the way tools/frame_codec.py encodes them decode
+// back to the same pixels, malformed frames are refused without reading past their end, and
+// a decode benchmark.
+#include <Arduino.h>
+#include <unity.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <vector>
+
+#include "FrameCodec.h"
+
+#define WIDTH 128
+#define HEIGHT 32
+#define PIXELS (WIDTH * HEIGHT)
+#define RUN_MAX 64
+#define LITERAL_MAX 128
+
+typedef std::vector<uint16_t> Frame;
+
+static void put16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+}
+
+// encode_runs() from tools/frame_codec.py
+static void encodeRuns(const uint16_t* row, const std::map<uint16_t, uint8_t>* index,
+                       std::vector<uint8_t>& out) {
+    std::vector<uint16_t> literal;
+    auto value = [&](uint16_t v) {
+        if (index) {
+            out.push_back(index->at(v));
+        } else {
+            put16(out, v);
+        }
+    };
+    auto flush = [&]() {
+        for (size_t start = 0; start < literal.size(); start += LITERAL_MAX) {
+            size_t count = std::min(literal.size() - start, (size_t)LITERAL_MAX);
+            out.push_back(FRAME_CODEC_RUN_LITERAL | (count - 1));
+            for (size_t i = 0; i < count; i++) {
+                value(literal[start + i]);
+            }
+        }
+        literal.clear();
+    };
+
+    int i = 0;
+    while (i < WIDTH) {
+        uint16_t v = row[i];
+        int j = i + 1;
+        while (j < WIDTH && row[j] == v) {
+            j++;
+        }
+        int run = j - i;
+        if (v == 0 && (run >= 2 || literal.empty())) {
+            flush();
+            for (int start = 0; start < run; start += RUN_MAX) {
+                out.push_back(FRAME_CODEC_RUN_ZERO | (std::min(RUN_MAX, run - start) - 1));
+            }
+        } else if (run >= 3 || (run == 2 && literal.empty())) {
+            flush();
+            for (int start = 0; start < run; start += RUN_MAX) {
+                out.push_back(FRAME_CODEC_RUN_REPEAT | (std::min(RUN_MAX, run - start) - 1));
+                value(v);
+            }
+        } else {
+            literal.insert(literal.end(), row + i, row + j);
+        }
+        i = j;
+    }
+    flush();
+}
+
+// encode_with() from tools/frame_codec.py; a delta when previous is given
+static std::vector<uint8_t> encode(const Frame& pixels, const Frame* previous, bool palette) {
+    Frame values = pixels;
+    if (previous) {
+        for (int i = 0; i < PIXELS; i++) {
+            values[i] ^= (*previous)[i];
+        }
+    }
+    std::map<uint16_t, uint8_t> index;
+    if (palette) {
+        Frame distinct = values;
+        std::sort(distinct.begin(), distinct.end());
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+        TEST_ASSERT_TRUE(distinct.size() <= FRAME_CODEC_PALETTE_MAX);
+        for (size_t i = 0; i < distinct.size(); i++) {
+            index[distinct[i]] = i;
+        }
+    }
+
+    std::vector<uint8_t> out = {'F', 'C', FRAME_CODEC_VERSION,
+                                (uint8_t)((previous ? FRAME_CODEC_DELTA : 0) |
+                                          (palette ? FRAME_CODEC_PALETTE : 0))};
+    put16(out, WIDTH);
+    put16(out, HEIGHT);
+    uint8_t mask[HEIGHT / 8] = {};
+    std::vector<uint8_t> rows;
+    for (int y = 0; y < HEIGHT; y++) {
+        const uint16_t* row = values.data() + y * WIDTH;
+        if (std::all_of(row, row + WIDTH, [](uint16_t v) { return v == 0; })) {
+            continue;
+        }
+        mask[y >> 3] |= 1 << (y & 7);
+        std::vector<uint8_t> runs;
+        encodeRuns(row, palette ? &index : nullptr, runs);
+        put16(rows, runs.size());
+        rows.insert(rows.end(), runs.begin(), runs.end());
+    }
+    out.insert(out.end(), mask, mask + sizeof(mask));
+    if (palette) {
+        out.push_back(index.size() & 0xFF);
+        for (auto& entry : index) {
+            put16(out, entry.first);
+        }
+    }
+    out.insert(out.end(), rows.begin(), rows.end());
+    return out;
+}
+
+static uint32_t rng = 12345;
+static uint16_t next() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+// Frame n of a scene with flat areas, a gradient, a moving block and some noise, so every run
+// type turns up
+static Frame scene(int n, int colors) {
+    Frame frame(PIXELS);
+    for (int y = 0; y < HEIGHT; y++) {
+        for (int x = 0; x < WIDTH; x++) {
+            uint16_t color = 0;
+            if (y >= 24) {
+                color = (x % colors) * 0x0841;  // Gradient
+            } else if (x >= (n * 3) % WIDTH && x < (n * 3) % WIDTH + 20 && y >= 4 && y < 16) {
+                color = 0xF800 + n % colors;  // Moving block
+            } else if (y < 2) {
+                color = next() % colors;  // Noise
+            }
+            frame[y * WIDTH + x] = color;
+        }
+    }
+    return frame;
+}
+
+static void assertDecodes(const std::vector<uint8_t>& data, Frame& frame,
+                          const Frame& expected) {
+    TEST_ASSERT_TRUE(FrameCodec::decode(data.data(), data.size(), frame.data(), WIDTH, HEIGHT));
+    TEST_ASSERT_EQUAL_MEMORY(expected.data(), frame.data(), PIXELS * 2);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_key_frames_round_trip(void) {
+    for (int palette = 0; palette < 2; palette++) {
+        for (int n = 0; n < 20; n++) {
+            Frame expected = scene(n, palette ? 100 : 65536);
+            Frame frame(PIXELS, 0xBEEF);  // Whatever was there before
+            assertDecodes(encode(expected, nullptr, palette), frame, expected);
+        }
+    }
+}
+
+void test_deltas_round_trip_over_a_clip(void) {
+    for (int palette = 0; palette < 2; palette++) {
+        Frame previous = scene(0, 50);
+        Frame frame = previous;
+        for (int n = 1; n < 60; n++) {
+            Frame expected = scene(n, 50);
+            assertDecodes(encode(expected, &previous, palette), frame, expected);
+            previous = expected;
+        }
+    }
+}
+
+void test_uncoded_rows_are_black_in_key_frames_and_kept_in_deltas(void) {
+    Frame lit(PIXELS, 0x1234);
+    Frame blank(PIXELS, 0);
+    std::vector<uint8_t> key = encode(blank, nullptr, false);
+    TEST_ASSERT_EQUAL_size_t(FRAME_CODEC_HEADER_SIZE + HEIGHT / 8, key.size());
+    Frame frame = lit;
+    assertDecodes(key, frame, blank);
+
+    std::vector<uint8_t> unchanged = encode(lit, &lit, false);
+    TEST_ASSERT_EQUAL_size_t(FRAME_CODEC_HEADER_SIZE + HEIGHT / 8, unchanged.size());
+    frame = lit;
+    assertDecodes(unchanged, frame, lit);
+}
+
+// A frame without two equal neighbouring pixels is all literals, the size PixelStream sizes its
+// buffers for
+void test_worst_case_size(void) {
+    Frame alternating(PIXELS);
+    for (int i = 0; i < PIXELS; i++) {
+        alternating[i] = 1 + i % 2;
+    }
+    std::vector<uint8_t> data = encode(alternating, nullptr, false);
+    TEST_ASSERT_EQUAL_size_t(FRAME_CODEC_MAX_BYTES(WIDTH, HEIGHT), data.size());
+    TEST_ASSERT_EQUAL_size_t(8300, data.size());
+    TEST_ASSERT_TRUE(encode(alternating, nullptr, true).size() < data.size());
+}
+
+// Every prefix of a valid frame is refused, and the decoder reads only the bytes it was given
+// (checked under AddressSanitizer by copying each prefix to its own allocation)
+void test_truncated_frames_are_refused(void) {
+    Frame previous = scene(3, 100);
+    const std::vector<uint8_t> frames[] = {encode(scene(4, 100), nullptr, false),
+                                           encode(scene(4, 100), &previous, true)};
+    for (const std::vector<uint8_t>& data : frames) {
+        for (size_t length = 0; length < data.size(); length++) {
+            std::vector<uint8_t> prefix(data.begin(), data.begin() + length);
+            Frame frame = previous;
+            TEST_ASSERT_FALSE(
+                FrameCodec::decode(prefix.data(), length, frame.data(), WIDTH, HEIGHT));
+        }
+    }
+}
+
+void test_malformed_frames_are_refused(void) {
+    Frame frame(PIXELS);
+    std::vector<uint8_t> good = encode(scene(1, 65536), nullptr, false);
+
+    std::vector<uint8_t> data = good;
+    data.push_back(0);  // Longer than its rows
+    TEST_ASSERT_FALSE(FrameCodec::decode(data.data(), data.size(), frame.data(), WIDTH, HEIGHT));
+
+    data = good;
+    data[2] = FRAME_CODEC_VERSION + 1;
+    TEST_ASSERT_FALSE(FrameCodec::decode(data.data(), data.size(), frame.data(), WIDTH, HEIGHT));
+
+    TEST_ASSERT_FALSE(
+        FrameCodec::decode(good.data(), good.size(), frame.data(), WIDTH / 2, HEIGHT));
+
+    // A run longer than what is left of the row
+    Frame flat(PIXELS, 0x0841);
+    data = encode(flat, nullptr, false);
+    size_t firstRun = FRAME_CODEC_HEADER_SIZE + HEIGHT / 8 + 2;
+    TEST_ASSERT_EQUAL_HEX8(FRAME_CODEC_RUN_REPEAT | (RUN_MAX - 1), data[firstRun]);
+    data[firstRun + 3] = FRAME_CODEC_RUN_LITERAL | 0x7F;
+    TEST_ASSERT_FALSE(FrameCodec::decode(data.data(), data.size(), frame.data(), WIDTH, HEIGHT));
+
+    // Palette indices past the palette decode as black instead of reading past it
+    Frame two(PIXELS, 0x0841);
+    two[0] = 0xF800;
+    data = encode(two, nullptr, true);
+    size_t row = FRAME_CODEC_HEADER_SIZE + HEIGHT / 8 + 1 + 2 * 2;
+    TEST_ASSERT_EQUAL_HEX8(FRAME_CODEC_RUN_LITERAL, data[row + 2]);
+    data[row + 3] = 200;
+    TEST_ASSERT_TRUE(FrameCodec::decode(data.data(), data.size(), frame.data(), WIDTH, HEIGHT));
+    TEST_ASSERT_EQUAL_HEX16(0, frame[0]);
+}
+
+static double nsPerDecode(const std::vector<std::vector<uint8_t>>& clip) {
+    Frame frame(PIXELS);
+    const int loops = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int loop = 0; loop < loops; loop++) {
+        for (const std::vector<uint8_t>& data : clip) {
+            FrameCodec::decode(data.data(), data.size(), frame.data(), WIDTH, HEIGHT);
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (loops * clip.size());
+}
+
+// Decode time per frame for key frames and for a clip of deltas, against the size of a raw
+// RGB888 frame
+void test_benchmark_decode(void) {
+    std::vector<std::vector<uint8_t>> keys;
+    std::vector<std::vector<uint8_t>> deltas;
+    size_t keyBytes = 0;
+    size_t deltaBytes = 0;
+    Frame previous = scene(0, 65536);
+    for (int n = 1; n <= 30; n++) {
+        Frame frame = scene(n, 65536);
+        keys.push_back(encode(frame, nullptr, false));
+        deltas.push_back(encode(frame, &previous, false));
+        keyBytes += keys.back().size();
+        deltaBytes += deltas.back().size();
+        previous = frame;
+    }
+    char report[128];
+    snprintf(report, sizeof(report),
+             "key %.0f ns/frame (%u bytes), delta %.0f ns/frame (%u bytes), raw %d bytes",
+             nsPerDecode(keys), (unsigned)(keyBytes / keys.size()), nsPerDecode(deltas),
+             (unsigned)(deltaBytes / deltas.size()), PIXELS * 3);
+    TEST_MESSAGE(report);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_key_frames_round_trip);
+    RUN_TEST(test_deltas_round_trip_over_a_clip);
+    RUN_TEST(test_uncoded_rows_are_black_in_key_frames_and_kept_in_deltas);
+    RUN_TEST(test_worst_case_size);
+    RUN_TEST(test_truncated_frames_are_refused);
+    RUN_TEST(test_malformed_frames_are_refused);
+    RUN_TEST(test_benchmark_decode);
+    return UNITY_END();
+}
@@ -0,0 +1,238 @@
+// MessageDatagramReceiver on the host: format and tag checks, the per-sender sequence window,
+// the clock check for senders without a window, eviction, and fleet dedupe
+#include <Arduino.h>
+#include <mbedtls/md.h>
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "MessageDatagram.h"
+
+#define KEY "secret"
+#define NOW 1700000000
+#define SECOND 1000000ULL  // Sequences are microseconds
+
+typedef std::vector<uint8_t> Datagram;
+
+static MessageDatagramReceiver* receiver;
+static MessageDatagram message;
+
+// encode() from tools/udp_message.py
+static Datagram encode(uint32_t sender, uint64_t sequence, const char* id = "ci",
+                       const char* text = "Build failed", uint8_t priority = 3,
+                       const char* key = KEY) {
+    size_t idLength = strlen(id);
+    size_t textLength = strlen(text);
+    Datagram out = {'M', 'Q', MESSAGE_DATAGRAM_VERSION, priority};
+    for (int i = 0; i < 4; i++) {
+        out.push_back(sender >> (i * 8));
+    }
+    for (int i = 0; i < 8; i++) {
+        out.push_back(sequence >> (i * 8));
+    }
+    out.push_back(idLength);
+    out.push_back(textLength & 0xFF);
+    out.push_back(textLength >> 8);
+    out.insert(out.end(), id, id + idLength);
+    out.insert(out.end(), text, text + textLength);
+    uint8_t mac[32];
+    mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const uint8_t*)key,
+                    strlen(key), out.data(), out.size(), mac);
+    out.insert(out.end(), mac, mac + MESSAGE_DATAGRAM_TAG_SIZE);
+    return out;
+}
+
+static DatagramStatus receive(const Datagram& data) {
+    return receiver->receive(data.data(), data.size(), message);
+}
+
+static uint64_t at(long seconds) {
+    return (uint64_t)(NOW + seconds) * SECOND;
+}
+
+void setUp(void) {
+    hostMillis = 1000;
+    hostTime = NOW;
+    delete receiver;
+    receiver = new MessageDatagramReceiver();
+    receiver->setKey(KEY);
+}
+
+void tearDown(void) {}
+
+// Built by `udp_message.encode(b"secret", 7, 1700000000000000, 3, "ci", "Build failed")`
+void test_datagram_from_udp_message_py_is_accepted(void) {
+    const Datagram fromPython = {
+        0x4D, 0x51, 0x01, 0x03, 0x07, 0x00, 0x00, 0x00, 0x00, 0x40, 0x1E, 0x18, 0x24,
+        0x0A, 0x06, 0x00, 0x02, 0x0C, 0x00, 0x63, 0x69, 0x42, 0x75, 0x69, 0x6C, 0x64,
+        0x20, 0x66, 0x61, 0x69, 0x6C, 0x65, 0x64, 0x02, 0xD1, 0x40, 0xA0, 0xF0, 0x6D,
+        0x48, 0x08, 0x31, 0xA3, 0x50, 0x39, 0x71, 0x9A, 0xE0, 0x8A};
+    TEST_ASSERT_TRUE(encode(7, at(0)) == fromPython);
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(fromPython));
+    TEST_ASSERT_EQUAL_UINT32(7, message.sender);
+    TEST_ASSERT_TRUE(message.sequence == at(0));
+    TEST_ASSERT_EQUAL_INT(MSG_PRIORITY_URGENT, message.priority);
+    TEST_ASSERT_EQUAL_STRING("ci", message.id);
+    TEST_ASSERT_EQUAL_STRING("Build failed", message.text);
+}
+
+void test_bad_mac_is_refused(void) {
+    Datagram good = encode(1, at(0));
+    for (size_t i = MESSAGE_DATAGRAM_HEADER_SIZE; i < good.size(); i++) {
+        Datagram flipped = good;
+        flipped[i] ^= 0x01;  // Id, text or tag
+        TEST_ASSERT_EQUAL_INT(DATAGRAM_BAD_TAG, receive(flipped));
+    }
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_BAD_TAG, receive(encode(1, at(0), "ci", "x", 1, "other")));
+
+    receiver->setKey("");  // UDP off
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_BAD_TAG, receive(encode(1, at(0), "ci", "x", 1, "")));
+
+    // None of them used up the sequence
+    receiver->setKey(KEY);
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(good));
+    TEST_ASSERT_EQUAL_UINT32(good.size() - MESSAGE_DATAGRAM_HEADER_SIZE + 2,
+                             receiver->getRejectedCount());
+}
+
+void test_truncated_and_malformed_are_refused(void) {
+    Datagram good = encode(1, at(0));
+    for (size_t length = 0; length < good.size(); length++) {
+        Datagram prefix(good.begin(), good.begin() + length);
+        TEST_ASSERT_EQUAL_INT(DATAGRAM_MALFORMED, receive(prefix));
+    }
+    Datagram longer = good;
+    longer.push_back(0);
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_MALFORMED, receive(longer));
+
+    const size_t fields[] = {0, 1, 2};  // Magic and version
+    for (size_t field : fields) {
+        Datagram bad = good;
+        bad[field] ^= 0x40;
+        TEST_ASSERT_EQUAL_INT(DATAGRAM_MALFORMED, receive(bad));
+    }
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_MALFORMED,
+                          receive(encode(1, at(0), "ci", "x", MESSAGE_PRIORITY_COUNT)));
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_MALFORMED, receive(encode(1, at(0), "ci", "")));
+    std::string longId(MESSAGE_ID_MAX_LENGTH + 1, 'i');
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_MALFORMED, receive(encode(1, at(0), longId.c_str())));
+    std::string longText(MESSAGE_TEXT_MAX_LENGTH + 1, 't');
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_MALFORMED, receive(encode(1, at(0), "", longText.c_str())));
+
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(good));
+}
+
+void test_sequence_window(void) {
+    uint64_t base = at(0);
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(1, base)));
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_REPLAYED, receive(encode(1, base)));
+
+    // Reordered: the newest arrives first, the ones before it are each taken once
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(1, base + 64)));
+    for (uint64_t sequence = base + 1; sequence < base + 64; sequence++) {
+        TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(1, sequence)));
+        TEST_ASSERT_EQUAL_INT(DATAGRAM_REPLAYED, receive(encode(1, sequence)));
+    }
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_REPLAYED, receive(encode(1, base)));  // 64 behind
+
+    // More than 64 behind the newest is refused, seen or not
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(1, base + 200)));
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_REPLAYED, receive(encode(1, base + 135)));
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(1, base + 136)));
+
+    // Windows are per sender
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(2, base)));
+
+    // A sender with a window is not held to the clock any more
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(1, at(3600))));
+}
+
+void test_unknown_sender_must_be_within_300_s(void) {
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_STALE, receive(encode(1, at(MESSAGE_DATAGRAM_MAX_SKEW_S + 1))));
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_STALE, receive(encode(2, at(-301))));
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(3, at(MESSAGE_DATAGRAM_MAX_SKEW_S))));
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(4, at(-300))));
+
+    // Without a wall clock there is nothing to compare against
+    hostTime = 0;
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(5, at(-86400))));
+}
+
+// More senders than windows: the idlest is evicted, and its captured datagrams must not pass
+// as the first datagram of a sender without a window
+void test_evicted_sender_cannot_replay(void) {
+    Datagram captured = encode(1, at(0));
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(captured));
+    Datagram older = encode(1, at(0) - 10);
+    for (uint32_t sender = 2; sender <= MESSAGE_DATAGRAM_SENDERS + 1; sender++) {
+        hostMillis += 1000;
+        TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(sender, at(1) + sender)));
+    }
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_REPLAYED, receive(captured));
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_REPLAYED, receive(older));
+
+    // The evicted sender carries on with fresh sequences
+    hostMillis += 1000;
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(1, at(2))));
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_REPLAYED, receive(encode(1, at(2))));
+}
+
+void test_fleet_dedupe(void) {
+    uint8_t status = 0xFF;
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(1, at(0), "drill")));
+    TEST_ASSERT_FALSE(receiver->findDelivered(message, status));
+    receiver->rememberDelivered(message, DATAGRAM_ACK_QUEUED);
+
+    // The retransmission is a new datagram with the same id
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(1, at(0) + 1, "drill")));
+    TEST_ASSERT_TRUE(receiver->findDelivered(message, status));
+    TEST_ASSERT_EQUAL_UINT8(DATAGRAM_ACK_QUEUED, status);
+
+    // Another sender's id, and messages without an id, are separate
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(2, at(0), "drill")));
+    TEST_ASSERT_FALSE(receiver->findDelivered(message, status));
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(3, at(0), "")));
+    receiver->rememberDelivered(message, DATAGRAM_ACK_QUEUED);
+    TEST_ASSERT_FALSE(receiver->findDelivered(message, status));
+
+    // Forgotten after MESSAGE_FLEET_DEDUPE_MS, or once the entries have gone round
+    TEST_ASSERT_EQUAL_INT(DATAGRAM_OK, receive(encode(1, at(0) + 2, "drill")));
+    hostMillis += MESSAGE_FLEET_DEDUPE_MS;
+    TEST_ASSERT_FALSE(receiver->findDelivered(message, status));
+    receiver->rememberDelivered(message, DATAGRAM_ACK_UPDATED);
+    TEST_ASSERT_TRUE(receiver->findDelivered(message, status));
+    TEST_ASSERT_EQUAL_UINT8(DATAGRAM_ACK_UPDATED, status);
+    MessageDatagram other = message;
+    for (int i = 0; i < MESSAGE_FLEET_DEDUPE_ENTRIES; i++) {
+        snprintf(other.id, sizeof(other.id), "m%d", i);
+        receiver->rememberDelivered(other, DATAGRAM_ACK_QUEUED);
+    }
+    TEST_ASSERT_FALSE(receiver->findDelivered(message, status));
+}
+
+void test_fleet_ack_is_signed(void) {
+    uint8_t ack[MESSAGE_FLEET_ACK_SIZE];
+    TEST_ASSERT_EQUAL_size_t(MESSAGE_FLEET_ACK_SIZE,
+                             receiver->buildFleetAck(ack, at(0), DATAGRAM_ACK_DUPLICATE, 42));
+    uint8_t mac[32];
+    mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), (const uint8_t*)KEY,
+                    strlen(KEY), ack, MESSAGE_FLEET_ACK_SIZE - MESSAGE_DATAGRAM_TAG_SIZE, mac);
+    TEST_ASSERT_EQUAL_MEMORY(mac, ack + MESSAGE_FLEET_ACK_SIZE - MESSAGE_DATAGRAM_TAG_SIZE,
+                             MESSAGE_DATAGRAM_TAG_SIZE);
+    TEST_ASSERT_EQUAL_UINT8(DATAGRAM_ACK_DUPLICATE, ack[10]);
+    TEST_ASSERT_EQUAL_UINT8(42, ack[11]);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_datagram_from_udp_message_py_is_accepted);
+    RUN_TEST(test_bad_mac_is_refused);
+    RUN_TEST(test_truncated_and_malformed_are_refused);
+    RUN_TEST(test_sequence_window);
+    RUN_TEST(test_unknown_sender_must_be_within_300_s);
+    RUN_TEST(test_evicted_sender_cannot_replay);
+    RUN_TEST(test_fleet_dedupe);
+    RUN_TEST(test_fleet_ack_is_signed);
+    return UNITY_END();
+}
@@ -0,0 +1,265 @@
+// MessagePoller on the host against a feed served from a loopback socket in the test: the
+// request it sends, how the response is parsed (status, ETag, Content-Length, body split at
+// any byte), its backoff, and DNS answers that arrive late
+#include <Arduino.h>
+#include <fcntl.h>
+#include <lwip/dns.h>
+#include <lwip/sockets.h>
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "MessagePoller.h"
+
+#define MAX_SPINS 20000  // update() passes before a poll that never ends fails the test
+
+static MessagePoller* poller;
+static std::vector<std::string> items;
+static int listener = -1;
+static uint16_t port;
+
+static std::string feedUrl(const char* host = "127.0.0.1", const char* path = "/feed") {
+    return "http://" + std::string(host) + ":" + std::to_string(port) + path;
+}
+
+static void spin() {
+    poller->update();
+    usleep(20);
+}
+
+// Accepts the poller's connection and reads its request up to the blank line
+static int acceptRequest(std::string& request) {
+    int client = -1;
+    for (int i = 0; i < MAX_SPINS && client < 0; i++) {
+        spin();
+        client = accept(listener, nullptr, nullptr);
+    }
+    TEST_ASSERT_TRUE_MESSAGE(client >= 0, "poller never connected");
+    fcntl(client, F_SETFL, fcntl(client, F_GETFL, 0) | O_NONBLOCK);
+    for (int i = 0; i < MAX_SPINS && request.find("\r\n\r\n") == std::string::npos; i++) {
+        spin();
+        char data[256];
+        ssize_t received = recv(client, data, sizeof(data), 0);
+        if (received > 0) {
+            request.append(data, received);
+        }
+    }
+    return client;
+}
+
+// One whole poll: the response goes out in pieces of `piece` bytes with update() passes in
+// between, then the server closes. Returns the request the poller sent.
+static std::string poll(const std::string& response, size_t piece = 4096) {
+    std::string request;
+    int client = acceptRequest(request);
+    for (size_t sent = 0; sent < response.size(); sent += piece) {
+        size_t length = std::min(piece, response.size() - sent);
+        TEST_ASSERT_EQUAL_INT((int)length, (int)send(client, response.data() + sent, length, 0));
+        spin();
+    }
+    close(client);
+    for (int i = 0; i < MAX_SPINS && poller->getState() != POLL_IDLE; i++) {
+        spin();
+    }
+    TEST_ASSERT_EQUAL_INT(POLL_IDLE, poller->getState());
+    return request;
+}
+
+// Moves the clock to the next poll
+static void nextPoll() {
+    hostMillis += MESSAGE_POLL_BACKOFF_MAX_MS * 2;
+}
+
+static std::string ok(const std::string& body, const char* etag = "\"v1\"",
+                      bool withLength = true) {
+    std::string response = "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n";
+    if (etag) {
+        response += std::string("ETag: ") + etag + "\r\n";
+    }
+    if (withLength) {
+        response += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    return response + "\r\n" + body;
+}
+
+static const char* FEED = "[{\"id\":\"a\",\"text\":\"first\"},{\"id\":\"b\",\"text\":\"second\"}]";
+
+void setUp(void) {
+    hostMillis = 1000;
+    items.clear();
+    hostDnsLookups.clear();
+    delete poller;
+    poller = new MessagePoller();
+    poller->onItem([](const char* json, size_t length) { items.emplace_back(json, length); });
+    TEST_ASSERT_TRUE(poller->setUrl(feedUrl().c_str()));
+}
+
+void tearDown(void) {}
+
+void test_items_headers_and_conditional_request(void) {
+    std::string request = poll(ok(FEED));
+    TEST_ASSERT_EQUAL_INT(0, request.find("GET /feed HTTP/1.0\r\n"));
+    TEST_ASSERT_TRUE(request.find("Host: 127.0.0.1:" + std::to_string(port) + "\r\n") !=
+                     std::string::npos);
+    TEST_ASSERT_TRUE(request.find("If-None-Match") == std::string::npos);
+    TEST_ASSERT_EQUAL_INT(200, poller->getLastStatus());
+    TEST_ASSERT_EQUAL_INT(2, items.size());
+    TEST_ASSERT_EQUAL_STRING("{\"id\":\"b\",\"text\":\"second\"}", items[1].c_str());
+
+    // The next poll sends the ETag and the cursor, escaped, and takes a 304
+    poller->setCursor("b c");
+    nextPoll();
+    request = poll("HTTP/1.1 304 Not Modified\r\nETag: \"v1\"\r\n\r\n");
+    TEST_ASSERT_EQUAL_INT(0, request.find("GET /feed?since=b%20c HTTP/1.0\r\n"));
+    TEST_ASSERT_TRUE(request.find("\r\nIf-None-Match: \"v1\"\r\n") != std::string::npos);
+    TEST_ASSERT_EQUAL_INT(304, poller->getLastStatus());
+    TEST_ASSERT_EQUAL_INT(0, poller->getFailureCount());
+    TEST_ASSERT_EQUAL_INT(2, items.size());
+}
+
+// Headers and body arriving a byte at a time, with header names in any case
+void test_response_split_at_every_byte(void) {
+    std::string response =
+        "HTTP/1.0 200 OK\r\ncontent-length: " + std::to_string(strlen(FEED)) +
+        "\r\netag:\t\"v2\"\r\n\r\n" + FEED;
+    poll(response, 1);
+    TEST_ASSERT_EQUAL_INT(200, poller->getLastStatus());
+    TEST_ASSERT_EQUAL_INT(2, items.size());
+    nextPoll();
+    std::string request = poll("HTTP/1.0 304 Not Modified\r\n\r\n", 1);
+    TEST_ASSERT_TRUE(request.find("If-None-Match: \"v2\"") != std::string::npos);
+}
+
+// Without Content-Length the body ends when the server closes; with one, bytes past it are
+// not part of the feed
+void test_body_length(void) {
+    poll(ok(FEED, "\"v1\"", false));
+    TEST_ASSERT_EQUAL_INT(2, items.size());
+    TEST_ASSERT_EQUAL_INT(0, poller->getFailureCount());
+
+    nextPoll();
+    items.clear();
+    poll(ok(FEED) + "[{\"id\":\"x\",\"text\":\"trailing\"}]");
+    TEST_ASSERT_EQUAL_INT(2, items.size());
+    TEST_ASSERT_EQUAL_INT(0, poller->getFailureCount());
+}
+
+// A body cut off, or one holding something other than message objects, keeps the old ETag
+// so the whole feed is fetched again
+void test_truncated_or_malformed_body_keeps_old_etag(void) {
+    poll(ok(FEED, "\"v1\""));
+    nextPoll();
+    std::string cut = ok(FEED, "\"v2\"");
+    cut.resize(cut.size() - 10);
+    poll(cut);
+    TEST_ASSERT_EQUAL_INT(1, poller->getFailureCount());
+
+    nextPoll();
+    poll(ok("[{\"id\":\"c\",\"text\":\"fine\"},42]", "\"v3\""));
+    nextPoll();
+    std::string request = poll("HTTP/1.1 304 Not Modified\r\n\r\n");
+    TEST_ASSERT_TRUE(request.find("If-None-Match: \"v1\"") != std::string::npos);
+}
+
+void test_errors_back_off(void) {
+    poll("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n");
+    TEST_ASSERT_EQUAL_INT(503, poller->getLastStatus());
+    TEST_ASSERT_EQUAL_INT(1, poller->getFailureCount());
+
+    // Not due again until the first backoff step has passed
+    hostMillis += MESSAGE_POLL_INTERVAL_MS - 1;
+    poller->update();
+    TEST_ASSERT_EQUAL_INT(POLL_IDLE, poller->getState());
+
+    // Closed before the headers ended
+    nextPoll();
+    poll("HTTP/1.1 200 OK\r\nContent-Len");
+    TEST_ASSERT_EQUAL_INT(0, poller->getLastStatus());
+    TEST_ASSERT_EQUAL_INT(2, poller->getFailureCount());
+
+    nextPoll();
+    poll(ok(FEED));
+    TEST_ASSERT_EQUAL_INT(0, poller->getFailureCount());
+}
+
+// The answer to a lookup that timed out must not be taken for the one that replaced it
+void test_stale_dns_answer_is_ignored(void) {
+    TEST_ASSERT_TRUE(poller->setUrl(feedUrl("feed.example").c_str()));
+    poller->update();
+    TEST_ASSERT_EQUAL_INT(POLL_RESOLVING, poller->getState());
+    hostMillis += MESSAGE_POLL_TIMEOUT_MS + 1;
+    poller->update();
+    TEST_ASSERT_EQUAL_INT(POLL_IDLE, poller->getState());
+
+    nextPoll();
+    poller->update();
+    TEST_ASSERT_EQUAL_INT(2, hostDnsLookups.size());
+    hostDnsAnswer(0, "10.9.9.9");  // The first lookup, finally
+    for (int i = 0; i < 10; i++) {
+        spin();
+    }
+    TEST_ASSERT_EQUAL_INT(POLL_RESOLVING, poller->getState());
+
+    hostDnsAnswer(1, "127.0.0.1");
+    poll(ok(FEED));
+    TEST_ASSERT_EQUAL_INT(200, poller->getLastStatus());
+    TEST_ASSERT_EQUAL_INT(2, items.size());
+}
+
+void test_failed_lookup(void) {
+    TEST_ASSERT_TRUE(poller->setUrl(feedUrl("nowhere.example").c_str()));
+    poller->update();
+    hostDnsAnswer(0, nullptr);
+    poller->update();
+    TEST_ASSERT_EQUAL_INT(POLL_IDLE, poller->getState());
+    TEST_ASSERT_EQUAL_INT(0, poller->getLastStatus());
+    TEST_ASSERT_EQUAL_INT(1, poller->getFailureCount());
+}
+
+void test_url_parsing(void) {
+    TEST_ASSERT_TRUE(MessagePoller::isSupportedUrl(""));
+    TEST_ASSERT_TRUE(MessagePoller::isSupportedUrl("http://feed.example"));
+    TEST_ASSERT_TRUE(MessagePoller::isSupportedUrl("http://feed.example:8080/a?b=c"));
+    TEST_ASSERT_FALSE(MessagePoller::isSupportedUrl("https://feed.example/"));
+    TEST_ASSERT_FALSE(MessagePoller::isSupportedUrl("http://:80/"));
+    TEST_ASSERT_FALSE(MessagePoller::isSupportedUrl("http://feed.example:0/"));
+    TEST_ASSERT_FALSE(MessagePoller::isSupportedUrl("http://feed.example:70000/"));
+    TEST_ASSERT_FALSE(MessagePoller::isSupportedUrl("http://feed.example:80x/"));
+
+    // A query in the URL takes the cursor with &
+    TEST_ASSERT_TRUE(poller->setUrl(feedUrl("127.0.0.1", "/feed?key=1").c_str()));
+    poller->setCursor("z");
+    std::string request = poll(ok("[]"));
+    TEST_ASSERT_EQUAL_INT(0, request.find("GET /feed?key=1&since=z HTTP/1.0\r\n"));
+}
+
+int main(int argc, char** argv) {
+    // The feed server: loopback, any free port, accepting without blocking
+    listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(listener, 4) != 0 ||
+        getsockname(listener, (struct sockaddr*)&address, &length) != 0) {
+        perror("feed server");
+        return 1;
+    }
+    port = ntohs(address.sin_port);
+    fcntl(listener, F_SETFL, fcntl(listener, F_GETFL, 0) | O_NONBLOCK);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_items_headers_and_conditional_request);
+    RUN_TEST(test_response_split_at_every_byte);
+    RUN_TEST(test_body_length);
+    RUN_TEST(test_truncated_or_malformed_body_keeps_old_etag);
+    RUN_TEST(test_errors_back_off);
+    RUN_TEST(test_stale_dns_answer_is_ignored);
+    RUN_TEST(test_failed_lookup);
+    RUN_TEST(test_url_parsing);
+    int failures = UNITY_END();
+    close(listener);
+    return failures;
+}
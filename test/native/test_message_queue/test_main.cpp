@@ -0,0 +1,263 @@
+// MessageQueue scheduling on the host. The queue clock is the seconds count handed to
+// advance(), so the tests drive it directly.
+#include <Arduino.h>
+#include <unity.h>
+
+#include <new>
+#include <string>
+
+#include "MessageQueue.h"
+
+// Every operator new in the test binary is counted, library code included
+static size_t heapAllocations = 0;
+
+void* operator new(size_t size) {
+    heapAllocations++;
+    void* memory = malloc(size ? size : 1);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+static MessageSchedule delayed(uint32_t delaySeconds) {
+    MessageSchedule schedule;
+    schedule.delaySeconds = delaySeconds;
+    return schedule;
+}
+
+// Pushes one message delayed from start and checks it is released exactly when due
+static void checkReleasedOnTime(uint32_t start, uint32_t delaySeconds) {
+    char where[64];
+    snprintf(where, sizeof(where), "start %lu, delay %lu", (unsigned long)start,
+             (unsigned long)delaySeconds);
+    MessageQueue queue;
+    queue.advance(start);
+    queue.push("m", "text", MSG_PRIORITY_NORMAL, delayed(delaySeconds));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, queue.scheduledCount(), where);
+    queue.advance(start + delaySeconds - 1);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, queue.count(), where);
+    queue.advance(start + delaySeconds);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, queue.count(), where);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, queue.scheduledCount(), where);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Delays either side of the 64 s and 4096 s level sizes, from clocks either side of a level
+// wrapping, so timers are filed at each level and cascaded down at the block boundaries
+void test_delay_fires_on_time_across_cascade_boundaries(void) {
+    const uint32_t delays[] = {1, 2, 63, 64, 65, 127, 128, 4031, 4095, 4096, 4097, 8191, 8192,
+                               MESSAGE_WHEEL_HORIZON - 1};
+    const uint32_t starts[] = {0, 1, 62, 63, 64, 65, 4094, 4095, 4096, 4097, 12345,
+                               MESSAGE_WHEEL_HORIZON - 1, MESSAGE_WHEEL_HORIZON};
+    for (uint32_t start : starts) {
+        for (uint32_t delaySeconds : delays) {
+            checkReleasedOnTime(start, delaySeconds);
+        }
+    }
+}
+
+void test_mixed_delays_release_in_due_order(void) {
+    MessageQueue queue;
+    queue.advance(100);
+    const uint32_t delays[MESSAGE_SLOT_COUNT] = {4096, 64, 1, 5000, 63, 300, 4095, 65};
+    for (int i = 0; i < MESSAGE_SLOT_COUNT; i++) {
+        char id[4];
+        snprintf(id, sizeof(id), "%d", i);
+        queue.push(id, "text", MSG_PRIORITY_NORMAL, delayed(delays[i]));
+    }
+    for (uint32_t elapsed = 1; elapsed <= 5000; elapsed++) {
+        queue.advance(100 + elapsed);
+        int due = 0;
+        for (uint32_t delaySeconds : delays) {
+            due += delaySeconds <= elapsed;
+        }
+        TEST_ASSERT_EQUAL_INT(due, queue.count());
+    }
+}
+
+void test_ttl_drops_message_not_shown_in_time(void) {
+    MessageQueue queue;
+    MessageSchedule schedule;
+    schedule.ttlSeconds = 300;
+    queue.push("t", "text", MSG_PRIORITY_NORMAL, schedule);
+    queue.advance(299);
+    TEST_ASSERT_EQUAL_INT(1, queue.count());
+    queue.advance(300);
+    TEST_ASSERT_EQUAL_INT(0, queue.count());
+    TEST_ASSERT_EQUAL_INT(MESSAGE_NO_SLOT, queue.find("t"));
+    TEST_ASSERT_EQUAL_INT(MESSAGE_SLOT_COUNT, queue.freeSlots());
+}
+
+void test_ttl_counts_from_not_before_time(void) {
+    MessageQueue queue;
+    MessageSchedule schedule;
+    schedule.delaySeconds = 100;
+    schedule.ttlSeconds = 50;
+    queue.push("t", "text", MSG_PRIORITY_NORMAL, schedule);
+    queue.advance(149);
+    TEST_ASSERT_EQUAL_INT(1, queue.count());
+    queue.advance(150);
+    TEST_ASSERT_EQUAL_INT(0, queue.count());
+}
+
+void test_ttl_no_longer_applies_once_shown(void) {
+    MessageQueue queue;
+    MessageSchedule schedule;
+    schedule.ttlSeconds = 10;
+    queue.push("t", "text", MSG_PRIORITY_NORMAL, schedule);
+    int slot = queue.pop();
+    queue.advance(60);
+    TEST_ASSERT_EQUAL_INT(MESSAGE_SLOT_ACTIVE, queue.getSlot(slot).state);
+    TEST_ASSERT_EQUAL_INT(slot, queue.find("t"));
+}
+
+void test_repeat_comes_back_from_start_of_showing(void) {
+    MessageQueue queue;
+    MessageSchedule schedule;
+    schedule.repeatSeconds = 900;
+    queue.push("r", "text", MSG_PRIORITY_HIGH, schedule);
+    for (uint32_t showing = 0; showing < 3; showing++) {
+        uint32_t shownAt = showing * 900;
+        queue.advance(shownAt);
+        TEST_ASSERT_EQUAL_INT(1, queue.count());
+        int slot = queue.pop();
+        queue.advance(shownAt + 20);  // Scrolled for 20 s
+        queue.finish(slot);
+        TEST_ASSERT_EQUAL_INT(1, queue.scheduledCount());
+        queue.advance(shownAt + 899);
+        TEST_ASSERT_EQUAL_INT(0, queue.count());
+    }
+}
+
+void test_repeat_shorter_than_showing_comes_back_next_tick(void) {
+    MessageQueue queue;
+    MessageSchedule schedule;
+    schedule.repeatSeconds = 5;
+    queue.push("r", "text", MSG_PRIORITY_NORMAL, schedule);
+    int slot = queue.pop();
+    queue.advance(30);
+    queue.finish(slot);
+    TEST_ASSERT_EQUAL_INT(0, queue.count());
+    queue.advance(31);
+    TEST_ASSERT_EQUAL_INT(1, queue.count());
+}
+
+void test_delete_stops_repeats(void) {
+    MessageQueue queue;
+    MessageSchedule schedule;
+    schedule.repeatSeconds = 60;
+    queue.push("r", "text", MSG_PRIORITY_NORMAL, schedule);
+    queue.finish(queue.pop());
+    queue.release(queue.find("r"));
+    queue.advance(600);
+    TEST_ASSERT_EQUAL_INT(0, queue.count());
+    TEST_ASSERT_EQUAL_INT(0, queue.scheduledCount());
+    TEST_ASSERT_EQUAL_INT(MESSAGE_SLOT_COUNT, queue.freeSlots());
+}
+
+// Timers past the ~72 h wheel horizon keep their real due time
+void test_delay_beyond_horizon_fires_on_time(void) {
+    checkReleasedOnTime(0, 360000);
+    checkReleasedOnTime(777, MESSAGE_WHEEL_HORIZON);
+    checkReleasedOnTime(4096, 3 * MESSAGE_WHEEL_HORIZON + 65);
+    checkReleasedOnTime(1, MESSAGE_SCHEDULE_MAX_SECONDS);
+}
+
+void test_ttl_beyond_horizon_does_not_expire_early(void) {
+    MessageQueue queue;
+    MessageSchedule schedule;
+    schedule.ttlSeconds = 100UL * 3600UL;
+    queue.push("t", "text", MSG_PRIORITY_NORMAL, schedule);
+    queue.advance(schedule.ttlSeconds - 1);
+    TEST_ASSERT_EQUAL_INT(1, queue.count());
+    queue.advance(schedule.ttlSeconds);
+    TEST_ASSERT_EQUAL_INT(0, queue.count());
+}
+
+void test_repeat_beyond_horizon_does_not_fire_early(void) {
+    MessageQueue queue;
+    MessageSchedule schedule;
+    schedule.repeatSeconds = 7UL * 24UL * 3600UL;
+    queue.push("r", "weekly", MSG_PRIORITY_NORMAL, schedule);
+    queue.finish(queue.pop());
+    queue.advance(schedule.repeatSeconds - 1);
+    TEST_ASSERT_EQUAL_INT(0, queue.count());
+    queue.advance(schedule.repeatSeconds);
+    TEST_ASSERT_EQUAL_INT(1, queue.count());
+}
+
+void test_upsert_replaces_schedule(void) {
+    MessageQueue queue;
+    queue.push("u", "text", MSG_PRIORITY_NORMAL, delayed(1000));
+    queue.push("u", "sooner", MSG_PRIORITY_NORMAL, delayed(10));
+    TEST_ASSERT_EQUAL_INT(1, queue.scheduledCount());
+    queue.advance(10);
+    TEST_ASSERT_EQUAL_INT(1, queue.count());
+    queue.advance(2000);
+    TEST_ASSERT_EQUAL_INT(1, queue.count());
+    TEST_ASSERT_EQUAL_INT(MESSAGE_SLOT_COUNT - 1, queue.freeSlots());
+}
+
+// The whole message life cycle, repeated once warm, must never reach the heap. The queue has
+// no malloc or free calls at all, so counting operator new covers it.
+void test_steady_state_does_not_allocate(void) {
+    std::string probe(64, 'x');  // The counter does see allocations
+    TEST_ASSERT_TRUE(heapAllocations > 0);
+
+    MessageQueue queue;
+    MessageSchedule repeating;
+    repeating.repeatSeconds = 30;
+    repeating.ttlSeconds = 5;
+    char id[16];
+    size_t before = heapAllocations;
+    for (uint32_t tick = 1; tick <= 5000; tick++) {
+        snprintf(id, sizeof(id), "m%lu", (unsigned long)(tick % 12));
+        queue.push(id, "steady state", (MessagePriority)(tick % MESSAGE_PRIORITY_COUNT));
+        queue.push("", "anonymous", MSG_PRIORITY_LOW, delayed(tick % 90));
+        queue.push("rep", "repeating", MSG_PRIORITY_HIGH, repeating);
+        queue.advance(tick);
+        int slot = queue.pop();
+        if (slot != MESSAGE_NO_SLOT && tick % 7 == 0) {
+            queue.requeueFront(slot, 3);
+            slot = queue.pop();
+        }
+        if (slot != MESSAGE_NO_SLOT) {
+            queue.finish(slot);
+        }
+        int found = queue.find(id);
+        if (found != MESSAGE_NO_SLOT && tick % 5 == 0) {
+            queue.release(found);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(before, heapAllocations);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_delay_fires_on_time_across_cascade_boundaries);
+    RUN_TEST(test_mixed_delays_release_in_due_order);
+    RUN_TEST(test_ttl_drops_message_not_shown_in_time);
+    RUN_TEST(test_ttl_counts_from_not_before_time);
+    RUN_TEST(test_ttl_no_longer_applies_once_shown);
+    RUN_TEST(test_repeat_comes_back_from_start_of_showing);
+    RUN_TEST(test_repeat_shorter_than_showing_comes_back_next_tick);
+    RUN_TEST(test_delete_stops_repeats);
+    RUN_TEST(test_delay_beyond_horizon_fires_on_time);
+    RUN_TEST(test_ttl_beyond_horizon_does_not_expire_early);
+    RUN_TEST(test_repeat_beyond_horizon_does_not_fire_early);
+    RUN_TEST(test_upsert_replaces_schedule);
+    RUN_TEST(test_steady_state_does_not_allocate);
+    return UNITY_END();
+}
@@ -0,0 +1,266 @@
+// MessageItemSplitter on the host: regressions for the awkward inputs, a fuzz pass over
+// mutated and random bodies, and a throughput benchmark
+#include <Arduino.h>
+#include <unity.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "MessageItemSplitter.h"
+
+struct SplitResult {
+    std::vector<std::string> items;
+    bool started;
+    bool complete;
+    bool malformed;
+};
+
+// Feeds body in chunks of chunkSize bytes (0 = all at once)
+static SplitResult split(const std::string& body, size_t chunkSize = 0) {
+    MessageItemSplitter splitter;
+    SplitResult result;
+    auto handler = [&result](const char* json, size_t length) {
+        result.items.push_back(std::string(json, length));
+    };
+    if (chunkSize == 0) {
+        chunkSize = body.size();
+    }
+    for (size_t pos = 0; pos < body.size(); pos += chunkSize) {
+        size_t length = std::min(chunkSize, body.size() - pos);
+        splitter.feed((const uint8_t*)body.data() + pos, length, handler);
+    }
+    result.started = splitter.isStarted();
+    result.complete = splitter.isComplete();
+    result.malformed = splitter.isMalformed();
+    return result;
+}
+
+// Braces and brackets balance outside strings, and the item is one object
+static bool isWholeObject(const std::string& item) {
+    if (item.size() < 2 || item.front() != '{' || item.back() != '}') {
+        return false;
+    }
+    int depth = 0;
+    bool inString = false;
+    bool escaped = false;
+    for (size_t i = 0; i < item.size(); i++) {
+        char c = item[i];
+        if (inString) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                inString = false;
+            }
+        } else if (c == '"') {
+            inString = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if ((c == '}' || c == ']') && --depth == 0 && i + 1 != item.size()) {
+            return false;
+        }
+    }
+    return depth == 0 && !inString;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_single_object_and_array(void) {
+    SplitResult single = split("  {\"text\":\"hi\"}");
+    TEST_ASSERT_EQUAL_INT(1, single.items.size());
+    TEST_ASSERT_EQUAL_STRING("{\"text\":\"hi\"}", single.items[0].c_str());
+    TEST_ASSERT_TRUE(single.complete);
+    TEST_ASSERT_FALSE(single.malformed);
+
+    SplitResult batch = split("[{\"text\":\"a\"}, {\"text\":\"b\"}\n,{\"text\":\"c\"}]");
+    TEST_ASSERT_EQUAL_INT(3, batch.items.size());
+    TEST_ASSERT_EQUAL_STRING("{\"text\":\"b\"}", batch.items[1].c_str());
+    TEST_ASSERT_TRUE(batch.complete);
+    TEST_ASSERT_FALSE(batch.malformed);
+
+    SplitResult empty = split("[ ]");
+    TEST_ASSERT_EQUAL_INT(0, empty.items.size());
+    TEST_ASSERT_TRUE(empty.complete);
+
+    SplitResult blank = split(" \r\n");
+    TEST_ASSERT_FALSE(blank.started);
+}
+
+void test_unterminated_string_is_never_complete(void) {
+    SplitResult result = split("[{\"text\":\"no end}]");
+    TEST_ASSERT_EQUAL_INT(0, result.items.size());
+    TEST_ASSERT_FALSE(result.complete);
+
+    SplitResult cut = split("[{\"text\":\"a\"},{\"text\":\"b");
+    TEST_ASSERT_EQUAL_INT(1, cut.items.size());
+    TEST_ASSERT_FALSE(cut.complete);
+}
+
+void test_escaped_quotes_and_brackets_in_strings(void) {
+    const char* tricky = "{\"text\":\"say \\\"}]\\\" \\\\\",\"id\":\"[{\"}";
+    SplitResult result = split(std::string("[") + tricky + "]");
+    TEST_ASSERT_EQUAL_INT(1, result.items.size());
+    TEST_ASSERT_EQUAL_STRING(tricky, result.items[0].c_str());
+    TEST_ASSERT_TRUE(result.complete);
+
+    // An escape split across two chunks still escapes
+    for (size_t chunk = 1; chunk <= 4; chunk++) {
+        SplitResult chunked = split(std::string("[") + tricky + "]", chunk);
+        TEST_ASSERT_EQUAL_INT(1, chunked.items.size());
+        TEST_ASSERT_EQUAL_STRING(tricky, chunked.items[0].c_str());
+    }
+}
+
+void test_nested_arrays_and_objects_stay_in_their_item(void) {
+    const char* nested = "{\"text\":\"x\",\"tags\":[1,[2,{\"k\":[]}]],\"meta\":{\"a\":{}}}";
+    SplitResult result = split(std::string("[") + nested + ",{\"text\":\"y\"}]");
+    TEST_ASSERT_EQUAL_INT(2, result.items.size());
+    TEST_ASSERT_EQUAL_STRING(nested, result.items[0].c_str());
+    TEST_ASSERT_TRUE(result.complete);
+
+    // Arrays of arrays are not message lists
+    SplitResult wrapped = split("[[{\"text\":\"x\"}]]");
+    TEST_ASSERT_EQUAL_INT(0, wrapped.items.size());
+    TEST_ASSERT_TRUE(wrapped.malformed);
+}
+
+void test_object_closed_by_a_bracket_is_dropped(void) {
+    SplitResult result = split("[{\"text\":\"a\"],{\"text\":\"b\"}]");
+    TEST_ASSERT_TRUE(result.malformed);
+    TEST_ASSERT_EQUAL_INT(1, result.items.size());
+    TEST_ASSERT_EQUAL_STRING("{\"text\":\"b\"}", result.items[0].c_str());
+}
+
+void test_oversize_item_is_dropped_and_flagged(void) {
+    std::string big = "{\"text\":\"" + std::string(MESSAGE_ITEM_MAX, 'x') + "\"}";
+    SplitResult result = split("[{\"text\":\"before\"}," + big + ",{\"text\":\"after\"}]");
+    TEST_ASSERT_TRUE(result.malformed);
+    TEST_ASSERT_EQUAL_INT(2, result.items.size());
+    TEST_ASSERT_EQUAL_STRING("{\"text\":\"after\"}", result.items[1].c_str());
+
+    // Exactly MESSAGE_ITEM_MAX bytes still fits
+    std::string fits = "{\"text\":\"" + std::string(MESSAGE_ITEM_MAX - 11, 'x') + "\"}";
+    TEST_ASSERT_EQUAL_INT(MESSAGE_ITEM_MAX, fits.size());
+    SplitResult edge = split("[" + fits + "]");
+    TEST_ASSERT_FALSE(edge.malformed);
+    TEST_ASSERT_EQUAL_INT(1, edge.items.size());
+}
+
+void test_garbage_between_items_stops_the_split(void) {
+    const char* bodies[] = {"[{\"text\":\"a\"} x {\"text\":\"b\"}]", "[{\"text\":\"a\"},1]",
+                            "[{\"text\":\"a\"},\"b\"]", "[{\"text\":\"a\"}}]", "\"text\"",
+                            "[{\"text\":\"a\"},null]"};
+    for (const char* body : bodies) {
+        SplitResult result = split(body);
+        TEST_ASSERT_TRUE_MESSAGE(result.malformed, body);
+        TEST_ASSERT_FALSE_MESSAGE(result.complete, body);
+        TEST_ASSERT_TRUE_MESSAGE(result.items.size() <= 1, body);
+    }
+}
+
+void test_trailing_bytes_after_the_end_are_ignored(void) {
+    SplitResult result = split("[{\"text\":\"a\"}] {\"text\":\"b\"}");
+    TEST_ASSERT_EQUAL_INT(1, result.items.size());
+    TEST_ASSERT_TRUE(result.complete);
+    TEST_ASSERT_FALSE(result.malformed);
+}
+
+// Mutated and random bodies: whatever comes in, items are whole objects no longer than
+// MESSAGE_ITEM_MAX, and the result does not depend on how the body was chunked
+void test_fuzz_mutated_and_random_bodies(void) {
+    std::mt19937 rng(2024);
+    const std::string seeds[] = {
+        "[{\"text\":\"hello\",\"priority\":\"high\"},{\"id\":\"a\",\"text\":\"b\\\"c\"}]",
+        "{\"text\":\"solo\",\"delay\":5}",
+        "[{\"text\":\"x\",\"tags\":[1,[2,3]],\"m\":{\"n\":{}}}, {\"text\":\"]}\"}]"};
+    const char alphabet[] = "{}[]\",:\\ ax0\n";
+    for (int round = 0; round < 20000; round++) {
+        std::string body;
+        if (round % 4 == 3) {
+            size_t length = rng() % 64;
+            for (size_t i = 0; i < length; i++) {
+                body += alphabet[rng() % (sizeof(alphabet) - 1)];
+            }
+        } else {
+            body = seeds[rng() % 3];
+            int edits = 1 + rng() % 4;
+            for (int e = 0; e < edits && !body.empty(); e++) {
+                size_t at = rng() % body.size();
+                switch (rng() % 4) {
+                    case 0:
+                        body.erase(at, 1);
+                        break;
+                    case 1:
+                        body.insert(at, 1, alphabet[rng() % (sizeof(alphabet) - 1)]);
+                        break;
+                    case 2:
+                        body[at] = (char)rng();
+                        break;
+                    default:
+                        body.resize(at);
+                        break;
+                }
+            }
+        }
+
+        SplitResult whole = split(body);
+        for (const std::string& item : whole.items) {
+            TEST_ASSERT_TRUE_MESSAGE(item.size() <= MESSAGE_ITEM_MAX, body.c_str());
+            TEST_ASSERT_TRUE_MESSAGE(isWholeObject(item), body.c_str());
+        }
+        SplitResult chunked = split(body, 1 + rng() % 7);
+        TEST_ASSERT_TRUE_MESSAGE(chunked.items == whole.items, body.c_str());
+        TEST_ASSERT_EQUAL_INT_MESSAGE(whole.complete, chunked.complete, body.c_str());
+        TEST_ASSERT_EQUAL_INT_MESSAGE(whole.malformed, chunked.malformed, body.c_str());
+    }
+}
+
+void test_benchmark_messages_per_second(void) {
+    const int messages = 20000;
+    std::string body = "[";
+    for (int i = 0; i < messages; i++) {
+        char item[128];
+        snprintf(item, sizeof(item),
+                 "%s{\"id\":\"m%d\",\"text\":\"Build %d passed \\\"main\\\"\","
+                 "\"priority\":\"normal\"}",
+                 i ? "," : "", i, i);
+        body += item;
+    }
+    body += "]";
+
+    // Fed in 1436-byte pieces, a TCP segment's worth, as the server hands them over
+    const int runs = 10;
+    size_t seen = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < runs; run++) {
+        seen += split(body, 1436).items.size();
+    }
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    TEST_ASSERT_EQUAL_INT(messages * runs, seen);
+
+    char report[96];
+    snprintf(report, sizeof(report), "split %.0f messages/s, %.1f MB/s", seen / seconds,
+             body.size() * runs / seconds / 1e6);
+    TEST_MESSAGE(report);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_single_object_and_array);
+    RUN_TEST(test_unterminated_string_is_never_complete);
+    RUN_TEST(test_escaped_quotes_and_brackets_in_strings);
+    RUN_TEST(test_nested_arrays_and_objects_stay_in_their_item);
+    RUN_TEST(test_object_closed_by_a_bracket_is_dropped);
+    RUN_TEST(test_oversize_item_is_dropped_and_flagged);
+    RUN_TEST(test_garbage_between_items_stops_the_split);
+    RUN_TEST(test_trailing_bytes_after_the_end_are_ignored);
+    RUN_TEST(test_fuzz_mutated_and_random_bodies);
+    RUN_TEST(test_benchmark_messages_per_second);
+    return UNITY_END();
+}
@@ -0,0 +1,329 @@
+// MessageStore replay on the host, over the RAM LittleFS in test/host
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unity.h>
+
+#include <chrono>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "MessageQueue.h"
+#include "MessageStore.h"
+
+typedef std::set<std::string> QueueState;
+
+// What a replay has to bring back: every live message with its text, priority and state
+static QueueState stateOf(const MessageQueue& queue) {
+    QueueState state;
+    for (int i = 0; i < MESSAGE_SLOT_COUNT; i++) {
+        const MessageSlot& slot = queue.getSlot(i);
+        if (slot.state != MESSAGE_SLOT_FREE) {
+            state.insert(std::string(slot.id) + "|" + slot.text + "|" +
+                         std::to_string(slot.priority) + "|" + std::to_string(slot.state));
+        }
+    }
+    return state;
+}
+
+static std::vector<uint8_t>& logFile() {
+    return LittleFS.files[MESSAGE_STORE_PATH];
+}
+
+void setUp(void) {
+    LittleFS.files.clear();
+    hostMillis = 0;
+    hostTime = 1700000000;
+}
+
+void tearDown(void) {}
+
+void test_replay_restores_puts_and_deletes(void) {
+    MessageQueue queue;
+    MessageStore store;
+    store.begin();
+    int slot;
+    queue.push("a", "first", MSG_PRIORITY_NORMAL, MessageSchedule(), &slot);
+    store.recordNewSlot(queue, slot);
+    queue.push("b", "second", MSG_PRIORITY_HIGH, MessageSchedule(), &slot);
+    store.recordNewSlot(queue, slot);
+    queue.push("a", "first, edited", MSG_PRIORITY_URGENT, MessageSchedule(), &slot);
+    store.recordSlot(queue, slot);
+    int b = queue.find("b");
+    queue.release(b);
+    store.recordSlot(queue, b);
+    store.flush();
+
+    MessageQueue restored;
+    MessageStore replayer;
+    replayer.begin();
+    TEST_ASSERT_EQUAL_INT(1, replayer.replay(restored));
+    TEST_ASSERT_TRUE(stateOf(queue) == stateOf(restored));
+    TEST_ASSERT_EQUAL_STRING("first, edited", restored.getSlot(restored.find("a")).text);
+}
+
+// Power loss can stop a write after any byte. Whatever is left must replay to the state as of
+// the last whole record, keep doing so, and take new records after it.
+void test_log_cut_at_every_offset_replays_last_whole_record(void) {
+    MessageQueue queue;
+    MessageStore store;
+    store.begin();
+    std::vector<size_t> boundaries(1, 0);
+    std::vector<QueueState> states(1, stateOf(queue));
+    auto step = [&]() {
+        store.flush();
+        boundaries.push_back(logFile().size());
+        states.push_back(stateOf(queue));
+    };
+
+    int slot;
+    queue.push("a", "hello", MSG_PRIORITY_NORMAL, MessageSchedule(), &slot);
+    store.recordNewSlot(queue, slot);
+    step();
+    queue.push("", "anonymous", MSG_PRIORITY_LOW, MessageSchedule(), &slot);
+    store.recordNewSlot(queue, slot);
+    step();
+    MessageSchedule later;
+    later.delaySeconds = 3600;
+    later.ttlSeconds = 60;
+    queue.push("b", "later", MSG_PRIORITY_HIGH, later, &slot);
+    store.recordNewSlot(queue, slot);
+    step();
+    queue.push("a", "hello again", MSG_PRIORITY_URGENT, MessageSchedule(), &slot);
+    store.recordSlot(queue, slot);
+    step();
+    int anonymous = 0;
+    while (queue.getSlot(anonymous).state == MESSAGE_SLOT_FREE ||
+           queue.getSlot(anonymous).id[0] != '\0') {
+        anonymous++;
+    }
+    queue.release(anonymous);
+    store.recordSlot(queue, anonymous);
+    step();
+    queue.push("", std::string(MESSAGE_TEXT_MAX_LENGTH, 'x').c_str(), MSG_PRIORITY_NORMAL,
+               MessageSchedule(), &slot);
+    store.recordNewSlot(queue, slot);
+    step();
+    int b = queue.find("b");
+    queue.release(b);
+    store.recordSlot(queue, b);
+    step();
+
+    const std::vector<uint8_t> full = logFile();
+    for (size_t cut = 0; cut <= full.size(); cut++) {
+        size_t whole = 0;
+        while (whole + 1 < boundaries.size() && boundaries[whole + 1] <= cut) {
+            whole++;
+        }
+        char where[48];
+        snprintf(where, sizeof(where), "log cut at byte %u", (unsigned)cut);
+
+        LittleFS.files.clear();
+        logFile().assign(full.begin(), full.begin() + cut);
+        MessageQueue first;
+        MessageStore firstStore;
+        firstStore.begin();
+        firstStore.replay(first);
+        TEST_ASSERT_TRUE_MESSAGE(stateOf(first) == states[whole], where);
+
+        // The torn tail was dropped when the log was rewritten, so a second boot agrees
+        MessageQueue second;
+        MessageStore secondStore;
+        secondStore.begin();
+        secondStore.replay(second);
+        TEST_ASSERT_TRUE_MESSAGE(stateOf(second) == states[whole], where);
+
+        second.push("z", "after recovery", MSG_PRIORITY_NORMAL, MessageSchedule(), &slot);
+        secondStore.recordNewSlot(second, slot);
+        secondStore.flush();
+        MessageQueue third;
+        MessageStore thirdStore;
+        thirdStore.begin();
+        thirdStore.replay(third);
+        TEST_ASSERT_TRUE_MESSAGE(third.find("z") != MESSAGE_NO_SLOT, where);
+        TEST_ASSERT_EQUAL_INT_MESSAGE(states[whole].size() + 1, stateOf(third).size(), where);
+    }
+}
+
+void test_corrupt_byte_stops_replay_at_that_record(void) {
+    MessageQueue queue;
+    MessageStore store;
+    store.begin();
+    int slot;
+    queue.push("a", "kept", MSG_PRIORITY_NORMAL, MessageSchedule(), &slot);
+    store.recordNewSlot(queue, slot);
+    store.flush();
+    size_t firstRecord = logFile().size();
+    queue.push("b", "lost", MSG_PRIORITY_NORMAL, MessageSchedule(), &slot);
+    store.recordNewSlot(queue, slot);
+    store.flush();
+
+    logFile()[firstRecord + MESSAGE_RECORD_HEADER_SIZE + 2] ^= 0x40;
+    MessageQueue restored;
+    MessageStore replayer;
+    replayer.begin();
+    TEST_ASSERT_EQUAL_INT(1, replayer.replay(restored));
+    TEST_ASSERT_TRUE(restored.find("a") != MESSAGE_NO_SLOT);
+    TEST_ASSERT_EQUAL_size_t(firstRecord, logFile().size());
+}
+
+void test_schedule_survives_reboot_by_wall_clock(void) {
+    MessageQueue queue;
+    MessageStore store;
+    store.begin();
+    MessageSchedule later;
+    later.delaySeconds = 3600;
+    int slot;
+    queue.push("w", "scheduled", MSG_PRIORITY_NORMAL, later, &slot);
+    store.recordNewSlot(queue, slot);
+    store.flush();
+
+    // Rebooted ten minutes later; the queue clock starts from zero again
+    hostTime += 600;
+    MessageQueue restored;
+    MessageStore replayer;
+    replayer.begin();
+    replayer.replay(restored);
+    TEST_ASSERT_EQUAL_INT(1, restored.scheduledCount());
+    restored.advance(2999);
+    TEST_ASSERT_EQUAL_INT(0, restored.count());
+    restored.advance(3000);
+    TEST_ASSERT_EQUAL_INT(1, restored.count());
+}
+
+void test_expired_while_off_is_not_restored(void) {
+    MessageQueue queue;
+    MessageStore store;
+    store.begin();
+    MessageSchedule shortLived;
+    shortLived.ttlSeconds = 60;
+    int slot;
+    queue.push("e", "expires", MSG_PRIORITY_NORMAL, shortLived, &slot);
+    store.recordNewSlot(queue, slot);
+    store.flush();
+
+    hostTime += 61;
+    MessageQueue restored;
+    MessageStore replayer;
+    replayer.begin();
+    TEST_ASSERT_EQUAL_INT(0, replayer.replay(restored));
+}
+
+// append() runs on the web server task and never writes flash. A batch that overflows before
+// the loop takes it drops records, and the loop then rewrites the log from the queue.
+void test_overflowing_batch_is_recovered_by_compaction(void) {
+    MessageQueue queue;
+    MessageStore store;
+    store.begin();
+    int slot;
+    char id[8];
+    std::string text(100, 't');
+    for (int i = 0; i < MESSAGE_SLOT_COUNT; i++) {
+        snprintf(id, sizeof(id), "m%d", i);
+        queue.push(id, text.c_str(), MSG_PRIORITY_NORMAL, MessageSchedule(), &slot);
+        store.recordNewSlot(queue, slot);
+    }
+    TEST_ASSERT_TRUE(logFile().empty());
+    TEST_ASSERT_TRUE(store.isCompactionDue());
+
+    // Full enough to be written at once, without waiting MESSAGE_STORE_FLUSH_MS
+    TEST_ASSERT_TRUE(store.update(queue));
+    store.write();
+    TEST_ASSERT_TRUE(store.compact(queue));
+    TEST_ASSERT_FALSE(store.isCompactionDue());
+
+    MessageQueue restored;
+    MessageStore replayer;
+    replayer.begin();
+    TEST_ASSERT_EQUAL_INT(MESSAGE_SLOT_COUNT, replayer.replay(restored));
+    TEST_ASSERT_TRUE(stateOf(queue) == stateOf(restored));
+}
+
+// Records logged while a compaction is under way are kept for the new log
+void test_records_logged_during_compaction_are_kept(void) {
+    MessageQueue queue;
+    MessageStore store;
+    store.begin();
+    int slot;
+    queue.push("a", "before", MSG_PRIORITY_NORMAL, MessageSchedule(), &slot);
+    store.recordNewSlot(queue, slot);
+    queue.push("b", "doomed", MSG_PRIORITY_NORMAL, MessageSchedule(), &slot);
+    store.recordNewSlot(queue, slot);
+    store.flush();
+
+    uint8_t record[MESSAGE_RECORD_HEADER_SIZE + MESSAGE_RECORD_MAX_PAYLOAD];
+    TEST_ASSERT_TRUE(store.beginCompaction());
+    for (int i = 0; i < MESSAGE_SLOT_COUNT; i++) {
+        store.writeCompacted(record, store.encodeSlot(queue, i, record));
+        if (i == 0) {
+            // The server task changes things between two slots
+            queue.push("a", "after", MSG_PRIORITY_HIGH, MessageSchedule(), &slot);
+            store.recordSlot(queue, slot);
+            int b = queue.find("b");
+            queue.release(b);
+            store.recordSlot(queue, b);
+            queue.push("c", "new", MSG_PRIORITY_LOW, MessageSchedule(), &slot);
+            store.recordNewSlot(queue, slot);
+        }
+    }
+    TEST_ASSERT_TRUE(store.finishCompaction());
+    store.flush();
+
+    MessageQueue restored;
+    MessageStore replayer;
+    replayer.begin();
+    TEST_ASSERT_EQUAL_INT(2, replayer.replay(restored));
+    TEST_ASSERT_TRUE(stateOf(queue) == stateOf(restored));
+}
+
+// The startup budget is for 100 log entries. This times the parse and queue work on the host;
+// flash reads add to it on the device, where replay() logs its own time.
+void test_replay_of_100_entries_within_budget(void) {
+    MessageQueue queue;
+    MessageStore store;
+    store.begin();
+    int slot;
+    char id[8];
+    char text[64];
+    for (int i = 0; i < 100; i++) {
+        snprintf(id, sizeof(id), "m%d", i % MESSAGE_SLOT_COUNT);
+        snprintf(text, sizeof(text), "Message number %d with some text to scroll by", i);
+        queue.push(id, text, MSG_PRIORITY_NORMAL, MessageSchedule(), &slot);
+        store.recordSlot(queue, slot);
+        if (store.update(queue)) {
+            store.write();
+        }
+    }
+    store.flush();
+    TEST_ASSERT_LESS_THAN(MESSAGE_STORE_COMPACT_BYTES, logFile().size());
+
+    const int runs = 100;
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < runs; run++) {
+        MessageQueue restored;
+        MessageStore replayer;
+        replayer.begin();
+        TEST_ASSERT_EQUAL_INT(MESSAGE_SLOT_COUNT, replayer.replay(restored));
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                          start)
+                    .count() /
+                runs;
+    char report[64];
+    snprintf(report, sizeof(report), "replay of 100 entries: %.3f ms", ms);
+    TEST_MESSAGE(report);
+    TEST_ASSERT_LESS_THAN(MESSAGE_STORE_REPLAY_BUDGET_MS, ms);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_restores_puts_and_deletes);
+    RUN_TEST(test_log_cut_at_every_offset_replays_last_whole_record);
+    RUN_TEST(test_corrupt_byte_stops_replay_at_that_record);
+    RUN_TEST(test_schedule_survives_reboot_by_wall_clock);
+    RUN_TEST(test_expired_while_off_is_not_restored);
+    RUN_TEST(test_overflowing_batch_is_recovered_by_compaction);
+    RUN_TEST(test_records_logged_during_compaction_are_kept);
+    RUN_TEST(test_replay_of_100_entries_within_budget);
+    return UNITY_END();
+}
@@ -0,0 +1,106 @@
+// RateLimiter on the host: bursts, refill, LRU eviction and a 20-client simulation. Time is
+// passed in explicitly, so the tests never touch millis().
+#include <Arduino.h>
+#include <unity.h>
+
+#include "RateLimiter.h"
+
+static bool tracks(const RateLimiter& limiter, uint32_t ip) {
+    for (int i = 0; i < RATE_LIMIT_CLIENTS; i++) {
+        if (limiter.getClient(i).ip == ip) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_burst_then_steady_rate(void) {
+    RateLimiter limiter(2, 10);
+    unsigned long now = 1000;
+    int allowed = 0;
+    for (int i = 0; i < 15; i++) {
+        allowed += limiter.take(0x0a000001, now);
+    }
+    TEST_ASSERT_EQUAL_INT(10, allowed);
+    TEST_ASSERT_EQUAL_UINT32(1, limiter.getRetryAfter(0x0a000001, now));
+
+    // One token every 500 ms at 2 per second
+    TEST_ASSERT_FALSE(limiter.check(0x0a000001, now + 499));
+    TEST_ASSERT_TRUE(limiter.check(0x0a000001, now + 500));
+    TEST_ASSERT_EQUAL_UINT32(10, limiter.getClient(0).allowed);
+    TEST_ASSERT_EQUAL_UINT32(5, limiter.getClient(0).limited);
+}
+
+void test_retry_after_is_at_least_one_second(void) {
+    RateLimiter limiter(1, 1);
+    limiter.take(1, 0);
+    TEST_ASSERT_EQUAL_UINT32(1, limiter.getRetryAfter(1, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, limiter.getRetryAfter(1, 1));
+}
+
+// One client posting 20 messages/s among 19 that post once each 950 ms, for a minute. The 20
+// clients overflow the 16-entry table, so the polite ones are evicted and come back in turn.
+// None of them may ever be limited, and the flood gets only its burst plus the steady rate.
+void test_twenty_clients_with_one_flooding(void) {
+    RateLimiter limiter(2, 10);
+    const uint32_t flooder = 0xC0A80063;
+    int floodAllowed = 0;
+    int politeLimited = 0;
+    for (unsigned long now = 0; now < 60000; now += 50) {
+        floodAllowed += limiter.take(flooder, now);
+        uint32_t polite = 0xC0A80001 + (now / 50) % 19;
+        if (!limiter.take(polite, now)) {
+            politeLimited++;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(0, politeLimited);
+    TEST_ASSERT_INT_WITHIN(3, 10 + 2 * 60, floodAllowed);
+    TEST_ASSERT_TRUE(tracks(limiter, flooder));
+}
+
+void test_least_recently_seen_client_is_evicted(void) {
+    RateLimiter limiter(2, 10);
+    for (uint32_t ip = 1; ip <= RATE_LIMIT_CLIENTS; ip++) {
+        limiter.take(ip, ip);
+    }
+    limiter.take(1, 100);  // 1 is fresh again, so 2 is now the oldest
+    limiter.take(99, 101);
+    TEST_ASSERT_TRUE(tracks(limiter, 1));
+    TEST_ASSERT_FALSE(tracks(limiter, 2));
+    TEST_ASSERT_TRUE(tracks(limiter, 99));
+}
+
+void test_millis_rollover(void) {
+    RateLimiter limiter(2, 10);
+    unsigned long now = 0xFFFFFF00UL;
+    for (int i = 0; i < 10; i++) {
+        limiter.take(5, now);
+    }
+    TEST_ASSERT_FALSE(limiter.check(5, now));
+    TEST_ASSERT_TRUE(limiter.check(5, now + 600));
+    TEST_ASSERT_TRUE(limiter.getClient(0).milliTokens <= 10000);
+}
+
+void test_long_idle_refills_to_the_burst(void) {
+    RateLimiter limiter(2, 10);
+    for (int i = 0; i < 10; i++) {
+        limiter.take(5, 0);
+    }
+    limiter.check(5, 3600000UL);
+    TEST_ASSERT_EQUAL_UINT32(10000, limiter.getClient(0).milliTokens);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_burst_then_steady_rate);
+    RUN_TEST(test_retry_after_is_at_least_one_second);
+    RUN_TEST(test_twenty_clients_with_one_flooding);
+    RUN_TEST(test_least_recently_seen_client_is_evicted);
+    RUN_TEST(test_millis_rollover);
+    RUN_TEST(test_long_idle_refills_to_the_burst);
+    return UNITY_END();
+}
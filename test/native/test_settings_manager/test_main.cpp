@@ -0,0 +1,73 @@
+// SettingsManager on the host: saved effect modes load as what the user chose, against the
+// emulated EEPROM.
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <unity.h>
+
+#include "SettingsManager.h"
+
+// Settings as earlier firmware saved them
+static void saveLegacy(uint8_t effectMode) {
+    EEPROM.bytes.assign(EEPROM_SIZE, 0xFF);
+    EEPROM.bytes[EEPROM_ADDR_MAGIC] = EEPROM_MAGIC;
+    EEPROM.bytes[EEPROM_ADDR_TEXT_SIZE] = 2;
+    EEPROM.bytes[EEPROM_ADDR_BRIGHTNESS] = 9;
+    EEPROM.bytes[EEPROM_ADDR_EFFECT_MODE] = effectMode;
+    EEPROM.bytes[EEPROM_ADDR_TIME_FORMAT] = 1;
+    EEPROM.bytes[EEPROM_ADDR_CLOCK_COLOR] = CLOCK_WHITE;
+}
+
+static EffectMode load() {
+    SettingsManager settings;
+    settings.begin();
+    return settings.getEffectMode();
+}
+
+void setUp(void) {
+    EEPROM.bytes.clear();
+    EEPROM.commits = 0;
+}
+
+void tearDown(void) {}
+
+// The original numbering, before Warp existed: Off was 8 and still is, with Warp and
+// Animation added after it
+void test_original_layout_keeps_its_modes(void) {
+    for (int mode = EFFECT_CONFETTI; mode <= EFFECT_OFF; mode++) {
+        saveLegacy(mode);
+        TEST_ASSERT_EQUAL_INT(mode, load());
+    }
+}
+
+void test_current_layout_round_trips_every_mode(void) {
+    for (int mode = EFFECT_CONFETTI; mode <= EFFECT_ANIMATION; mode++) {
+        EEPROM.bytes.clear();
+        SettingsManager saved;
+        saved.begin();
+        saved.setEffectMode((EffectMode)mode);
+        saved.saveSettings();
+        TEST_ASSERT_EQUAL_INT(mode, load());
+    }
+}
+
+void test_blank_eeprom_saves_defaults(void) {
+    TEST_ASSERT_EQUAL_INT(EFFECT_CONFETTI, load());
+    TEST_ASSERT_EQUAL_UINT8(EEPROM_MAGIC, EEPROM.bytes[EEPROM_ADDR_MAGIC]);
+    TEST_ASSERT_EQUAL_INT(1, EEPROM.commits);
+}
+
+void test_out_of_range_mode_keeps_the_default(void) {
+    saveLegacy(EFFECT_ANIMATION + 1);
+    TEST_ASSERT_EQUAL_INT(EFFECT_CONFETTI, load());
+    saveLegacy(0xFF);
+    TEST_ASSERT_EQUAL_INT(EFFECT_CONFETTI, load());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_original_layout_keeps_its_modes);
+    RUN_TEST(test_current_layout_round_trips_every_mode);
+    RUN_TEST(test_blank_eeprom_saves_defaults);
+    RUN_TEST(test_out_of_range_mode_keeps_the_default);
+    return UNITY_END();
+}
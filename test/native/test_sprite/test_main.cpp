@@ -0,0 +1,150 @@
+// MatrixDisplayManager::drawSprite on the host canvas: sprites partly or wholly off the panel
+// draw exactly what a bounds-checked drawPixel() loop draws, and a benchmark of the two.
+#include <Arduino.h>
+#include <unity.h>
+
+#include <chrono>
+#include <vector>
+
+#include "MatrixDisplayManager.h"
+#include "SpriteAssets.h"
+
+#define BACKGROUND 0x1234  // Anything the sprites do not use, to catch stray writes
+
+static uint8_t pins[6] = {};
+static Adafruit_Protomatter matrix(MATRIX_WIDTH, BIT_DEPTH, 1, pins, 4, pins, 0, 0, 0, true);
+static SettingsManager settings;
+static Metrics metrics;
+static EventStream events;
+static VideoWall wall(&settings);
+static MatrixDisplayManager display(&matrix, &settings, &events, &wall, &metrics);
+
+// Odd sizes, so packed rows end mid-byte
+static uint16_t rgbPixels[13 * 9];
+static const Sprite RGB_SPRITE = {13, 9, SPRITE_RGB565, true, 0, nullptr, 0xF81F, 0, rgbPixels};
+static const uint8_t INDEXED_DATA[] = {0x12, 0x30, 0x01, 0x23, 0x30, 0x21};  // 3x3, 2 bytes/row
+static const uint16_t INDEXED_PALETTE[] = {0x0000, 0xF800, 0x07E0, 0x001F};
+static const Sprite INDEXED_SPRITE = {3, 3, SPRITE_INDEXED4, true, 4, INDEXED_PALETTE, 0xF81F,
+                                      0, INDEXED_DATA};
+static const uint8_t MONO_DATA[] = {0xAA, 0xC0, 0x55, 0x80, 0xFF, 0xE0};  // 11x3, 2 bytes/row
+static const Sprite MONO_SPRITE = {11, 3, SPRITE_MONO, true, 0, nullptr, 0xF81F, 0xFFE0,
+                                   MONO_DATA};
+
+static const Sprite* const SPRITES[] = {&RGB_SPRITE,         &INDEXED_SPRITE,
+                                        &MONO_SPRITE,        &SPRITE_STATUS_MESSAGE,
+                                        &SPRITE_WEATHER_SUN, &SPRITE_STATUS_WIFI_OFF};
+
+// The same image one drawPixel() call at a time, scaling each pixel on its own
+static void drawSpritePerPixel(const Sprite& sprite, int x, int y, uint16_t monoColor) {
+    uint8_t level =
+        (uint8_t)(display.getBrightnessLevels()[settings.getBrightnessIndex()] * 255.0f);
+    const uint8_t* packed = static_cast<const uint8_t*>(sprite.data);
+    for (int row = 0; row < sprite.height; row++) {
+        for (int col = 0; col < sprite.width; col++) {
+            uint16_t color;
+            if (sprite.format == SPRITE_RGB565) {
+                color = static_cast<const uint16_t*>(sprite.data)[row * sprite.width + col];
+                if (sprite.hasTransparency && color == sprite.transparentColor) {
+                    continue;
+                }
+            } else if (sprite.format == SPRITE_INDEXED4) {
+                uint8_t byte = packed[row * ((sprite.width + 1) / 2) + col / 2];
+                uint8_t index = col % 2 ? byte & 0x0F : byte >> 4;
+                if (index == 0) {
+                    continue;
+                }
+                color = sprite.palette[index];
+            } else {
+                if (!(packed[row * ((sprite.width + 7) / 8) + col / 8] & (0x80 >> (col % 8)))) {
+                    continue;
+                }
+                color = monoColor;
+            }
+            display.drawPixel(x + col, y + row, display.fadeColor(color, level));
+        }
+    }
+}
+
+static std::vector<uint16_t> canvas() {
+    return std::vector<uint16_t>(matrix.getBuffer(),
+                                 matrix.getBuffer() + MATRIX_WIDTH * MATRIX_HEIGHT);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_sprites_clip_at_every_edge(void) {
+    for (const Sprite* sprite : SPRITES) {
+        const int w = sprite->width;
+        const int h = sprite->height;
+        const int xs[] = {-w - 1, -w, -w + 1, -3, 0, 60, MATRIX_WIDTH - w, MATRIX_WIDTH - 3,
+                          MATRIX_WIDTH - 1, MATRIX_WIDTH};
+        const int ys[] = {-h - 1, -h, -h + 1, -2, 0, 10, MATRIX_HEIGHT - h, MATRIX_HEIGHT - 2,
+                          MATRIX_HEIGHT - 1, MATRIX_HEIGHT};
+        for (int x : xs) {
+            for (int y : ys) {
+                matrix.fillScreen(BACKGROUND);
+                drawSpritePerPixel(*sprite, x, y, sprite->color);
+                std::vector<uint16_t> expected = canvas();
+
+                matrix.fillScreen(BACKGROUND);
+                display.drawSprite(*sprite, x, y);
+                char where[64];
+                snprintf(where, sizeof(where), "%dx%d sprite at (%d, %d)", w, h, x, y);
+                TEST_ASSERT_TRUE_MESSAGE(expected == canvas(), where);
+            }
+        }
+    }
+}
+
+void test_mono_sprite_takes_the_given_color(void) {
+    matrix.fillScreen(BACKGROUND);
+    drawSpritePerPixel(MONO_SPRITE, -4, MATRIX_HEIGHT - 2, 0x07FF);
+    std::vector<uint16_t> expected = canvas();
+    matrix.fillScreen(BACKGROUND);
+    display.drawSprite(MONO_SPRITE, -4, MATRIX_HEIGHT - 2, 0x07FF);
+    TEST_ASSERT_TRUE(expected == canvas());
+}
+
+// Nanoseconds per blit of each sprite at (x, y), drawn by draw
+template <typename Draw>
+static double nsPerBlit(Draw draw) {
+    const int loops = 20000;
+    double best = 1e30;
+    for (int run = 0; run < 3; run++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < loops; i++) {
+            draw(i % 16 - 4);  // Partly off the left edge a quarter of the time
+        }
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count() / loops;
+        best = std::min(best, ns);
+    }
+    return best;
+}
+
+void test_benchmark_draw_sprite_against_draw_pixel(void) {
+    for (const Sprite* sprite : SPRITES) {
+        double blit = nsPerBlit([&](int x) { display.drawSprite(*sprite, x, 4); });
+        double perPixel = nsPerBlit([&](int x) { drawSpritePerPixel(*sprite, x, 4, 0xFFE0); });
+        char report[96];
+        snprintf(report, sizeof(report),
+                 "%dx%d format %d: drawSprite %.0f ns, drawPixel loop %.0f ns", sprite->width,
+                 sprite->height, sprite->format, blit, perPixel);
+        TEST_MESSAGE(report);
+    }
+}
+
+int main(int argc, char** argv) {
+    for (int i = 0; i < 13 * 9; i++) {
+        rgbPixels[i] = i % 7 == 0 ? 0xF81F : (uint16_t)(i * 0x0841);  // Every 7th transparent
+    }
+    settings.begin();
+    display.begin();
+    UNITY_BEGIN();
+    RUN_TEST(test_sprites_clip_at_every_edge);
+    RUN_TEST(test_mono_sprite_takes_the_given_color);
+    RUN_TEST(test_benchmark_draw_sprite_against_draw_pixel);
+    return UNITY_END();
+}
@@ -0,0 +1,177 @@
+// TimeManager's cached local time on the host. Each result is checked against the same
+// arithmetic done from scratch for that second (the code the cache replaced), across local
+// midnights, month and year ends and the DST switch days, then timed per frame.
+#include <Arduino.h>
+#include <unity.h>
+
+#include <chrono>
+#include <string>
+
+#include "TimeManager.h"
+
+struct Zone {
+    int offset;
+    bool dst;
+    int dstOffset;
+};
+
+static Metrics metrics;
+static TimeManager timeManager(nullptr, &metrics);
+
+// Local time of hostTime worked out with no cache, as getLocalTime() used to every frame
+static DateTime directLocalTime(const Zone& zone) {
+    time_t utc = hostTime;
+    struct tm utcParts;
+    gmtime_r(&utc, &utcParts);
+    int offset = zone.offset;
+    if (zone.dst &&
+        timeManager.isDSTActive(utcParts.tm_mon + 1, utcParts.tm_mday, zone.offset)) {
+        offset += zone.dstOffset;
+    }
+    time_t local = utc + offset * 3600;
+    struct tm parts;
+    gmtime_r(&local, &parts);
+    return DateTime(parts.tm_year + 1900, parts.tm_mon + 1, parts.tm_mday, parts.tm_hour,
+                    parts.tm_min, parts.tm_sec);
+}
+
+static std::string directClock(const DateTime& now, bool use24Hour, bool amPm) {
+    int hour = now.hour();
+    if (!use24Hour) {
+        hour = hour % 12 == 0 ? 12 : hour % 12;
+    }
+    char text[16];
+    snprintf(text, sizeof(text), "%02d:%02d:%02d%s", hour, now.minute(), now.second(),
+             amPm ? (now.hour() >= 12 ? " PM" : " AM") : "");
+    return text;
+}
+
+static std::string directDate(const DateTime& now) {
+    static const char* days[] = {"SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT"};
+    char text[20];
+    snprintf(text, sizeof(text), "%02d/%02d/%04d [%s]", now.month(), now.day(), now.year(),
+             days[now.dayOfTheWeek()]);
+    return text;
+}
+
+// Compares the cached result for hostTime with the direct one; true when they agree
+static bool matchesDirect(const Zone& zone) {
+    DateTime expected = directLocalTime(zone);
+    LocalTime cached;
+    timeManager.getLocalTime(cached);
+    DateTime now = timeManager.getLocalTime();
+    return cached.utc == hostTime && now.year() == expected.year() &&
+           now.month() == expected.month() && now.day() == expected.day() &&
+           now.hour() == expected.hour() && now.minute() == expected.minute() &&
+           now.second() == expected.second() && cached.tm.tm_hour == expected.hour() &&
+           directClock(expected, true, false) == cached.time24 &&
+           directClock(expected, false, false) == cached.time12 &&
+           directClock(expected, false, true) == cached.time12AmPm &&
+           directDate(expected) == cached.date;
+}
+
+static time_t utcMidnight(int year, int month, int day) {
+    struct tm parts = {};
+    parts.tm_year = year - 1900;
+    parts.tm_mon = month - 1;
+    parts.tm_mday = day;
+    return timegm(&parts);
+}
+
+void setUp(void) {
+    hostMillis = 0;
+    hostTime = 1700000000;
+    timeManager.setTimezoneOffset(-7, false, 0);
+}
+
+void tearDown(void) {}
+
+// From 14 hours before to 14 hours after each UTC midnight covers that day's local midnight
+// in every zone (UTC-12 to UTC+13, DST included). Those all fall on whole UTC hours, so every
+// second within 90 s of an hour is checked and every 61st second between. Each second is
+// asked twice, so both the fresh and the cached path are checked.
+void test_matches_direct_time_around_midnights_and_dst_days(void) {
+    const Zone zones[] = {{-7, false, 0}, {-8, true, 1}, {-5, true, 1}, {0, false, 0},
+                          {1, true, 1},   {10, true, 1}, {13, false, 0}, {-12, false, 0}};
+    // Leap day, the March 14 and Nov 7-8 switches of isDSTActive (Oct 1 and Apr 1 for
+    // southern zones), a year end and the 32-bit rollover day
+    const int days[][3] = {{2024, 2, 29}, {2024, 3, 14}, {2024, 4, 1},   {2024, 10, 1},
+                           {2024, 11, 7}, {2024, 11, 8}, {2024, 12, 31}, {2038, 1, 19}};
+    int mismatches = 0;
+    char first[96] = "";
+    for (const Zone& zone : zones) {
+        timeManager.setTimezoneOffset(zone.offset, zone.dst, zone.dstOffset);
+        for (const int* day : days) {
+            time_t midnight = utcMidnight(day[0], day[1], day[2]);
+            for (hostTime = midnight - 14 * 3600; hostTime < midnight + 14 * 3600; hostTime++) {
+                int intoHour = hostTime % 3600;
+                if (intoHour >= 90 && intoHour < 3600 - 90 && hostTime % 61 != 0) {
+                    continue;
+                }
+                bool fresh = matchesDirect(zone);
+                bool cached = matchesDirect(zone);
+                if ((!fresh || !cached) && mismatches++ == 0) {
+                    snprintf(first, sizeof(first), "first at utc %lld, offset %d, dst %d",
+                             (long long)hostTime, zone.offset, zone.dst);
+                }
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, mismatches, first);
+}
+
+void test_timezone_change_within_a_second_is_not_served_stale(void) {
+    LocalTime before;
+    LocalTime after;
+    timeManager.getLocalTime(before);
+    timeManager.setTimezoneOffset(2, false, 0);
+    timeManager.getLocalTime(after);
+    TEST_ASSERT_EQUAL_INT((before.tm.tm_hour + 9) % 24, after.tm.tm_hour);
+    TEST_ASSERT_TRUE(matchesDirect({2, false, 0}));
+}
+
+void test_clock_stepped_back_is_recomputed(void) {
+    TEST_ASSERT_TRUE(matchesDirect({-7, false, 0}));
+    hostTime -= 3600;  // An NTP correction
+    TEST_ASSERT_TRUE(matchesDirect({-7, false, 0}));
+}
+
+// One frame's clock work, from scratch and through the cache, at 200 frames a second
+void test_benchmark_per_frame_cost(void) {
+    const Zone zone = {-8, true, 1};
+    const long frames = 1000000;
+    timeManager.setTimezoneOffset(zone.offset, zone.dst, zone.dstOffset);
+    size_t sink = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < frames; i++) {
+        hostTime = 1710000000 + i / 200;
+        DateTime now = directLocalTime(zone);
+        sink += directClock(now, false, false).size() + (now.hour() >= 12);
+    }
+    auto direct = std::chrono::steady_clock::now();
+    for (long i = 0; i < frames; i++) {
+        hostTime = 1710000000 + i / 200;
+        LocalTime now;
+        timeManager.getLocalTime(now);
+        sink += strlen(now.time12) + (now.tm.tm_hour >= 12);
+    }
+    auto cached = std::chrono::steady_clock::now();
+    TEST_ASSERT_TRUE(sink > 0);
+
+    double directNs = std::chrono::duration<double, std::nano>(direct - start).count() / frames;
+    double cachedNs = std::chrono::duration<double, std::nano>(cached - direct).count() / frames;
+    char report[96];
+    snprintf(report, sizeof(report), "per frame: direct %.1f ns, cached %.1f ns (%.1fx)",
+             directNs, cachedNs, directNs / cachedNs);
+    TEST_MESSAGE(report);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_matches_direct_time_around_midnights_and_dst_days);
+    RUN_TEST(test_timezone_change_within_a_second_is_not_served_stale);
+    RUN_TEST(test_clock_stepped_back_is_recomputed);
+    RUN_TEST(test_benchmark_per_frame_cost);
+    return UNITY_END();
+}
@@ -0,0 +1,232 @@
+// VideoWall on the host: the beacon layout, how a follower takes the leader's time base from
+// beacons (least delayed of the recent ones, restarted when the leader restarts), which frame
+// a wall time falls in, beacons that belong to another wall, and the shared hash helpers.
+#include <Arduino.h>
+#include <unity.h>
+
+#include <esp_timer.h>
+
+#include "VideoWall.h"
+
+static SettingsManager settings;
+
+static uint32_t get32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) |
+           ((uint32_t)in[3] << 24);
+}
+
+// A beacon the leader of a wall of tiles stamped at wallUs
+static size_t leaderBeacon(uint8_t* out, int64_t wallUs, int tiles = 3, uint32_t hash = 0,
+                           uint32_t startFrame = 0) {
+    VideoWall leader(&settings);
+    leader.setLayout(0, tiles);
+    leader.setLeaderMessage(hash, startFrame);
+    return leader.buildBeacon(out, wallUs);
+}
+
+void setUp(void) {
+    hostMillis = 10000;
+}
+
+void tearDown(void) {}
+
+void test_beacon_layout(void) {
+    uint8_t beacon[WALL_BEACON_SIZE];
+    int64_t wallUs = 1234LL * WALL_FRAME_US + 5678;
+    TEST_ASSERT_EQUAL_size_t(WALL_BEACON_SIZE, leaderBeacon(beacon, wallUs, 4, 0xCAFE, 1200));
+    TEST_ASSERT_EQUAL_MEMORY("WB", beacon, 2);
+    TEST_ASSERT_EQUAL_UINT8(WALL_BEACON_VERSION, beacon[2]);
+    TEST_ASSERT_EQUAL_UINT8(4, beacon[3]);
+    TEST_ASSERT_EQUAL_UINT32(1234, get32(beacon + 8));
+    TEST_ASSERT_EQUAL_UINT32(5678, get32(beacon + 12));
+    TEST_ASSERT_EQUAL_UINT32(0xCAFE, get32(beacon + 16));
+    TEST_ASSERT_EQUAL_UINT32(1200, get32(beacon + 20));
+}
+
+// The leader booted 5 s before the follower: the follower's wall time, frame and seed become
+// the leader's
+void test_follower_takes_the_leader_time_base(void) {
+    VideoWall follower(&settings);
+    follower.setLayout(2, 3);
+    TEST_ASSERT_FALSE(follower.isSynced());
+
+    int64_t localUs = esp_timer_get_time();
+    int64_t wallUs = localUs + 5000000 + 1234;
+    uint8_t beacon[WALL_BEACON_SIZE];
+    leaderBeacon(beacon, wallUs);
+    TEST_ASSERT_TRUE(follower.handleBeacon(beacon, sizeof(beacon), localUs));
+    TEST_ASSERT_EQUAL_INT64(5001234, follower.getOffsetMicros());
+    TEST_ASSERT_EQUAL_INT64(wallUs, follower.getWallMicros());
+    TEST_ASSERT_EQUAL_UINT32(wallUs / WALL_FRAME_US, follower.getFrame());
+    TEST_ASSERT_EQUAL_UINT32(get32(beacon + 4), follower.getSeed());
+    TEST_ASSERT_TRUE(follower.isSynced());
+    TEST_ASSERT_EQUAL_UINT32(1, follower.getBeaconCount());
+}
+
+// A wall time at the start of frame 900 stays in that frame for one frame period
+void test_frame_slots(void) {
+    VideoWall follower(&settings);
+    follower.setLayout(1, 2);
+    uint8_t beacon[WALL_BEACON_SIZE];
+    leaderBeacon(beacon, 900LL * WALL_FRAME_US, 2);
+    follower.handleBeacon(beacon, sizeof(beacon), esp_timer_get_time());
+
+    TEST_ASSERT_EQUAL_UINT32(900, follower.getFrame());
+    hostMillis += WALL_FRAME_US / 1000;  // Just short of the period
+    TEST_ASSERT_EQUAL_UINT32(900, follower.getFrame());
+    hostMillis += 1;
+    TEST_ASSERT_EQUAL_UINT32(901, follower.getFrame());
+    hostMillis += 1000;
+    TEST_ASSERT_EQUAL_UINT32(901 + WALL_FRAME_HZ, follower.getFrame());
+}
+
+// Beacons arrive late but never early, so the largest offset of the last WALL_SYNC_WINDOW
+// beacons wins, and a well-timed beacon counts only until it leaves the window
+void test_offset_is_the_least_delayed_recent_beacon(void) {
+    VideoWall follower(&settings);
+    follower.setLayout(1, 3);
+    const int64_t trueOffset = 7000000;
+    const int delays[] = {4000, 300, 9000, 2500};
+    uint8_t beacon[WALL_BEACON_SIZE];
+    for (int delay : delays) {
+        int64_t localUs = esp_timer_get_time();
+        leaderBeacon(beacon, localUs + trueOffset - delay);
+        follower.handleBeacon(beacon, sizeof(beacon), localUs);
+        hostMillis += WALL_BEACON_MS;
+    }
+    TEST_ASSERT_EQUAL_INT64(trueOffset - 300, follower.getOffsetMicros());
+
+    for (int i = 0; i < WALL_SYNC_WINDOW; i++) {
+        int64_t localUs = esp_timer_get_time();
+        leaderBeacon(beacon, localUs + trueOffset - 2000 - i);
+        follower.handleBeacon(beacon, sizeof(beacon), localUs);
+        hostMillis += WALL_BEACON_MS;
+    }
+    TEST_ASSERT_EQUAL_INT64(trueOffset - 2000, follower.getOffsetMicros());
+}
+
+// After the leader restarts its clock is far behind; the follower follows it right away
+// instead of keeping the larger offsets from before the restart
+void test_leader_restart_resets_the_offset(void) {
+    VideoWall follower(&settings);
+    follower.setLayout(1, 3);
+    uint8_t beacon[WALL_BEACON_SIZE];
+    int64_t localUs = esp_timer_get_time();
+    leaderBeacon(beacon, localUs + 60000000);
+    follower.handleBeacon(beacon, sizeof(beacon), localUs);
+
+    hostMillis += WALL_BEACON_MS;
+    localUs = esp_timer_get_time();
+    leaderBeacon(beacon, 200000);
+    TEST_ASSERT_TRUE(follower.handleBeacon(beacon, sizeof(beacon), localUs));
+    TEST_ASSERT_EQUAL_INT64(200000 - localUs, follower.getOffsetMicros());
+    TEST_ASSERT_EQUAL_UINT32(200000 / WALL_FRAME_US, follower.getFrame());
+
+    // A beacon up to WALL_RESYNC_US late is delay, not a restart
+    int64_t offsetUs = follower.getOffsetMicros();
+    hostMillis += WALL_BEACON_MS;
+    localUs = esp_timer_get_time();
+    leaderBeacon(beacon, localUs + offsetUs - 100000);
+    follower.handleBeacon(beacon, sizeof(beacon), localUs);
+    TEST_ASSERT_EQUAL_INT64(offsetUs, follower.getOffsetMicros());
+}
+
+void test_other_beacons_are_ignored(void) {
+    VideoWall follower(&settings);
+    follower.setLayout(1, 3);
+    uint8_t good[WALL_BEACON_SIZE];
+    leaderBeacon(good, 123456789);
+    uint8_t beacon[WALL_BEACON_SIZE];
+
+    memcpy(beacon, good, sizeof(beacon));
+    beacon[3] = 4;  // Another wall of four tiles
+    TEST_ASSERT_FALSE(follower.handleBeacon(beacon, sizeof(beacon), 0));
+    memcpy(beacon, good, sizeof(beacon));
+    beacon[1] = 'X';
+    TEST_ASSERT_FALSE(follower.handleBeacon(beacon, sizeof(beacon), 0));
+    memcpy(beacon, good, sizeof(beacon));
+    beacon[2] = WALL_BEACON_VERSION + 1;
+    TEST_ASSERT_FALSE(follower.handleBeacon(beacon, sizeof(beacon), 0));
+    TEST_ASSERT_FALSE(follower.handleBeacon(good, sizeof(good) - 1, 0));
+    TEST_ASSERT_EQUAL_UINT32(0, follower.getBeaconCount());
+    TEST_ASSERT_EQUAL_INT64(0, follower.getOffsetMicros());
+
+    VideoWall leader(&settings);
+    leader.setLayout(0, 3);
+    TEST_ASSERT_FALSE(leader.handleBeacon(good, sizeof(good), 0));
+    TEST_ASSERT_EQUAL_INT64(0, leader.getOffsetMicros());
+}
+
+void test_leader_message_needs_recent_beacons(void) {
+    VideoWall follower(&settings);
+    follower.setLayout(1, 2);
+    uint32_t hash = VideoWall::hashText("hello wall");
+    uint8_t beacon[WALL_BEACON_SIZE];
+    leaderBeacon(beacon, esp_timer_get_time(), 2, hash, 4321);
+    follower.handleBeacon(beacon, sizeof(beacon), esp_timer_get_time());
+
+    uint32_t startFrame = 0;
+    TEST_ASSERT_TRUE(follower.getLeaderMessage(hash, startFrame));
+    TEST_ASSERT_EQUAL_UINT32(4321, startFrame);
+    TEST_ASSERT_FALSE(follower.getLeaderMessage(VideoWall::hashText("other"), startFrame));
+
+    hostMillis += WALL_SYNC_TIMEOUT_MS;
+    TEST_ASSERT_FALSE(follower.isSynced());
+    TEST_ASSERT_FALSE(follower.getLeaderMessage(hash, startFrame));
+
+    // The leader itself never takes a start frame from anyone
+    VideoWall leader(&settings);
+    leader.setLayout(0, 2);
+    leader.setLeaderMessage(hash, 4321);
+    TEST_ASSERT_FALSE(leader.getLeaderMessage(hash, startFrame));
+}
+
+void test_invalid_layouts_are_refused(void) {
+    VideoWall wall(&settings);
+    wall.setLayout(1, 4);
+    wall.setLayout(4, 4);
+    wall.setLayout(-1, 4);
+    wall.setLayout(0, 0);
+    TEST_ASSERT_EQUAL_INT(1, wall.getTileIndex());
+    TEST_ASSERT_EQUAL_INT(4, wall.getTileCount());
+    wall.setLayout(0, 1);
+    TEST_ASSERT_FALSE(wall.isActive());
+    TEST_ASSERT_TRUE(wall.isSynced());
+}
+
+// Every tile derives the same particles from the seed, so hash() has to be a fixed function
+// of its inputs; confetti also picks one of 7 colors from it, which should come out even
+void test_hash_helpers(void) {
+    TEST_ASSERT_EQUAL_UINT32(VideoWall::hash(42, 7), VideoWall::hash(42, 7));
+    TEST_ASSERT_NOT_EQUAL(VideoWall::hash(42, 7), VideoWall::hash(7, 42));
+    TEST_ASSERT_NOT_EQUAL(VideoWall::hash(42, 7), VideoWall::hash(43, 7));
+
+    int colors[7] = {};
+    const int samples = 70000;
+    for (int i = 0; i < samples; i++) {
+        colors[(VideoWall::hash(0x5EED + i, 3) >> 20) % 7]++;
+    }
+    for (int count : colors) {
+        TEST_ASSERT_INT_WITHIN(samples / 7 / 10, samples / 7, count);
+    }
+
+    // FNV-1a test vectors
+    TEST_ASSERT_EQUAL_HEX32(0x811C9DC5, VideoWall::hashText(""));
+    TEST_ASSERT_EQUAL_HEX32(0xE40C292C, VideoWall::hashText("a"));
+    TEST_ASSERT_EQUAL_HEX32(0xBF9CF968, VideoWall::hashText("foobar"));
+}
+
+int main(int argc, char** argv) {
+    settings.begin();
+    UNITY_BEGIN();
+    RUN_TEST(test_beacon_layout);
+    RUN_TEST(test_follower_takes_the_leader_time_base);
+    RUN_TEST(test_frame_slots);
+    RUN_TEST(test_offset_is_the_least_delayed_recent_beacon);
+    RUN_TEST(test_leader_restart_resets_the_offset);
+    RUN_TEST(test_other_beacons_are_ignored);
+    RUN_TEST(test_leader_message_needs_recent_beacons);
+    RUN_TEST(test_invalid_layouts_are_refused);
+    RUN_TEST(test_hash_helpers);
+    return UNITY_END();
+}
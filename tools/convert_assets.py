@@ -0,0 +1,280 @@
+"""
+Convert PNG images in assets/ into flash-resident sprite data.
+
+Runs automatically before each PlatformIO build (extra_scripts = pre:tools/convert_assets.py)
+and can also be run by hand:
+
+    python tools/convert_assets.py
+
+Each assets/<name>.png becomes a `const Sprite SPRITE_<NAME>` in lib/Sprite/SpriteAssets.cpp.
+The pixel format is picked automatically unless the file name carries an override:
+
+    <name>.mono.png    1 bit per pixel, drawn in a single color (the image's opaque color)
+    <name>.i4.png      4-bit palette indices, up to 15 colors plus transparency
+    <name>.rgb565.png  16-bit color with a transparency key
+
+Pixels with alpha below 128 are transparent. Only a small, dependency-free PNG decoder is used
+(non-interlaced, 8-bit RGB/RGBA/gray or 1/2/4/8-bit palette), so no extra Python packages are
+needed in the PlatformIO environment.
+"""
+
+import os
+import struct
+import sys
+import zlib
+
+TRANSPARENT_KEY = 0xF81F  # Magenta, never produced for opaque pixels
+
+
+def read_png(path):
+    """Return (width, height, rows) where rows are lists of (r, g, b, a) tuples."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise ValueError("%s: not a PNG file" % path)
+
+    pos = 8
+    idat = b""
+    palette = []
+    trns = b""
+    width = height = bit_depth = color_type = interlace = None
+    while pos < len(data):
+        length, ctype = struct.unpack(">I4s", data[pos : pos + 8])
+        chunk = data[pos + 8 : pos + 8 + length]
+        pos += 12 + length
+        if ctype == b"IHDR":
+            width, height, bit_depth, color_type, _, _, interlace = struct.unpack(">IIBBBBB", chunk)
+        elif ctype == b"PLTE":
+            palette = [tuple(chunk[i : i + 3]) for i in range(0, len(chunk), 3)]
+        elif ctype == b"tRNS":
+            trns = chunk
+        elif ctype == b"IDAT":
+            idat += chunk
+        elif ctype == b"IEND":
+            break
+
+    if interlace:
+        raise ValueError("%s: interlaced PNGs are not supported" % path)
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color_type]
+    if color_type != 3 and bit_depth != 8:
+        raise ValueError("%s: only 8-bit non-palette PNGs are supported" % path)
+
+    bits_per_pixel = channels * bit_depth
+    stride = (width * bits_per_pixel + 7) // 8
+    bpp = max(1, bits_per_pixel // 8)
+    raw = zlib.decompress(idat)
+
+    rows = []
+    prev = bytearray(stride)
+    for y in range(height):
+        offset = y * (stride + 1)
+        ftype = raw[offset]
+        line = bytearray(raw[offset + 1 : offset + 1 + stride])
+        for i in range(stride):
+            left = line[i - bpp] if i >= bpp else 0
+            up = prev[i]
+            upleft = prev[i - bpp] if i >= bpp else 0
+            if ftype == 1:
+                line[i] = (line[i] + left) & 0xFF
+            elif ftype == 2:
+                line[i] = (line[i] + up) & 0xFF
+            elif ftype == 3:
+                line[i] = (line[i] + ((left + up) >> 1)) & 0xFF
+            elif ftype == 4:
+                p = left + up - upleft
+                pa, pb, pc = abs(p - left), abs(p - up), abs(p - upleft)
+                pred = left if pa <= pb and pa <= pc else (up if pb <= pc else upleft)
+                line[i] = (line[i] + pred) & 0xFF
+        prev = line
+
+        pixels = []
+        for x in range(width):
+            if color_type == 3:
+                bit = x * bit_depth
+                index = (line[bit // 8] >> (8 - bit_depth - bit % 8)) & ((1 << bit_depth) - 1)
+                r, g, b = palette[index]
+                a = trns[index] if index < len(trns) else 255
+            else:
+                px = line[x * channels : (x + 1) * channels]
+                if color_type == 0:
+                    r = g = b = px[0]
+                    a = 255
+                elif color_type == 4:
+                    r = g = b = px[0]
+                    a = px[1]
+                elif color_type == 2:
+                    r, g, b = px
+                    a = 255
+                else:
+                    r, g, b, a = px
+            pixels.append((r, g, b, a))
+        rows.append(pixels)
+
+    return width, height, rows
+
+
+def rgb565(r, g, b):
+    color = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+    return color ^ 0x0001 if color == TRANSPARENT_KEY else color
+
+
+def convert(name, fmt, width, height, rows):
+    """Return (format, data_type, data_values, palette_values, mono_color, transparent)."""
+    colors = []
+    transparent = False
+    for row in rows:
+        for r, g, b, a in row:
+            if a < 128:
+                transparent = True
+            else:
+                c = rgb565(r, g, b)
+                if c not in colors:
+                    colors.append(c)
+
+    if fmt is None:
+        if len(colors) <= 1:
+            fmt = "mono"
+        elif len(colors) <= 15:
+            fmt = "i4"
+        else:
+            fmt = "rgb565"
+
+    if fmt == "mono":
+        if len(colors) > 1:
+            raise ValueError("%s: mono sprites may only use one opaque color" % name)
+        data = []
+        for row in rows:
+            for x0 in range(0, width, 8):
+                byte = 0
+                for bit in range(8):
+                    x = x0 + bit
+                    if x < width and row[x][3] >= 128:
+                        byte |= 0x80 >> bit
+                data.append(byte)
+        return "SPRITE_MONO", "uint8_t", data, [], colors[0] if colors else 0xFFFF, True
+
+    if fmt == "i4":
+        # Index 0 is reserved for transparency so the blitter can skip it without a compare
+        if len(colors) > 15:
+            raise ValueError("%s: indexed sprites may only use 15 colors" % name)
+        palette = [0x0000] + colors
+        data = []
+        for row in rows:
+            for x0 in range(0, width, 2):
+                byte = 0
+                for half in range(2):
+                    x = x0 + half
+                    index = 0
+                    if x < width and row[x][3] >= 128:
+                        index = palette.index(rgb565(*row[x][:3]), 1)
+                    byte |= index << (4 - 4 * half)
+                data.append(byte)
+        return "SPRITE_INDEXED4", "uint8_t", data, palette, 0, transparent
+
+    data = []
+    for row in rows:
+        for r, g, b, a in row:
+            data.append(rgb565(r, g, b) if a >= 128 else TRANSPARENT_KEY)
+    return "SPRITE_RGB565", "uint16_t", data, [], 0, transparent
+
+
+def format_array(values, width_hex):
+    per_line = 12 if width_hex == 2 else 8
+    lines = []
+    for i in range(0, len(values), per_line):
+        chunk = values[i : i + per_line]
+        lines.append("    " + ", ".join("0x%0*X" % (width_hex, v) for v in chunk) + ",")
+    return "\n".join(lines)
+
+
+def generate(project_dir):
+    asset_dir = os.path.join(project_dir, "assets")
+    out_dir = os.path.join(project_dir, "lib", "Sprite")
+    header_path = os.path.join(out_dir, "SpriteAssets.h")
+    source_path = os.path.join(out_dir, "SpriteAssets.cpp")
+
+    pngs = sorted(f for f in os.listdir(asset_dir) if f.lower().endswith(".png"))
+    inputs = [os.path.join(asset_dir, f) for f in pngs] + [os.path.abspath(__file__)]
+    if os.path.exists(header_path) and os.path.exists(source_path):
+        newest_input = max(os.path.getmtime(p) for p in inputs)
+        oldest_output = min(os.path.getmtime(header_path), os.path.getmtime(source_path))
+        if newest_input <= oldest_output:
+            return False
+
+    header = [
+        "// Generated by tools/convert_assets.py from assets/*.png - do not edit",
+        "#ifndef SPRITE_ASSETS_H",
+        "#define SPRITE_ASSETS_H",
+        "",
+        '#include "Sprite.h"',
+        "",
+    ]
+    source = [
+        "// Generated by tools/convert_assets.py from assets/*.png - do not edit",
+        '#include "SpriteAssets.h"',
+        "",
+    ]
+    total_bytes = 0
+
+    for filename in pngs:
+        stem = filename[:-4]
+        fmt = None
+        for suffix in ("mono", "i4", "rgb565"):
+            if stem.endswith("." + suffix):
+                fmt = suffix
+                stem = stem[: -len(suffix) - 1]
+        ident = "".join(c if c.isalnum() else "_" for c in stem).upper()
+
+        width, height, rows = read_png(os.path.join(asset_dir, filename))
+        kind, ctype, data, palette, mono_color, transparent = convert(
+            filename, fmt, width, height, rows
+        )
+        total_bytes += len(data) * (2 if ctype == "uint16_t" else 1) + len(palette) * 2
+
+        header.append("extern const Sprite SPRITE_%s;  // %dx%d %s" % (ident, width, height, kind))
+
+        source.append("// %s" % filename)
+        source.append("static const %s %s_DATA[] PROGMEM = {" % (ctype, ident))
+        source.append(format_array(data, 4 if ctype == "uint16_t" else 2))
+        source.append("};")
+        palette_ref = "nullptr"
+        if palette:
+            source.append("static const uint16_t %s_PALETTE[] PROGMEM = {" % ident)
+            source.append(format_array(palette, 4))
+            source.append("};")
+            palette_ref = "%s_PALETTE" % ident
+        source.append(
+            "const Sprite SPRITE_%s = {%d, %d, %s, %s, %d, %s, 0x%04X, 0x%04X, %s_DATA};"
+            % (
+                ident,
+                width,
+                height,
+                kind,
+                "true" if transparent else "false",
+                len(palette),
+                palette_ref,
+                TRANSPARENT_KEY,
+                mono_color,
+                ident,
+            )
+        )
+        source.append("")
+
+    header += ["", "#endif  // SPRITE_ASSETS_H", ""]
+
+    with open(header_path, "w") as f:
+        f.write("\n".join(header))
+    with open(source_path, "w") as f:
+        f.write("\n".join(source))
+
+    print("convert_assets: %d sprites, %d bytes of flash data" % (len(pngs), total_bytes))
+    return True
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+    generate(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        generate(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+        sys.exit(0)
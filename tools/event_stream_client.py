@@ -0,0 +1,169 @@
+"""
+Test client for the clock's live event stream (WebSocket on /events).
+
+    python tools/event_stream_client.py <device-ip> --password secret --duration 60
+    python tools/event_stream_client.py <device-ip> --slow 0.2   # Read slowly to force overruns
+
+Prints every event and checks the stream as it goes:
+
+    - seq goes up by exactly one per event
+    - after {"type":"overrun","count":K} the next seq is exactly K further on
+
+At the end it prints event counts by type and how many events were lost to overruns. The exit
+status is 1 if the ordering or the drop accounting was ever wrong. Run tools/http_load.py at the
+same time to generate message events.
+
+Only the standard library is used.
+"""
+
+import argparse
+import base64
+import json
+import os
+import socket
+import struct
+import sys
+import time
+
+
+def connect(host, port, path, password, timeout):
+    sock = socket.create_connection((host, port), timeout)
+    key = base64.b64encode(os.urandom(16)).decode("ascii")
+    head = ("GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+            "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n" % (path, host, key))
+    if password:
+        head += "Authorization: Bearer %s\r\n" % password
+    sock.sendall((head + "\r\n").encode("ascii"))
+    response = b""
+    while b"\r\n\r\n" not in response:
+        chunk = sock.recv(1024)
+        if not chunk:
+            raise ConnectionError("connection closed during handshake")
+        response += chunk
+    status = response.split(b"\r\n", 1)[0]
+    if b" 101 " not in status:
+        raise ConnectionError("handshake failed: %s" % status.decode("ascii", "replace"))
+    return sock, response.split(b"\r\n\r\n", 1)[1]
+
+
+def read_exact(sock, buffer, count):
+    while len(buffer) < count:
+        chunk = sock.recv(4096)
+        if not chunk:
+            raise ConnectionError("connection closed")
+        buffer += chunk
+    return buffer[:count], buffer[count:]
+
+
+def send_frame(sock, opcode, payload=b""):
+    # Client frames must be masked
+    mask = os.urandom(4)
+    masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+    sock.sendall(struct.pack("!BB", 0x80 | opcode, 0x80 | len(payload)) + mask + masked)
+
+
+def frames(sock, buffer):
+    """Yields (opcode, payload) for each complete message; answers pings."""
+    while True:
+        head, buffer = read_exact(sock, buffer, 2)
+        opcode = head[0] & 0x0F
+        length = head[1] & 0x7F
+        if length == 126:
+            raw, buffer = read_exact(sock, buffer, 2)
+            length = struct.unpack("!H", raw)[0]
+        elif length == 127:
+            raw, buffer = read_exact(sock, buffer, 8)
+            length = struct.unpack("!Q", raw)[0]
+        payload, buffer = read_exact(sock, buffer, length)
+        if opcode == 0x9:
+            send_frame(sock, 0xA, payload)
+        elif opcode == 0x8:
+            return
+        else:
+            yield opcode, payload
+
+
+class StreamChecker:
+    def __init__(self):
+        self.expected = None  # seq the next event must carry
+        self.pending_skip = 0
+        self.counts = {}
+        self.lost = 0
+        self.errors = 0
+
+    def check(self, event):
+        kind = event.get("type", "?")
+        self.counts[kind] = self.counts.get(kind, 0) + 1
+
+        if kind == "overrun":
+            self.pending_skip += int(event.get("count", 0))
+            self.lost += int(event.get("count", 0))
+            return None
+
+        seq = event.get("seq")
+        if seq is None:
+            self.errors += 1
+            return "event without seq"
+        problem = None
+        if self.expected is not None and seq != self.expected + self.pending_skip:
+            self.errors += 1
+            problem = "expected seq %d, got %d" % (self.expected + self.pending_skip, seq)
+        self.expected = seq + 1
+        self.pending_skip = 0
+        return problem
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("host", help="IP address of the clock")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--path", default="/events")
+    parser.add_argument("--password", default="", help="MESSAGE_API_PASSWORD of the clock")
+    parser.add_argument("--duration", type=float, default=0, help="seconds to run (0 = forever)")
+    parser.add_argument("--slow", type=float, default=0,
+                        help="seconds to sleep after each event, to act as a slow subscriber")
+    parser.add_argument("--quiet", action="store_true", help="only print problems and the summary")
+    options = parser.parse_args()
+
+    sock, buffer = connect(options.host, options.port, options.path, options.password, 10)
+    sock.settimeout(None)
+    checker = StreamChecker()
+    deadline = time.monotonic() + options.duration if options.duration else None
+
+    try:
+        for opcode, payload in frames(sock, buffer):
+            if opcode != 0x1:
+                continue
+            text = payload.decode("utf-8", "replace")
+            try:
+                event = json.loads(text)
+            except ValueError:
+                checker.errors += 1
+                print("ERROR: not JSON: %s" % text)
+                continue
+
+            problem = checker.check(event)
+            if problem:
+                print("ERROR: %s" % problem)
+            if not options.quiet:
+                print(text)
+
+            if options.slow:
+                time.sleep(options.slow)
+            if deadline and time.monotonic() > deadline:
+                break
+    except KeyboardInterrupt:
+        pass
+    except ConnectionError as error:
+        print("connection ended: %s" % error)
+    finally:
+        sock.close()
+
+    print("events:   %s" % ", ".join("%s=%d" % item for item in sorted(checker.counts.items())))
+    print("lost:     %d (reported by overrun events)" % checker.lost)
+    print("problems: %d" % checker.errors)
+    return 1 if checker.errors else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,152 @@
+"""
+Grabs frames from the clock's GET /frame and compares them with golden images.
+
+    python tools/frame_capture.py grab <device-ip> shot.png --password secret
+    python tools/frame_capture.py compare shot.png golden.png --tolerance 8
+
+grab saves the frame the clock sends. compare reads raw (128x32 RGB565), ppm or png files,
+as written by the clock or by a host harness built on lib/FrameCapture, and prints how many
+pixels differ by more than --tolerance in any channel. It exits with 1 if any do.
+
+Only the standard library is used.
+"""
+
+import argparse
+import struct
+import sys
+import urllib.request
+import zlib
+
+WIDTH = 128
+HEIGHT = 32
+
+
+def grab(options):
+    url = "http://%s/frame?format=%s" % (options.host, options.format)
+    request = urllib.request.Request(url)
+    if options.password:
+        request.add_header("Authorization", "Bearer %s" % options.password)
+    with urllib.request.urlopen(request, timeout=30) as response:
+        data = response.read()
+
+    with open(options.output, "wb") as out:
+        out.write(data)
+    print("%d bytes: %s" % (len(data), options.output))
+
+
+def read_image(path):
+    """Pixels of a raw, ppm or png file as rows of (r, g, b) bytes."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data.startswith(b"P6"):
+        return read_ppm(data)
+    if data.startswith(b"\x89PNG\r\n\x1a\n"):
+        return read_png(data)
+    if len(data) != WIDTH * HEIGHT * 2:
+        sys.exit("%s: not a ppm, png or %dx%d raw frame" % (path, WIDTH, HEIGHT))
+    rows = []
+    for y in range(HEIGHT):
+        row = bytearray()
+        for color in struct.unpack_from("<%dH" % WIDTH, data, y * WIDTH * 2):
+            r, g, b = color >> 11, (color >> 5) & 0x3F, color & 0x1F
+            row += bytes(((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)))
+        rows.append(bytes(row))
+    return rows
+
+
+def read_ppm(data):
+    fields = data.split(None, 4)
+    width, height, maximum = int(fields[1]), int(fields[2]), int(fields[3])
+    if maximum != 255:
+        sys.exit("only 8-bit ppm files are supported")
+    pixels = data[len(data) - width * height * 3:]
+    return [pixels[y * width * 3:(y + 1) * width * 3] for y in range(height)]
+
+
+def read_png(data):
+    """8-bit RGB or RGBA, not interlaced; enough for golden images from any editor."""
+    pos = 8
+    idat = bytearray()
+    while pos < len(data):
+        length, kind = struct.unpack_from(">I4s", data, pos)
+        body = data[pos + 8:pos + 8 + length]
+        if kind == b"IHDR":
+            width, height, depth, color, _, _, interlace = struct.unpack(">IIBBBBB", body)
+            if depth != 8 or color not in (2, 6) or interlace:
+                sys.exit("only 8-bit RGB or RGBA png files are supported")
+        elif kind == b"IDAT":
+            idat += body
+        pos += 12 + length
+    channels = 3 if color == 2 else 4
+    stride = width * channels
+    raw = zlib.decompress(bytes(idat))
+    rows = []
+    previous = bytearray(stride)
+    for y in range(height):
+        kind = raw[y * (stride + 1)]
+        row = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for x in range(stride):
+            left = row[x - channels] if x >= channels else 0
+            up = previous[x]
+            corner = previous[x - channels] if x >= channels else 0
+            if kind == 1:
+                row[x] = (row[x] + left) & 0xFF
+            elif kind == 2:
+                row[x] = (row[x] + up) & 0xFF
+            elif kind == 3:
+                row[x] = (row[x] + (left + up) // 2) & 0xFF
+            elif kind == 4:
+                p = left + up - corner
+                pa, pb, pc = abs(p - left), abs(p - up), abs(p - corner)
+                predictor = left if pa <= pb and pa <= pc else up if pb <= pc else corner
+                row[x] = (row[x] + predictor) & 0xFF
+        previous = row
+        if channels == 4:
+            row = bytearray(b for i, b in enumerate(row) if i % 4 != 3)
+        rows.append(bytes(row))
+    return rows
+
+
+def compare(options):
+    a = read_image(options.a)
+    b = read_image(options.b)
+    if len(a) != len(b) or len(a[0]) != len(b[0]):
+        sys.exit("sizes differ: %dx%d and %dx%d" %
+                 (len(a[0]) // 3, len(a), len(b[0]) // 3, len(b)))
+    different = 0
+    largest = 0
+    for row_a, row_b in zip(a, b):
+        for x in range(0, len(row_a), 3):
+            diff = max(abs(row_a[x + i] - row_b[x + i]) for i in range(3))
+            largest = max(largest, diff)
+            if diff > options.tolerance:
+                different += 1
+    print("%d of %d pixels differ by more than %d (largest difference %d)" %
+          (different, len(a) * len(a[0]) // 3, options.tolerance, largest))
+    return 1 if different else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+    grab_parser = commands.add_parser("grab", help="save a frame from GET /frame")
+    grab_parser.add_argument("host")
+    grab_parser.add_argument("output")
+    grab_parser.add_argument("--format", choices=("png", "ppm", "raw"), default="png")
+    grab_parser.add_argument("--password", default="")
+    compare_parser = commands.add_parser("compare", help="compare two images")
+    compare_parser.add_argument("a")
+    compare_parser.add_argument("b")
+    compare_parser.add_argument("--tolerance", type=int, default=0,
+                                help="largest channel difference that still counts as equal")
+    options = parser.parse_args()
+
+    if options.command == "grab":
+        grab(options)
+        return 0
+    return compare(options)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,520 @@
+"""
+Encoder for the compressed frame format of lib/FrameCodec/FrameCodec.h.
+
+    python tools/frame_codec.py bench                          # Synthetic clips
+    python tools/frame_codec.py bench clip.gif other.gif       # Plus GIF animations
+    python tools/frame_codec.py convert clip.gif clip.fca      # Animation file for the clock
+
+A frame is either a key frame or a delta XORed onto the previous frame. Rows that did not
+change are left out, and the rest are run-length coded. If a frame needs no more than 256
+distinct values it may use a palette of them, with one byte per value. The encoder tries both
+and keeps the smaller one.
+
+bench encodes each clip with a key frame every --key-interval frames, decodes it again with
+the reference decoder below to check the round trip, and prints the compression ratio against
+raw 8 KB RGB565 frames. --dump DIR also writes each clip as <name>.raw (raw frames) and
+<name>.fcs (each encoded frame preceded by its length as a 32-bit little endian number), for
+benchmarking the firmware decoder on a host.
+
+convert turns a GIF into the animation file format of lib/AnimationPlayer/AnimationPlayer.h:
+a header, an index of frame chunk offsets with key frames marked, then one chunk per frame
+holding its GIF delay and the encoded frame. Upload it with
+
+    curl --data-binary @clip.fca -H "Authorization: Bearer <password>" http://<clock>/animation
+
+GIFs are scaled to the panel with nearest neighbour sampling: --fit letterboxes, --fill crops.
+Only the standard library is used.
+"""
+
+import argparse
+import math
+import os
+import random
+import struct
+import sys
+
+WIDTH = 128
+HEIGHT = 32
+MAGIC = b"FC"
+VERSION = 1
+DELTA = 0x01
+PALETTE = 0x02
+PALETTE_MAX = 256
+RUN_ZERO = 0x00
+RUN_REPEAT = 0x40
+RUN_LITERAL = 0x80
+RUN_MAX = 64
+LITERAL_MAX = 128
+ANIMATION_MAGIC = b"FCAN"
+ANIMATION_VERSION = 1
+ANIMATION_INDEX_KEY = 0x80000000
+ANIMATION_MIN_DELAY_MS = 20
+
+
+def rgb565(r, g, b):
+    return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
+
+
+def encode_runs(row, index):
+    """Runs for one row of values; index maps values to palette entries or is None."""
+    out = bytearray()
+    literal = []
+
+    def value(v):
+        return bytes((index[v],)) if index is not None else struct.pack("<H", v)
+
+    def flush():
+        while literal:
+            chunk = literal[:LITERAL_MAX]
+            del literal[:LITERAL_MAX]
+            out.append(RUN_LITERAL | (len(chunk) - 1))
+            for v in chunk:
+                out.extend(value(v))
+
+    i = 0
+    while i < len(row):
+        v = row[i]
+        j = i + 1
+        while j < len(row) and row[j] == v:
+            j += 1
+        run = j - i
+        # A short run inside a literal is cheaper kept in it than split out
+        if v == 0 and (run >= 2 or not literal):
+            flush()
+            for start in range(0, run, RUN_MAX):
+                out.append(RUN_ZERO | (min(RUN_MAX, run - start) - 1))
+        elif run >= 3 or (run == 2 and not literal):
+            flush()
+            for start in range(0, run, RUN_MAX):
+                out.append(RUN_REPEAT | (min(RUN_MAX, run - start) - 1))
+                out.extend(value(v))
+        else:
+            literal.extend(row[i:j])
+        i = j
+    flush()
+    return bytes(out)
+
+
+def encode_with(values, delta, palette, width, height):
+    flags = (DELTA if delta else 0) | (PALETTE if palette is not None else 0)
+    out = bytearray(MAGIC) + struct.pack("<BBHH", VERSION, flags, width, height)
+    mask = bytearray((height + 7) // 8)
+    rows = bytearray()
+    index = {c: i for i, c in enumerate(palette)} if palette is not None else None
+    for y in range(height):
+        row = values[y * width:(y + 1) * width]
+        if not any(row):
+            continue  # Unchanged in a delta, black in a key frame
+        mask[y >> 3] |= 1 << (y & 7)
+        runs = encode_runs(row, index)
+        rows += struct.pack("<H", len(runs)) + runs
+    out += mask
+    if palette is not None:
+        out.append(len(palette) & 0xFF)
+        for color in palette:
+            out += struct.pack("<H", color)
+    return bytes(out + rows)
+
+
+def encode_frame(pixels, previous=None, width=WIDTH, height=HEIGHT, palette="auto"):
+    """Encodes RGB565 pixels, as a delta against previous if given."""
+    delta = previous is not None
+    values = [p ^ q for p, q in zip(pixels, previous)] if delta else list(pixels)
+    candidates = []
+    if palette != "always":
+        candidates.append(encode_with(values, delta, None, width, height))
+    distinct = sorted(set(values))
+    if palette != "never" and len(distinct) <= PALETTE_MAX:
+        candidates.append(encode_with(values, delta, distinct, width, height))
+    return min(candidates, key=len)
+
+
+def decode_frame(data, frame, width=WIDTH, height=HEIGHT):
+    """Reference decoder: applies data to frame (a list) in place, like FrameCodec::decode."""
+    if data[:2] != MAGIC or data[2] != VERSION:
+        raise ValueError("not a frame")
+    flags = data[3]
+    if struct.unpack("<HH", data[4:8]) != (width, height):
+        raise ValueError("wrong size")
+    delta = bool(flags & DELTA)
+    pos = 8
+    mask = data[pos:pos + (height + 7) // 8]
+    pos += len(mask)
+    colors = None
+    if flags & PALETTE:
+        count = data[pos] or PALETTE_MAX
+        colors = struct.unpack("<%dH" % count, data[pos + 1:pos + 1 + count * 2])
+        pos += 1 + count * 2
+    size = 1 if colors else 2
+
+    def read(at):
+        return colors[data[at]] if colors else struct.unpack("<H", data[at:at + 2])[0]
+
+    for y in range(height):
+        start = y * width
+        if not mask[y >> 3] & (1 << (y & 7)):
+            if not delta:
+                frame[start:start + width] = [0] * width
+            continue
+        length, = struct.unpack("<H", data[pos:pos + 2])
+        pos += 2
+        end = pos + length
+        x = start
+        while pos < end:
+            control = data[pos]
+            pos += 1
+            if control >= RUN_LITERAL:
+                values = [read(pos + i * size) for i in range(control - RUN_LITERAL + 1)]
+                pos += len(values) * size
+            elif control >= RUN_REPEAT:
+                values = [read(pos)] * (control - RUN_REPEAT + 1)
+                pos += size
+            else:
+                values = [0] * (control + 1)
+            for v in values:
+                frame[x] = frame[x] ^ v if delta else v
+                x += 1
+        if x != start + width:
+            raise ValueError("row %d covers %d pixels" % (y, x - start))
+    if pos != len(data):
+        raise ValueError("%d bytes left over" % (len(data) - pos))
+
+
+def encode_clip(frames, key_interval):
+    """Encoded frames of a clip, with a key frame every key_interval frames."""
+    encoded = []
+    previous = None
+    for number, frame in enumerate(frames):
+        key = previous is None or (key_interval and number % key_interval == 0)
+        encoded.append(encode_frame(frame, None if key else previous))
+        previous = frame
+    return encoded
+
+
+# GIF input
+
+
+def lzw_decode(data, min_code, count):
+    clear = 1 << min_code
+    stop = clear + 1
+    size = min_code + 1
+    table = [bytes((i,)) for i in range(clear)] + [b"", b""]
+    out = bytearray()
+    previous = None
+    buffer = bits = pos = 0
+    while len(out) < count:
+        while bits < size and pos < len(data):
+            buffer |= data[pos] << bits
+            bits += 8
+            pos += 1
+        if bits < size:
+            break
+        code = buffer & ((1 << size) - 1)
+        buffer >>= size
+        bits -= size
+        if code == clear:
+            size = min_code + 1
+            del table[clear + 2:]
+            previous = None
+            continue
+        if code == stop:
+            break
+        if code < len(table):
+            entry = table[code]
+            if previous is not None:
+                table.append(previous + entry[:1])
+        elif previous is not None and code == len(table):
+            entry = previous + previous[:1]
+            table.append(entry)
+        else:
+            break  # Corrupt stream; keep what was decoded
+        out += entry
+        previous = entry
+        if len(table) == (1 << size) and size < 12:
+            size += 1
+    return bytes(out[:count]) + bytes(max(0, count - len(out)))
+
+
+def read_color_table(data, pos, flags):
+    count = 2 << (flags & 7)
+    table = [tuple(data[pos + i * 3:pos + i * 3 + 3]) for i in range(count)]
+    return table, pos + count * 3
+
+
+def read_gif(path):
+    """Returns (width, height, frames, delays_ms); frames are lists of (r, g, b)."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:6] not in (b"GIF87a", b"GIF89a"):
+        raise ValueError("%s: not a GIF file" % path)
+    width, height, flags = struct.unpack("<HHB", data[6:11])
+    pos = 13
+    global_table = None
+    if flags & 0x80:
+        global_table, pos = read_color_table(data, pos, flags)
+
+    canvas = [(0, 0, 0)] * (width * height)
+    frames, delays = [], []
+    transparent, delay, disposal = None, 100, 0
+    while pos < len(data):
+        block = data[pos]
+        pos += 1
+        if block == 0x3B:
+            break
+        if block == 0x21:
+            label = data[pos]
+            pos += 1
+            if label == 0xF9 and data[pos] >= 4:
+                control, centiseconds, index = struct.unpack("<BHB", data[pos + 1:pos + 5])
+                disposal = (control >> 2) & 7
+                transparent = index if control & 1 else None
+                delay = centiseconds * 10 or 100
+            while data[pos]:
+                pos += data[pos] + 1
+            pos += 1
+            continue
+        if block != 0x2C:
+            raise ValueError("%s: unexpected block 0x%02x" % (path, block))
+
+        left, top, w, h, flags = struct.unpack("<HHHHB", data[pos:pos + 9])
+        pos += 9
+        table = global_table
+        if flags & 0x80:
+            table, pos = read_color_table(data, pos, flags)
+        min_code = data[pos]
+        pos += 1
+        compressed = bytearray()
+        while data[pos]:
+            compressed += data[pos + 1:pos + 1 + data[pos]]
+            pos += data[pos] + 1
+        pos += 1
+        indices = lzw_decode(compressed, min_code, w * h)
+        if flags & 0x40:
+            rows = list(range(0, h, 8)) + list(range(4, h, 8)) + list(range(2, h, 4)) + \
+                list(range(1, h, 2))
+            ordered = bytearray(w * h)
+            for i, y in enumerate(rows):
+                ordered[y * w:(y + 1) * w] = indices[i * w:(i + 1) * w]
+            indices = bytes(ordered)
+
+        saved = list(canvas) if disposal == 3 else None
+        for y in range(h):
+            if top + y >= height:
+                break
+            for x in range(w):
+                index = indices[y * w + x]
+                if left + x < width and index != transparent and index < len(table):
+                    canvas[(top + y) * width + left + x] = table[index]
+        frames.append(list(canvas))
+        delays.append(delay)
+        if disposal == 2:
+            for y in range(top, min(height, top + h)):
+                for x in range(left, min(width, left + w)):
+                    canvas[y * width + x] = (0, 0, 0)
+        elif disposal == 3:
+            canvas = saved
+        transparent, delay, disposal = None, 100, 0
+    return width, height, frames, delays
+
+
+def scale(frame, width, height, fill=False):
+    """Nearest neighbour scale of an RGB frame to the panel, as RGB565."""
+    factor = (max if fill else min)(WIDTH / width, HEIGHT / height)
+    offset_x = (WIDTH - width * factor) / 2
+    offset_y = (HEIGHT - height * factor) / 2
+    out = []
+    for y in range(HEIGHT):
+        sy = int((y + 0.5 - offset_y) / factor)
+        for x in range(WIDTH):
+            sx = int((x + 0.5 - offset_x) / factor)
+            if 0 <= sx < width and 0 <= sy < height:
+                out.append(rgb565(*frame[sy * width + sx]))
+            else:
+                out.append(0)
+    return out
+
+
+def gif_clip(path, fill=False):
+    width, height, frames, delays = read_gif(path)
+    return [scale(frame, width, height, fill) for frame in frames], delays
+
+
+# Synthetic clips
+
+
+def hue(h):
+    h = h % 1.0 * 6
+    i = int(h)
+    f = h - i
+    rgb = [(1, f, 0), (1 - f, 1, 0), (0, 1, f), (0, 1 - f, 1), (f, 0, 1), (1, 0, 1 - f)][i]
+    return [int(c * 255) for c in rgb]
+
+
+def clip_scroll(frames):
+    """Rainbow gradient scrolling one pixel a frame: every pixel changes."""
+    columns = [rgb565(*hue(x / WIDTH)) for x in range(WIDTH)]
+    return [[columns[(x + n) % WIDTH] for y in range(HEIGHT) for x in range(WIDTH)]
+            for n in range(frames)]
+
+
+def clip_plasma(frames):
+    """Sine plasma: smooth, every pixel changes, many colors."""
+    out = []
+    for n in range(frames):
+        t = n / 10.0
+        frame = []
+        for y in range(HEIGHT):
+            for x in range(WIDTH):
+                v = math.sin(x / 9.0 + t) + math.sin(y / 5.0 - t) + math.sin((x + y) / 13.0 + t)
+                frame.append(rgb565(*hue(v / 6 + 0.5)))
+        out.append(frame)
+    return out
+
+
+def clip_marquee(frames, rng):
+    """Blocky text scrolling over black, like a message."""
+    glyphs = [[rng.random() < 0.45 for _ in range(35)] for _ in range(40)]
+    text = [rng.randrange(len(glyphs)) for _ in range(60)]
+    color = rgb565(255, 200, 40)
+    out = []
+    for n in range(frames):
+        frame = [0] * (WIDTH * HEIGHT)
+        for i, g in enumerate(text):
+            left = WIDTH - n + i * 12
+            for k, on in enumerate(glyphs[g]):
+                gx, gy = k % 5, k // 5
+                for dy in range(2):
+                    for dx in range(2):
+                        x, y = left + gx * 2 + dx, 9 + gy * 2 + dy
+                        if on and 0 <= x < WIDTH:
+                            frame[y * WIDTH + x] = color
+        out.append(frame)
+    return out
+
+
+def clip_particles(frames, rng):
+    """A few dozen colored dots drifting over black."""
+    dots = [[rng.uniform(0, WIDTH), rng.uniform(0, HEIGHT), rng.uniform(-1, 1),
+             rng.uniform(-0.5, 0.5), rgb565(*hue(rng.random()))] for _ in range(40)]
+    out = []
+    for _ in range(frames):
+        frame = [0] * (WIDTH * HEIGHT)
+        for dot in dots:
+            dot[0] = (dot[0] + dot[2]) % WIDTH
+            dot[1] = (dot[1] + dot[3]) % HEIGHT
+            frame[int(dot[1]) * WIDTH + int(dot[0])] = dot[4]
+        out.append(frame)
+    return out
+
+
+def clip_noise(frames, rng):
+    """Random pixels: the incompressible case."""
+    return [[rng.randrange(65536) for _ in range(WIDTH * HEIGHT)] for _ in range(frames)]
+
+
+def synthetic_clips(frames, seed):
+    rng = random.Random(seed)
+    return [("scroll", clip_scroll(frames)), ("plasma", clip_plasma(frames)),
+            ("marquee", clip_marquee(frames, rng)), ("particles", clip_particles(frames, rng)),
+            ("noise", clip_noise(frames, rng))]
+
+
+def command_bench(options):
+    clips = synthetic_clips(options.frames, options.seed)
+    for path in options.gifs:
+        frames, _ = gif_clip(path, options.fill)
+        clips.append((os.path.splitext(os.path.basename(path))[0], frames))
+    if options.dump:
+        os.makedirs(options.dump, exist_ok=True)
+
+    raw = WIDTH * HEIGHT * 2
+    print("%-14s %6s %9s %9s %9s %7s %8s" % ("clip", "frames", "avg B", "key B", "delta B",
+                                             "ratio", "palette"))
+    for name, frames in clips:
+        encoded = encode_clip(frames, options.key_interval)
+        decoded = [0] * (WIDTH * HEIGHT)
+        for frame, data in zip(frames, encoded):
+            decode_frame(data, decoded)
+            if decoded != frame:
+                raise SystemExit("%s: round trip failed" % name)
+
+        keys = [len(d) for d in encoded if not d[3] & DELTA]
+        deltas = [len(d) for d in encoded if d[3] & DELTA]
+        total = sum(len(d) for d in encoded)
+        palette = sum(1 for d in encoded if d[3] & PALETTE)
+        print("%-14s %6d %9.0f %9.0f %9s %6.1fx %7.0f%%" % (
+            name[:14], len(frames), total / len(frames), sum(keys) / len(keys),
+            "%.0f" % (sum(deltas) / len(deltas)) if deltas else "-",
+            raw * len(frames) / total, 100.0 * palette / len(frames)))
+
+        if options.dump:
+            base = os.path.join(options.dump, name)
+            with open(base + ".raw", "wb") as f:
+                for frame in frames:
+                    f.write(struct.pack("<%dH" % len(frame), *frame))
+            with open(base + ".fcs", "wb") as f:
+                for data in encoded:
+                    f.write(struct.pack("<I", len(data)) + data)
+    return 0
+
+
+def animation_file(frames, delays, key_interval):
+    """The bytes of an animation file: header, index, then (length, delay, frame) chunks."""
+    encoded = encode_clip(frames, key_interval)
+    header = ANIMATION_MAGIC + struct.pack("<BBHHHI", ANIMATION_VERSION, 0, WIDTH, HEIGHT,
+                                           len(encoded), 0)
+    offset = len(header) + 4 * len(encoded)
+    index, chunks = bytearray(), bytearray()
+    for data, delay in zip(encoded, delays):
+        key = 0 if data[3] & DELTA else ANIMATION_INDEX_KEY
+        index += struct.pack("<I", offset | key)
+        chunk = struct.pack("<HH", len(data), max(ANIMATION_MIN_DELAY_MS, min(delay, 0xFFFF)))
+        chunks += chunk + data
+        offset += len(chunk) + len(data)
+    return header + bytes(index) + bytes(chunks)
+
+
+def command_convert(options):
+    frames, delays = gif_clip(options.gif, options.fill)
+    if len(frames) > 0xFFFF:
+        raise SystemExit("%s: too many frames" % options.gif)
+    data = animation_file(frames, delays, options.key_interval)
+    with open(options.output, "wb") as f:
+        f.write(data)
+    seconds = sum(max(ANIMATION_MIN_DELAY_MS, d) for d in delays) / 1000.0
+    print("%s: %d frames, %.1f s, %d bytes (%.0f per frame, %.1f KB/s at its own speed)" % (
+        options.output, len(frames), seconds, len(data), len(data) / len(frames),
+        len(data) / seconds / 1024))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    bench = commands.add_parser("bench", help="compression ratio of synthetic and GIF clips")
+    bench.add_argument("gifs", nargs="*", help="GIF animations to add")
+    bench.add_argument("--frames", type=int, default=120, help="frames per synthetic clip")
+    bench.add_argument("--key-interval", type=int, default=30)
+    bench.add_argument("--seed", type=int, default=1)
+    bench.add_argument("--dump", help="directory to write raw and encoded clips to")
+    fit = bench.add_mutually_exclusive_group()
+    fit.add_argument("--fit", dest="fill", action="store_false", help="letterbox (default)")
+    fit.add_argument("--fill", dest="fill", action="store_true", help="crop to fill the panel")
+
+    convert = commands.add_parser("convert", help="GIF to a clock animation file")
+    convert.add_argument("gif")
+    convert.add_argument("output")
+    convert.add_argument("--key-interval", type=int, default=30)
+    fit = convert.add_mutually_exclusive_group()
+    fit.add_argument("--fit", dest="fill", action="store_false", help="letterbox (default)")
+    fit.add_argument("--fill", dest="fill", action="store_true", help="crop to fill the panel")
+
+    options = parser.parse_args()
+    if options.command == "convert":
+        return command_convert(options)
+    return command_bench(options)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
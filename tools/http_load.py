@@ -0,0 +1,117 @@
+"""
+Load generator for the clock's HTTP API.
+
+    python tools/http_load.py <device-ip> --clients 50 --duration 30 --password secret
+
+Each client keeps sending requests back to back, alternating GET /status with a POST /messages
+(an upsert under a per-client id, so the queue does not fill up). At the end the script prints
+requests per second, latency percentiles and status codes. It also prints the largest gap
+between two passes of the clock's render loop, as reported by loop_gap_max_ms in /status. Run it
+once with --clients 1 for a baseline.
+
+Only the standard library is used. Requests are HTTP/1.0, one connection each, like curl.
+"""
+
+import argparse
+import asyncio
+import json
+import sys
+import time
+
+
+async def request(host, port, method, path, password, body=None, timeout=10.0):
+    reader, writer = await asyncio.wait_for(asyncio.open_connection(host, port), timeout)
+    try:
+        payload = body.encode("utf-8") if body is not None else b""
+        head = "%s %s HTTP/1.0\r\nHost: %s\r\n" % (method, path, host)
+        if password:
+            head += "Authorization: Bearer %s\r\n" % password
+        if body is not None:
+            head += "Content-Type: application/json\r\n"
+            head += "Content-Length: %d\r\n" % len(payload)
+        writer.write((head + "\r\n").encode("ascii") + payload)
+        await writer.drain()
+        response = await asyncio.wait_for(reader.read(), timeout)
+    finally:
+        writer.close()
+    status_line = response.split(b"\r\n", 1)[0].split()
+    status = int(status_line[1]) if len(status_line) > 1 else 0
+    return status, response.split(b"\r\n\r\n", 1)[-1]
+
+
+async def client(index, options, deadline, latencies, statuses):
+    n = 0
+    while time.monotonic() < deadline:
+        if n % 2 == 0:
+            method, path, body = "GET", "/status", None
+        else:
+            method, path = "POST", "/messages"
+            body = json.dumps({"id": "load-%d" % index, "text": "Load %d/%d" % (index, n)})
+        n += 1
+
+        start = time.monotonic()
+        try:
+            status, _ = await request(options.host, options.port, method, path,
+                                      options.password, body)
+        except (OSError, asyncio.TimeoutError):
+            status = 0
+        latencies.append(time.monotonic() - start)
+        statuses[status] = statuses.get(status, 0) + 1
+
+
+async def loop_gap(options):
+    # Reading /status also resets the device's counter
+    try:
+        status, body = await request(options.host, options.port, "GET", "/status",
+                                     options.password)
+        if status == 200:
+            return json.loads(body.decode("utf-8")).get("loop_gap_max_ms")
+    except (OSError, asyncio.TimeoutError, ValueError):
+        pass
+    return None
+
+
+def percentile(values, fraction):
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+async def run(options):
+    await loop_gap(options)  # Start the gap measurement from now
+
+    latencies = []
+    statuses = {}
+    start = time.monotonic()
+    deadline = start + options.duration
+    await asyncio.gather(*(client(i, options, deadline, latencies, statuses)
+                           for i in range(options.clients)))
+    elapsed = time.monotonic() - start
+    gap = await loop_gap(options)
+
+    print("clients:        %d" % options.clients)
+    print("requests:       %d in %.1f s" % (len(latencies), elapsed))
+    print("requests/sec:   %.1f" % (len(latencies) / elapsed))
+    print("latency p50:    %.1f ms" % (percentile(latencies, 0.50) * 1000))
+    print("latency p99:    %.1f ms" % (percentile(latencies, 0.99) * 1000))
+    print("latency max:    %.1f ms" % (max(latencies) * 1000 if latencies else 0))
+    print("status codes:   %s" % ", ".join("%s=%d" % (code or "error", count)
+                                           for code, count in sorted(statuses.items())))
+    print("loop gap max:   %s ms" % ("?" if gap is None else gap))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("host", help="IP address of the clock")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--clients", type=int, default=50, help="concurrent connections")
+    parser.add_argument("--duration", type=float, default=30, help="seconds to run")
+    parser.add_argument("--password", default="", help="MESSAGE_API_PASSWORD of the clock")
+    options = parser.parse_args()
+    return asyncio.run(run(options))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,99 @@
+"""
+Stand-in message feed for trying out the clock's poller (POST /poll) without a real backend.
+
+    python tools/message_feed_server.py feed.json --port 3000
+
+feed.json holds a JSON array of message objects, e.g.
+[{"id": "1", "text": "Hello"}, {"id": "2", "text": "Standup!", "at": "09:55"}]. It is re-read on
+every request, so edits show up on the next poll. The server behaves like the feeds the clock
+expects:
+
+    - ETag is a hash of the feed; a matching If-None-Match gets 304 Not Modified
+    - ?since=<id> returns only the messages after that id (all of them if the id is unknown)
+
+--delay and --fail-rate simulate slow and flaky servers; stop the server entirely to check that
+the display keeps running while the poller backs off.
+"""
+
+import argparse
+import hashlib
+import json
+import random
+import sys
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+
+def load_feed(path):
+    with open(path, "r", encoding="utf-8") as f:
+        messages = json.load(f)
+    if not isinstance(messages, list):
+        raise ValueError("%s: expected a JSON array of messages" % path)
+    return messages
+
+
+def messages_after(messages, since):
+    for index, message in enumerate(messages):
+        if str(message.get("id", "")) == since:
+            return messages[index + 1:]
+    return messages
+
+
+class FeedHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.0"
+
+    def do_GET(self):
+        options = self.server.options
+        if options.delay:
+            time.sleep(options.delay)
+        if random.random() < options.fail_rate:
+            self.send_error(503, "Simulated failure")
+            return
+
+        url = urlparse(self.path)
+        if url.path != options.path:
+            self.send_error(404)
+            return
+
+        since = parse_qs(url.query).get("since", [""])[0]
+        body = json.dumps(messages_after(load_feed(options.feed), since)).encode("utf-8")
+        etag = '"%s"' % hashlib.sha1(body).hexdigest()[:16]
+
+        if self.headers.get("If-None-Match") == etag:
+            self.send_response(304)
+            self.send_header("ETag", etag)
+            self.end_headers()
+            return
+
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.send_header("ETag", etag)
+        self.end_headers()
+        self.wfile.write(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("feed", help="JSON file holding an array of messages")
+    parser.add_argument("--port", type=int, default=3000)
+    parser.add_argument("--path", default="/messages", help="path the feed is served on")
+    parser.add_argument("--delay", type=float, default=0, help="seconds to wait before answering")
+    parser.add_argument("--fail-rate", type=float, default=0,
+                        help="fraction of requests answered with 503")
+    options = parser.parse_args()
+
+    load_feed(options.feed)  # Fail early on a broken file
+    server = ThreadingHTTPServer(("", options.port), FeedHandler)
+    server.options = options
+    print("Serving %s on port %d%s" % (options.feed, options.port, options.path))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
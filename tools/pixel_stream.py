@@ -0,0 +1,195 @@
+"""
+Test sender for the clock's network video sink (see lib/PixelStream/PixelStream.h).
+
+    python tools/pixel_stream.py send <device-ip>                       # DDP at 60 fps
+    python tools/pixel_stream.py send <device-ip> --protocol sacn --fps 40 --seconds 30
+    python tools/pixel_stream.py send <device-ip> --codec --key-interval 30
+
+send streams a moving test pattern at --fps, paced against the monotonic clock so a slow
+frame does not push the later ones back, and prints the rate it actually reached. DDP frames
+go out as 480-pixel packets with the push flag on the last one; sACN frames as 25 unicast
+universes of 170 pixels from --universe on, optionally followed by a sync packet. --loss drops
+that share of packets at random, to see the clock's lost packet and incomplete frame counters
+move in /status.
+
+--codec (DDP only) sends the frames compressed with tools/frame_codec.py instead, as the
+customer-defined DDP data type, with a key frame every --key-interval frames. A frame that
+loses a packet is skipped on the clock, and so is every delta after it up to the next key
+frame; /status counts them as skipped.
+
+The pattern carries the frame number in the blue channel of every pixel, so a receiver can
+tell a torn frame (pixels from two frames) from a whole one even after RGB565: red is
+x * 2 + frame, green is y * 8 and blue is frame * 8, all modulo 256.
+
+Only the standard library is used.
+"""
+
+import argparse
+import functools
+import random
+import socket
+import struct
+import sys
+import time
+import uuid
+
+import frame_codec
+
+WIDTH = 128
+HEIGHT = 32
+DDP_PORT = 4048
+DDP_PIXELS_PER_PACKET = 480  # 1440 bytes, fits an Ethernet frame
+DDP_HEADER = struct.Struct(">BBBBIH")  # flags, sequence, data type, id, offset, length
+DDP_VERSION_1 = 0x40
+DDP_PUSH = 0x01
+DDP_TYPE_RGB8 = 0x0B
+DDP_TYPE_CODEC = 0x80  # Customer defined: a lib/FrameCodec frame
+DDP_ID_DISPLAY = 1
+E131_PORT = 5568
+E131_PIXELS = 170
+E131_ID = b"ASC-E1.17\x00\x00\x00"
+
+
+@functools.lru_cache(maxsize=256)
+def pattern(frame):
+    """One frame of RGB bytes, rows top to bottom; it repeats every 256 frames."""
+    blue = (frame * 8) & 0xFF
+    rows = []
+    for y in range(HEIGHT):
+        green = (y * 8) & 0xFF
+        rows.append(bytes(b for x in range(WIDTH) for b in ((x * 2 + frame) & 0xFF, green, blue)))
+    return b"".join(rows)
+
+
+def encoded_pattern(key_interval):
+    """The 256 pattern frames compressed; frame 0 is a key frame, so the loop wraps cleanly."""
+    frames = []
+    for frame in range(256):
+        rgb = pattern(frame)
+        frames.append([frame_codec.rgb565(*rgb[i:i + 3]) for i in range(0, len(rgb), 3)])
+    return frame_codec.encode_clip(frames, key_interval)
+
+
+class DdpSender:
+    def __init__(self, data_type=DDP_TYPE_RGB8):
+        self.sequence = 0
+        self.data_type = data_type
+
+    def packets(self, pixels):
+        step = DDP_PIXELS_PER_PACKET * 3
+        for offset in range(0, len(pixels), step):
+            chunk = pixels[offset:offset + step]
+            self.sequence = self.sequence % 15 + 1
+            flags = DDP_VERSION_1 | (DDP_PUSH if offset + step >= len(pixels) else 0)
+            yield DDP_HEADER.pack(flags, self.sequence, self.data_type, DDP_ID_DISPLAY, offset,
+                                  len(chunk)) + chunk
+
+
+class SacnSender:
+    def __init__(self, universe, sync_universe):
+        self.universe = universe
+        self.sync_universe = sync_universe
+        self.cid = uuid.uuid4().bytes
+        self.sequences = {}
+        self.sync_sequence = 0
+
+    def next_sequence(self, universe):
+        self.sequences[universe] = (self.sequences.get(universe, -1) + 1) & 0xFF
+        return self.sequences[universe]
+
+    def data_packet(self, universe, channels):
+        count = len(channels) + 1  # Start code is a property too
+        dmp = struct.pack(">HBBHHH", 0x7000 | (10 + count), 0x02, 0xA1, 0, 1, count)
+        dmp += b"\x00" + channels
+        framing = struct.pack(">HI", 0x7000 | (77 + len(dmp)), 0x02)
+        framing += b"pixel_stream.py".ljust(64, b"\x00")
+        framing += struct.pack(">BHBBH", 100, self.sync_universe, self.next_sequence(universe), 0,
+                               universe)
+        root = struct.pack(">HH", 0x0010, 0) + E131_ID
+        root += struct.pack(">HI", 0x7000 | (22 + len(framing) + len(dmp)), 0x04) + self.cid
+        return root + framing + dmp
+
+    def sync_packet(self):
+        self.sync_sequence = (self.sync_sequence + 1) & 0xFF
+        framing = struct.pack(">HIBHH", 0x7000 | 11, 0x01, self.sync_sequence,
+                              self.sync_universe, 0)
+        root = struct.pack(">HH", 0x0010, 0) + E131_ID
+        root += struct.pack(">HI", 0x7000 | (22 + len(framing)), 0x08) + self.cid
+        return root + framing
+
+    def packets(self, pixels):
+        step = E131_PIXELS * 3
+        for index, offset in enumerate(range(0, len(pixels), step)):
+            yield self.data_packet(self.universe + index, pixels[offset:offset + step])
+        if self.sync_universe:
+            yield self.sync_packet()
+
+
+def command_send(options):
+    frame_data = pattern
+    if options.codec:
+        if options.protocol != "ddp":
+            print("--codec needs --protocol ddp", file=sys.stderr)
+            return 1
+        encoded = encoded_pattern(options.key_interval)
+        frame_data = encoded.__getitem__
+        sender, port = DdpSender(DDP_TYPE_CODEC), DDP_PORT
+    elif options.protocol == "ddp":
+        sender, port = DdpSender(), DDP_PORT
+    else:
+        sender, port = SacnSender(options.universe, options.sync), E131_PORT
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    rng = random.Random(options.seed)
+
+    frames = int(options.seconds * options.fps)
+    interval = 1.0 / options.fps
+    packets = lost = late = size = 0
+    start = time.monotonic()
+    for frame in range(frames):
+        deadline = start + frame * interval
+        wait = deadline - time.monotonic()
+        if wait > 0:
+            time.sleep(wait)
+        elif wait < -interval:
+            late += 1
+        data = frame_data(frame & 0xFF)
+        size += len(data)
+        for packet in sender.packets(data):
+            packets += 1
+            if rng.random() < options.loss:
+                lost += 1
+                continue
+            sock.sendto(packet, (options.host, port))
+    elapsed = time.monotonic() - start
+
+    print("%s: %d frames in %.2f s = %.1f fps, %d packets (%d dropped on purpose), "
+          "%d frames sent more than a frame late" % (options.protocol, frames, elapsed,
+                                                     frames / elapsed, packets, lost, late))
+    if options.codec:
+        print("codec: %.0f bytes per frame, %.1fx smaller than RGB888" %
+              (size / frames, frames * WIDTH * HEIGHT * 3 / size))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    send = commands.add_parser("send", help="stream the test pattern to a clock")
+    send.add_argument("host")
+    send.add_argument("--protocol", choices=("ddp", "sacn"), default="ddp")
+    send.add_argument("--fps", type=float, default=60)
+    send.add_argument("--seconds", type=float, default=10)
+    send.add_argument("--universe", type=int, default=1, help="first sACN universe")
+    send.add_argument("--sync", type=int, default=0, help="sACN sync universe, 0 for none")
+    send.add_argument("--loss", type=float, default=0, help="share of packets to drop")
+    send.add_argument("--seed", type=int, default=None, help="repeat the same losses")
+    send.add_argument("--codec", action="store_true", help="send compressed frames (DDP)")
+    send.add_argument("--key-interval", type=int, default=30, help="frames per key frame")
+
+    options = parser.parse_args()
+    return command_send(options)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,378 @@
+"""
+Sender for the clock's binary UDP message protocol (see lib/MessageDatagram/MessageDatagram.h).
+
+    python tools/udp_message.py send <device-ip> "Build failed" --key secret --priority urgent
+    python tools/udp_message.py bench <device-ip> --key secret --count 200
+
+send pushes one message and waits for the clock's ack. bench sends --count messages one after
+another, all under one id so the queue does not fill up, and prints round-trip percentiles.
+
+broadcast sends one message to every clock that joined the fleet multicast group
+(MESSAGE_FLEET_GROUP) and collects their signed acks. Clocks that have not answered after a
+round get a retransmission with the same id, which clocks that already have it only re-ack.
+
+    python tools/udp_message.py broadcast 239.255.42.10 "Fire drill at 3" --key secret --expect 12
+
+serve is a reference receiver: it checks datagrams exactly as the clock does (format, HMAC
+tag, sequence window, fleet dedupe) and acks them. Use it to try an integration without a
+clock. A loopback benchmark of the protocol itself is
+
+    python tools/udp_message.py serve --key secret &
+    python tools/udp_message.py bench 127.0.0.1 --key secret
+
+and a simulated fleet of three clocks on loopback is
+
+    for n in 1 2 3; do python tools/udp_message.py serve --key secret --group 239.255.42.10 \
+        --device-id $n & done
+    python tools/udp_message.py broadcast 239.255.42.10 "Hello fleet" --key secret --expect 3 \
+        --interface 127.0.0.1
+
+The key is MESSAGE_UDP_KEY from credentials/message_config.h, which defaults to the API
+password. Only the standard library is used.
+"""
+
+import argparse
+import hashlib
+import hmac
+import os
+import socket
+import struct
+import sys
+import time
+
+PORT = 4210
+FLEET_PORT = 4211
+VERSION = 1
+HEADER = struct.Struct("<2sBBIQBH")  # magic, version, priority, sender, sequence, id/text len
+TAG_SIZE = 16
+ACK = struct.Struct("<2sQB")
+FLEET_ACK = struct.Struct("<2sQBI")  # followed by a 16-byte tag
+DUPLICATE = 0x80
+DEDUPE_S = 120
+ID_MAX = 31
+TEXT_MAX = 255
+PRIORITIES = {"low": 0, "normal": 1, "high": 2, "urgent": 3}
+ACK_STATUS = {0: "queued", 1: "updated", 2: "queue full"}
+MAX_SKEW_S = 300
+
+
+class Sequencer:
+    """Sequences are microseconds of wall clock, bumped if two datagrams share a tick."""
+
+    def __init__(self):
+        self.last = 0
+
+    def next(self):
+        self.last = max(self.last + 1, time.time_ns() // 1000)
+        return self.last
+
+
+def encode(key, sender, sequence, priority, message_id, text):
+    id_bytes = message_id.encode("utf-8")
+    text_bytes = text.encode("utf-8")
+    if len(id_bytes) > ID_MAX:
+        raise ValueError("id is longer than %d bytes" % ID_MAX)
+    if not 0 < len(text_bytes) <= TEXT_MAX:
+        raise ValueError("text must be 1 to %d bytes" % TEXT_MAX)
+    body = HEADER.pack(b"MQ", VERSION, priority, sender, sequence, len(id_bytes),
+                       len(text_bytes)) + id_bytes + text_bytes
+    return body + hmac.new(key, body, hashlib.sha256).digest()[:TAG_SIZE]
+
+
+def decode_ack(data):
+    if len(data) != ACK.size:
+        return None
+    magic, sequence, status = ACK.unpack(data)
+    return (sequence, status) if magic == b"MA" else None
+
+
+def encode_fleet_ack(key, sequence, status, device_id):
+    body = FLEET_ACK.pack(b"MF", sequence, status, device_id)
+    return body + hmac.new(key, body, hashlib.sha256).digest()[:TAG_SIZE]
+
+
+def decode_fleet_ack(key, data):
+    if len(data) != FLEET_ACK.size + TAG_SIZE:
+        return None
+    body, tag = data[:FLEET_ACK.size], data[FLEET_ACK.size:]
+    if not hmac.compare_digest(hmac.new(key, body, hashlib.sha256).digest()[:TAG_SIZE], tag):
+        return None
+    magic, sequence, status, device_id = FLEET_ACK.unpack(body)
+    return (sequence, status, device_id) if magic == b"MF" else None
+
+
+def exchange(sock, address, datagram, sequence, timeout):
+    """Sends one datagram and returns (status, seconds) for its ack, or None on timeout."""
+    start = time.perf_counter()
+    sock.sendto(datagram, address)
+    deadline = start + timeout
+    while True:
+        remaining = deadline - time.perf_counter()
+        if remaining <= 0:
+            return None
+        sock.settimeout(remaining)
+        try:
+            data, _ = sock.recvfrom(64)
+        except socket.timeout:
+            return None
+        ack = decode_ack(data)
+        if ack and ack[0] == sequence:  # Late acks of earlier datagrams are skipped
+            return ack[1], time.perf_counter() - start
+
+
+def default_sender():
+    # Stable per host and user, so the clock keeps one replay window for this sender
+    name = "%s:%s" % (socket.gethostname(), os.getuid() if hasattr(os, "getuid") else 0)
+    return struct.unpack("<I", hashlib.sha256(name.encode("utf-8")).digest()[:4])[0]
+
+
+def command_send(options):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sequence = Sequencer().next()
+    datagram = encode(options.key.encode("utf-8"), options.sender, sequence,
+                      PRIORITIES[options.priority], options.id, options.text)
+    result = exchange(sock, (options.host, options.port), datagram, sequence, options.timeout)
+    if result is None:
+        print("no ack (wrong key, stale clock, or the clock is unreachable)")
+        return 1
+    status, seconds = result
+    print("%s in %.1f ms" % (ACK_STATUS.get(status, "status %d" % status), seconds * 1000))
+    return 0 if status != 2 else 1
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def command_bench(options):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    key = options.key.encode("utf-8")
+    sequencer = Sequencer()
+    rtts = []
+    lost = 0
+    for n in range(options.count):
+        sequence = sequencer.next()
+        datagram = encode(key, options.sender, sequence, PRIORITIES[options.priority],
+                          "udp-bench", "Bench %d" % n)
+        result = exchange(sock, (options.host, options.port), datagram, sequence,
+                          options.timeout)
+        if result is None:
+            lost += 1
+        else:
+            rtts.append(result[1])
+        if options.interval:
+            time.sleep(options.interval)
+
+    print("sent:        %d" % options.count)
+    print("acked:       %d (%d lost)" % (len(rtts), lost))
+    if rtts:
+        print("rtt p50:     %.3f ms" % (percentile(rtts, 0.50) * 1000))
+        print("rtt p99:     %.3f ms" % (percentile(rtts, 0.99) * 1000))
+        print("rtt max:     %.3f ms" % (max(rtts) * 1000))
+    return 0 if rtts else 1
+
+
+def describe(status):
+    text = ACK_STATUS.get(status & ~DUPLICATE, "status %d" % status)
+    return text + (" (retransmission)" if status & DUPLICATE else "")
+
+
+def command_broadcast(options):
+    key = options.key.encode("utf-8")
+    message_id = options.id or "fleet-%08x" % struct.unpack("<I", os.urandom(4))[0]
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, options.ttl)
+    if options.interface:
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF,
+                        socket.inet_aton(options.interface))
+
+    sequencer = Sequencer()
+    sent_at = {}  # sequence -> (round, send time)
+    acks = {}  # device id -> (status, round, rtt)
+    start = time.perf_counter()
+    for round_number in range(1, options.rounds + 1):
+        sequence = sequencer.next()
+        datagram = encode(key, options.sender, sequence, PRIORITIES[options.priority],
+                          message_id, options.text)
+        sent_at[sequence] = (round_number, time.perf_counter())
+        sock.sendto(datagram, (options.group, options.port))
+
+        # Acks of earlier rounds still count; a clock is reported with its first ack
+        deadline = time.perf_counter() + options.wait
+        while options.expect == 0 or len(acks) < options.expect:
+            remaining = deadline - time.perf_counter()
+            if remaining <= 0:
+                break
+            sock.settimeout(remaining)
+            try:
+                data, _ = sock.recvfrom(64)
+            except socket.timeout:
+                break
+            ack = decode_fleet_ack(key, data)
+            if not ack or ack[0] not in sent_at or ack[2] in acks:
+                continue
+            sent_round, sent_time = sent_at[ack[0]]
+            acks[ack[2]] = (ack[1], sent_round, time.perf_counter() - sent_time)
+        if options.expect and len(acks) >= options.expect:
+            break
+
+    print("message id %s, %d round(s), %.1f ms" % (message_id, len(sent_at),
+                                                  (time.perf_counter() - start) * 1000))
+    for device_id, (status, round_number, rtt) in sorted(acks.items()):
+        print("  %08x  %-30s round %d  %.1f ms" % (device_id, describe(status), round_number,
+                                                  rtt * 1000))
+    delivered = sum(1 for status, _, _ in acks.values() if status & ~DUPLICATE != 2)
+    missing = max(0, options.expect - len(acks))
+    print("acked by %d clock(s), delivered to %d%s" % (
+        len(acks), delivered, ", %d missing" % missing if options.expect else ""))
+    return 0 if missing == 0 and delivered == len(acks) else 1
+
+
+class ReferenceReceiver:
+    """Same checks as MessageDatagramReceiver, for testing senders without a clock."""
+
+    WINDOW = 64
+
+    def __init__(self, key):
+        self.key = key
+        self.windows = {}  # sender -> (highest, seen bitmap)
+        self.delivered = {}  # (sender, id) -> (status, time), fleet dedupe
+
+    def receive(self, data):
+        if len(data) < HEADER.size + TAG_SIZE:
+            return "malformed", None
+        magic, version, priority, sender, sequence, id_len, text_len = HEADER.unpack_from(data)
+        if (magic != b"MQ" or version != VERSION or priority >= len(PRIORITIES) or
+                id_len > ID_MAX or not 0 < text_len <= TEXT_MAX or
+                len(data) != HEADER.size + id_len + text_len + TAG_SIZE):
+            return "malformed", None
+        tag = hmac.new(self.key, data[:-TAG_SIZE], hashlib.sha256).digest()[:TAG_SIZE]
+        if not self.key or not hmac.compare_digest(tag, data[-TAG_SIZE:]):
+            return "bad tag", None
+
+        if sender not in self.windows:
+            if abs(sequence // 1000000 - int(time.time())) > MAX_SKEW_S:
+                return "stale", None
+            self.windows[sender] = (sequence, 0)
+        else:
+            highest, seen = self.windows[sender]
+            if sequence > highest:
+                shift = sequence - highest
+                seen = 0 if shift > self.WINDOW else ((seen << shift) | (1 << (shift - 1)))
+                self.windows[sender] = (sequence, seen & ((1 << self.WINDOW) - 1))
+            else:
+                behind = highest - sequence
+                if behind == 0 or behind > self.WINDOW or seen & (1 << (behind - 1)):
+                    return "replayed", None
+                self.windows[sender] = (highest, seen | (1 << (behind - 1)))
+
+        text = data[HEADER.size + id_len:HEADER.size + id_len + text_len].decode("utf-8", "replace")
+        return "ok", (sender, sequence, priority, data[HEADER.size:HEADER.size + id_len], text)
+
+
+def command_serve(options):
+    key = options.key.encode("utf-8")
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    if options.group:
+        # Several simulated clocks can share the group port on one host
+        port = options.port if options.port != PORT else FLEET_PORT
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        if hasattr(socket, "SO_REUSEPORT"):
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+        sock.bind((options.group, port))
+        membership = socket.inet_aton(options.group) + socket.inet_aton(options.bind)
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+        print("Device %08x listening on %s:%d" % (options.device_id, options.group, port))
+    else:
+        sock.bind((options.bind, options.port))
+        print("Listening on %s:%d" % (options.bind, options.port))
+
+    receiver = ReferenceReceiver(key)
+    held = set()
+    try:
+        while True:
+            data, address = sock.recvfrom(2048)
+            result, message = receiver.receive(data)
+            if result != "ok":
+                if options.verbose:
+                    print("%s: rejected (%s)" % (address[0], result))
+                continue
+            sender, sequence, priority, message_id, text = message
+
+            recent = receiver.delivered.get((sender, message_id))
+            if options.group and message_id and recent and time.time() - recent[1] < DEDUPE_S:
+                status = recent[0] | DUPLICATE
+            else:
+                status = 1 if message_id and message_id in held else 0
+                if message_id:
+                    held.add(message_id)
+                    receiver.delivered[(sender, message_id)] = (status, time.time())
+
+            if options.group:
+                sock.sendto(encode_fleet_ack(key, sequence, status, options.device_id), address)
+            else:
+                sock.sendto(ACK.pack(b"MA", sequence, status), address)
+            if options.verbose:
+                print("%s: %s %r" % (address[0], describe(status), text))
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    def add_common(sub, needs_host=True):
+        if needs_host:
+            sub.add_argument("host", help="IP address of the clock")
+        sub.add_argument("--port", type=int, default=PORT)
+        sub.add_argument("--key", required=True, help="MESSAGE_UDP_KEY of the clock")
+
+    send = commands.add_parser("send", help="push one message")
+    add_common(send)
+    send.add_argument("text")
+    send.add_argument("--id", default="", help="upsert under this id")
+    send.add_argument("--priority", choices=sorted(PRIORITIES), default="normal")
+
+    bench = commands.add_parser("bench", help="measure push round trips")
+    add_common(bench)
+    bench.add_argument("--count", type=int, default=200)
+    bench.add_argument("--interval", type=float, default=0, help="seconds between pushes")
+    bench.add_argument("--priority", choices=sorted(PRIORITIES), default="low")
+
+    broadcast = commands.add_parser("broadcast", help="push one message to a fleet")
+    broadcast.add_argument("group", help="multicast group (MESSAGE_FLEET_GROUP)")
+    broadcast.add_argument("text")
+    broadcast.add_argument("--port", type=int, default=FLEET_PORT)
+    broadcast.add_argument("--key", required=True, help="MESSAGE_UDP_KEY of the clocks")
+    broadcast.add_argument("--id", default="", help="message id (default: a random one)")
+    broadcast.add_argument("--priority", choices=sorted(PRIORITIES), default="normal")
+    broadcast.add_argument("--expect", type=int, default=0,
+                           help="number of clocks; stops as soon as all have acked")
+    broadcast.add_argument("--rounds", type=int, default=3, help="transmissions at most")
+    broadcast.add_argument("--wait", type=float, default=0.5, help="seconds to collect acks")
+    broadcast.add_argument("--ttl", type=int, default=1, help="multicast hops")
+    broadcast.add_argument("--interface", default="", help="local address to send from")
+
+    serve = commands.add_parser("serve", help="run the reference receiver")
+    add_common(serve, needs_host=False)
+    serve.add_argument("--bind", default="127.0.0.1", help="address (and multicast interface)")
+    serve.add_argument("--group", default="", help="join this fleet group instead")
+    serve.add_argument("--device-id", type=int, default=1, help="id reported in fleet acks")
+    serve.add_argument("--verbose", action="store_true")
+
+    for sub in (send, bench, broadcast):
+        sub.add_argument("--sender", type=int, default=default_sender(),
+                         help="32-bit sender id (default: derived from host and user)")
+        sub.add_argument("--timeout", type=float, default=1.0, help="seconds to wait for an ack")
+
+    options = parser.parse_args()
+    handlers = {"send": command_send, "bench": command_bench, "broadcast": command_broadcast,
+                "serve": command_serve}
+    return handlers[options.command](options)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,286 @@
+"""
+Video wall sync tools (see lib/VideoWall/VideoWall.h).
+
+    python tools/wall_sync.py watch                     # Print the beacons of a wall on the LAN
+    python tools/wall_sync.py simulate --tiles 4        # Loopback simulation of a whole wall
+
+simulate starts one Linux process per tile. Tile 0 sends beacons to the sync group on
+loopback like a leader clock; the other tiles estimate the leader's time base from them the
+way the firmware does (largest offset over the last WALL_SYNC_WINDOW beacons). Every tile
+gets its own boot time and a crystal error of up to --drift-ppm, and reads beacons only at
+the end of a simulated loop pass of up to --loop-ms, so beacons reach it late by a varying
+amount. A message starts on the leader partway through the run and reaches each follower
+--spread-ms later or less, as it would from a fleet broadcast.
+
+Each tile samples its wall frame and marquee position every few milliseconds against the
+host's monotonic clock, which all processes share. The report compares every follower with
+the leader at the same instants, separately for the first beacons after a follower synced
+and for the time after it had a full window. The exit status is 1 if a follower with a full
+window was a frame or more off the leader.
+
+Only the standard library is used.
+"""
+
+import argparse
+import json
+import random
+import socket
+import struct
+import subprocess
+import sys
+import time
+
+GROUP = "239.255.42.11"
+PORT = 4212
+BEACON = struct.Struct("<2sBBIIIII")
+VERSION = 1
+FRAME_US = 1000000 // 30
+BEACON_S = 0.25
+WINDOW = 8
+RESYNC_US = 1000000
+TILE_WIDTH = 128
+MESSAGE_HASH = 0x5EED0001
+SAMPLE_S = 0.005
+
+
+def host_us():
+    return time.monotonic_ns() // 1000
+
+
+class TileClock:
+    """Local clock of a simulated tile: its own boot time and crystal error."""
+
+    def __init__(self, boot_us, drift_ppm):
+        self.boot_us = boot_us
+        self.drift_ppm = drift_ppm
+
+    def local_us(self, host):
+        return int(self.boot_us + host + host * self.drift_ppm / 1000000)
+
+
+class Follower:
+    """The firmware's beacon handling (VideoWall::handleBeacon)."""
+
+    def __init__(self):
+        self.offset_us = 0
+        self.samples = []
+        self.message_hash = 0
+        self.message_origin = 0
+        self.beacons = 0
+
+    def handle(self, data, local_us):
+        magic, version, tiles, seed, frame, into, message_hash, origin = BEACON.unpack(data)
+        sample = frame * FRAME_US + into - local_us
+        if self.samples and abs(sample - self.offset_us) > RESYNC_US:
+            self.samples = []
+        self.samples = (self.samples + [sample])[-WINDOW:]
+        self.offset_us = max(self.samples)
+        self.message_hash = message_hash
+        self.message_origin = origin
+        self.beacons += 1
+
+
+def open_socket(interface):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    if hasattr(socket, "SO_REUSEPORT"):
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+    sock.bind((GROUP, PORT))
+    membership = socket.inet_aton(GROUP) + socket.inet_aton(interface)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, membership)
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_IF, socket.inet_aton(interface))
+    sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_LOOP, 1)
+    return sock
+
+
+def command_tile(options):
+    """One simulated clock; prints its samples as JSON when the run is over."""
+    rng = random.Random(options.index * 7919 + options.run_seed)
+    clock = TileClock(rng.randrange(1, 600) * 1000000, rng.uniform(-1, 1) * options.drift_ppm)
+    leader = options.index == 0
+    follower = None if leader else Follower()
+    sock = open_socket("127.0.0.1")
+    sock.setblocking(False)
+    canvas = options.tiles * TILE_WIDTH
+    step_us = options.scroll_ms * 1000
+
+    def wall_us(host):
+        return clock.local_us(host) + (0 if leader else follower.offset_us)
+
+    # The message reaches followers a little later than the leader
+    message_at = options.epoch + int(options.message_at * 1000000)
+    if not leader:
+        message_at += int(rng.uniform(0, options.spread_ms) * 1000)
+    origin = None
+    adopted_at = None
+
+    end = options.epoch + int(options.seconds * 1000000)
+    next_beacon = options.epoch
+    samples = []
+    while True:
+        host = host_us()
+        if host >= end:
+            break
+
+        if leader and host >= next_beacon:
+            now = wall_us(host)
+            message = (MESSAGE_HASH, origin) if origin is not None else (0, 0)
+            sock.sendto(BEACON.pack(b"WB", VERSION, options.tiles, options.run_seed,
+                                    now // FRAME_US, now % FRAME_US, *message), (GROUP, PORT))
+            next_beacon += int(BEACON_S * 1000000)
+        elif not leader:
+            while True:
+                try:
+                    data = sock.recv(64)
+                except BlockingIOError:
+                    break
+                if len(data) == BEACON.size and rng.random() >= options.loss:
+                    # Stamped when the loop pass gets to it, not when it arrived
+                    follower.handle(data, clock.local_us(host_us()))
+
+        if origin is None and host >= message_at:
+            origin = wall_us(host) // FRAME_US + 1  # Starts on the next frame
+        if (not leader and origin is not None and adopted_at is None and
+                follower.message_hash == MESSAGE_HASH):
+            origin = follower.message_origin
+            adopted_at = host
+
+        scroll = None
+        if origin is not None:
+            elapsed = wall_us(host) - origin * FRAME_US
+            scroll = canvas - max(0, elapsed) // step_us
+        samples.append((host, wall_us(host), scroll, WINDOW if leader else follower.beacons))
+
+        # One simulated loop pass: render time plus whatever else the loop did
+        time.sleep(rng.uniform(SAMPLE_S, SAMPLE_S + options.loop_ms / 1000.0))
+
+    json.dump({"index": options.index, "boot_us": clock.boot_us, "drift_ppm": clock.drift_ppm,
+               "origin": origin, "adopted_at": adopted_at, "samples": samples}, sys.stdout)
+    return 0
+
+
+def leader_at(leader, host, canvas, step_us):
+    """The leader's wall time and marquee position at any host instant."""
+    samples = leader["samples"]
+    lo, hi = 0, len(samples) - 1
+    while hi - lo > 1:
+        mid = (lo + hi) // 2
+        if samples[mid][0] <= host:
+            lo = mid
+        else:
+            hi = mid
+    a, b = samples[lo], samples[hi]
+    span = max(1, b[0] - a[0])
+    wall = a[1] + (b[1] - a[1]) * (host - a[0]) / span
+    if a[2] is None:
+        return wall, None
+    return wall, canvas - max(0, int(wall) - leader["origin"] * FRAME_US) // step_us
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))] if ordered else 0
+
+
+def command_simulate(options):
+    epoch = host_us() + 500000  # Time for every process to start
+    run_seed = random.randrange(1 << 32) if options.seed is None else options.seed
+    processes = []
+    for index in range(options.tiles):
+        args = [sys.executable, __file__, "tile", "--index", str(index), "--epoch", str(epoch),
+                "--run-seed", str(run_seed)]
+        for name in ("tiles", "seconds", "drift_ppm", "loop_ms", "loss", "spread_ms",
+                     "message_at", "scroll_ms"):
+            args += ["--" + name.replace("_", "-"), str(getattr(options, name))]
+        processes.append(subprocess.Popen(args, stdout=subprocess.PIPE))
+    results = [json.loads(process.communicate()[0]) for process in processes]
+    leader = results[0]
+
+    print("%d tiles, %.0f s, drift up to %g ppm, loop passes up to %g ms, %g%% beacon loss"
+          % (options.tiles, options.seconds, options.drift_ppm, options.loop_ms,
+             options.loss * 100))
+    print("frame errors in frames; 'first' is before a follower had %d beacons" % WINDOW)
+    worst = 0.0
+    for tile in results[1:]:
+        first_errors = []
+        frame_errors = []
+        scroll_errors = []
+        for host, wall, scroll, beacons in tile["samples"]:
+            if not beacons or host <= leader["samples"][0][0] or host >= leader["samples"][-1][0]:
+                continue
+            leader_wall, leader_scroll = leader_at(leader, host, options.tiles * TILE_WIDTH,
+                                                   options.scroll_ms * 1000)
+            error = abs(wall - leader_wall) / FRAME_US
+            (frame_errors if beacons >= WINDOW else first_errors).append(error)
+            if tile["adopted_at"] and host > tile["adopted_at"] and leader_scroll is not None:
+                scroll_errors.append(abs(scroll - leader_scroll))
+        worst = max([worst] + frame_errors)
+        print("tile %d: boot %+4d s, %+6.1f ppm  first max %.3f  then p50 %.3f  p99 %.3f  "
+              "max %.3f  marquee max %s px" % (
+                  tile["index"], (tile["boot_us"] - leader["boot_us"]) // 1000000,
+                  tile["drift_ppm"], max(first_errors or [0]), percentile(frame_errors, 0.5),
+                  percentile(frame_errors, 0.99), max(frame_errors or [0]),
+                  max(scroll_errors) if scroll_errors else "-"))
+    print("worst frame error with a full window: %.3f frames (%.2f ms) -> %s"
+          % (worst, worst * FRAME_US / 1000, "PASS" if worst < 1 else "FAIL"))
+    return 0 if worst < 1 else 1
+
+
+def command_watch(options):
+    sock = open_socket(options.interface)
+    last = None
+    print("Waiting for beacons on %s:%d" % (GROUP, PORT))
+    try:
+        while True:
+            data, address = sock.recvfrom(64)
+            now = time.monotonic()
+            if len(data) != BEACON.size:
+                continue
+            magic, version, tiles, seed, frame, into, message_hash, origin = BEACON.unpack(data)
+            if magic != b"WB":
+                continue
+            interval = "%6.1f ms" % ((now - last) * 1000) if last else "       -"
+            last = now
+            print("%s  %d tiles  seed %08x  frame %9d +%5d us  %s  message %08x from %d"
+                  % (address[0], tiles, seed, frame, into, interval, message_hash, origin))
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+def add_run_options(parser):
+    parser.add_argument("--tiles", type=int, default=4)
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--drift-ppm", type=float, default=50, help="largest crystal error")
+    parser.add_argument("--loop-ms", type=float, default=20, help="longest extra loop pass")
+    parser.add_argument("--loss", type=float, default=0.05, help="share of beacons lost")
+    parser.add_argument("--spread-ms", type=float, default=80,
+                        help="how much later a follower may get the message")
+    parser.add_argument("--message-at", type=float, default=3, help="seconds into the run")
+    parser.add_argument("--scroll-ms", type=int, default=25, help="ms per marquee step")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    simulate = commands.add_parser("simulate", help="simulate a wall on loopback")
+    add_run_options(simulate)
+    simulate.add_argument("--seed", type=int, default=None, help="repeat a run")
+
+    tile = commands.add_parser("tile", help="one simulated tile (started by simulate)")
+    add_run_options(tile)
+    tile.add_argument("--index", type=int, required=True)
+    tile.add_argument("--epoch", type=int, required=True)
+    tile.add_argument("--run-seed", type=int, required=True)
+
+    watch = commands.add_parser("watch", help="print the beacons of a real wall")
+    watch.add_argument("--interface", default="0.0.0.0", help="local address to listen on")
+
+    options = parser.parse_args()
+    handlers = {"simulate": command_simulate, "tile": command_tile, "watch": command_watch}
+    return handlers[options.command](options)
+
+
+if __name__ == "__main__":
+    sys.exit(main())